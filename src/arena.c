@@ -0,0 +1,130 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file arena.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "dbg.h"
+
+struct arena_chunk {
+	struct arena_chunk *next; //!< Previous, now full chunk.
+	size_t              size; //!< Usable size of @ref arena_chunk::data.
+	max_align_t         data[];
+};
+
+/**
+ * @brief Arena selected with @ref arena_use() on this thread.
+ */
+static _Thread_local struct arena *arena_cur;
+
+/**
+ * @brief Round an allocation size up to the arena alignment.
+ */
+static const_inline size_t
+arena_round (size_t size)
+{
+	return (size + (sizeof(max_align_t) - 1U))
+	       & ~(sizeof(max_align_t) - 1U);
+}
+
+/**
+ * @brief Allocate a new chunk and make it current.
+ */
+nonnull_in()
+static void *
+arena_grow (struct arena *a,
+            size_t        size)
+{
+	size_t n = a->head ? a->total : a->hint;
+	if (n < ARENA_CHUNK_MIN)
+		n = ARENA_CHUNK_MIN;
+	if (n < size)
+		n = size;
+
+	if (n > SIZE_MAX - sizeof(struct arena_chunk)) {
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	struct arena_chunk *c = malloc(sizeof *c + n);
+	if (!c)
+		return nullptr;
+
+	pr_dbg("%zu byte chunk", n);
+	c->next = a->head;
+	c->size = n;
+	a->head = c;
+	a->used = size;
+	a->total += n;
+	return c->data;
+}
+
+void *
+arena_alloc (struct arena *a,
+             size_t        size)
+{
+	if (size > SIZE_MAX - sizeof(max_align_t)) {
+		errno = ENOMEM;
+		return nullptr;
+	}
+
+	size = arena_round(size ? size : 1U);
+	struct arena_chunk *c = a->head;
+	if (!c || c->size - a->used < size)
+		return arena_grow(a, size);
+
+	void *p = (char *)c->data + a->used;
+	a->used += size;
+	return p;
+}
+
+void
+arena_reset (struct arena *a)
+{
+	struct arena_chunk *c = a->head;
+	if (c && c->next) {
+		a->hint = a->total - (c->size - a->used);
+		arena_fini(a);
+	}
+	a->used = 0;
+}
+
+void
+arena_fini (struct arena *a)
+{
+	if (a) {
+		for (struct arena_chunk *c = a->head, *n; c; c = n) {
+			n = c->next;
+			free(c);
+		}
+		a->head = nullptr;
+		a->used = 0;
+		a->total = 0;
+	}
+}
+
+struct arena *
+arena_use (struct arena *a)
+{
+	struct arena *prev = arena_cur;
+	arena_cur = a;
+	return prev;
+}
+
+void *
+arena_hook_malloc (size_t size)
+{
+	struct arena *a = arena_cur;
+	return a ? arena_alloc(a, size) : malloc(size);
+}
+
+void
+arena_hook_free (void *ptr)
+{
+	if (!arena_cur)
+		free(ptr);
+}
@@ -0,0 +1,101 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file arena.h
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_ARENA_H_
+#define LIBCANTH_SRC_ARENA_H_
+
+#include <stddef.h>
+
+#include "util.h"
+
+/**
+ * @brief Size of the first chunk an arena allocates.
+ */
+#define ARENA_CHUNK_MIN (64U << 10U)
+
+struct arena_chunk;
+
+/**
+ * @brief Bump allocator for objects that die together.
+ *
+ * Allocations are carved out of large chunks and never freed one by
+ * one. Everything is dropped at once with @ref arena_reset(), which
+ * keeps enough memory around for the next round to fit in one chunk.
+ *
+ * Zero-initialize before first use.
+ */
+struct arena {
+	struct arena_chunk *head;  //!< Current chunk, linked to older ones.
+	size_t              used;  //!< Bytes used in the current chunk.
+	size_t              total; //!< Combined size of all chunks.
+	size_t              hint;  //!< Bytes used before the last reset.
+};
+
+/**
+ * @brief Allocate from an arena.
+ *
+ * @param[in,out] a    Arena.
+ * @param[in]     size Allocation size.
+ * @return Pointer to at least @p size bytes aligned for any type, or
+ *         `nullptr` with `errno` set if a new chunk couldn't be had.
+ */
+extern void *
+arena_alloc (struct arena *a,
+             size_t        size) nonnull_in(1);
+
+/**
+ * @brief Release every allocation made from an arena.
+ *
+ * If the last round spilled over into more than one chunk, the chunks
+ * are freed and the next allocation gets one chunk big enough for all
+ * that was used in them. Otherwise the single chunk is simply rewound.
+ */
+extern void
+arena_reset (struct arena *a) nonnull_in();
+
+/**
+ * @brief Release the memory of an arena.
+ */
+extern void
+arena_fini (struct arena *a);
+
+/**
+ * @brief Route @ref arena_hook_malloc() to an arena on this thread.
+ *
+ * @param[in] a Arena, or `nullptr` to fall back to `malloc()`.
+ * @return The previous arena of this thread.
+ */
+extern struct arena *
+arena_use (struct arena *a);
+
+/**
+ * @brief `malloc()` replacement for library allocator hooks.
+ *
+ * Allocates from the arena selected with @ref arena_use(), or with
+ * `malloc()` if none is. The signature matches the `malloc_fn` member
+ * of `cJSON_Hooks`, so cJSON can build its trees in an arena:
+ *
+ * @code
+ * cJSON_InitHooks(&(cJSON_Hooks){.malloc_fn = arena_hook_malloc,
+ *                                .free_fn   = arena_hook_free});
+ * @endcode
+ *
+ * `cJSON_Delete()` is then unnecessary for trees parsed while an arena
+ * was selected. Call @ref arena_reset() instead.
+ */
+extern void *
+arena_hook_malloc (size_t size);
+
+/**
+ * @brief `free()` replacement for library allocator hooks.
+ *
+ * Does nothing while an arena is selected with @ref arena_use(), and
+ * calls `free()` otherwise. Memory must be released with the same
+ * selection it was allocated with.
+ */
+extern void
+arena_hook_free (void *ptr);
+
+#endif /* LIBCANTH_SRC_ARENA_H_ */
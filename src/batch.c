@@ -0,0 +1,690 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file batch.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "fstream.h"
+#include "mono.h"
+
+/**
+ * @brief API version sent unless another is given.
+ */
+#define BATCH_VERSION "2023-06-01"
+
+/**
+ * @brief Path of the batch collection.
+ */
+#define BATCH_PATH "/v1/messages/batches"
+
+/**
+ * @brief Size of the buffer holding the generated header lines.
+ */
+#define BATCH_HEADERS_SIZE 512U
+
+JDECODE_FUNC(batch_counts, BATCH_COUNT_FIELDS)
+JDECODE_FUNC(batch, BATCH_FIELDS)
+JDECODE_FUNC(batch_outcome, BATCH_OUTCOME_FIELDS)
+JDECODE_FUNC(batch_result, BATCH_RESULT_FIELDS)
+
+/**
+ * @brief Parameters of a request, either serialized or a prompt.
+ */
+struct batch_params {
+	char const *raw;        //!< Serialized parameters, or `nullptr`.
+	size_t      rlen;       //!< Length of raw.
+	char const *model;      //!< Model of a prompt.
+	int64_t     max_tokens; //!< Output token limit of a prompt.
+	char const *text;       //!< Prompt text.
+	size_t      tlen;       //!< Length of text.
+};
+
+nonnull_in()
+static bool
+batch_id_valid (char const *id,
+                size_t      n)
+{
+	if (!n || n > BATCH_ID_MAX)
+		return false;
+
+	for (size_t i = 0; i < n; ++i) {
+		uint8_t c = (uint8_t)id[i];
+		if ((unsigned)((c | 0x20U) - 'a') >= 26U &&
+		    (unsigned)(c - '0') >= 10U && c != '_' && c != '-')
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Write one element of the `requests` array.
+ */
+nonnull_in()
+static int
+batch_entry (struct jwriter            *w,
+             char const                *id,
+             size_t                     idlen,
+             struct batch_params const *p)
+{
+	(void)jwriter_object_begin(w);
+	(void)jwriter_key(w, "custom_id", 9U);
+	(void)jwriter_string_clean(w, id, idlen);
+	(void)jwriter_key(w, "params", 6U);
+
+	if (p->raw) {
+		(void)jwriter_raw(w, p->raw, p->rlen);
+	} else {
+		(void)jwriter_object_begin(w);
+		(void)jwriter_key(w, "model", 5U);
+		(void)jwriter_string(w, p->model, strlen(p->model));
+		(void)jwriter_key(w, "max_tokens", 10U);
+		(void)jwriter_int(w, p->max_tokens);
+		(void)jwriter_key(w, "messages", 8U);
+		(void)jwriter_array_begin(w);
+		(void)jwriter_object_begin(w);
+		(void)jwriter_key(w, "role", 4U);
+		(void)jwriter_string_clean(w, "user", 4U);
+		(void)jwriter_key(w, "content", 7U);
+		(void)jwriter_string(w, p->text, p->tlen);
+		(void)jwriter_object_end(w);
+		(void)jwriter_array_end(w);
+		(void)jwriter_object_end(w);
+	}
+
+	return jwriter_object_end(w);
+}
+
+nonnull_in()
+static int
+batch_start (struct batch_writer *b)
+{
+	char path[PATH_MAX];
+	int e = batch_path(path, sizeof path, b->prefix, b->files);
+	if (!e)
+		e = file_out_open(&b->out, path, file_out_atomic);
+	if (e) {
+		file_out_fini(&b->out);
+		return e;
+	}
+
+	jwriter_init_file(&b->w, &b->out, 0);
+	(void)jwriter_object_begin(&b->w);
+	(void)jwriter_key(&b->w, "requests", 8U);
+	b->open = true;
+	b->count = 0;
+	return jwriter_array_begin(&b->w);
+}
+
+nonnull_in()
+static int
+batch_finish (struct batch_writer *b)
+{
+	(void)jwriter_array_end(&b->w);
+	(void)jwriter_object_end(&b->w);
+	int e = jwriter_end(&b->w);
+	if (!e)
+		e = file_out_commit(&b->out);
+	file_out_fini(&b->out);
+
+	b->open = false;
+	b->files += !e;
+	return e;
+}
+
+nonnull_in()
+static int
+batch_add (struct batch_writer       *b,
+           char const                *id,
+           size_t                     idlen,
+           struct batch_params const *p)
+{
+	if (!batch_id_valid(id, idlen))
+		return EINVAL;
+
+	struct jwriter z;
+	jwriter_size(&z);
+	(void)batch_entry(&z, id, idlen, p);
+	int e = jwriter_end(&z);
+	if (e)
+		return e;
+
+	/* The entry goes between `{"requests":[` and `]}`,
+	 * after a comma unless it's the first one. */
+	size_t n = jwriter_length(&z);
+	if (n > b->lim.max_bytes - 15U)
+		return EMSGSIZE;
+
+	if (b->open && (b->count == b->lim.max_requests ||
+	                jwriter_length(&b->w) + n + 3U > b->lim.max_bytes)) {
+		e = batch_finish(b);
+		if (e)
+			return e;
+	}
+
+	if (!b->open) {
+		e = batch_start(b);
+		if (e)
+			return e;
+	}
+
+	e = batch_entry(&b->w, id, idlen, p);
+	if (!e) {
+		++b->count;
+		++b->total;
+	}
+	return e;
+}
+
+int
+batch_writer_open (struct batch_writer       *b,
+                   char const                *prefix,
+                   struct batch_limits const *lim)
+{
+	*b = (struct batch_writer){.lim = lim ? *lim : (struct batch_limits){0}};
+
+	if (!b->lim.max_requests)
+		b->lim.max_requests = BATCH_MAX_REQUESTS;
+	if (!b->lim.max_bytes)
+		b->lim.max_bytes = BATCH_MAX_BYTES;
+	if (b->lim.max_bytes < 16U)
+		return EINVAL;
+
+	b->prefix = strdup(prefix);
+	return b->prefix ? 0 : errno;
+}
+
+int
+batch_writer_add (struct batch_writer *b,
+                  char const          *id,
+                  size_t               idlen,
+                  char const          *params,
+                  size_t               plen)
+{
+	return batch_add(b, id, idlen, &(struct batch_params){
+		.raw  = params,
+		.rlen = plen,
+	});
+}
+
+int
+batch_writer_prompt (struct batch_writer *b,
+                     char const          *id,
+                     size_t               idlen,
+                     char const          *model,
+                     int64_t              max_tokens,
+                     char const          *text,
+                     size_t               tlen)
+{
+	return batch_add(b, id, idlen, &(struct batch_params){
+		.model      = model,
+		.max_tokens = max_tokens,
+		.text       = text,
+		.tlen       = tlen,
+	});
+}
+
+int
+batch_writer_close (struct batch_writer *b)
+{
+	return b->open ? batch_finish(b) : 0;
+}
+
+void
+batch_writer_fini (struct batch_writer *b)
+{
+	if (!b)
+		return;
+
+	if (b->open) {
+		(void)jwriter_end(&b->w);
+		file_out_fini(&b->out);
+		b->open = false;
+	}
+
+	free(b->prefix);
+	b->prefix = nullptr;
+}
+
+int
+batch_path (char       *dst,
+            size_t      size,
+            char const *prefix,
+            uint32_t    i)
+{
+	int n = snprintf(dst, size, "%s.%" PRIu32 ".json", prefix, i);
+	return n < 0 || (size_t)n >= size ? ENAMETOOLONG : 0;
+}
+
+/**
+ * @brief Generate the header lines of an API request.
+ *
+ * @param[in]  api Endpoint.
+ * @param[out] buf Storage of the lines.
+ * @param[out] h   Header lines, views of @p buf.
+ * @return 0 on success, `E2BIG` if the lines don't fit in @p buf.
+ */
+nonnull_in()
+static int
+batch_headers (struct batch_api const *api,
+               char                    buf[static BATCH_HEADERS_SIZE],
+               dstr                    h[static 3])
+{
+	char const *v = api->version ? api->version : BATCH_VERSION;
+	int a = snprintf(buf, BATCH_HEADERS_SIZE, "x-api-key: %s", api->key);
+	if (a < 0 || (size_t)a >= BATCH_HEADERS_SIZE / 2U)
+		return E2BIG;
+
+	char *s = &buf[a + 1];
+	int b = snprintf(s, BATCH_HEADERS_SIZE - (size_t)a - 1U,
+	                 "anthropic-version: %s", v);
+	if (b < 0 || (size_t)b >= BATCH_HEADERS_SIZE - (size_t)a - 1U)
+		return E2BIG;
+
+	h[0] = make_dstr_view_from_decay(buf, (size_t)a);
+	h[1] = make_dstr_view_from_decay(s, (size_t)b);
+	h[2] = make_dstr_view("content-type: application/json");
+	return 0;
+}
+
+/**
+ * @brief Make an API request and decode the batch object it returns.
+ *
+ * @return 0 on success, `EAGAIN` if the server asked to be retried
+ *         later, otherwise an error code.
+ */
+nonnull_in(1,2,3,4,7,8)
+static int
+batch_call (struct http_pool       *p,
+            struct batch_api const *api,
+            char const             *method,
+            char const             *path,
+            struct iovec const     *body,
+            size_t                  nbody,
+            struct jtape           *t,
+            struct batch           *v)
+{
+	char buf[BATCH_HEADERS_SIZE];
+	dstr h[3];
+	int e = batch_headers(api, buf, h);
+	if (e)
+		return e;
+
+	struct http_request req = {
+		.method   = method,
+		.host     = api->host,
+		.port     = api->port,
+		.path     = path,
+		.headers  = h,
+		.nheaders = nbody ? 3U : 2U,
+		.body     = body,
+		.nbody    = nbody,
+	};
+	struct http_response res;
+
+	e = http_request(p, &req, &res);
+	if (!e && (res.status == 429 || res.status >= 500))
+		e = EAGAIN;
+	else if (!e && res.status != 200)
+		e = EPROTO;
+	if (!e)
+		e = jtape_parse(t, dstr_get(&res.body), res.body.len);
+	if (!e)
+		e = batch_decode(v, t, 1U);
+	if (!e && !v->has.id)
+		e = EPROTO;
+
+	http_response_fini(&res);
+	return e;
+}
+
+nonnull_in()
+static int
+batch_copy (dstr       *dst,
+            char const *s,
+            size_t      n)
+{
+	int e = 0;
+	return dstr_set(dst, s, n, &e) ? 0 : e;
+}
+
+int
+batch_create (struct http_pool       *p,
+              struct batch_api const *api,
+              char const             *path,
+              dstr                   *id)
+{
+	dstr_init(id);
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return errno;
+
+	struct stat st;
+	void *m = MAP_FAILED;
+	int e = fstat(fd, &st) ? errno : !st.st_size ? EINVAL : 0;
+	if (!e) {
+		m = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+		         fd, 0);
+		if (m == MAP_FAILED)
+			e = errno;
+	}
+	(void)close(fd);
+	if (e)
+		return e;
+
+	(void)madvise(m, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+	struct iovec body = {m, (size_t)st.st_size};
+	struct jtape t = {0};
+	struct batch b;
+	e = batch_call(p, api, "POST", BATCH_PATH, &body, 1U, &t, &b);
+	(void)munmap(m, (size_t)st.st_size);
+
+	if (!e)
+		e = batch_copy(id, dstr_get(&b.m_id), b.m_id.len);
+
+	jtape_fini(&t);
+	return e;
+}
+
+/**
+ * @brief Find the path of a URL.
+ */
+nonnull_in()
+static int
+batch_url_path (dstr const *url,
+                dstr       *path)
+{
+	char const *s = dstr_get(url);
+	size_t n = url->len, i = 0;
+
+	for (size_t k = 0; k + 3U <= n && s[k] != '/'; ++k) {
+		if (!__builtin_memcmp(&s[k], "://", 3U)) {
+			for (i = k + 3U; i < n && s[i] != '/'; ++i);
+			break;
+		}
+	}
+	if (i == n || s[i] != '/')
+		return EPROTO;
+
+	return batch_copy(path, &s[i], n - i);
+}
+
+int
+batch_wait (struct http_pool        *p,
+            struct batch_api const  *api,
+            dstr const              *id,
+            struct batch_poll const *poll,
+            dstr                    *results)
+{
+	struct batch_poll sched = poll ? *poll : (struct batch_poll){0};
+	if (!sched.initial_ms)
+		sched.initial_ms = BATCH_POLL_MS;
+	if (!sched.max_ms)
+		sched.max_ms = BATCH_POLL_MAX_MS;
+	if (!sched.timeout_ms)
+		sched.timeout_ms = BATCH_WAIT_MS;
+
+	dstr_init(results);
+
+	char path[PATH_MAX];
+	int n = snprintf(path, sizeof path, BATCH_PATH "/%.*s",
+	                 (int)id->len, dstr_get(id));
+	if (n < 0 || (size_t)n >= sizeof path)
+		return ENAMETOOLONG;
+
+	struct jtape t = {0};
+	uint64_t end = mono_ms() + sched.timeout_ms;
+	uint64_t delay = sched.initial_ms;
+	int e;
+
+	for (;;) {
+		struct batch b;
+		e = batch_call(p, api, "GET", path, nullptr, 0, &t, &b);
+		if (!e && dstr_eq(&b.m_processing_status, "ended", 5U)) {
+			e = b.has.results_url
+			    ? batch_url_path(&b.m_results_url, results)
+			    : EPROTO;
+			break;
+		}
+		if (e && e != EAGAIN)
+			break;
+
+		uint64_t now = mono_ms();
+		if (now >= end) {
+			e = ETIMEDOUT;
+			break;
+		}
+
+		mono_sleep_ms(delay < end - now ? delay : end - now);
+		delay = delay * 2U < sched.max_ms ? delay * 2U : sched.max_ms;
+	}
+
+	jtape_fini(&t);
+	return e;
+}
+
+/**
+ * @brief State of a results download.
+ */
+struct batch_fetch {
+	pthread_mutex_t lock; //!< Guards done.
+	pthread_cond_t  cond; //!< Signaled when done is set.
+	struct file_out out;  //!< Results file.
+	int             e;    //!< First error.
+	bool            done; //!< Download finished.
+};
+
+static void
+batch_fetch_head (void                    *ctx,
+                  struct http_frame const *f)
+{
+	struct batch_fetch *x = ctx;
+	if (f->status != 200)
+		x->e = EPROTO;
+}
+
+static void
+batch_fetch_data (void       *ctx,
+                  void const *s,
+                  size_t      n)
+{
+	struct batch_fetch *x = ctx;
+	if (!x->e)
+		x->e = file_out_write(&x->out, s, n);
+}
+
+static void
+batch_fetch_done (void *ctx,
+                  int   e,
+                  int   status)
+{
+	struct batch_fetch *x = ctx;
+	(void)status;
+
+	(void)pthread_mutex_lock(&x->lock);
+	if (!x->e)
+		x->e = e;
+	x->done = true;
+	(void)pthread_cond_signal(&x->cond);
+	(void)pthread_mutex_unlock(&x->lock);
+}
+
+static struct hloop_ops const batch_fetch_ops = {
+	.head = batch_fetch_head,
+	.data = batch_fetch_data,
+	.done = batch_fetch_done,
+};
+
+int
+batch_fetch (struct hloop           *l,
+             struct batch_api const *api,
+             dstr const             *results,
+             char const             *path)
+{
+	char buf[BATCH_HEADERS_SIZE];
+	dstr h[3];
+	int e = batch_headers(api, buf, h);
+	if (e)
+		return e;
+
+	char *target = strndup(dstr_get(results), results->len);
+	if (!target)
+		return errno;
+
+	struct batch_fetch x = {
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.cond = PTHREAD_COND_INITIALIZER,
+	};
+	e = file_out_open(&x.out, path, file_out_atomic);
+	if (!e) {
+		struct http_request req = {
+			.method   = "GET",
+			.host     = api->host,
+			.port     = api->port,
+			.path     = target,
+			.headers  = h,
+			.nheaders = 2U,
+		};
+		e = hloop_submit(l, &req, &batch_fetch_ops, &x);
+	}
+
+	if (!e) {
+		(void)pthread_mutex_lock(&x.lock);
+		while (!x.done)
+			(void)pthread_cond_wait(&x.cond, &x.lock);
+		(void)pthread_mutex_unlock(&x.lock);
+		e = x.e;
+	}
+
+	if (!e)
+		e = file_out_commit(&x.out);
+	file_out_fini(&x.out);
+	(void)pthread_cond_destroy(&x.cond);
+	(void)pthread_mutex_destroy(&x.lock);
+	free(target);
+	return e;
+}
+
+/**
+ * @brief Parse a result line and hand it to the callback.
+ */
+static int
+batch_line (struct jtape  *t,
+            uint8_t const *s,
+            size_t         n,
+            int          (*fn)(void                      *ctx,
+                               struct batch_result const *r,
+                               struct jtape const        *t),
+            void          *ctx)
+{
+	if (n && s[n - 1U] == '\r')
+		--n;
+	if (!n)
+		return 0;
+
+	int e = jtape_parse(t, s, n);
+	if (e)
+		return e;
+
+	struct batch_result r;
+	e = batch_result_decode(&r, t, 1U);
+	if (!e && (!r.has.custom_id || !r.has.result || !r.m_result.has.type))
+		e = EPROTO;
+	return e ? e : fn(ctx, &r, t);
+}
+
+/**
+ * @brief Append to the line cut off by the end of a chunk.
+ */
+nonnull_in()
+static int
+batch_carry (uint8_t       **buf,
+             size_t         *len,
+             size_t         *cap,
+             uint8_t const  *s,
+             size_t          n)
+{
+	if (n > BATCH_LINE_MAX - *len)
+		return EMSGSIZE;
+
+	if (*len + n > *cap) {
+		size_t c = *cap ? *cap : 4096U;
+		while (c < *len + n)
+			c *= 2U;
+		uint8_t *b = realloc(*buf, c);
+		if (!b)
+			return errno;
+		*buf = b;
+		*cap = c;
+	}
+
+	__builtin_memcpy(&(*buf)[*len], s, n);
+	*len += n;
+	return 0;
+}
+
+int
+batch_results (char const *path,
+               int       (*fn)(void                      *ctx,
+                               struct batch_result const *r,
+                               struct jtape const        *t),
+               void       *ctx)
+{
+	struct fstream s;
+	struct jtape t = {0};
+	uint8_t *carry = nullptr;
+	size_t clen = 0, ccap = 0;
+
+	int e = fstream_open(&s, path);
+	while (!e) {
+		unsigned char const *c;
+		size_t n;
+		e = fstream_next(&s, &c, &n);
+		if (e || !n)
+			break;
+
+		size_t i = 0;
+		for (;;) {
+			uint8_t const *nl = __builtin_memchr(&c[i], '\n', n - i);
+			if (!nl) {
+				e = batch_carry(&carry, &clen, &ccap, &c[i], n - i);
+				break;
+			}
+
+			size_t end = (size_t)(nl - c);
+			if (clen) {
+				e = batch_carry(&carry, &clen, &ccap, &c[i], end - i);
+				if (!e)
+					e = batch_line(&t, carry, clen, fn, ctx);
+				clen = 0;
+			} else {
+				e = batch_line(&t, &c[i], end - i, fn, ctx);
+			}
+
+			i = end + 1U;
+			if (e || i == n)
+				break;
+		}
+	}
+
+	if (!e && clen)
+		e = batch_line(&t, carry, clen, fn, ctx);
+
+	free(carry);
+	jtape_fini(&t);
+	fstream_fini(&s);
+	return e;
+}
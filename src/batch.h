@@ -0,0 +1,334 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file batch.h
+ *
+ * @brief Message Batches pipeline.
+ *
+ * Requests are written to batch files as they're produced, a new file
+ * being started whenever the next request would break the count or
+ * size limit of a batch. Each file is then submitted as one batch,
+ * polled until it has ended, and its results downloaded to a file and
+ * handed back to the caller one line at a time by custom ID. Nothing
+ * along the way holds more than one request or one result in memory.
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_BATCH_H_
+#define LIBCANTH_SRC_BATCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dstr.h"
+#include "file.h"
+#include "hloop.h"
+#include "http.h"
+#include "jdecode.h"
+#include "jtape.h"
+#include "jwriter.h"
+#include "util.h"
+
+/**
+ * @brief Most requests the API accepts in one batch.
+ */
+#define BATCH_MAX_REQUESTS 100000U
+
+/**
+ * @brief Largest batch the API accepts, in bytes.
+ */
+#define BATCH_MAX_BYTES (256U << 20U)
+
+/**
+ * @brief Longest custom ID the API accepts.
+ */
+#define BATCH_ID_MAX 64U
+
+/**
+ * @brief Longest result line that is parsed.
+ */
+#define BATCH_LINE_MAX (64U << 20U)
+
+/**
+ * @brief Default first and longest poll interval.
+ */
+#define BATCH_POLL_MS     1000U
+#define BATCH_POLL_MAX_MS 60000U
+
+/**
+ * @brief Default time to wait for a batch to end.
+ */
+#define BATCH_WAIT_MS (24U * 3600U * 1000U)
+
+/**
+ * @brief Counts of a batch by result type.
+ */
+#define BATCH_COUNT_FIELDS(X)                                             \
+	X(number, processing, "processing")                               \
+	X(number, succeeded,  "succeeded")                                \
+	X(number, errored,    "errored")                                  \
+	X(number, canceled,   "canceled")                                 \
+	X(number, expired,    "expired")
+
+/**
+ * @brief Message batch object.
+ */
+#define BATCH_FIELDS(X)                                                   \
+	X(string, id,                "id")                                \
+	X(string, type,              "type")                              \
+	X(string, processing_status, "processing_status")                 \
+	X(string, results_url,       "results_url")                       \
+	X(object, request_counts,    "request_counts", batch_counts)
+
+/**
+ * @brief Result of one request. Depending on the type, which is one of
+ *        `succeeded`, `errored`, `canceled`, and `expired`, there is a
+ *        message or an error object.
+ */
+#define BATCH_OUTCOME_FIELDS(X)                                           \
+	X(string, type,    "type")                                        \
+	X(value,  message, "message")                                     \
+	X(value,  error,   "error")
+
+/**
+ * @brief Line of a results file.
+ */
+#define BATCH_RESULT_FIELDS(X)                                            \
+	X(string, custom_id, "custom_id")                                 \
+	X(object, result,    "result", batch_outcome)
+
+JDECODE_STRUCT(batch_counts, BATCH_COUNT_FIELDS);
+JDECODE_STRUCT(batch, BATCH_FIELDS);
+JDECODE_STRUCT(batch_outcome, BATCH_OUTCOME_FIELDS);
+JDECODE_STRUCT(batch_result, BATCH_RESULT_FIELDS);
+
+JDECODE_PROTO(batch_counts);
+JDECODE_PROTO(batch);
+JDECODE_PROTO(batch_outcome);
+JDECODE_PROTO(batch_result);
+
+/**
+ * @brief Batch limits. Zero fields take the API limits.
+ */
+struct batch_limits {
+	uint32_t max_requests; //!< Requests per batch.
+	uint32_t max_bytes;    //!< Bytes per batch.
+};
+
+/**
+ * @brief Batch file writer.
+ *
+ * Files are named `PREFIX.N.json` with N counting from 0. Each holds a
+ * complete request body, `{"requests":[...]}`, and is written under a
+ * temporary name until it is full or the writer is closed.
+ */
+struct batch_writer {
+	struct file_out     out;    //!< Current file.
+	struct jwriter      w;      //!< Writer of the current file.
+	struct batch_limits lim;    //!< Limits.
+	char               *prefix; //!< File name prefix.
+	size_t              total;  //!< Requests written.
+	uint32_t            count;  //!< Requests in the current file.
+	uint32_t            files;  //!< Files completed.
+	bool                open;   //!< A file is being written.
+};
+
+/**
+ * @brief Start writing batch files.
+ *
+ * @param[out] b      Writer. Always safe to pass to
+ *                    @ref batch_writer_fini() afterwards.
+ * @param[in]  prefix File name prefix, such as `out/batch`.
+ * @param[in]  lim    Limits, or `NULL` for those of the API.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+batch_writer_open (struct batch_writer       *b,
+                   char const                *prefix,
+                   struct batch_limits const *lim) nonnull_in(1,2);
+
+/**
+ * @brief Add a request.
+ *
+ * The request is sized with a counting writer first, so a file is
+ * completed exactly when the request wouldn't fit in it.
+ *
+ * @param[in,out] b      Writer.
+ * @param[in]     id     Custom ID, 1 to @ref BATCH_ID_MAX letters,
+ *                       digits, underscores, and hyphens.
+ * @param[in]     idlen  Length of @p id.
+ * @param[in]     params Messages API request body as serialized JSON.
+ *                       Not checked.
+ * @param[in]     plen   Length of @p params.
+ * @return 0 on success, otherwise an error code. A malformed ID is
+ *         `EINVAL`, and a request too large for any batch `EMSGSIZE`.
+ */
+extern int
+batch_writer_add (struct batch_writer *b,
+                  char const          *id,
+                  size_t               idlen,
+                  char const          *params,
+                  size_t               plen) nonnull_in();
+
+/**
+ * @brief Add a single-turn request with a user prompt.
+ *
+ * The request is written straight to the file without being built in
+ * memory first. See @ref batch_writer_add() for the rest.
+ *
+ * @param[in,out] b          Writer.
+ * @param[in]     id         Custom ID.
+ * @param[in]     idlen      Length of @p id.
+ * @param[in]     model      Model name.
+ * @param[in]     max_tokens Output token limit.
+ * @param[in]     text       Prompt text, UTF-8.
+ * @param[in]     tlen       Length of @p text.
+ */
+extern int
+batch_writer_prompt (struct batch_writer *b,
+                     char const          *id,
+                     size_t               idlen,
+                     char const          *model,
+                     int64_t              max_tokens,
+                     char const          *text,
+                     size_t               tlen) nonnull_in();
+
+/**
+ * @brief Complete the last file.
+ *
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+batch_writer_close (struct batch_writer *b) nonnull_in();
+
+/**
+ * @brief Release a writer, discarding an incomplete file.
+ */
+extern void
+batch_writer_fini (struct batch_writer *b);
+
+/**
+ * @brief Format the path of a batch file.
+ *
+ * @param[out] dst    Destination.
+ * @param[in]  size   Size of @p dst.
+ * @param[in]  prefix File name prefix.
+ * @param[in]  i      File number.
+ * @return 0 on success, `ENAMETOOLONG` if @p dst is too small.
+ */
+extern int
+batch_path (char       *dst,
+            size_t      size,
+            char const *prefix,
+            uint32_t    i) nonnull_in();
+
+/**
+ * @brief API endpoint and credentials.
+ *
+ * The client speaks plain HTTP, so a TLS endpoint is reached through
+ * a local proxy.
+ */
+struct batch_api {
+	char const *host;    //!< Host name or address.
+	char const *port;    //!< Port number or service name.
+	char const *key;     //!< API key.
+	char const *version; //!< API version, or `NULL` for the default.
+};
+
+/**
+ * @brief Poll schedule. Zero fields take their defaults.
+ *
+ * The interval starts at @ref batch_poll::initial_ms and doubles after
+ * every poll up to @ref batch_poll::max_ms.
+ */
+struct batch_poll {
+	uint32_t initial_ms; //!< First interval.
+	uint32_t max_ms;     //!< Longest interval.
+	uint32_t timeout_ms; //!< Time to wait in total.
+};
+
+/**
+ * @brief Submit a batch file.
+ *
+ * The file is mapped and sent as is, so its pages are file-backed and
+ * can be dropped by the kernel as soon as they've been sent.
+ *
+ * @param[in,out] p    Connection pool.
+ * @param[in]     api  Endpoint.
+ * @param[in]     path Batch file.
+ * @param[out]    id   Batch ID. Release it with `dstr_fini()`.
+ * @return 0 on success, otherwise an error code. Rate limiting and
+ *         server errors are `EAGAIN`, any other error response is
+ *         `EPROTO`.
+ */
+extern int
+batch_create (struct http_pool       *p,
+              struct batch_api const *api,
+              char const             *path,
+              dstr                   *id) nonnull_in();
+
+/**
+ * @brief Wait for a batch to end.
+ *
+ * Rate limiting and server errors are treated like a batch that is
+ * still in progress.
+ *
+ * @param[in,out] p       Connection pool.
+ * @param[in]     api     Endpoint.
+ * @param[in]     id      Batch ID.
+ * @param[in]     poll    Poll schedule, or `NULL` for the default.
+ * @param[out]    results Path of the results. Release it with
+ *                        `dstr_fini()`.
+ * @return 0 on success, otherwise an error code. A batch that doesn't
+ *         end in time is `ETIMEDOUT`, and an error response `EPROTO`.
+ */
+extern int
+batch_wait (struct http_pool        *p,
+            struct batch_api const  *api,
+            dstr const              *id,
+            struct batch_poll const *poll,
+            dstr                    *results) nonnull_in(1,2,3,5);
+
+/**
+ * @brief Download the results of a batch to a file.
+ *
+ * The body is written out as it arrives, so it is never held in memory
+ * as a whole. The file only appears once the download has completed.
+ *
+ * @param[in,out] l       Event loop group.
+ * @param[in]     api     Endpoint.
+ * @param[in]     results Path of the results, from @ref batch_wait().
+ * @param[in]     path    Output file.
+ * @return 0 on success, otherwise an error code. An error response is
+ *         `EPROTO`.
+ */
+extern int
+batch_fetch (struct hloop           *l,
+             struct batch_api const *api,
+             dstr const             *results,
+             char const             *path) nonnull_in();
+
+/**
+ * @brief Hand the results in a file to a callback one line at a time.
+ *
+ * The file is read in chunks, which may be compressed, and each line
+ * is parsed into a reused tape. Only a line cut off by the end of a
+ * chunk is copied.
+ *
+ * @param[in] path File of results, in JSON Lines.
+ * @param[in] fn   Callback, given the decoded line and the tape that
+ *                 @ref batch_outcome::m_message and
+ *                 @ref batch_outcome::m_error index into. Both are
+ *                 valid during the call. A nonzero return value stops
+ *                 the iteration and is returned.
+ * @param[in] ctx  Passed to @p fn.
+ * @return 0 on success, otherwise an error code. A malformed line is
+ *         `EBADMSG` or `EPROTO`, and one longer than
+ *         @ref BATCH_LINE_MAX `EMSGSIZE`.
+ */
+extern int
+batch_results (char const *path,
+               int (*fn)(void                      *ctx,
+                         struct batch_result const *r,
+                         struct jtape const        *t),
+               void       *ctx) nonnull_in(1,2);
+
+#endif /* LIBCANTH_SRC_BATCH_H_ */
@@ -190,7 +190,7 @@ diag_clang(pop)
 # define IF_DEBUG(...)      __VA_ARGS__
 # define IF_NDEBUG(...)
 
-# define dbg_close(fd) ({                       \
+# define dbg_close(fd) __extension__ ({         \
   int fd__ = (fd);                              \
   int rv__ = close(fd__);                       \
   int ec__ = errno;                             \
@@ -200,7 +200,7 @@ diag_clang(pop)
   rv__;                                         \
 })
 
-# define dbg_fclose(fp) ({                      \
+# define dbg_fclose(fp) __extension__ ({        \
   FILE *fp__ = (fp);                            \
   char fs__[24] = {'\0'};                       \
   snprintf(fs__, sizeof(fs__), "%p",            \
@@ -214,7 +214,7 @@ diag_clang(pop)
   rv__;                                         \
 })
 
-# define dbg_fopen(pt, md) ({                   \
+# define dbg_fopen(pt, md) __extension__ ({     \
   char const *pt__ = (pt), *md__ = (md);        \
   FILE *fp__ = fopen(pt__, md__);               \
   int ec__ = errno;                             \
@@ -224,7 +224,7 @@ diag_clang(pop)
   fp__;                                         \
 })
 
-# define dbg_fstat(fd, sb) ({                   \
+# define dbg_fstat(fd, sb) __extension__ ({     \
   int fd__ = (fd);                              \
   int rv__ = fstat(fd__, (sb));                 \
   int ec__ = errno;                             \
@@ -234,7 +234,7 @@ diag_clang(pop)
   rv__;                                         \
 })
 
-# define dbg_mkdirat(fd, pt, md) ({             \
+# define dbg_mkdirat(fd, pt, md) __extension__ ({ \
   int fd__ = (fd);                              \
   char const *pt__ = (pt);                      \
   mode_t md__ = (md);                           \
@@ -252,7 +252,7 @@ dbg_mkdtemp_ (char *tmpl) nonnull_in();
 # define dbg_mkdtemp(x) _Generic(0, default:    \
   (assert((x) != nullptr), dbg_mkdtemp_))(x)
 
-# define dbg_mkfifoat(fd, pt, md) ({            \
+# define dbg_mkfifoat(fd, pt, md) __extension__ ({ \
   int fd__ = (fd);                              \
   char const *pt__ = (pt);                      \
   mode_t md__ = (md);                           \
@@ -264,7 +264,7 @@ dbg_mkdtemp_ (char *tmpl) nonnull_in();
   rv__;                                         \
 })
 
-# define dbg_open(pt, fl, md) ({                \
+# define dbg_open(pt, fl, md) __extension__ ({  \
   char const *pt__ = (pt);                      \
   int fl__ = (fl);                              \
   mode_t md__ = (md);                           \
@@ -276,7 +276,7 @@ dbg_mkdtemp_ (char *tmpl) nonnull_in();
   rv__;                                         \
 })
 
-# define dbg_openat(fd, pt, fl, md) ({          \
+# define dbg_openat(fd, pt, fl, md) __extension__ ({ \
   int fd__ = (fd);                              \
   char const *pt__ = (pt);                      \
   int fl__ = (fl);                              \
@@ -290,7 +290,7 @@ dbg_mkdtemp_ (char *tmpl) nonnull_in();
   rv__;                                         \
 })
 
-# define dbg_renameat(fd1, pt1, fd2, pt2) ({    \
+# define dbg_renameat(fd1, pt1, fd2, pt2) __extension__ ({ \
   int fd1_ = (fd1), fd2_ = (fd2);               \
   char const *pt1_ = (pt1), *pt2_ = (pt2);      \
   int rv__ = renameat(fd1_, pt1_, fd2_, pt2_);  \
@@ -301,7 +301,7 @@ dbg_mkdtemp_ (char *tmpl) nonnull_in();
   rv__;                                         \
 })
 
-# define dbg_rmdir(pt) ({                       \
+# define dbg_rmdir(pt) __extension__ ({         \
   char const *pt__ = (pt);                      \
   int rv__ = rmdir(pt__);                       \
   int ec__ = errno;                             \
@@ -310,7 +310,7 @@ dbg_mkdtemp_ (char *tmpl) nonnull_in();
   rv__;                                         \
 })
 
-# define dbg_stat(pt, sb) ({                    \
+# define dbg_stat(pt, sb) __extension__ ({      \
   char const *pt__ = (pt);                      \
   int rv__ = stat(pt__, (sb));                  \
   int ec__ = errno;                             \
@@ -320,7 +320,7 @@ dbg_mkdtemp_ (char *tmpl) nonnull_in();
   rv__;                                         \
 })
 
-# define dbg_unlink(pt) ({                      \
+# define dbg_unlink(pt) __extension__ ({        \
   char const *pt__ = (pt);                      \
   int rv__ = unlink(pt__);                      \
   int ec__ = errno;                             \
@@ -329,7 +329,7 @@ dbg_mkdtemp_ (char *tmpl) nonnull_in();
   rv__;                                         \
 })
 
-# define dbg_unlinkat(fd, pt, fl) ({            \
+# define dbg_unlinkat(fd, pt, fl) __extension__ ({ \
   int fd__ = (fd);                              \
   char const *pt__ = (pt);                      \
   int fl__ = (fl);                              \
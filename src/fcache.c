@@ -0,0 +1,737 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file fcache.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+# include <poll.h>
+# include <sys/eventfd.h>
+# include <sys/inotify.h>
+#endif /* __linux__ */
+
+#include "dbg.h"
+#include "fcache.h"
+
+#ifdef __linux__
+# define FCACHE_WATCH_MASK (IN_ATTRIB | IN_CLOSE_WRITE | IN_DELETE_SELF \
+                            | IN_MODIFY | IN_MOVE_SELF)
+# define FCACHE_DIR_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM \
+                          | IN_MOVED_TO | IN_ONLYDIR)
+#endif /* __linux__ */
+
+/**
+ * @brief File identity used to validate cache entries.
+ */
+struct fcache_key {
+	dev_t           dev;
+	ino_t           ino;
+	off_t           size;
+	struct timespec mtime;
+};
+
+/**
+ * @brief Path component watched through its parent directory.
+ */
+struct fcache_dir {
+	uint32_t off; //!< Offset of the name in the entry path.
+	uint32_t len; //!< Length of the name.
+	int      wd;  //!< Watch on the directory the name is in.
+};
+
+struct fcache_entry {
+	struct fcache_entry *next;
+	struct file_blob    *blob;
+	struct fcache_key    key;
+	uint64_t             hash;
+	struct fcache_dir   *dirs;
+	uint32_t             ndirs;
+	int                  wd;
+	char                 path[];
+};
+
+static struct {
+	pthread_mutex_t       lock;
+	struct fcache_entry **tab;
+	size_t                cap;
+	size_t                cursor;
+	struct fcache_stats   stats;
+	size_t                epoch;
+	size_t                gen;
+	uint32_t             *refs;
+	size_t                nrefs;
+	pthread_t             tid;
+	int                   ifd;
+	int                   evfd;
+} fcache = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.ifd  = -2,
+	.evfd = -1,
+};
+
+static const_inline uint64_t
+fcache_hash (char const *path)
+{
+	uint64_t h = 0xcbf29ce484222325U;
+	for (; *path; ++path)
+		h = (h ^ (unsigned char)*path) * 0x100000001b3U;
+	return h;
+}
+
+static force_inline struct fcache_key
+fcache_key (struct stat const *s)
+{
+	return (struct fcache_key){
+		.dev  = s->st_dev,
+		.ino  = s->st_ino,
+		.size = s->st_size,
+#ifdef __APPLE__
+		.mtime = s->st_mtimespec,
+#else
+		.mtime = s->st_mtim,
+#endif /* __APPLE__ */
+	};
+}
+
+static force_inline bool
+fcache_key_eq (struct fcache_key const *a,
+               struct fcache_key const *b)
+{
+	return a->dev == b->dev && a->ino == b->ino && a->size == b->size
+	       && a->mtime.tv_sec == b->mtime.tv_sec
+	       && a->mtime.tv_nsec == b->mtime.tv_nsec;
+}
+
+/**
+ * @brief Take a reference to watch @p wd. Called with the lock held.
+ *
+ * Adding a watch for an inode that is already watched returns the same
+ * descriptor, so watches are counted rather than owned by entries.
+ */
+static bool
+fcache_wref (int wd)
+{
+	if (wd < 0)
+		return false;
+
+	if ((size_t)wd >= fcache.nrefs) {
+		size_t n = fcache.nrefs ? fcache.nrefs : 64U;
+		while (n <= (size_t)wd)
+			n <<= 1U;
+		uint32_t *r = realloc(fcache.refs, n * sizeof *r);
+		if (!r)
+			return false;
+		__builtin_memset(&r[fcache.nrefs], 0,
+		                 (n - fcache.nrefs) * sizeof *r);
+		fcache.refs = r;
+		fcache.nrefs = n;
+	}
+
+	fcache.refs[wd] += 1U;
+	return true;
+}
+
+/**
+ * @brief Drop a reference to watch @p wd, and remove the watch with the
+ *        last one. Called with the lock held.
+ */
+static void
+fcache_wunref (int wd)
+{
+	if (wd < 0 || (size_t)wd >= fcache.nrefs || !fcache.refs[wd])
+		return;
+	if (--fcache.refs[wd])
+		return;
+#ifdef __linux__
+	(void)inotify_rm_watch(fcache.ifd, wd);
+#endif /* __linux__ */
+}
+
+/**
+ * @brief Add a watch and take a reference to it. Called with the lock
+ *        held.
+ *
+ * @return Watch descriptor, or -1 on error.
+ */
+static int
+fcache_add_watch (char const *path,
+                  uint32_t    mask)
+{
+#ifdef __linux__
+	/* Adding to the mask keeps a directory that was also looked up as
+	 * a file from losing the events its entries depend on. */
+	int wd = inotify_add_watch(fcache.ifd, path, mask | IN_MASK_ADD);
+	if (wd >= 0 && !fcache_wref(wd)) {
+		if ((size_t)wd >= fcache.nrefs || !fcache.refs[wd])
+			(void)inotify_rm_watch(fcache.ifd, wd);
+		wd = -1;
+	}
+	return wd;
+#else
+	(void)path;
+	(void)mask;
+	return -1;
+#endif /* __linux__ */
+}
+
+/**
+ * @brief Watch a file and every directory its path goes through.
+ *        Called with the lock held.
+ *
+ * Each component is watched for being created, deleted, or renamed in
+ * the directory it's in, so renaming or replacing any directory on the
+ * way, or retargeting a symlink, is noticed as well as changes to the
+ * file itself.
+ *
+ * @return true if everything is watched, false otherwise.
+ */
+static bool
+fcache_watch (struct fcache_entry *e)
+{
+#ifdef __linux__
+	size_t n = 1U;
+	for (char const *p = e->path; *p; ++p)
+		n += *p == '/';
+
+	e->dirs = calloc(n, sizeof *e->dirs);
+	if (!e->dirs)
+		return false;
+
+	e->wd = fcache_add_watch(e->path, FCACHE_WATCH_MASK);
+	if (e->wd < 0)
+		return false;
+
+	char *s = e->path;
+	for (size_t i = 0, k = 0; s[i]; i = k) {
+		while (s[i] == '/')
+			++i;
+		for (k = i; s[k] && s[k] != '/'; ++k);
+		if (k == i)
+			break;
+
+		/* Dot names can't be replaced. */
+		if (s[i] == '.' && (k - i == 1U ||
+		                    (k - i == 2U && s[i + 1U] == '.')))
+			continue;
+
+		/* The path isn't shared yet, cut it at the component. */
+		char c = s[i];
+		s[i] = '\0';
+		int wd = fcache_add_watch(i ? s : ".", FCACHE_DIR_MASK);
+		s[i] = c;
+
+		if (wd < 0)
+			return false;
+
+		e->dirs[e->ndirs++] = (struct fcache_dir){
+			.off = (uint32_t)i,
+			.len = (uint32_t)(k - i),
+			.wd  = wd,
+		};
+	}
+
+	return true;
+#else
+	(void)e;
+	return false;
+#endif /* __linux__ */
+}
+
+/**
+ * @brief Release the watches of an entry. Called with the lock held.
+ *
+ * @param e   Entry.
+ * @param ref Whether or not the watches are still referenced, which
+ *            they're not after a purge.
+ */
+static void
+fcache_unwatch (struct fcache_entry *e,
+                bool                 ref)
+{
+	if (ref) {
+		for (uint32_t i = 0; i < e->ndirs; ++i)
+			fcache_wunref(e->dirs[i].wd);
+		fcache_wunref(e->wd);
+	}
+	free(e->dirs);
+	e->dirs = nullptr;
+	e->ndirs = 0;
+	e->wd = -1;
+}
+
+/**
+ * @brief Unlink and free the entry at @p link. Called with the lock held.
+ *
+ * @param link Pointer to the chain link referencing the entry.
+ */
+static void
+fcache_drop (struct fcache_entry **link)
+{
+	struct fcache_entry *e = *link;
+	*link = e->next;
+
+	fcache_unwatch(e, true);
+	fcache.stats.bytes -= e->blob->size;
+	fcache.stats.entries -= 1U;
+	fcache.stats.evicted += 1U;
+	file_blob_unref(e->blob);
+	free(e);
+}
+
+/**
+ * @brief Check whether an entry depends on an event.
+ *
+ * @param e    Entry.
+ * @param wd   Watch the event is for.
+ * @param name Name in the watched directory the event is about, or
+ *             `NULL` if it's about the watched file or directory.
+ */
+static bool
+fcache_affected (struct fcache_entry const *e,
+                 int                        wd,
+                 char const                *name)
+{
+	if (!name && e->wd == wd)
+		return true;
+
+	for (uint32_t i = 0; i < e->ndirs; ++i) {
+		struct fcache_dir const *d = &e->dirs[i];
+		if (d->wd == wd && (!name || (strlen(name) == d->len &&
+		                              !memcmp(&e->path[d->off], name,
+		                                      d->len))))
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * @brief Drop every entry an event affects. Called with the lock held.
+ */
+static void
+fcache_invalidate (int         wd,
+                   char const *name)
+{
+	for (size_t i = 0; i < fcache.cap; ++i) {
+		for (struct fcache_entry **p = &fcache.tab[i]; *p;) {
+			if (!fcache_affected(*p, wd, name)) {
+				p = &(*p)->next;
+				continue;
+			}
+			pr_dbg("invalidate %s", (*p)->path);
+			fcache_drop(p);
+		}
+	}
+}
+
+/**
+ * @brief Apply pending inotify events. Called with the lock held.
+ */
+static void
+fcache_poll (void)
+{
+#ifdef __linux__
+	_Alignas(struct inotify_event) char buf[4096];
+
+	for (;;) {
+		ssize_t n = read(fcache.ifd, buf, sizeof buf);
+		if (n <= 0) {
+			if (n < 0 && errno == EINTR)
+				continue;
+			break;
+		}
+
+		for (char const *p = buf; p < &buf[n];) {
+			struct inotify_event const *ev = (void const *)p;
+			p += sizeof *ev + ev->len;
+
+			fcache.epoch += 1U;
+
+			if (ev->mask & IN_Q_OVERFLOW) {
+				/* Events were lost, nothing can be trusted. */
+				for (size_t i = 0; i < fcache.cap; ++i) {
+					while (fcache.tab[i])
+						fcache_drop(&fcache.tab[i]);
+				}
+				continue;
+			}
+
+			fcache_invalidate(ev->wd, ev->len ? ev->name : nullptr);
+		}
+	}
+#endif /* __linux__ */
+}
+
+#ifdef __linux__
+/**
+ * @brief Apply inotify events as they come in, so that they don't
+ *        pile up between lookups.
+ *
+ * @param arg Generation of the cache the thread was started for.
+ */
+static void *
+fcache_watcher (void *arg)
+{
+	size_t gen = (size_t)(uintptr_t)arg;
+
+	(void)pthread_mutex_lock(&fcache.lock);
+	struct pollfd fds[] = {
+		{.fd = fcache.ifd,  .events = POLLIN},
+		{.fd = fcache.evfd, .events = POLLIN},
+	};
+	bool stop = fcache.gen != gen;
+	(void)pthread_mutex_unlock(&fcache.lock);
+
+	while (!stop) {
+		if (poll(fds, 2U, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			pr_wrrno_(errno, "poll");
+			break;
+		}
+
+		(void)pthread_mutex_lock(&fcache.lock);
+		stop = fcache.gen != gen || fds[1].revents;
+		if (!stop)
+			fcache_poll();
+		(void)pthread_mutex_unlock(&fcache.lock);
+	}
+
+	return nullptr;
+}
+#endif /* __linux__ */
+
+/**
+ * @brief Lazily set up the inotify instance and its watcher thread.
+ *        Called with the lock held.
+ */
+static bool
+fcache_watching (void)
+{
+#ifdef __linux__
+	if (fcache.ifd == -2) {
+		int e = 0;
+		fcache.ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		fcache.evfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+		if (fcache.ifd < 0 || fcache.evfd < 0)
+			e = errno;
+		else
+			e = pthread_create(&fcache.tid, nullptr, fcache_watcher,
+			                   (void *)(uintptr_t)fcache.gen);
+
+		if (e) {
+			pr_wrrno_(e, "inotify");
+			if (fcache.ifd >= 0)
+				(void)dbg_close(fcache.ifd);
+			if (fcache.evfd >= 0)
+				(void)close(fcache.evfd);
+			fcache.ifd = -1;
+			fcache.evfd = -1;
+		}
+	}
+	return fcache.ifd >= 0;
+#else
+	return false;
+#endif /* __linux__ */
+}
+
+/**
+ * @brief Find the chain link of a path. Called with the lock held.
+ */
+static struct fcache_entry **
+fcache_find (char const *path,
+             uint64_t    hash)
+{
+	if (!fcache.cap)
+		return nullptr;
+
+	struct fcache_entry **p = &fcache.tab[hash & (fcache.cap - 1U)];
+	for (; *p; p = &(*p)->next) {
+		if ((*p)->hash == hash && !strcmp((*p)->path, path))
+			return p;
+	}
+	return nullptr;
+}
+
+/**
+ * @brief Make room for one more entry. Called with the lock held.
+ */
+static bool
+fcache_grow (void)
+{
+	if (fcache.stats.entries < fcache.cap - (fcache.cap >> 2U))
+		return true;
+
+	size_t cap = fcache.cap ? fcache.cap << 1U : 16U;
+	struct fcache_entry **tab = calloc(cap, sizeof *tab);
+	if (!tab)
+		return false;
+
+	for (size_t i = 0; i < fcache.cap; ++i) {
+		for (struct fcache_entry *e = fcache.tab[i], *n; e; e = n) {
+			n = e->next;
+			e->next = tab[e->hash & (cap - 1U)];
+			tab[e->hash & (cap - 1U)] = e;
+		}
+	}
+
+	free(fcache.tab);
+	fcache.tab = tab;
+	fcache.cap = cap;
+	return true;
+}
+
+/**
+ * @brief Evict entries other than @p keep until the content fits in the
+ *        budget. Called with the lock held.
+ */
+static void
+fcache_trim (struct fcache_entry const *keep)
+{
+	while (fcache.stats.entries > 1U &&
+	       fcache.stats.bytes > FCACHE_MAX_BYTES) {
+		struct fcache_entry **p =
+			&fcache.tab[fcache.cursor++ & (fcache.cap - 1U)];
+		if (*p == keep)
+			p = &(*p)->next;
+		if (*p)
+			fcache_drop(p);
+	}
+}
+
+/**
+ * @brief Read a whole regular file into a new blob.
+ */
+static struct file_blob *
+fcache_load (char const        *path,
+             struct fcache_key *key,
+             int               *err)
+{
+	struct file_blob *b = nullptr;
+	int fd = dbg_open(path, O_RDONLY | O_CLOEXEC, 0);
+	if (fd < 0) {
+		*err = errno;
+		return nullptr;
+	}
+
+	do {
+		struct stat s = {0};
+		if (dbg_fstat(fd, &s)) {
+			*err = errno;
+			break;
+		}
+
+		if ((s.st_mode & S_IFMT) != S_IFREG) {
+			*err = EINVAL;
+			break;
+		}
+
+		if (s.st_size < 0) {
+			*err = EIO;
+			break;
+		}
+
+		b = file_blob_new((size_t)s.st_size);
+		if (!b) {
+			*err = errno;
+			break;
+		}
+
+		for (size_t k = 0; k < b->size;) {
+			ssize_t n = read(fd, &b->data[k], b->size - k);
+			if (n < 1) {
+				if (n && errno == EINTR)
+					continue;
+				*err = n ? errno : EIO;
+				file_blob_unref(b);
+				b = nullptr;
+				break;
+			}
+			k += (size_t)n;
+		}
+
+		*key = fcache_key(&s);
+	} while (0);
+
+	(void)dbg_close(fd);
+	return b;
+}
+
+/**
+ * @brief Insert an entry for a freshly loaded blob. Called with the lock
+ *        held.
+ *
+ * @return Whether or not the cache took over @p e and a reference to
+ *         @p b.
+ */
+static bool
+fcache_insert (struct fcache_entry     *e,
+               struct file_blob        *b,
+               struct fcache_key const *key)
+{
+	if (!fcache_grow())
+		return false;
+
+	e->blob = file_blob_ref(b);
+	e->key = *key;
+
+	struct fcache_entry **p = &fcache.tab[e->hash & (fcache.cap - 1U)];
+	e->next = *p;
+	*p = e;
+
+	fcache.stats.entries += 1U;
+	fcache.stats.bytes += b->size;
+
+	/* Another thread may have cached the same path meanwhile. It goes
+	 * after the new entry so that watches they share stay put. */
+	for (p = &e->next; *p; p = &(*p)->next) {
+		if ((*p)->hash == e->hash && !strcmp((*p)->path, e->path)) {
+			fcache_drop(p);
+			break;
+		}
+	}
+
+	fcache_trim(e);
+	return true;
+}
+
+struct file_in
+file_read_cached (char const *path)
+{
+	struct file_in ret = {0};
+	uint64_t hash = fcache_hash(path);
+	struct fcache_key key = {0};
+
+	(void)pthread_mutex_lock(&fcache.lock);
+
+	/* Events are queued by the time the call that caused them returns,
+	 * so draining the queue here makes changes made before this lookup
+	 * visible to it. The read is non-blocking and usually finds nothing.
+	 */
+	bool watching = fcache_watching();
+	if (watching)
+		fcache_poll();
+
+	struct fcache_entry **p = fcache_find(path, hash);
+	if (p) {
+		/* Watched entries that changed were dropped above. */
+		struct stat s = {0};
+		if ((*p)->wd >= 0 || (!stat(path, &s) &&
+		                      (key = fcache_key(&s),
+		                       fcache_key_eq(&key, &(*p)->key)))) {
+			ret = file_blob_share((*p)->blob);
+			fcache.stats.hits += 1U;
+			(void)pthread_mutex_unlock(&fcache.lock);
+			return ret;
+		}
+		fcache_drop(p);
+	}
+
+	fcache.stats.misses += 1U;
+	size_t epoch = fcache.epoch;
+	size_t gen = fcache.gen;
+
+	size_t n = strlen(path) + 1U;
+	struct fcache_entry *e = malloc(sizeof *e + n);
+	if (e) {
+		*e = (struct fcache_entry){
+			.hash = hash,
+			.wd   = -1,
+		};
+		__builtin_memcpy(e->path, path, n);
+
+		/* Watch before reading so that no change can slip through
+		 * between loading the file and starting to watch it. Without
+		 * watches the entry is validated with stat() instead.
+		 */
+		if (watching && !fcache_watch(e))
+			fcache_unwatch(e, true);
+	}
+
+	(void)pthread_mutex_unlock(&fcache.lock);
+
+	struct file_blob *b = fcache_load(path, &key, &ret.ec[0]);
+	if (b)
+		ret = file_blob_share(b);
+
+	(void)pthread_mutex_lock(&fcache.lock);
+
+	if (e) {
+		/* The cache was purged meanwhile, and the watches with it. */
+		if (fcache.gen != gen)
+			fcache_unwatch(e, false);
+		else if (e->wd >= 0)
+			fcache_poll();
+
+		/* Only cache what was read if no event came in meantime.
+		 * Telling whether one was about this path isn't worth it.
+		 */
+		if (!b || b->size > FCACHE_MAX_FILE ||
+		    (e->wd >= 0 && fcache.epoch != epoch) ||
+		    !fcache_insert(e, b, &key)) {
+			fcache_unwatch(e, true);
+			free(e);
+		}
+	}
+
+	(void)pthread_mutex_unlock(&fcache.lock);
+
+	file_blob_unref(b);
+	return ret;
+}
+
+struct fcache_stats
+fcache_stats (void)
+{
+	(void)pthread_mutex_lock(&fcache.lock);
+	struct fcache_stats ret = fcache.stats;
+	(void)pthread_mutex_unlock(&fcache.lock);
+	return ret;
+}
+
+void
+fcache_purge (void)
+{
+	(void)pthread_mutex_lock(&fcache.lock);
+
+	for (size_t i = 0; i < fcache.cap; ++i) {
+		while (fcache.tab[i])
+			fcache_drop(&fcache.tab[i]);
+	}
+
+	free(fcache.tab);
+	fcache.tab = nullptr;
+	fcache.cap = 0;
+	free(fcache.refs);
+	fcache.refs = nullptr;
+	fcache.nrefs = 0;
+	fcache.gen += 1U;
+
+#ifdef __linux__
+	int ifd = fcache.ifd;
+	int evfd = fcache.evfd;
+	pthread_t tid = fcache.tid;
+	fcache.ifd = -2;
+	fcache.evfd = -1;
+#endif /* __linux__ */
+
+	(void)pthread_mutex_unlock(&fcache.lock);
+
+#ifdef __linux__
+	if (ifd >= 0) {
+		uint64_t one = 1;
+		(void)write(evfd, &one, sizeof one);
+		(void)pthread_join(tid, nullptr);
+		(void)dbg_close(ifd);
+		(void)close(evfd);
+	}
+#endif /* __linux__ */
+}
@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file fcache.h
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_FCACHE_H_
+#define LIBCANTH_SRC_FCACHE_H_
+
+#include <stddef.h>
+
+#include "file.h"
+
+/**
+ * @brief Total content size above which cache entries are evicted.
+ */
+#define FCACHE_MAX_BYTES (64U << 20U)
+
+/**
+ * @brief Files larger than this are read but never cached.
+ */
+#define FCACHE_MAX_FILE (FCACHE_MAX_BYTES / 8U)
+
+/**
+ * @brief Cache statistics.
+ */
+struct fcache_stats {
+	size_t hits;    //!< Lookups served from the cache.
+	size_t misses;  //!< Lookups that had to read the file.
+	size_t evicted; //!< Entries invalidated or evicted.
+	size_t entries; //!< Current entry count.
+	size_t bytes;   //!< Current total content size.
+};
+
+/**
+ * @brief Read a file through the process-wide content cache.
+ *
+ * Entries are keyed by path and validated against the device, inode,
+ * size, and modification time of the file. On Linux every cached file
+ * is watched with inotify, and so is each directory on its path for the
+ * next component being created, deleted, or renamed. An entry is
+ * invalidated when the file changes or the path may lead elsewhere.
+ * Each lookup first applies pending events with one non-blocking read,
+ * so a change that was made before the lookup is always seen, and a
+ * hit costs no more than that. A watcher thread applies events as they
+ * arrive in between lookups. Elsewhere, or when the watches can't be
+ * set up, a hit costs one `stat()`. Relative paths are assumed to stay
+ * relative to the same working directory.
+ *
+ * The returned @ref file_in shares an immutable buffer with the cache
+ * and must not be modified. Release it with @ref file_in_fini() as if
+ * it came from @ref file_read().
+ *
+ * @param[in] path File path.
+ * @return A @ref file_in by value. Use @ref file_error() to check it.
+ */
+extern struct file_in
+file_read_cached (char const *path) nonnull_in();
+
+/**
+ * @brief Get a snapshot of the cache statistics.
+ */
+extern struct fcache_stats
+fcache_stats (void);
+
+/**
+ * @brief Drop every cache entry, stop watching files, and stop the
+ *        watcher thread.
+ *
+ * Buffers still referenced by callers remain valid until released.
+ */
+extern void
+fcache_purge (void);
+
+#endif /* LIBCANTH_SRC_FCACHE_H_ */
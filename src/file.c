@@ -3,13 +3,25 @@
  *
  * @author Juuso Alasuutari
  */
+#ifdef __linux__
+# define _GNU_SOURCE
+#endif /* __linux__ */
+
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+# include <sys/sendfile.h>
+#endif /* __linux__ */
 
 #include "compat.h"
+#include "dbg.h"
 #include "file.h"
+#include "utf8.h"
 
 struct file_in
 file_read (char const *path)
@@ -69,12 +81,542 @@ file_read (char const *path)
 	return ret;
 }
 
+struct file_in
+file_read_text (char const *path)
+{
+	struct file_in ret = {0};
+	int e = 0;
+
+	int fd = dbg_open(path, O_RDONLY | O_CLOEXEC, 0);
+	if (fd < 0) {
+		ret.ec[0] = errno;
+		return ret;
+	}
+
+	do {
+		struct stat s = {0};
+		if (dbg_fstat(fd, &s)) {
+			e = errno;
+			break;
+		}
+
+		if ((s.st_mode & S_IFMT) != S_IFREG) {
+			e = EINVAL;
+			break;
+		}
+
+		if (s.st_size < 0) {
+			e = EIO;
+			break;
+		}
+
+		/* Output is never longer than input,
+		 * so normalization can be in place.
+		 */
+		size_t cap = (size_t)s.st_size;
+		ret.data = malloc(cap + 1U);
+		if (!ret.data) {
+			e = errno;
+			break;
+		}
+
+		struct utf8_text t = utf8_text(true);
+		size_t raw = 0; // Bytes read
+		size_t pos = 0; // Bytes scanned
+		size_t w = 0;   // Bytes written
+
+		for (;;) {
+			size_t n = cap - raw;
+			if (n > FILE_TEXT_CHUNK)
+				n = FILE_TEXT_CHUNK;
+
+			ssize_t r = n ? read(fd, &ret.data[raw], n) : 0;
+			if (r < 0) {
+				if (errno == EINTR)
+					continue;
+				e = errno;
+				break;
+			}
+			raw += (size_t)r;
+
+			if (!pos) {
+				/* Wait for enough input to spot a BOM. */
+				if (r && raw < 3U)
+					continue;
+				if (raw >= 3U &&
+				    !__builtin_memcmp(ret.data, "\xef\xbb\xbf", 3U)) {
+					pos = t.offset = 3U;
+					ret.text |= file_text_bom;
+				}
+			}
+
+			w += utf8_text_scan(&t, &ret.data[w],
+			                    &ret.data[pos], raw - pos);
+			pos = raw;
+
+			if (!r)
+				break;
+		}
+
+		if (e)
+			break;
+
+		w += utf8_text_end(&t, &ret.data[w]);
+		ret.data[w] = 0;
+		ret.size = w;
+		ret.chars = t.chars;
+
+		if (t.error == SIZE_MAX)
+			ret.text |= file_text_valid;
+		else
+			ret.bad = t.error;
+
+		if (w + (ret.text & file_text_bom ? 3U : 0U) < raw)
+			ret.text |= file_text_crlf;
+	} while (0);
+
+	(void)dbg_close(fd);
+
+	if (e) {
+		free(ret.data);
+		ret = (struct file_in){.ec = {e}};
+	}
+
+	return ret;
+}
+
 void
 file_in_fini (struct file_in *f)
 {
 	if (f) {
-		free(f->data);
+		if (f->blob)
+			file_blob_unref(f->blob);
+		else
+			free(f->data);
 		f->data = nullptr;
 		f->size = 0;
+		f->blob = nullptr;
+	}
+}
+
+struct file_blob *
+file_blob_new (size_t size)
+{
+	if (size > SIZE_MAX - sizeof (struct file_blob) - 1U) {
+		errno = EOVERFLOW;
+		return nullptr;
+	}
+
+	struct file_blob *b = malloc(sizeof *b + size + 1U);
+	if (b) {
+		b->refs = 1U;
+		b->size = size;
+		b->data[size] = 0;
+	}
+
+	return b;
+}
+
+void
+file_blob_unref (struct file_blob *b)
+{
+	if (b && !__atomic_sub_fetch(&b->refs, 1U, __ATOMIC_ACQ_REL))
+		free(b);
+}
+
+/**
+ * @brief Store the first error of a writer and pass it through.
+ */
+nonnull_in()
+static force_inline int
+file_out_fail (struct file_out *f,
+               int              e)
+{
+	if (!f->ec)
+		f->ec = e ? e : EIO;
+	return f->ec;
+}
+
+int
+file_out_open (struct file_out *f,
+               char const      *path,
+               unsigned         flags)
+{
+	f->fd = -1;
+	f->ec = 0;
+	f->flags = flags;
+	f->iovcnt = 0;
+	f->used = 0;
+	f->path = nullptr;
+	f->tmp = nullptr;
+
+	if (!*path)
+		return file_out_fail(f, EINVAL);
+
+	if (!(flags & file_out_atomic)) {
+		int o = O_WRONLY | O_CREAT | O_CLOEXEC;
+		o |= flags & file_out_append ? O_APPEND : O_TRUNC;
+		f->fd = dbg_open(path, o, 0666);
+		return f->fd < 0 ? file_out_fail(f, errno) : 0;
+	}
+
+	if (flags & file_out_append)
+		return file_out_fail(f, EINVAL);
+
+	size_t n = strlen(path);
+	f->path = malloc(n + 1U);
+	f->tmp = malloc(n + sizeof ".XXXXXX");
+	if (!f->path || !f->tmp)
+		return file_out_fail(f, errno);
+
+	__builtin_memcpy(f->path, path, n + 1U);
+	__builtin_memcpy(f->tmp, path, n);
+	__builtin_memcpy(&f->tmp[n], ".XXXXXX", sizeof ".XXXXXX");
+
+	f->fd = mkostemp(f->tmp, O_CLOEXEC);
+	if (f->fd < 0) {
+		int e = errno;
+		free(f->tmp);
+		f->tmp = nullptr;
+		return file_out_fail(f, e);
+	}
+
+	/* mkostemp() creates the file with mode 0600,
+	 * give it the permissions open() would have.
+	 */
+	mode_t m = umask(0);
+	(void)umask(m);
+	if (fchmod(f->fd, 0666 & ~m))
+		return file_out_fail(f, errno);
+
+	return 0;
+}
+
+int
+file_out_reserve (struct file_out *f,
+                  size_t           size)
+{
+	if (f->ec)
+		return f->ec;
+
+	/* fallocate() rejects an empty range with EINVAL. */
+	if (!size)
+		return 0;
+
+#ifdef __linux__
+	off_t off = lseek(f->fd, 0, SEEK_CUR);
+	if (off < 0)
+		return 0;
+
+	for (int i = 0; i < f->iovcnt; ++i)
+		off += (off_t)f->iov[i].iov_len;
+
+	if (!fallocate(f->fd, FALLOC_FL_KEEP_SIZE, off, (off_t)size))
+		return 0;
+
+	int e = errno;
+	if (e != EOPNOTSUPP && e != ENOSYS && e != ESPIPE && e != ENODEV)
+		return file_out_fail(f, e);
+#else
+	(void)size;
+#endif /* __linux__ */
+
+	return 0;
+}
+
+/**
+ * @brief Write out the pending iovec batch.
+ */
+nonnull_in()
+static int
+file_out_drain (struct file_out *f)
+{
+	struct iovec *v = &f->iov[0];
+	int n = f->iovcnt;
+
+	while (n > 0) {
+		ssize_t w = writev(f->fd, v, n);
+		if (w < 1) {
+			if (w && errno == EINTR)
+				continue;
+			return file_out_fail(f, w ? errno : EIO);
+		}
+
+		size_t k = (size_t)w;
+		for (; n && k >= v->iov_len; --n, ++v)
+			k -= v->iov_len;
+
+		if (n) {
+			v->iov_base = (char *)v->iov_base + k;
+			v->iov_len -= k;
+		}
+	}
+
+	f->iovcnt = 0;
+	f->used = 0;
+	return 0;
+}
+
+int
+file_out_flush (struct file_out *f)
+{
+	return f->ec ? f->ec : file_out_drain(f);
+}
+
+/**
+ * @brief Append a piece to the iovec batch, merging it with the
+ *        previous one if they're contiguous in memory.
+ */
+nonnull_in()
+static force_inline void
+file_out_queue (struct file_out *f,
+                void const      *src,
+                size_t           len)
+{
+	if (f->iovcnt) {
+		struct iovec *v = &f->iov[f->iovcnt - 1];
+		if ((char *)v->iov_base + v->iov_len == src) {
+			v->iov_len += len;
+			return;
+		}
+	}
+
+	f->iov[f->iovcnt++] = (struct iovec){
+		.iov_base = (void *)(uintptr_t)src,
+		.iov_len  = len,
+	};
+}
+
+/**
+ * @brief Copy a short piece to the staging buffer.
+ */
+nonnull_in()
+static int
+file_out_stage (struct file_out *f,
+                void const      *src,
+                size_t           len)
+{
+	if (f->used + len > sizeof f->buf || f->iovcnt == FILE_OUT_IOV_MAX) {
+		int e = file_out_drain(f);
+		if (e)
+			return e;
+	}
+
+	unsigned char *dst = &f->buf[f->used];
+	__builtin_memcpy(dst, src, len);
+	f->used += len;
+	file_out_queue(f, dst, len);
+	return 0;
+}
+
+int
+file_out_write (struct file_out *f,
+                void const      *src,
+                size_t           len)
+{
+	if (f->ec || !len)
+		return f->ec;
+
+	if (len < sizeof f->buf)
+		return file_out_stage(f, src, len);
+
+	/* Too large to stage; write it out right away with the
+	 * rest of the batch so the caller can reuse the buffer.
+	 */
+	if (f->iovcnt == FILE_OUT_IOV_MAX) {
+		int e = file_out_drain(f);
+		if (e)
+			return e;
+	}
+
+	file_out_queue(f, src, len);
+	return file_out_drain(f);
+}
+
+int
+file_out_ref (struct file_out *f,
+              void const      *src,
+              size_t           len)
+{
+	if (f->ec || !len)
+		return f->ec;
+
+	if (len < FILE_OUT_COPY_MAX)
+		return file_out_stage(f, src, len);
+
+	if (f->iovcnt == FILE_OUT_IOV_MAX) {
+		int e = file_out_drain(f);
+		if (e)
+			return e;
+	}
+
+	file_out_queue(f, src, len);
+	return 0;
+}
+
+/**
+ * @brief Transfer @p len bytes from @p in to a writer in kernel space.
+ *
+ * @return 0 on success, `EAGAIN` if the kernel refused before anything
+ *         was copied, otherwise an error code.
+ */
+nonnull_in()
+static int
+file_out_copy_kernel (struct file_out *f,
+                      int              in,
+                      size_t          *len)
+{
+#ifdef __linux__
+	bool sf = false;
+
+	while (*len) {
+		size_t k = *len < 0x7ffff000U ? *len : 0x7ffff000U;
+		ssize_t n = sf ? sendfile(f->fd, in, nullptr, k)
+		               : copy_file_range(in, nullptr, f->fd,
+		                                 nullptr, k, 0U);
+		if (n > 0) {
+			*len -= (size_t)n;
+			continue;
+		}
+
+		if (!n)
+			return EIO; /* Input shrank underneath us. */
+
+		int e = errno;
+		if (e == EINTR)
+			continue;
+
+		switch (e) {
+		case EBADF: case EINVAL: case ENOSYS:
+		case EOPNOTSUPP: case EXDEV:
+			if (!sf) {
+				sf = true;
+				continue;
+			}
+			return EAGAIN;
+		default:
+			return e;
+		}
+	}
+
+	return 0;
+#else
+	(void)f;
+	(void)in;
+	(void)len;
+	return EAGAIN;
+#endif /* __linux__ */
+}
+
+int
+file_out_splice (struct file_out *f,
+                 char const      *path)
+{
+	int e = file_out_flush(f);
+	if (e)
+		return e;
+
+	int in = dbg_open(path, O_RDONLY | O_CLOEXEC, 0);
+	if (in < 0)
+		return errno;
+
+	do {
+		struct stat s = {0};
+		if (dbg_fstat(in, &s)) {
+			e = errno;
+			break;
+		}
+
+		if ((s.st_mode & S_IFMT) != S_IFREG) {
+			e = EINVAL;
+			break;
+		}
+
+		size_t len = (size_t)s.st_size;
+		e = file_out_copy_kernel(f, in, &len);
+		if (e != EAGAIN) {
+			if (e)
+				(void)file_out_fail(f, e);
+			break;
+		}
+
+		/* Kernel copy is unavailable, bounce through
+		 * the staging buffer instead.
+		 */
+		e = 0;
+		while (len) {
+			size_t k = len < sizeof f->buf ? len : sizeof f->buf;
+			ssize_t n = read(in, &f->buf[0], k);
+			if (n < 1) {
+				if (n && errno == EINTR)
+					continue;
+				e = file_out_fail(f, n ? errno : EIO);
+				break;
+			}
+
+			f->used = (size_t)n;
+			file_out_queue(f, &f->buf[0], (size_t)n);
+			e = file_out_drain(f);
+			if (e)
+				break;
+
+			len -= (size_t)n;
+		}
+	} while (0);
+
+	(void)dbg_close(in);
+	return e;
+}
+
+int
+file_out_commit (struct file_out *f)
+{
+	int e = file_out_flush(f);
+
+	if (f->fd >= 0) {
+		if (!e && (f->flags & file_out_sync)) {
+#ifdef __APPLE__
+			if (fsync(f->fd))
+#else
+			if (fdatasync(f->fd))
+#endif /* __APPLE__ */
+				e = file_out_fail(f, errno);
+		}
+
+		if (dbg_close(f->fd) && !e)
+			e = file_out_fail(f, errno);
+
+		f->fd = -1;
+	}
+
+	if (!e && f->tmp) {
+		if (dbg_renameat(AT_FDCWD, f->tmp, AT_FDCWD, f->path))
+			return file_out_fail(f, errno);
+
+		free(f->tmp);
+		f->tmp = nullptr;
+	}
+
+	return e;
+}
+
+void
+file_out_fini (struct file_out *f)
+{
+	if (f) {
+		if (f->fd >= 0)
+			(void)dbg_close(f->fd);
+
+		if (f->tmp)
+			(void)dbg_unlink(f->tmp);
+
+		free(f->tmp);
+		free(f->path);
+
+		f->fd = -1;
+		f->iovcnt = 0;
+		f->used = 0;
+		f->tmp = nullptr;
+		f->path = nullptr;
 	}
 }
@@ -7,24 +7,118 @@
 #define LIBCANTH_SRC_FILE_H_
 
 #include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
 
+#include "dstr.h"
 #include "util.h"
 
+/**
+ * @brief Immutable reference-counted file contents.
+ */
+struct file_blob {
+	size_t        refs; //!< Reference count, atomically updated.
+	size_t        size; //!< Size of @ref file_blob::data.
+	unsigned char data[]; //!< Null-terminated file contents.
+};
+
+/**
+ * @brief Text properties recorded by @ref file_read_text().
+ */
+fixed_enum(file_text_flag, uint8_t) {
+	file_text_valid = 1U << 0U, //!< Contents are valid UTF-8.
+	file_text_bom   = 1U << 1U, //!< A byte order mark was removed.
+	file_text_crlf  = 1U << 2U, //!< CRLF line endings were converted.
+};
+
 struct file_in {
-	unsigned char *data;
+	unsigned char    *data;
 	union {
 		size_t size;
 		int ec[!(sizeof (size_t) / sizeof (int))
 		       + sizeof (size_t) / sizeof (int)];
 	};
+	struct file_blob *blob;  //!< Shared owner of `data`, if any.
+	size_t            chars; //!< Code point count of valid text.
+	size_t            bad;   //!< File offset of the first invalid byte.
+	unsigned          text;  //!< Bitwise OR of @ref file_text_flag values.
 };
 
 extern struct file_in
 file_read (char const *path);
 
+/**
+ * @brief Number of bytes @ref file_read_text() reads at a time.
+ */
+#define FILE_TEXT_CHUNK (64U << 10U)
+
+/**
+ * @brief Read a UTF-8 text file.
+ *
+ * Validation, code point counting, byte order mark removal, and CRLF
+ * to LF conversion all happen on each chunk right after it has been
+ * read, while it's still in cache, instead of in separate passes over
+ * the whole file.
+ *
+ * Invalid input is not an error. The contents are returned as usual,
+ * but @ref file_text_valid is not set in @ref file_in::text and
+ * @ref file_in::bad holds the offset of the first invalid byte in
+ * the file (or the file size if it ends mid-sequence). In that case
+ * @ref file_in::chars only counts the code points before it.
+ *
+ * @param[in] path File path.
+ * @return A @ref file_in by value. Use @ref file_error() to check it.
+ */
+extern struct file_in
+file_read_text (char const *path) nonnull_in();
+
 extern void
 file_in_fini (struct file_in *f);
 
+/**
+ * @brief Allocate a @ref file_blob with a reference count of one.
+ *
+ * @param[in] size Content size, not including the null terminator
+ *                 which is written by this function.
+ * @return Pointer to the blob, or `nullptr` with `errno` set.
+ */
+extern struct file_blob *
+file_blob_new (size_t size);
+
+/**
+ * @brief Drop a @ref file_blob reference, freeing it if it was the last.
+ */
+extern void
+file_blob_unref (struct file_blob *b);
+
+/**
+ * @brief Take a new reference to a @ref file_blob.
+ */
+nonnull_in() nonnull_out
+static force_inline struct file_blob *
+file_blob_ref (struct file_blob *b)
+{
+	(void)__atomic_add_fetch(&b->refs, 1U, __ATOMIC_RELAXED);
+	return b;
+}
+
+/**
+ * @brief Share the contents of a @ref file_blob as a @ref file_in.
+ *
+ * Takes a new reference, which @ref file_in_fini() drops. The data
+ * must be treated as read-only.
+ */
+nonnull_in()
+static force_inline struct file_in
+file_blob_share (struct file_blob *b)
+{
+	return (struct file_in){
+		.data = &file_blob_ref(b)->data[0],
+		.size = b->size,
+		.blob = b,
+	};
+}
+
 static force_inline int
 file_error (struct file_in const *f)
 {
@@ -37,4 +131,179 @@ file_text (struct file_in const *f)
 	return f && f->data ? (char const *)f->data : "";
 }
 
+/**
+ * @brief Maximum number of pending @ref file_out pieces.
+ */
+#define FILE_OUT_IOV_MAX 64U
+
+/**
+ * @brief Size of the @ref file_out staging buffer.
+ */
+#define FILE_OUT_BUF_SIZE 16384U
+
+/**
+ * @brief Pieces shorter than this are copied to the staging buffer
+ *        instead of being referenced in place.
+ */
+#define FILE_OUT_COPY_MAX 512U
+
+/**
+ * @brief Output file open flags.
+ */
+fixed_enum(file_out_flag, uint8_t) {
+	file_out_append = 1U << 0U, //!< Append instead of truncating.
+	file_out_atomic = 1U << 1U, //!< Write to a temporary file, rename
+	                            //!< it over the destination on commit.
+	file_out_sync   = 1U << 2U, //!< Flush to stable storage on commit.
+};
+
+/**
+ * @brief Buffered output file.
+ *
+ * Small pieces are coalesced into a staging buffer, large ones are
+ * referenced in place, and the whole batch is written with a single
+ * `writev()` call when either the buffer or the iovec array fills up.
+ */
+struct file_out {
+	int           fd;     //!< Output file descriptor, -1 if closed.
+	int           ec;     //!< Sticky error code.
+	unsigned      flags;  //!< Bitwise OR of @ref file_out_flag values.
+	int           iovcnt; //!< Pending iovec count.
+	size_t        used;   //!< Bytes of @ref file_out::buf in use.
+	char         *path;   //!< Destination path of an atomic writer.
+	char         *tmp;    //!< Temporary path of an atomic writer.
+	struct iovec  iov[FILE_OUT_IOV_MAX];
+	unsigned char buf[FILE_OUT_BUF_SIZE];
+};
+
+/**
+ * @brief Open a buffered output file.
+ *
+ * With @ref file_out_atomic the data is written to a temporary file
+ * in the same directory as @p path, and only renamed over @p path by
+ * @ref file_out_commit(). The temporary file is removed if the writer
+ * is finalized without being committed.
+ *
+ * @param[out] f     Writer to initialize. Always safe to pass to
+ *                   @ref file_out_fini() afterwards.
+ * @param[in]  path  Output file path.
+ * @param[in]  flags Bitwise OR of @ref file_out_flag values.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+file_out_open (struct file_out *f,
+               char const      *path,
+               unsigned         flags) nonnull_in();
+
+/**
+ * @brief Preallocate disk space for upcoming writes.
+ *
+ * Reserves @p size bytes starting at the current end of queued data
+ * without changing the apparent file size. This is only a hint: file
+ * systems without preallocation support are silently ignored.
+ *
+ * @param[in,out] f    Writer.
+ * @param[in]     size Number of bytes expected to be written.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+file_out_reserve (struct file_out *f,
+                  size_t           size) nonnull_in();
+
+/**
+ * @brief Copy bytes to the writer.
+ *
+ * The source buffer may be reused as soon as this function returns.
+ * Short pieces are staged, long ones are written out immediately
+ * together with whatever was pending.
+ *
+ * @param[in,out] f   Writer.
+ * @param[in]     src Data to write.
+ * @param[in]     len Length of @p src.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+file_out_write (struct file_out *f,
+                void const      *src,
+                size_t           len) nonnull_in(1);
+
+/**
+ * @brief Queue bytes without copying them.
+ *
+ * Unlike @ref file_out_write() the data is referenced in place if it
+ * isn't short enough to be staged, so it must remain valid and must
+ * not be modified until the next @ref file_out_flush() (explicit, or
+ * implicit through any other writer function) has returned.
+ *
+ * @param[in,out] f   Writer.
+ * @param[in]     src Data to write.
+ * @param[in]     len Length of @p src.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+file_out_ref (struct file_out *f,
+              void const      *src,
+              size_t           len) nonnull_in(1);
+
+/**
+ * @brief Queue the contents of a @ref dstr without copying them.
+ *
+ * Small strings stored inside the @ref dstr itself are always copied;
+ * see @ref file_out_ref() for the lifetime rules of everything else.
+ */
+nonnull_in()
+static force_inline int
+file_out_put (struct file_out *f,
+              dstr const      *s)
+{
+	return dstr_is_pointer(s)
+	       ? file_out_ref(f, dstr_get(s), s->len)
+	       : file_out_write(f, s->arr, s->len);
+}
+
+/**
+ * @brief Copy the contents of a file to the writer in kernel space.
+ *
+ * Pending data is flushed first, then the input is transferred with
+ * `copy_file_range()`, falling back to `sendfile()` and finally to a
+ * plain read/write loop if the kernel can't do better.
+ *
+ * @param[in,out] f    Writer.
+ * @param[in]     path Path of the input file.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+file_out_splice (struct file_out *f,
+                 char const      *path) nonnull_in();
+
+/**
+ * @brief Write out all pending data.
+ *
+ * @param[in,out] f Writer.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+file_out_flush (struct file_out *f) nonnull_in();
+
+/**
+ * @brief Flush, close, and (if atomic) publish an output file.
+ *
+ * The writer is closed whether or not this succeeds, but it still has
+ * to be passed to @ref file_out_fini() to release its resources.
+ *
+ * @param[in,out] f Writer.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+file_out_commit (struct file_out *f) nonnull_in();
+
+/**
+ * @brief Release a writer, discarding pending data and uncommitted
+ *        atomic output.
+ *
+ * @param[in,out] f Writer.
+ */
+extern void
+file_out_fini (struct file_out *f);
+
 #endif /* LIBCANTH_SRC_FILE_H_ */
@@ -0,0 +1,451 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file fstream.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_ZLIB
+# include <zlib.h>
+#endif /* HAVE_ZLIB */
+#ifdef HAVE_ZSTD
+# include <zstd.h>
+#endif /* HAVE_ZSTD */
+
+#include "dbg.h"
+#include "fstream.h"
+
+/**
+ * @brief Refill the raw input buffer, keeping unconsumed bytes.
+ *
+ * @return 0 on success, including end of file, otherwise an error code.
+ */
+nonnull_in()
+static int
+fstream_fill (struct fstream *s)
+{
+	if (s->in_pos) {
+		s->in_len -= s->in_pos;
+		__builtin_memmove(s->in, &s->in[s->in_pos], s->in_len);
+		s->in_pos = 0;
+	}
+
+	while (!s->eof && s->in_len < FSTREAM_IN_SIZE) {
+		ssize_t n = read(s->fd, &s->in[s->in_len],
+		                 FSTREAM_IN_SIZE - s->in_len);
+		if (n > 0) {
+			s->in_len += (size_t)n;
+			break;
+		}
+
+		if (!n)
+			s->eof = true;
+		else if (errno != EINTR)
+			return errno;
+	}
+
+	return 0;
+}
+
+nonnull_in()
+static force_inline int
+fstream_fail (struct fstream *s,
+              int             e)
+{
+	if (!s->ec)
+		s->ec = e ? e : EIO;
+	return s->ec;
+}
+
+static force_inline enum fstream_codec
+fstream_detect (unsigned char const *p,
+                size_t               n)
+{
+	if (n >= 2U && p[0] == 0x1fU && p[1] == 0x8bU)
+		return fstream_gzip;
+	if (n >= 4U && p[0] == 0x28U && p[1] == 0xb5U
+	            && p[2] == 0x2fU && p[3] == 0xfdU)
+		return fstream_zstd;
+	return fstream_plain;
+}
+
+int
+fstream_open (struct fstream *s,
+              char const     *path)
+{
+	*s = (struct fstream){.fd = -1};
+
+	s->fd = dbg_open(path, O_RDONLY | O_CLOEXEC, 0);
+	if (s->fd < 0)
+		return fstream_fail(s, errno);
+
+#ifdef POSIX_FADV_SEQUENTIAL
+	/* Let readahead fetch the next raw buffer while
+	 * the current one is being decoded and parsed.
+	 */
+	(void)posix_fadvise(s->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif /* POSIX_FADV_SEQUENTIAL */
+
+	s->in = malloc(FSTREAM_IN_SIZE);
+	if (!s->in)
+		return fstream_fail(s, errno);
+
+	/* Short reads are possible on pipes, make sure
+	 * there's enough input to recognize the magic.
+	 */
+	while (!s->eof && s->in_len < 4U) {
+		int e = fstream_fill(s);
+		if (e)
+			return fstream_fail(s, e);
+	}
+
+	s->codec = fstream_detect(s->in, s->in_len);
+
+	switch (s->codec) {
+	case fstream_plain:
+		return 0;
+
+	case fstream_gzip:
+#ifdef HAVE_ZLIB
+	{
+		z_stream *z = calloc(1U, sizeof *z);
+		if (!z)
+			return fstream_fail(s, errno);
+		s->dec = z;
+		if (inflateInit2(z, 15 + 16) != Z_OK) {
+			free(z);
+			s->dec = nullptr;
+			return fstream_fail(s, ENOMEM);
+		}
+		break;
+	}
+#else
+		return fstream_fail(s, ENOTSUP);
+#endif /* HAVE_ZLIB */
+
+	case fstream_zstd:
+#ifdef HAVE_ZSTD
+		s->dec = ZSTD_createDStream();
+		if (!s->dec)
+			return fstream_fail(s, ENOMEM);
+		break;
+#else
+		return fstream_fail(s, ENOTSUP);
+#endif /* HAVE_ZSTD */
+	}
+
+	s->out = malloc(FSTREAM_OUT_SIZE);
+	return s->out ? 0 : fstream_fail(s, errno);
+}
+
+#ifdef HAVE_ZLIB
+nonnull_in()
+static int
+fstream_inflate (struct fstream *s,
+                 size_t         *len)
+{
+	z_stream *z = s->dec;
+	z->next_out = s->out;
+	z->avail_out = FSTREAM_OUT_SIZE;
+
+	while (z->avail_out) {
+		if (s->in_pos == s->in_len && !s->eof) {
+			int e = fstream_fill(s);
+			if (e)
+				return e;
+			continue;
+		}
+
+		/* Keep going without input as long as
+		 * inflate() has buffered output left.
+		 */
+		uInt avail = z->avail_out;
+		z->next_in = &s->in[s->in_pos];
+		z->avail_in = (uInt)(s->in_len - s->in_pos);
+
+		int r = inflate(z, Z_NO_FLUSH);
+		s->in_pos = s->in_len - z->avail_in;
+
+		if (r == Z_STREAM_END) {
+			/* Another member may follow. */
+			if (s->in_pos == s->in_len) {
+				int e = fstream_fill(s);
+				if (e)
+					return e;
+			}
+			if (s->in_pos == s->in_len) {
+				s->done = true;
+				break;
+			}
+			if (inflateReset(z) != Z_OK)
+				return EBADMSG;
+			continue;
+		}
+
+		if (r == Z_BUF_ERROR || (r == Z_OK && s->eof &&
+		                         s->in_pos == s->in_len &&
+		                         z->avail_out == avail))
+			break;
+
+		if (r != Z_OK)
+			return r == Z_MEM_ERROR ? ENOMEM : EBADMSG;
+	}
+
+	*len = FSTREAM_OUT_SIZE - z->avail_out;
+	if (!*len && !s->done)
+		return EBADMSG; /* Input ended mid-member. */
+
+	return 0;
+}
+#endif /* HAVE_ZLIB */
+
+#ifdef HAVE_ZSTD
+nonnull_in()
+static int
+fstream_unzstd (struct fstream *s,
+                size_t         *len)
+{
+	ZSTD_outBuffer o = {.dst = s->out, .size = FSTREAM_OUT_SIZE};
+
+	while (o.pos < o.size) {
+		if (s->in_pos == s->in_len && !s->eof) {
+			int e = fstream_fill(s);
+			if (e)
+				return e;
+			continue;
+		}
+
+		/* Keep going without input as long as the
+		 * decoder has buffered output left.
+		 */
+		size_t pos = o.pos;
+		ZSTD_inBuffer i = {
+			.src  = s->in,
+			.size = s->in_len,
+			.pos  = s->in_pos,
+		};
+
+		size_t r = ZSTD_decompressStream(s->dec, &o, &i);
+		if (ZSTD_isError(r))
+			return EBADMSG;
+
+		/* Zero means a frame was fully decoded and flushed, also
+		 * when only its end was consumed. A call that did nothing
+		 * returns the size of the next frame header instead.
+		 */
+		if (i.pos != s->in_pos || o.pos != pos)
+			s->partial = r;
+		s->in_pos = i.pos;
+
+		if (s->eof && i.pos == s->in_len && o.pos == pos)
+			break;
+	}
+
+	*len = o.pos;
+	if (!*len) {
+		if (s->partial)
+			return EBADMSG;
+		s->done = true;
+	}
+
+	return 0;
+}
+#endif /* HAVE_ZSTD */
+
+int
+fstream_next (struct fstream       *s,
+              unsigned char const **chunk,
+              size_t               *len)
+{
+	*chunk = nullptr;
+	*len = 0;
+
+	if (s->ec || s->done)
+		return s->ec;
+
+	int e = 0;
+
+	switch (s->codec) {
+	case fstream_plain:
+		if (s->in_pos == s->in_len) {
+			e = fstream_fill(s);
+			if (e)
+				break;
+		}
+		*chunk = &s->in[s->in_pos];
+		*len = s->in_len - s->in_pos;
+		s->in_pos = s->in_len;
+		s->done = !*len;
+		return 0;
+
+	case fstream_gzip:
+#ifdef HAVE_ZLIB
+		e = fstream_inflate(s, len);
+#endif /* HAVE_ZLIB */
+		break;
+
+	case fstream_zstd:
+#ifdef HAVE_ZSTD
+		e = fstream_unzstd(s, len);
+#endif /* HAVE_ZSTD */
+		break;
+	}
+
+	if (e) {
+		*len = 0;
+		return fstream_fail(s, e);
+	}
+
+	*chunk = s->out;
+	return 0;
+}
+
+void
+fstream_fini (struct fstream *s)
+{
+	if (!s)
+		return;
+
+	if (s->dec) {
+		switch (s->codec) {
+		case fstream_plain:
+			break;
+		case fstream_gzip:
+#ifdef HAVE_ZLIB
+			(void)inflateEnd(s->dec);
+			free(s->dec);
+#endif /* HAVE_ZLIB */
+			break;
+		case fstream_zstd:
+#ifdef HAVE_ZSTD
+			(void)ZSTD_freeDStream(s->dec);
+#endif /* HAVE_ZSTD */
+			break;
+		}
+	}
+
+	if (s->fd >= 0)
+		(void)dbg_close(s->fd);
+
+	free(s->out);
+	free(s->in);
+	*s = (struct fstream){.fd = -1};
+}
+
+/**
+ * @brief Read the rest of an uncompressed file into one buffer sized
+ *        to fit it, after the bytes read for detection.
+ *
+ * Like @ref file_read(), but through the descriptor that was opened to
+ * detect the encoding, so it can't end up reading another file.
+ */
+nonnull_in()
+static int
+fstream_read_plain (struct fstream *s,
+                    struct file_in *ret)
+{
+	struct stat st;
+	if (dbg_fstat(s->fd, &st))
+		return errno;
+	if ((st.st_mode & S_IFMT) != S_IFREG)
+		return EINVAL;
+	if (st.st_size < 0)
+		return EIO;
+
+	size_t cap = (size_t)st.st_size;
+	if (cap < s->in_len)
+		cap = s->in_len;
+
+	unsigned char *p = malloc(cap + 1U);
+	if (!p)
+		return errno;
+
+	__builtin_memcpy(p, s->in, s->in_len);
+	size_t len = s->in_len;
+	while (!s->eof && len < cap) {
+		ssize_t r = read(s->fd, &p[len], cap - len);
+		if (r > 0) {
+			len += (size_t)r;
+		} else if (!r) {
+			s->eof = true;
+		} else if (errno != EINTR) {
+			int e = errno;
+			free(p);
+			return e;
+		}
+	}
+
+	p[len] = 0;
+	ret->data = p;
+	ret->size = len;
+	return 0;
+}
+
+struct file_in
+fstream_read (char const *path)
+{
+	struct file_in ret = {0};
+	struct fstream s;
+
+	int e = fstream_open(&s, path);
+	if (!e && s.codec == fstream_plain) {
+		e = fstream_read_plain(&s, &ret);
+		fstream_fini(&s);
+		return e ? (struct file_in){.ec = {e}} : ret;
+	}
+
+	size_t cap = 0;
+	while (!e) {
+		unsigned char const *p;
+		size_t n;
+		e = fstream_next(&s, &p, &n);
+		if (e || !n)
+			break;
+
+		if (ret.size + n >= cap) {
+			size_t c = cap ? cap : FSTREAM_OUT_SIZE;
+			while (ret.size + n >= c) {
+				if (c > SIZE_MAX / 2U) {
+					e = EOVERFLOW;
+					break;
+				}
+				c <<= 1U;
+			}
+			if (e)
+				break;
+
+			unsigned char *q = realloc(ret.data, c);
+			if (!q) {
+				e = errno;
+				break;
+			}
+			ret.data = q;
+			cap = c;
+		}
+
+		__builtin_memcpy(&ret.data[ret.size], p, n);
+		ret.size += n;
+	}
+
+	fstream_fini(&s);
+
+	if (!e && !ret.data) {
+		/* Empty stream; file_text() still expects a buffer. */
+		ret.data = malloc(1U);
+		if (!ret.data)
+			e = errno;
+	}
+
+	if (e) {
+		free(ret.data);
+		ret = (struct file_in){.ec = {e}};
+	} else {
+		ret.data[ret.size] = 0;
+	}
+
+	return ret;
+}
@@ -0,0 +1,103 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file fstream.h
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_FSTREAM_H_
+#define LIBCANTH_SRC_FSTREAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "file.h"
+
+/**
+ * @brief Size of the raw input buffer of a @ref fstream.
+ */
+#define FSTREAM_IN_SIZE (64U << 10U)
+
+/**
+ * @brief Size of the decompressed chunk buffer of a @ref fstream.
+ */
+#define FSTREAM_OUT_SIZE (256U << 10U)
+
+/**
+ * @brief Stream encodings recognized by magic bytes.
+ */
+fixed_enum(fstream_codec, uint8_t) {
+	fstream_plain, //!< Passed through as-is.
+	fstream_gzip,  //!< RFC 1952, possibly multi-member.
+	fstream_zstd,  //!< Zstandard, possibly multi-frame.
+};
+
+/**
+ * @brief Chunked file reader with transparent decompression.
+ */
+struct fstream {
+	int                 fd;      //!< Input file descriptor.
+	int                 ec;      //!< Sticky error code.
+	enum fstream_codec  codec;   //!< Detected encoding.
+	bool                eof;     //!< Input file exhausted.
+	bool                done;    //!< Last chunk handed out.
+	bool                partial; //!< Decoder is inside a frame.
+	unsigned char      *in;      //!< Raw input buffer.
+	size_t              in_pos;  //!< Consumed raw input.
+	size_t              in_len;  //!< Buffered raw input.
+	unsigned char      *out;     //!< Decompressed chunk buffer.
+	void               *dec;     //!< Decoder state.
+};
+
+/**
+ * @brief Open a file for chunked reading.
+ *
+ * The first bytes are inspected to detect gzip and zstd streams.
+ * Support for each is compiled in if zlib and libzstd respectively
+ * were found at build time. Opening a stream whose decoder wasn't
+ * built in fails with `ENOTSUP`.
+ *
+ * @param[out] s    Stream to initialize. Always safe to pass to
+ *                  @ref fstream_fini() afterwards.
+ * @param[in]  path File path.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+fstream_open (struct fstream *s,
+              char const     *path) nonnull_in();
+
+/**
+ * @brief Get the next chunk of decoded data.
+ *
+ * Raw input is read and decoded one buffer at a time, so consumers
+ * work on each chunk while it's still in cache. The chunk is valid
+ * until the next call on the same stream.
+ *
+ * @param[in,out] s     Stream.
+ * @param[out]    chunk Where to store the chunk address.
+ * @param[out]    len   Where to store the chunk length, which is 0
+ *                      only at the end of the stream.
+ * @return 0 on success, otherwise an error code. Corrupt or truncated
+ *         compressed data is reported as `EBADMSG`.
+ */
+extern int
+fstream_next (struct fstream       *s,
+              unsigned char const **chunk,
+              size_t               *len) nonnull_in();
+
+/**
+ * @brief Release a stream.
+ */
+extern void
+fstream_fini (struct fstream *s);
+
+/**
+ * @brief Read a whole file, decompressing it if necessary.
+ *
+ * Behaves like @ref file_read() on plain files.
+ *
+ * @param[in] path File path.
+ * @return A @ref file_in by value. Use @ref file_error() to check it.
+ */
+extern struct file_in
+fstream_read (char const *path) nonnull_in();
+
+#endif /* LIBCANTH_SRC_FSTREAM_H_ */
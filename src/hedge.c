@@ -0,0 +1,465 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file hedge.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hedge.h"
+#include "mono.h"
+
+/**
+ * @brief Times to first byte seen before the delay is set from them,
+ *        and between updates of it.
+ */
+#define HEDGE_SAMPLES 16U
+
+/**
+ * @brief One of the two streams of a request.
+ */
+struct hedge_leg {
+	struct hedge_call *c;      //!< Request.
+	uint64_t           start;  //!< Time the stream was sent, in us.
+	int                e;      //!< Error code from done.
+	int                status; //!< Status code from done.
+	uint8_t            i;      //!< Index in @ref hedge_call::leg.
+	bool               done;   //!< Stream has finished.
+};
+
+/**
+ * @brief Request that may be hedged.
+ */
+struct hedge_call {
+	struct hedge_call      *prev;   //!< Previous call waiting to hedge.
+	struct hedge_call      *next;   //!< Next call waiting to hedge.
+	struct hedge           *h;      //!< Policy.
+	struct http_request     req;    //!< Request.
+	struct hloop_ops const *ops;    //!< Callbacks of the caller.
+	void                   *ctx;    //!< Context of @ref hedge_call::ops.
+	uint64_t                due;    //!< When to hedge, in us.
+	struct hedge_leg        leg[2]; //!< First request and hedge.
+	uint32_t                winner; //!< Index + 1 of the leg passed on,
+	                                //!< atomically updated.
+	uint32_t                legs;   //!< Legs sent.
+	uint32_t                refs;   //!< Legs not done, the submitter, and
+	                                //!< the hedge timer while it fires.
+	bool                    timed;  //!< Waiting to hedge.
+};
+
+static int
+hedge_cmp (void const *a,
+           void const *b)
+{
+	uint32_t x = *(uint32_t const *)a, y = *(uint32_t const *)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief Take a call off the timer list.
+ */
+nonnull_in()
+static void
+hedge_untime (struct hedge      *h,
+              struct hedge_call *c)
+{
+	if (!c->timed)
+		return;
+	if (c->prev)
+		c->prev->next = c->next;
+	else
+		h->head = c->next;
+	if (c->next)
+		c->next->prev = c->prev;
+	else
+		h->tail = c->prev;
+	c->prev = c->next = nullptr;
+	c->timed = false;
+}
+
+/**
+ * @brief Put a call on the timer list. Delays change slowly, so a new
+ *        call usually goes last.
+ */
+nonnull_in()
+static void
+hedge_time (struct hedge      *h,
+            struct hedge_call *c)
+{
+	struct hedge_call *p = h->tail;
+	while (p && p->due > c->due)
+		p = p->prev;
+
+	c->prev = p;
+	c->next = p ? p->next : h->head;
+	if (c->next)
+		c->next->prev = c;
+	else
+		h->tail = c;
+	if (p)
+		p->next = c;
+	else
+		h->head = c;
+	c->timed = true;
+
+	if (h->head == c)
+		(void)pthread_cond_signal(&h->cond);
+}
+
+/**
+ * @brief Record a time to first byte, and update the delay now and
+ *        then.
+ */
+nonnull_in()
+static void
+hedge_record (struct hedge *h,
+              uint64_t      us)
+{
+	uint32_t n = h->cfg.window;
+	h->lat[h->ilat] = us < UINT32_MAX ? (uint32_t)us : UINT32_MAX;
+	h->ilat = (h->ilat + 1U) % n;
+	if (h->nlat < n)
+		h->nlat += 1U;
+	if (++h->fresh < HEDGE_SAMPLES)
+		return;
+	h->fresh = 0;
+
+	/* The second half of the buffer is scratch space. */
+	uint32_t *v = &h->lat[n];
+	memcpy(v, h->lat, h->nlat * sizeof *v);
+	qsort(v, h->nlat, sizeof *v, hedge_cmp);
+	uint64_t d = v[(h->nlat - 1U) * h->cfg.percentile / 1000U];
+
+	uint64_t lo = h->cfg.min_ms * UINT64_C(1000);
+	uint64_t hi = h->cfg.max_ms * UINT64_C(1000);
+	d = d < lo ? lo : d > hi ? hi : d;
+	h->stats.delay_us = (uint32_t)d;
+}
+
+/**
+ * @brief Drop a reference to a call, freeing it with the last one.
+ */
+nonnull_in()
+static void
+hedge_put (struct hedge_call *c)
+{
+	struct hedge *h = c->h;
+	(void)pthread_mutex_lock(&h->lock);
+	bool last = !--c->refs;
+	(void)pthread_mutex_unlock(&h->lock);
+	if (last)
+		free(c);
+}
+
+/**
+ * @brief Check if a leg's callbacks are passed on, making it the one
+ *        that is if neither is yet.
+ */
+nonnull_in()
+static bool
+hedge_claim (struct hedge_leg *g)
+{
+	struct hedge_call *c = g->c;
+	uint32_t w = __atomic_load_n(&c->winner, __ATOMIC_ACQUIRE);
+	if (w)
+		return w == g->i + 1U;
+	if (!__atomic_compare_exchange_n(&c->winner, &w, g->i + 1U, false,
+	                                 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		return false;
+
+	struct hedge *h = c->h;
+	struct hedge_leg *o = &c->leg[!g->i];
+	(void)pthread_mutex_lock(&h->lock);
+	hedge_untime(h, c);
+	hedge_record(h, mono_us() - g->start);
+	bool cancel = c->legs > 1U && !o->done;
+	if (c->legs > 1U) {
+		if (g->i)
+			h->stats.hedge_won += 1U;
+		else
+			h->stats.first_won += 1U;
+	}
+	(void)pthread_mutex_unlock(&h->lock);
+
+	if (cancel)
+		(void)hloop_cancel(h->l, o);
+	return true;
+}
+
+static void
+hedge_on_header (void       *ctx,
+                 char const *s,
+                 size_t      n)
+{
+	struct hedge_leg *g = ctx;
+	if (hedge_claim(g) && g->c->ops->header)
+		g->c->ops->header(g->c->ctx, s, n);
+}
+
+static void
+hedge_on_head (void                    *ctx,
+               struct http_frame const *f)
+{
+	struct hedge_leg *g = ctx;
+	if (hedge_claim(g) && g->c->ops->head)
+		g->c->ops->head(g->c->ctx, f);
+}
+
+static void
+hedge_on_event (void                   *ctx,
+                struct sse_event const *ev)
+{
+	struct hedge_leg *g = ctx;
+	if (hedge_claim(g) && g->c->ops->event)
+		g->c->ops->event(g->c->ctx, ev);
+}
+
+static void
+hedge_on_data (void       *ctx,
+               void const *s,
+               size_t      n)
+{
+	struct hedge_leg *g = ctx;
+	if (hedge_claim(g) && g->c->ops->data)
+		g->c->ops->data(g->c->ctx, s, n);
+}
+
+static void
+hedge_on_done (void *ctx,
+               int   e,
+               int   status)
+{
+	struct hedge_leg *g = ctx;
+	struct hedge_call *c = g->c;
+	struct hedge *h = c->h;
+	struct hedge_leg *o = &c->leg[!g->i];
+	bool pass = false;
+
+	(void)pthread_mutex_lock(&h->lock);
+	g->done = true;
+	g->e = e;
+	g->status = status;
+	uint32_t w = __atomic_load_n(&c->winner, __ATOMIC_ACQUIRE);
+	if (w) {
+		pass = w == g->i + 1U;
+		if (!pass && e == ECANCELED)
+			h->stats.cancelled += 1U;
+	} else if (c->legs < 2U || o->done) {
+		/* Neither stream started. Don't wait for a hedge that
+		 * wasn't sent, and when both failed, report the first. */
+		hedge_untime(h, c);
+		__atomic_store_n(&c->winner, g->i + 1U, __ATOMIC_RELEASE);
+		if (c->legs > 1U) {
+			e = c->leg[0].e;
+			status = c->leg[0].status;
+		}
+		pass = true;
+	}
+	(void)pthread_mutex_unlock(&h->lock);
+
+	if (pass && c->ops->done)
+		c->ops->done(c->ctx, e, status);
+	hedge_put(c);
+}
+
+static struct hloop_ops const hedge_leg_ops = {
+	.header = hedge_on_header,
+	.head   = hedge_on_head,
+	.event  = hedge_on_event,
+	.data   = hedge_on_data,
+	.done   = hedge_on_done,
+};
+
+/**
+ * @brief Send the hedge of a call that is due, if the budget allows.
+ *
+ * Called and returns with the lock held.
+ */
+nonnull_in()
+static void
+hedge_fire (struct hedge      *h,
+            struct hedge_call *c,
+            uint64_t           now)
+{
+	hedge_untime(h, c);
+	if (h->tokens < 1.0) {
+		h->stats.denied += 1U;
+		return;
+	}
+	h->tokens -= 1.0;
+	h->stats.hedged += 1U;
+	c->legs = 2U;
+	/* One for the hedge, and one to keep the call around until done
+	 * with it here, as both legs may finish before that. */
+	c->refs += 2U;
+	c->leg[1].start = now;
+	(void)pthread_mutex_unlock(&h->lock);
+
+	struct http_request r = c->req;
+	if (h->cfg.alt_host)
+		r.host = h->cfg.alt_host;
+	if (h->cfg.alt_port)
+		r.port = h->cfg.alt_port;
+	int e = hloop_submit(h->l, &r, &hedge_leg_ops, &c->leg[1]);
+	if (e)
+		hedge_on_done(&c->leg[1], e, 0);
+	else if (__atomic_load_n(&c->winner, __ATOMIC_ACQUIRE) == 1U)
+		/* The first stream started before the hedge was sent. */
+		(void)hloop_cancel(h->l, &c->leg[1]);
+
+	hedge_put(c);
+	(void)pthread_mutex_lock(&h->lock);
+}
+
+static void *
+hedge_main (void *arg)
+{
+	struct hedge *h = arg;
+	(void)pthread_mutex_lock(&h->lock);
+	while (!h->stop) {
+		struct hedge_call *c = h->head;
+		uint64_t now = mono_us();
+		if (!c) {
+			(void)pthread_cond_wait(&h->cond, &h->lock);
+		} else if (c->due > now) {
+			struct timespec ts = {
+				.tv_sec  = (time_t)(c->due / 1000000U),
+				.tv_nsec = (long)(c->due % 1000000U) * 1000L,
+			};
+			(void)pthread_cond_timedwait(&h->cond, &h->lock, &ts);
+		} else {
+			hedge_fire(h, c, now);
+		}
+	}
+	(void)pthread_mutex_unlock(&h->lock);
+	return nullptr;
+}
+
+int
+hedge_init (struct hedge           *h,
+            struct hloop           *l,
+            struct hedge_cfg const *cfg)
+{
+	*h = (struct hedge){
+		.l   = l,
+		.cfg = cfg ? *cfg : (struct hedge_cfg){0},
+	};
+	struct hedge_cfg *c = &h->cfg;
+	if (!c->percentile)
+		c->percentile = HEDGE_PERCENTILE;
+	if (c->percentile > 1000U)
+		c->percentile = 1000U;
+	if (!c->window)
+		c->window = HEDGE_WINDOW;
+	if (!c->min_ms)
+		c->min_ms = HEDGE_MIN_MS;
+	if (!c->max_ms)
+		c->max_ms = HEDGE_MAX_MS;
+	if (c->max_ms < c->min_ms)
+		c->max_ms = c->min_ms;
+	if (!c->budget)
+		c->budget = HEDGE_BUDGET;
+	if (!c->burst)
+		c->burst = HEDGE_BURST;
+	h->tokens = c->burst;
+	h->stats.delay_us = c->max_ms * 1000U;
+
+	h->lat = calloc(c->window * 2U, sizeof *h->lat);
+	if (!h->lat)
+		return errno;
+
+	int e = pthread_condattr_init(&h->attr);
+	if (!e) {
+		e = pthread_condattr_setclock(&h->attr, CLOCK_MONOTONIC);
+		if (!e)
+			e = pthread_cond_init(&h->cond, &h->attr);
+		if (!e) {
+			e = pthread_mutex_init(&h->lock, nullptr);
+			if (!e) {
+				e = pthread_create(&h->tid, nullptr,
+				                   hedge_main, h);
+				if (e)
+					(void)pthread_mutex_destroy(&h->lock);
+			}
+			if (e)
+				(void)pthread_cond_destroy(&h->cond);
+		}
+		if (e)
+			(void)pthread_condattr_destroy(&h->attr);
+	}
+	if (e) {
+		free(h->lat);
+		h->lat = nullptr;
+	}
+	return e;
+}
+
+void
+hedge_fini (struct hedge *h)
+{
+	(void)pthread_mutex_lock(&h->lock);
+	h->stop = true;
+	(void)pthread_cond_signal(&h->cond);
+	(void)pthread_mutex_unlock(&h->lock);
+	(void)pthread_join(h->tid, nullptr);
+
+	(void)pthread_mutex_destroy(&h->lock);
+	(void)pthread_cond_destroy(&h->cond);
+	(void)pthread_condattr_destroy(&h->attr);
+	free(h->lat);
+	h->lat = nullptr;
+}
+
+int
+hedge_submit (struct hedge              *h,
+              struct http_request const *req,
+              struct hloop_ops const    *ops,
+              void                      *ctx)
+{
+	struct hedge_call *c = malloc(sizeof *c);
+	if (!c)
+		return errno;
+
+	*c = (struct hedge_call){
+		.h    = h,
+		.req  = *req,
+		.ops  = ops,
+		.ctx  = ctx,
+		.leg  = {{.c = c, .i = 0}, {.c = c, .i = 1}},
+		.legs = 1U,
+		.refs = 2U,
+	};
+	uint64_t now = mono_us();
+	c->leg[0].start = now;
+
+	int e = hloop_submit(h->l, req, &hedge_leg_ops, &c->leg[0]);
+	if (e) {
+		free(c);
+		return e;
+	}
+
+	(void)pthread_mutex_lock(&h->lock);
+	h->stats.requests += 1U;
+	h->tokens += h->cfg.budget / 1000.0;
+	if (h->tokens > h->cfg.burst)
+		h->tokens = h->cfg.burst;
+	if (!__atomic_load_n(&c->winner, __ATOMIC_ACQUIRE)) {
+		c->due = now + h->stats.delay_us;
+		hedge_time(h, c);
+	}
+	(void)pthread_mutex_unlock(&h->lock);
+
+	hedge_put(c);
+	return 0;
+}
+
+struct hedge_stats
+hedge_stats (struct hedge *h)
+{
+	(void)pthread_mutex_lock(&h->lock);
+	struct hedge_stats st = h->stats;
+	(void)pthread_mutex_unlock(&h->lock);
+	return st;
+}
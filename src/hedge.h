@@ -0,0 +1,156 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file hedge.h
+ *
+ * @brief Hedged requests on an event loop.
+ *
+ * A request that hasn't got the first byte of its response after a
+ * delay is sent once more, to an alternate endpoint if one is set, and
+ * otherwise to the same one, where it goes out on another connection.
+ * Whichever of the two streams starts first is passed on, and the other
+ * one is cancelled at once. The delay is a percentile of recent times
+ * to first byte, so only the slowest few requests are hedged, and a
+ * budget every request pays into limits the hedges to a share of the
+ * traffic, also when everything is slow.
+ *
+ * A hedged request may be processed twice by the server, so only hedge
+ * requests that are safe to send more than once.
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_HEDGE_H_
+#define LIBCANTH_SRC_HEDGE_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hloop.h"
+#include "http.h"
+#include "util.h"
+
+/**
+ * @brief Default percentile of the time to first byte to hedge after,
+ *        in permille.
+ */
+#define HEDGE_PERCENTILE 950U
+
+/**
+ * @brief Default number of recent times to first byte kept.
+ */
+#define HEDGE_WINDOW 256U
+
+/**
+ * @brief Default shortest and longest delay. The longest one is also
+ *        used until enough times have been seen.
+ */
+#define HEDGE_MIN_MS 10U
+#define HEDGE_MAX_MS 1000U
+
+/**
+ * @brief Default hedges per request the budget allows, in permille.
+ */
+#define HEDGE_BUDGET 50U
+
+/**
+ * @brief Default hedges the budget holds, and starts out with.
+ */
+#define HEDGE_BURST 10U
+
+/**
+ * @brief Configuration. Zero fields take their defaults.
+ */
+struct hedge_cfg {
+	uint32_t    percentile; //!< Percentile to hedge after, in permille.
+	uint32_t    window;     //!< Recent times to first byte kept.
+	uint32_t    min_ms;     //!< Shortest delay.
+	uint32_t    max_ms;     //!< Longest delay.
+	uint32_t    budget;     //!< Hedges per request, in permille.
+	uint32_t    burst;      //!< Hedges the budget holds.
+	char const *alt_host;   //!< Alternate host, or `NULL` for the same.
+	char const *alt_port;   //!< Alternate port, or `NULL` for the same.
+};
+
+/**
+ * @brief Statistics.
+ */
+struct hedge_stats {
+	size_t   requests;  //!< Requests started.
+	size_t   hedged;    //!< Hedges sent.
+	size_t   hedge_won; //!< Hedges that started first.
+	size_t   first_won; //!< Hedged requests that started first anyway.
+	size_t   denied;    //!< Hedges refused by the budget.
+	size_t   cancelled; //!< Losing streams cancelled.
+	uint32_t delay_us;  //!< Current delay.
+};
+
+struct hedge_call;
+
+/**
+ * @brief Hedging policy on a loop group, shared by any number of
+ *        threads.
+ */
+struct hedge {
+	pthread_mutex_t     lock;   //!< Guards everything below.
+	pthread_cond_t      cond;   //!< Signaled when the timer changes.
+	pthread_condattr_t  attr;   //!< Monotonic clock for waits.
+	pthread_t           tid;    //!< Timer thread.
+	struct hloop       *l;      //!< Loop group.
+	struct hedge_cfg    cfg;    //!< Configuration.
+	struct hedge_call  *head;   //!< Calls waiting to hedge, by time.
+	struct hedge_call  *tail;   //!< Last of @ref hedge::head.
+	uint32_t           *lat;    //!< Recent times to first byte, in us.
+	size_t              nlat;   //!< Times in @ref hedge::lat.
+	size_t              ilat;   //!< Where the next time goes.
+	size_t              fresh;  //!< Times since the delay was set.
+	double              tokens; //!< Hedges the budget allows now.
+	struct hedge_stats  stats;  //!< Statistics.
+	bool                stop;   //!< Timer thread should exit.
+};
+
+/**
+ * @brief Start a hedging policy.
+ *
+ * @param[out]    h   Policy.
+ * @param[in,out] l   Loop group to send requests on.
+ * @param[in]     cfg Configuration, or `NULL` for the defaults. The
+ *                    alternate endpoint strings must outlive @p h.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+hedge_init (struct hedge           *h,
+            struct hloop           *l,
+            struct hedge_cfg const *cfg) nonnull_in(1,2);
+
+/**
+ * @brief Stop a hedging policy. No requests may be left.
+ */
+extern void
+hedge_fini (struct hedge *h) nonnull_in();
+
+/**
+ * @brief Start a request that may be hedged.
+ *
+ * Works as @ref hloop_submit(), except that @p req and everything it
+ * points to must stay valid until `done` is called, since a hedge may
+ * be sent later. Only the stream that started first reaches @p ops.
+ *
+ * @param[in,out] h   Policy.
+ * @param[in]     req Request.
+ * @param[in]     ops Callbacks, which must outlive the request.
+ * @param[in]     ctx Passed to the callbacks.
+ * @return 0 if the request was started, otherwise an error code. No
+ *         callback is made for a request that wasn't started.
+ */
+extern int
+hedge_submit (struct hedge              *h,
+              struct http_request const *req,
+              struct hloop_ops const    *ops,
+              void                      *ctx) nonnull_in(1,2,3);
+
+/**
+ * @brief Get a snapshot of the statistics.
+ */
+extern struct hedge_stats
+hedge_stats (struct hedge *h) nonnull_in();
+
+#endif /* LIBCANTH_SRC_HEDGE_H_ */
@@ -0,0 +1,1002 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file hloop.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "hloop.h"
+#include "mono.h"
+
+/**
+ * @brief Interval of the timeout and idle connection sweep.
+ */
+#define HLOOP_SWEEP_MS 1000U
+
+/**
+ * @brief Readiness events taken from epoll at once.
+ */
+#define HLOOP_EVENTS 64U
+
+/**
+ * @brief Where a stream is in its exchange.
+ */
+fixed_enum(hloop_state, uint8_t) {
+	hloop_connect,    //!< Waiting for the connection to open.
+	hloop_send,       //!< Sending the request.
+	hloop_status,     //!< Waiting for the status line.
+	hloop_header,     //!< Reading header lines.
+	hloop_sized,      //!< Reading a body of known size.
+	hloop_chunk_size, //!< Waiting for a chunk size line.
+	hloop_chunk,      //!< Reading chunk data.
+	hloop_chunk_end,  //!< Waiting for the line ending a chunk.
+	hloop_trailer,    //!< Reading trailer lines.
+	hloop_until_eof,  //!< Reading a body that ends with the connection.
+};
+
+/**
+ * @brief Resolved endpoint address.
+ */
+union hloop_addr {
+	struct sockaddr     sa;
+	struct sockaddr_in  in;
+	struct sockaddr_in6 in6;
+};
+
+/**
+ * @brief Idle connection.
+ */
+struct hloop_conn {
+	struct hloop_conn *next;  //!< Next idle connection.
+	uint64_t           since; //!< When the connection became idle.
+	union hloop_addr   addr;  //!< Peer address.
+	socklen_t          alen;  //!< Length of @ref hloop_conn::addr.
+	int                fd;    //!< Socket.
+};
+
+/**
+ * @brief Request in flight.
+ *
+ * Nothing of the response is buffered except a line or an event cut
+ * off by the end of a read.
+ */
+struct hloop_stream {
+	struct hloop_stream    *prev;      //!< Previous active stream.
+	struct hloop_stream    *next;      //!< Next active or queued stream.
+	struct hloop_ops const *ops;       //!< Callbacks.
+	void                   *ctx;       //!< Callback context.
+	char                   *out;       //!< Request head and body.
+	size_t                  olen;      //!< Length of @ref hloop_stream::out.
+	size_t                  osent;     //!< Bytes of it sent.
+	uint64_t                deadline;  //!< When the stream times out.
+	uint64_t                left;      //!< Bytes left of a body or chunk.
+	uint8_t                *line;      //!< Line cut off by the end of a read.
+	uint32_t                llen;      //!< Bytes in @ref hloop_stream::line.
+	uint32_t                lcap;      //!< Size of @ref hloop_stream::line.
+	struct sse              sse;       //!< Event parser.
+	struct http_frame       f;         //!< Response framing.
+	union hloop_addr        addr;      //!< Peer address.
+	socklen_t               alen;      //!< Length of @ref hloop_stream::addr.
+	int                     fd;        //!< Socket, or -1.
+	enum hloop_state        state;     //!< Exchange state.
+	bool                    warm;      //!< Connection was reused.
+	bool                    recvd;     //!< Response input arrived.
+	bool                    extra;     //!< Input followed the response.
+	bool                    closes;    //!< Request asked to close.
+	bool                    head_only; //!< Request method is HEAD.
+	bool                    killed;    //!< Cancelled, not yet finished.
+};
+
+/**
+ * @brief Loop thread.
+ */
+struct hloop_thread {
+	pthread_t            tid;    //!< Thread.
+	pthread_mutex_t      lock;   //!< Guards inbox and stop.
+	struct hloop_stream *inbox;  //!< Submitted streams, latest first.
+	struct hloop_stream *active; //!< Streams being driven.
+	struct hloop_conn   *idle;   //!< Idle connections, latest first.
+	struct hloop const  *l;      //!< Owning group.
+	uint8_t             *buf;    //!< Receive buffer.
+	struct hloop_stats   stats;  //!< Statistics, atomically updated.
+	int                  epfd;   //!< Epoll instance.
+	int                  evfd;   //!< Wakeup event.
+	bool                 stop;   //!< Exit requested.
+	bool                 kills;  //!< Some active streams are killed.
+};
+
+static force_inline void
+hloop_count (size_t *n,
+             ssize_t d)
+{
+	(void)__atomic_add_fetch(n, (size_t)d, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Check if an idle connection is still open.
+ */
+static bool
+hloop_alive (int fd)
+{
+	uint8_t b;
+	ssize_t r = recv(fd, &b, 1U, MSG_PEEK | MSG_DONTWAIT);
+	return r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+/**
+ * @brief Watch a stream's socket for both directions, edge-triggered.
+ */
+nonnull_in()
+static int
+hloop_watch (struct hloop_thread *t,
+             struct hloop_stream *s)
+{
+	struct epoll_event ev = {
+		.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+		.data   = {.ptr = s},
+	};
+	return epoll_ctl(t->epfd, EPOLL_CTL_ADD, s->fd, &ev) ? errno : 0;
+}
+
+/**
+ * @brief Start opening a new connection for a stream.
+ */
+nonnull_in()
+static int
+hloop_open (struct hloop_thread *t,
+            struct hloop_stream *s)
+{
+	int fd = socket(s->addr.sa.sa_family,
+	                SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return errno;
+
+	int one = 1;
+	if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one)) {
+		int e = errno;
+		(void)close(fd);
+		return e;
+	}
+
+	if (connect(fd, &s->addr.sa, s->alen)) {
+		if (errno != EINPROGRESS) {
+			int e = errno;
+			(void)close(fd);
+			return e;
+		}
+		s->state = hloop_connect;
+	} else {
+		s->state = hloop_send;
+	}
+
+	s->fd = fd;
+	s->warm = false;
+	hloop_count(&t->stats.connects, 1);
+	return hloop_watch(t, s);
+}
+
+/**
+ * @brief Take an idle connection to the stream's peer, if there is one.
+ */
+nonnull_in()
+static bool
+hloop_reuse (struct hloop_thread *t,
+             struct hloop_stream *s)
+{
+	for (struct hloop_conn *c, **p = &t->idle; (c = *p);) {
+		if (c->alen != s->alen ||
+		    __builtin_memcmp(&c->addr, &s->addr, s->alen)) {
+			p = &c->next;
+			continue;
+		}
+
+		*p = c->next;
+		hloop_count(&t->stats.idle, -1);
+		int fd = c->fd;
+		free(c);
+
+		if (!hloop_alive(fd)) {
+			(void)close(fd);
+			continue;
+		}
+
+		s->fd = fd;
+		s->warm = true;
+		s->state = hloop_send;
+		if (hloop_watch(t, s)) {
+			(void)close(fd);
+			s->fd = -1;
+			return false;
+		}
+
+		hloop_count(&t->stats.reuses, 1);
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * @brief Retire a stream and report how it went.
+ *
+ * The connection goes to the idle list if the response was complete and
+ * neither side asked for it to be closed.
+ */
+nonnull_in()
+static void
+hloop_finish (struct hloop_thread *t,
+              struct hloop_stream *s,
+              int                  e)
+{
+	if (s->prev)
+		s->prev->next = s->next;
+	else if (t->active == s)
+		t->active = s->next;
+	if (s->next)
+		s->next->prev = s->prev;
+
+	if (s->fd >= 0) {
+		bool keep = !e && s->f.keep && s->f.status != 101 &&
+		            !s->extra && !s->closes;
+		struct hloop_conn *c = nullptr;
+		if (keep && !epoll_ctl(t->epfd, EPOLL_CTL_DEL, s->fd, nullptr))
+			c = malloc(sizeof *c);
+		if (c) {
+			c->next = t->idle;
+			c->since = mono_ms();
+			c->addr = s->addr;
+			c->alen = s->alen;
+			c->fd = s->fd;
+			t->idle = c;
+			hloop_count(&t->stats.idle, 1);
+		} else {
+			(void)close(s->fd);
+		}
+	}
+
+	if (s->ops->done)
+		s->ops->done(s->ctx, e, s->f.status);
+
+	hloop_count(&t->stats.requests, 1);
+	hloop_count(&t->stats.streams, -1);
+
+	sse_fini(&s->sse);
+	free(s->line);
+	free(s->out);
+	free(s);
+}
+
+/**
+ * @brief Send what the socket will take of the request.
+ *
+ * @return 0 once the request is sent, `EAGAIN` if the socket is full,
+ *         otherwise an error code.
+ */
+nonnull_in()
+static int
+hloop_send_out (struct hloop_stream *s)
+{
+	while (s->osent < s->olen) {
+		ssize_t r = send(s->fd, &s->out[s->osent], s->olen - s->osent,
+		                 MSG_NOSIGNAL);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno == EWOULDBLOCK ? EAGAIN : errno;
+		}
+		s->osent += (size_t)r;
+	}
+
+	s->state = hloop_status;
+	return 0;
+}
+
+/**
+ * @brief Get the next line of the response head or chunk framing.
+ *
+ * A line cut off by the end of the input is kept for the next read.
+ *
+ * @return 0 if a line was found, `EAGAIN` if the input ran out,
+ *         otherwise an error code.
+ */
+nonnull_in()
+static int
+hloop_line (struct hloop_stream  *s,
+            uint8_t const        *p,
+            size_t                n,
+            size_t               *i,
+            char const          **ln,
+            size_t               *m)
+{
+	uint8_t const *nl = __builtin_memchr(&p[*i], '\n', n - *i);
+	size_t end = nl ? (size_t)(nl - p) + 1U : n;
+	size_t k = end - *i;
+
+	if (s->llen || !nl) {
+		if (k > HTTP_BUF_SIZE - s->llen)
+			return EPROTO;
+		if (s->llen + k > s->lcap) {
+			uint32_t c = s->lcap ? s->lcap : 64U;
+			while (c < s->llen + k)
+				c *= 2U;
+			uint8_t *b = realloc(s->line, c);
+			if (!b)
+				return errno;
+			s->line = b;
+			s->lcap = c;
+		}
+		__builtin_memcpy(&s->line[s->llen], &p[*i], k);
+		s->llen += (uint32_t)k;
+		*i = end;
+		if (!nl)
+			return EAGAIN;
+		*ln = (char const *)s->line;
+		k = s->llen;
+		s->llen = 0;
+	} else {
+		*ln = (char const *)&p[*i];
+		*i = end;
+	}
+
+	k -= 1U;
+	*m = k && (*ln)[k - 1U] == '\r' ? k - 1U : k;
+	return 0;
+}
+
+/**
+ * @brief Act on a line of the response head or chunk framing.
+ *
+ * @return 0 if the response is complete, `EAGAIN` if more is expected,
+ *         otherwise an error code.
+ */
+nonnull_in()
+static int
+hloop_framing (struct hloop_stream *s,
+               char const          *ln,
+               size_t               m)
+{
+	int e;
+
+	switch (s->state) {
+	case hloop_status:
+		e = http_frame_status(&s->f, ln, m);
+		if (e)
+			return e;
+		s->state = hloop_header;
+		return EAGAIN;
+
+	case hloop_header:
+		if (m) {
+			e = http_frame_header(&s->f, ln, m);
+			if (e)
+				return e;
+			if (s->ops->header)
+				s->ops->header(s->ctx, ln, m);
+			return EAGAIN;
+		}
+		if (s->f.status < 200 && s->f.status != 101) {
+			s->state = hloop_status;
+			return EAGAIN;
+		}
+		if (s->ops->head)
+			s->ops->head(s->ctx, &s->f);
+		if (s->f.status == 101 ||
+		    !http_frame_body(&s->f, s->head_only ? "HEAD" : "GET"))
+			return 0;
+		if (s->f.chunked) {
+			s->state = hloop_chunk_size;
+		} else if (s->f.sized) {
+			if (!s->f.length)
+				return 0;
+			s->left = s->f.length;
+			s->state = hloop_sized;
+		} else {
+			s->f.keep = false;
+			s->state = hloop_until_eof;
+		}
+		return EAGAIN;
+
+	case hloop_chunk_size:
+		e = http_chunk_size(ln, m, &s->left);
+		if (e)
+			return e;
+		s->state = s->left ? hloop_chunk : hloop_trailer;
+		return EAGAIN;
+
+	case hloop_chunk_end:
+		if (m)
+			return EPROTO;
+		s->state = hloop_chunk_size;
+		return EAGAIN;
+
+	case hloop_trailer:
+		return m ? EAGAIN : 0;
+
+	default:
+		return EPROTO;
+	}
+}
+
+/**
+ * @brief Hand body bytes to the stream's callbacks.
+ */
+nonnull_in()
+static int
+hloop_body (struct hloop_thread *t,
+            struct hloop_stream *s,
+            uint8_t const       *p,
+            size_t               n)
+{
+	if (!s->f.events) {
+		if (s->ops->data)
+			s->ops->data(s->ctx, p, n);
+		return 0;
+	}
+
+	size_t off = 0;
+	size_t events = s->sse.events;
+	struct sse_event ev;
+	int e;
+	while (!(e = sse_feed(&s->sse, p, n, &off, &ev))) {
+		if (s->ops->event)
+			s->ops->event(s->ctx, &ev);
+	}
+	hloop_count(&t->stats.events, (ssize_t)(s->sse.events - events));
+
+	return e == EAGAIN ? 0 : e;
+}
+
+/**
+ * @brief Parse received input.
+ *
+ * @return 0 if the response is complete, `EAGAIN` if more is expected,
+ *         otherwise an error code.
+ */
+nonnull_in()
+static int
+hloop_input (struct hloop_thread *t,
+             struct hloop_stream *s,
+             uint8_t const       *p,
+             size_t               n)
+{
+	for (size_t i = 0; i < n;) {
+		int e;
+
+		if (s->state == hloop_sized || s->state == hloop_chunk ||
+		    s->state == hloop_until_eof) {
+			size_t k = n - i;
+			if (s->state != hloop_until_eof) {
+				if (k > s->left)
+					k = (size_t)s->left;
+				s->left -= k;
+			}
+			e = hloop_body(t, s, &p[i], k);
+			if (e)
+				return e;
+			i += k;
+			if (s->left || s->state == hloop_until_eof)
+				continue;
+			if (s->state == hloop_sized) {
+				s->extra = i < n;
+				return 0;
+			}
+			s->state = hloop_chunk_end;
+			continue;
+		}
+
+		char const *ln = nullptr;
+		size_t m = 0;
+		e = hloop_line(s, p, n, &i, &ln, &m);
+		if (!e)
+			e = hloop_framing(s, ln, m);
+		if (e != EAGAIN) {
+			s->extra = i < n;
+			return e;
+		}
+	}
+
+	return EAGAIN;
+}
+
+/**
+ * @brief Read until the socket runs dry or the response is complete.
+ *
+ * @return 0 if the response is complete, `EAGAIN` if more is expected,
+ *         otherwise an error code.
+ */
+nonnull_in()
+static int
+hloop_recv (struct hloop_thread *t,
+            struct hloop_stream *s)
+{
+	for (;;) {
+		ssize_t r = recv(s->fd, t->buf, HLOOP_RECV_SIZE, 0);
+		if (r > 0) {
+			s->recvd = true;
+			int e = hloop_input(t, s, t->buf, (size_t)r);
+			if (e != EAGAIN)
+				return e;
+			continue;
+		}
+
+		if (!r) {
+			if (s->state == hloop_until_eof)
+				return 0;
+			return s->recvd ? EPROTO : ECONNRESET;
+		}
+
+		if (errno == EINTR)
+			continue;
+		return errno == EWOULDBLOCK ? EAGAIN : errno;
+	}
+}
+
+/**
+ * @brief Drive a stream whose socket became ready.
+ */
+nonnull_in()
+static void
+hloop_ready (struct hloop_thread *t,
+             struct hloop_stream *s,
+             uint32_t             events)
+{
+	int e = 0;
+
+	if (s->state == hloop_connect) {
+		socklen_t n = sizeof e;
+		if (!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+			return;
+		if (getsockopt(s->fd, SOL_SOCKET, SO_ERROR, &e, &n))
+			e = errno;
+		if (!e)
+			s->state = hloop_send;
+	}
+
+	if (!e && s->state == hloop_send)
+		e = hloop_send_out(s);
+
+	if (!e)
+		e = hloop_recv(t, s);
+
+	if (e == EAGAIN) {
+		s->deadline = mono_ms() + t->l->cfg.timeout_ms;
+		return;
+	}
+
+	if (e && s->warm && !s->recvd &&
+	    (e == ECONNRESET || e == EPIPE || e == ECONNABORTED)) {
+		(void)close(s->fd);
+		s->fd = -1;
+		s->osent = 0;
+		hloop_count(&t->stats.retries, 1);
+		e = hloop_open(t, s);
+		if (!e)
+			return;
+	}
+
+	hloop_finish(t, s, e);
+}
+
+/**
+ * @brief Put a submitted stream on its way.
+ */
+nonnull_in()
+static void
+hloop_start (struct hloop_thread *t,
+             struct hloop_stream *s)
+{
+	s->prev = nullptr;
+	s->next = t->active;
+	if (t->active)
+		t->active->prev = s;
+	t->active = s;
+	s->deadline = mono_ms() + t->l->cfg.timeout_ms;
+
+	/* A new or reused socket is reported writable as soon as it is
+	 * added to epoll, so sending starts from the event loop. */
+	if (!hloop_reuse(t, s)) {
+		int e = hloop_open(t, s);
+		if (e)
+			hloop_finish(t, s, e);
+	}
+}
+
+/**
+ * @brief Mark the streams with a context cancelled, for
+ *        @ref hloop_cancel().
+ *
+ * They are only finished by @ref hloop_reap() once the current batch of
+ * readiness events is handled, since a later event of the batch may
+ * still point to one of them.
+ */
+nonnull_in(1)
+static void
+hloop_kill (struct hloop_thread *t,
+            void                *ctx)
+{
+	for (struct hloop_stream *s = t->active; s; s = s->next) {
+		if (s->ctx == ctx) {
+			s->killed = true;
+			t->kills = true;
+		}
+	}
+}
+
+/**
+ * @brief Finish the streams marked by @ref hloop_kill().
+ */
+nonnull_in()
+static void
+hloop_reap (struct hloop_thread *t)
+{
+	if (!t->kills)
+		return;
+	t->kills = false;
+	for (struct hloop_stream *s = t->active, *next; s; s = next) {
+		next = s->next;
+		if (s->killed)
+			hloop_finish(t, s, ECANCELED);
+	}
+}
+
+/**
+ * @brief Fail timed out streams and close expired idle connections.
+ */
+nonnull_in()
+static void
+hloop_sweep (struct hloop_thread *t,
+             uint64_t             now)
+{
+	for (struct hloop_stream *s = t->active, *next; s; s = next) {
+		next = s->next;
+		if (s->deadline <= now)
+			hloop_finish(t, s, ETIMEDOUT);
+	}
+
+	for (struct hloop_conn *c, **p = &t->idle; (c = *p);) {
+		if (now - c->since < t->l->cfg.idle_ms) {
+			p = &c->next;
+			continue;
+		}
+		*p = c->next;
+		(void)close(c->fd);
+		free(c);
+		hloop_count(&t->stats.idle, -1);
+	}
+}
+
+/**
+ * @brief Take the streams submitted to a thread.
+ *
+ * @return `true` if the thread should exit.
+ */
+nonnull_in()
+static bool
+hloop_drain (struct hloop_thread  *t,
+             struct hloop_stream **ret)
+{
+	uint64_t v;
+	(void)read(t->evfd, &v, sizeof v);
+
+	(void)pthread_mutex_lock(&t->lock);
+	struct hloop_stream *s = t->inbox;
+	bool stop = t->stop;
+	t->inbox = nullptr;
+	(void)pthread_mutex_unlock(&t->lock);
+
+	/* Restore submission order. */
+	struct hloop_stream *r = nullptr;
+	while (s) {
+		struct hloop_stream *next = s->next;
+		s->next = r;
+		r = s;
+		s = next;
+	}
+
+	*ret = r;
+	return stop;
+}
+
+static void *
+hloop_main (void *arg)
+{
+	struct hloop_thread *t = arg;
+	struct epoll_event ev[HLOOP_EVENTS];
+	uint64_t sweep = mono_ms() + HLOOP_SWEEP_MS;
+	bool stop = false;
+
+	while (!stop) {
+		int ms = -1;
+		if (t->active || t->idle) {
+			uint64_t now = mono_ms();
+			ms = sweep > now ? (int)(sweep - now) : 0;
+		}
+
+		int n = epoll_wait(t->epfd, ev, (int)HLOOP_EVENTS, ms);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		for (int i = 0; i < n; ++i) {
+			if (ev[i].data.ptr != t) {
+				struct hloop_stream *s = ev[i].data.ptr;
+				if (!s->killed)
+					hloop_ready(t, s, ev[i].events);
+				continue;
+			}
+			struct hloop_stream *s;
+			stop = hloop_drain(t, &s);
+			for (struct hloop_stream *next; s; s = next) {
+				next = s->next;
+				s->next = nullptr;
+				if (!s->ops) {
+					if (!stop)
+						hloop_kill(t, s->ctx);
+					free(s);
+				} else if (stop) {
+					hloop_finish(t, s, ECANCELED);
+				} else {
+					hloop_start(t, s);
+				}
+			}
+		}
+		hloop_reap(t);
+
+		uint64_t now = mono_ms();
+		if (now >= sweep) {
+			hloop_sweep(t, now);
+			sweep = now + HLOOP_SWEEP_MS;
+		}
+	}
+
+	/* Anything submitted after the last wakeup is still in the inbox. */
+	struct hloop_stream *s;
+	(void)hloop_drain(t, &s);
+	for (struct hloop_stream *next; s; s = next) {
+		next = s->next;
+		s->next = nullptr;
+		if (s->ops)
+			hloop_finish(t, s, ECANCELED);
+		else
+			free(s);
+	}
+	while (t->active)
+		hloop_finish(t, t->active, ECANCELED);
+	hloop_sweep(t, UINT64_MAX);
+
+	return nullptr;
+}
+
+/**
+ * @brief Stop a loop thread and release it.
+ */
+nonnull_in()
+static void
+hloop_thread_fini (struct hloop_thread *t,
+                   bool                 started)
+{
+	if (started) {
+		uint64_t one = 1;
+		(void)pthread_mutex_lock(&t->lock);
+		t->stop = true;
+		(void)pthread_mutex_unlock(&t->lock);
+		(void)write(t->evfd, &one, sizeof one);
+		(void)pthread_join(t->tid, nullptr);
+	}
+
+	if (t->evfd >= 0)
+		(void)close(t->evfd);
+	if (t->epfd >= 0)
+		(void)close(t->epfd);
+	free(t->buf);
+	(void)pthread_mutex_destroy(&t->lock);
+}
+
+/**
+ * @brief Set up a loop thread and start it.
+ */
+nonnull_in()
+static int
+hloop_thread_init (struct hloop_thread *t,
+                   struct hloop const  *l)
+{
+	*t = (struct hloop_thread){.l = l, .epfd = -1, .evfd = -1};
+
+	int e = pthread_mutex_init(&t->lock, nullptr);
+	if (e)
+		return e;
+
+	t->buf = malloc(HLOOP_RECV_SIZE);
+	t->epfd = epoll_create1(EPOLL_CLOEXEC);
+	t->evfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	struct epoll_event ev = {.events = EPOLLIN, .data = {.ptr = t}};
+
+	if (!t->buf || t->epfd < 0 || t->evfd < 0 ||
+	    epoll_ctl(t->epfd, EPOLL_CTL_ADD, t->evfd, &ev))
+		e = errno;
+	else
+		e = pthread_create(&t->tid, nullptr, hloop_main, t);
+
+	if (e)
+		hloop_thread_fini(t, false);
+	return e;
+}
+
+int
+hloop_init (struct hloop           *l,
+            struct hloop_cfg const *cfg)
+{
+	l->next = 0;
+	l->cfg = cfg ? *cfg : (struct hloop_cfg){0};
+
+	if (!l->cfg.threads)
+		l->cfg.threads = HLOOP_THREADS;
+	if (!l->cfg.idle_ms)
+		l->cfg.idle_ms = HTTP_IDLE_MS;
+	if (!l->cfg.timeout_ms)
+		l->cfg.timeout_ms = HTTP_TIMEOUT_MS;
+
+	l->threads = calloc(l->cfg.threads, sizeof *l->threads);
+	if (!l->threads)
+		return errno;
+
+	for (uint32_t i = 0; i < l->cfg.threads; ++i) {
+		int e = hloop_thread_init(&l->threads[i], l);
+		if (e) {
+			while (i)
+				hloop_thread_fini(&l->threads[--i], true);
+			free(l->threads);
+			l->threads = nullptr;
+			return e;
+		}
+	}
+
+	return 0;
+}
+
+void
+hloop_fini (struct hloop *l)
+{
+	for (uint32_t i = 0; i < l->cfg.threads; ++i)
+		hloop_thread_fini(&l->threads[i], true);
+
+	free(l->threads);
+	l->threads = nullptr;
+}
+
+/**
+ * @brief Put a stream in a thread's inbox and wake the thread.
+ */
+nonnull_in()
+static void
+hloop_post (struct hloop_thread *t,
+            struct hloop_stream *s)
+{
+	(void)pthread_mutex_lock(&t->lock);
+	bool wake = !t->inbox;
+	s->next = t->inbox;
+	t->inbox = s;
+	(void)pthread_mutex_unlock(&t->lock);
+
+	if (wake) {
+		uint64_t one = 1;
+		(void)write(t->evfd, &one, sizeof one);
+	}
+}
+
+int
+hloop_submit (struct hloop              *l,
+              struct http_request const *req,
+              struct hloop_ops const    *ops,
+              void                      *ctx)
+{
+	struct addrinfo *ai, hints = {
+		.ai_family   = AF_UNSPEC,
+		.ai_socktype = SOCK_STREAM,
+	};
+
+	int e = getaddrinfo(req->host, req->port, &hints, &ai);
+	if (e) {
+		return e == EAI_SYSTEM ? errno
+		     : e == EAI_MEMORY ? ENOMEM
+		                       : EHOSTUNREACH;
+	}
+
+	struct hloop_stream *s = nullptr;
+	if (ai->ai_addrlen > sizeof s->addr) {
+		freeaddrinfo(ai);
+		return EAFNOSUPPORT;
+	}
+
+	size_t body = 0;
+	for (size_t i = 0; i < req->nbody; ++i)
+		body += req->body[i].iov_len;
+
+	char *out = nullptr;
+	size_t n = 0;
+	e = http_request_head(req, body, &out, &n);
+	if (!e && !(s = malloc(sizeof *s))) {
+		e = errno;
+		free(out);
+	}
+	if (e) {
+		freeaddrinfo(ai);
+		return e;
+	}
+
+	for (size_t i = 0; i < req->nbody; ++i) {
+		__builtin_memcpy(&out[n], req->body[i].iov_base,
+		                 req->body[i].iov_len);
+		n += req->body[i].iov_len;
+	}
+
+	*s = (struct hloop_stream){
+		.ops       = ops,
+		.ctx       = ctx,
+		.out       = out,
+		.olen      = n,
+		.sse       = sse(),
+		.alen      = ai->ai_addrlen,
+		.fd        = -1,
+		.closes    = http_request_closes(req),
+		.head_only = !strcmp(req->method, "HEAD"),
+	};
+	__builtin_memcpy(&s->addr, ai->ai_addr, ai->ai_addrlen);
+	freeaddrinfo(ai);
+
+	uint32_t i = __atomic_fetch_add(&l->next, 1U, __ATOMIC_RELAXED);
+	struct hloop_thread *t = &l->threads[i % l->cfg.threads];
+	hloop_count(&t->stats.streams, 1);
+	hloop_post(t, s);
+	return 0;
+}
+
+int
+hloop_cancel (struct hloop *l,
+              void         *ctx)
+{
+	/* The stream may be on any thread. Each one gets a record with no
+	 * callbacks, which finishes the streams with the context that it
+	 * finds active, and so not a stream submitted after the call. */
+	int e = 0;
+	for (uint32_t i = 0; i < l->cfg.threads; ++i) {
+		struct hloop_stream *s = malloc(sizeof *s);
+		if (!s) {
+			e = errno;
+			continue;
+		}
+		*s = (struct hloop_stream){.ctx = ctx, .fd = -1};
+		hloop_post(&l->threads[i], s);
+	}
+	return e;
+}
+
+struct hloop_stats
+hloop_stats (struct hloop *l)
+{
+	struct hloop_stats st = {0};
+
+	for (uint32_t i = 0; i < l->cfg.threads; ++i) {
+		struct hloop_stats *t = &l->threads[i].stats;
+		st.streams  += __atomic_load_n(&t->streams, __ATOMIC_RELAXED);
+		st.requests += __atomic_load_n(&t->requests, __ATOMIC_RELAXED);
+		st.connects += __atomic_load_n(&t->connects, __ATOMIC_RELAXED);
+		st.reuses   += __atomic_load_n(&t->reuses, __ATOMIC_RELAXED);
+		st.retries  += __atomic_load_n(&t->retries, __ATOMIC_RELAXED);
+		st.events   += __atomic_load_n(&t->events, __ATOMIC_RELAXED);
+		st.idle     += __atomic_load_n(&t->idle, __ATOMIC_RELAXED);
+	}
+
+	return st;
+}
@@ -0,0 +1,186 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file hloop.h
+ *
+ * @brief Non-blocking HTTP/1.1 client on epoll event loops.
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_HLOOP_H_
+#define LIBCANTH_SRC_HLOOP_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "http.h"
+#include "sse.h"
+#include "util.h"
+
+/**
+ * @brief Default number of loop threads.
+ */
+#define HLOOP_THREADS 2U
+
+/**
+ * @brief Receive buffer size of a loop thread.
+ */
+#define HLOOP_RECV_SIZE 65536U
+
+/**
+ * @brief Loop configuration. Zero fields take their defaults.
+ */
+struct hloop_cfg {
+	uint32_t threads;    //!< Loop threads.
+	uint32_t idle_ms;    //!< Idle time before a connection is closed.
+	uint32_t timeout_ms; //!< Time a stream may go without progress.
+};
+
+/**
+ * @brief Loop statistics.
+ */
+struct hloop_stats {
+	size_t streams;  //!< Streams in progress.
+	size_t requests; //!< Streams completed, successfully or not.
+	size_t connects; //!< Connections opened.
+	size_t reuses;   //!< Streams started on a warm connection.
+	size_t retries;  //!< Streams resent after a stale connection.
+	size_t events;   //!< Server-sent events handed out.
+	size_t idle;     //!< Connections currently idle.
+};
+
+/**
+ * @brief Stream callbacks.
+ *
+ * The callbacks run on the loop thread that owns the stream and must
+ * not block. Any of them may be `NULL`.
+ */
+struct hloop_ops {
+	/**
+	 * @brief Response header line received.
+	 * @param ctx Stream context.
+	 * @param s   Line without the line terminator, valid during the
+	 *            call.
+	 * @param n   Length of @p s.
+	 */
+	void (*header)(void *ctx, char const *s, size_t n);
+
+	/**
+	 * @brief Response head received.
+	 * @param ctx Stream context.
+	 * @param f   Framing, including the status code.
+	 */
+	void (*head)(void *ctx, struct http_frame const *f);
+
+	/**
+	 * @brief Event of a `text/event-stream` response parsed.
+	 * @param ctx Stream context.
+	 * @param ev  Event, valid during the call.
+	 */
+	void (*event)(void *ctx, struct sse_event const *ev);
+
+	/**
+	 * @brief Body bytes of any other response received, with any
+	 *        chunked encoding removed.
+	 * @param ctx Stream context.
+	 * @param s   Bytes, valid during the call.
+	 * @param n   Number of bytes.
+	 */
+	void (*data)(void *ctx, void const *s, size_t n);
+
+	/**
+	 * @brief Stream finished. Called exactly once per stream.
+	 * @param ctx    Stream context.
+	 * @param e      0 on success, otherwise an error code.
+	 * @param status Status code, or 0 if no response head arrived.
+	 */
+	void (*done)(void *ctx, int e, int status);
+};
+
+struct hloop_thread;
+
+/**
+ * @brief Event loop group.
+ *
+ * Each loop thread waits on its own epoll instance and owns the streams
+ * and idle connections given to it. New streams are handed out to the
+ * threads in turn.
+ */
+struct hloop {
+	struct hloop_thread *threads; //!< Loop threads.
+	uint32_t             next;    //!< Next thread, atomically updated.
+	struct hloop_cfg     cfg;     //!< Configuration.
+};
+
+/**
+ * @brief Start the loop threads.
+ *
+ * @param[out] l   Loop group.
+ * @param[in]  cfg Configuration, or `NULL` for the defaults.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+hloop_init (struct hloop           *l,
+            struct hloop_cfg const *cfg) nonnull_in(1);
+
+/**
+ * @brief Stop the loop threads and release the group.
+ *
+ * Streams still in progress finish with `ECANCELED`.
+ */
+extern void
+hloop_fini (struct hloop *l) nonnull_in();
+
+/**
+ * @brief Start a request.
+ *
+ * The host name is resolved and the request copied before the call
+ * returns, so @p req need not outlive it. The rest happens on a loop
+ * thread: an idle connection to the same address is reused, or a new
+ * one opened without blocking, and the response is parsed as it
+ * arrives. A `text/event-stream` body goes through the server-sent
+ * events parser, so a stream only buffers an event cut off by the end
+ * of a read.
+ *
+ * As with @ref http_request(), a request that fails on a warm
+ * connection before any of the response arrives is sent once more on
+ * a new connection.
+ *
+ * @param[in,out] l   Loop group.
+ * @param[in]     req Request.
+ * @param[in]     ops Callbacks, which must outlive the stream.
+ * @param[in]     ctx Passed to the callbacks.
+ * @return 0 if the stream was started, otherwise an error code. A host
+ *         name that doesn't resolve is `EHOSTUNREACH`. No callback is
+ *         made for a stream that wasn't started.
+ */
+extern int
+hloop_submit (struct hloop              *l,
+              struct http_request const *req,
+              struct hloop_ops const    *ops,
+              void                      *ctx) nonnull_in(1,2,3);
+
+/**
+ * @brief Cancel the streams with a context.
+ *
+ * Streams submitted with @p ctx before the call finish with `ECANCELED`
+ * on their loop threads soon after, and their connections are closed
+ * rather than kept idle. A stream that already finished, or finishes
+ * first on its own, isn't affected, and neither is one submitted after
+ * the call.
+ *
+ * @param[in,out] l   Loop group.
+ * @param[in]     ctx Context the streams were submitted with.
+ * @return 0 on success, otherwise an error code, in which case some
+ *         streams might not be cancelled.
+ */
+extern int
+hloop_cancel (struct hloop *l,
+              void         *ctx) nonnull_in(1);
+
+/**
+ * @brief Get a snapshot of the statistics summed over all threads.
+ */
+extern struct hloop_stats
+hloop_stats (struct hloop *l) nonnull_in();
+
+#endif /* LIBCANTH_SRC_HLOOP_H_ */
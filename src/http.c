@@ -0,0 +1,1129 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file http.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "http.h"
+#include "mono.h"
+#include "num.h"
+
+/**
+ * @brief Maximum number of pieces passed to one `sendmsg()` call.
+ */
+#define HTTP_IOV_MAX 64U
+
+/**
+ * @brief Pooled connection.
+ */
+struct http_conn {
+	struct http_conn *next;       //!< Next idle connection.
+	uint64_t          idle_since; //!< When the connection was returned.
+	size_t            off;        //!< Start of unread input in buf.
+	size_t            len;        //!< End of unread input in buf.
+	int               fd;         //!< Socket.
+	bool              recvd;      //!< Input arrived for this request.
+	uint8_t           buf[HTTP_BUF_SIZE];
+};
+
+/**
+ * @brief Connections to one endpoint.
+ */
+struct http_host {
+	struct http_host *next;  //!< Next endpoint.
+	struct http_conn *idle;  //!< Idle connections, most recent first.
+	pthread_cond_t    cond;  //!< Signaled when a connection is freed.
+	uint32_t          open;  //!< Connections open, idle or in use.
+	char const       *port;  //!< Port, stored after the name.
+	char              name[];
+};
+
+/**
+ * @brief Growable byte buffer.
+ */
+struct http_buf {
+	uint8_t *p;
+	size_t   len;
+	size_t   cap;
+};
+
+static const_inline uint8_t
+http_lower (uint8_t c)
+{
+	return (unsigned)(c - 'A') < 26U ? c | 0x20U : c;
+}
+
+/**
+ * @brief Compare ASCII strings of equal length without regard to case.
+ */
+nonnull_in()
+static bool
+http_caseeq (char const *a,
+             char const *b,
+             size_t      n)
+{
+	for (size_t i = 0; i < n; ++i) {
+		if (http_lower((uint8_t)a[i]) != http_lower((uint8_t)b[i]))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Check if a comma-separated header value lists a token.
+ */
+nonnull_in()
+static bool
+http_has_token (char const *s,
+                size_t      n,
+                char const *tok)
+{
+	size_t m = strlen(tok);
+
+	for (size_t i = 0; i < n;) {
+		while (i < n && (s[i] == ' ' || s[i] == '\t' || s[i] == ','))
+			++i;
+		size_t a = i;
+		while (i < n && s[i] != ',')
+			++i;
+		size_t b = i;
+		while (b > a && (s[b - 1U] == ' ' || s[b - 1U] == '\t'))
+			--b;
+		if (b - a == m && http_caseeq(&s[a], tok, m))
+			return true;
+	}
+
+	return false;
+}
+
+nonnull_in()
+static int
+http_buf_reserve (struct http_buf *b,
+                  size_t           n)
+{
+	if (b->cap - b->len > n)
+		return 0;
+
+	/* Keep room for a terminator and the size within a dstr. */
+	if (n > UINT_MAX - 1U - b->len)
+		return EFBIG;
+
+	size_t cap = b->cap ? b->cap : 256U;
+	while (cap - b->len <= n)
+		cap *= 2U;
+	if (cap > UINT_MAX)
+		cap = UINT_MAX;
+
+	uint8_t *p = realloc(b->p, cap);
+	if (!p)
+		return errno;
+
+	b->p = p;
+	b->cap = cap;
+	return 0;
+}
+
+nonnull_in()
+static int
+http_buf_put (struct http_buf *b,
+              void const      *s,
+              size_t           n)
+{
+	int e = http_buf_reserve(b, n);
+	if (!e) {
+		__builtin_memcpy(&b->p[b->len], s, n);
+		b->len += n;
+	}
+	return e;
+}
+
+/**
+ * @brief Hand a buffer over to a @ref dstr.
+ */
+nonnull_in()
+static dstr
+http_buf_take (struct http_buf *b)
+{
+	dstr d = {0};
+
+	if (b->len < sizeof d.arr) {
+		if (b->len)
+			d = make_dstr_from_small_string((char *)b->p, b->len);
+		free(b->p);
+	} else {
+		b->p[b->len] = '\0';
+		d = (dstr){.ptr = (char *)b->p, .size = (unsigned)b->cap,
+		           .len = (unsigned)b->len};
+	}
+
+	*b = (struct http_buf){0};
+	return d;
+}
+
+nonnull_in()
+static void
+http_close (struct http_conn *c)
+{
+	(void)close(c->fd);
+	free(c);
+}
+
+/**
+ * @brief Check that an idle connection is still usable.
+ *
+ * A server that timed out the connection has sent a FIN, which shows
+ * up as end of input without blocking. Unsolicited input means the
+ * connection is out of step and can't be used either.
+ */
+nonnull_in()
+static bool
+http_alive (struct http_conn const *c)
+{
+	uint8_t b;
+	if (c->off != c->len)
+		return false;
+	ssize_t n = recv(c->fd, &b, 1U, MSG_PEEK | MSG_DONTWAIT);
+	return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+/**
+ * @brief Close the expired idle connections of an endpoint.
+ *
+ * @return Number of connections closed.
+ */
+nonnull_in()
+static size_t
+http_host_reap (struct http_pool *p,
+                struct http_host *h,
+                uint64_t          now)
+{
+	size_t n = 0;
+
+	for (struct http_conn **pc = &h->idle; *pc;) {
+		struct http_conn *c = *pc;
+		if (now - c->idle_since < p->cfg.idle_ms) {
+			pc = &c->next;
+			continue;
+		}
+		*pc = c->next;
+		http_close(c);
+		++n;
+	}
+
+	if (n) {
+		h->open -= (uint32_t)n;
+		p->stats.idle -= n;
+		p->stats.reaped += n;
+		(void)pthread_cond_broadcast(&h->cond);
+	}
+
+	return n;
+}
+
+/**
+ * @brief Find or add an endpoint. Called with the pool locked.
+ */
+nonnull_in()
+static int
+http_host_get (struct http_pool  *p,
+               char const        *name,
+               char const        *port,
+               struct http_host **ret)
+{
+	struct http_host *h = p->hosts;
+
+	for (; h; h = h->next) {
+		if (!strcmp(h->name, name) && !strcmp(h->port, port)) {
+			*ret = h;
+			return 0;
+		}
+	}
+
+	size_t n = strlen(name) + 1U;
+	size_t m = strlen(port) + 1U;
+	h = malloc(sizeof *h + n + m);
+	if (!h)
+		return errno;
+
+	int e = pthread_cond_init(&h->cond, nullptr);
+	if (e) {
+		free(h);
+		return e;
+	}
+
+	__builtin_memcpy(h->name, name, n);
+	__builtin_memcpy(&h->name[n], port, m);
+	h->port = &h->name[n];
+	h->idle = nullptr;
+	h->open = 0;
+	h->next = p->hosts;
+	p->hosts = h;
+
+	*ret = h;
+	return 0;
+}
+
+/**
+ * @brief Open a connection.
+ */
+nonnull_in()
+static int
+http_connect (struct http_request const *req,
+              uint32_t                   timeout_ms,
+              struct http_conn         **ret)
+{
+	struct addrinfo *ai, hints = {
+		.ai_family   = AF_UNSPEC,
+		.ai_socktype = SOCK_STREAM,
+	};
+
+	int e = getaddrinfo(req->host, req->port, &hints, &ai);
+	if (e) {
+		return e == EAI_SYSTEM ? errno
+		     : e == EAI_MEMORY ? ENOMEM
+		                       : EHOSTUNREACH;
+	}
+
+	int fd = -1;
+	e = EHOSTUNREACH;
+
+	for (struct addrinfo *a = ai; a; a = a->ai_next) {
+		fd = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC,
+		            a->ai_protocol);
+		if (fd < 0) {
+			e = errno;
+			continue;
+		}
+		if (!connect(fd, a->ai_addr, a->ai_addrlen))
+			break;
+		e = errno;
+		(void)close(fd);
+		fd = -1;
+	}
+
+	freeaddrinfo(ai);
+	if (fd < 0)
+		return e;
+
+	/* Requests go out in one write and the response is awaited right
+	 * after, so Nagle's algorithm could only ever add latency. */
+	int one = 1;
+	struct timeval tv = {
+		.tv_sec  = timeout_ms / 1000U,
+		.tv_usec = (suseconds_t)(timeout_ms % 1000U) * 1000,
+	};
+	if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one) ||
+	    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv) ||
+	    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof tv)) {
+		e = errno;
+		(void)close(fd);
+		return e;
+	}
+
+	struct http_conn *c = malloc(sizeof *c);
+	if (!c) {
+		e = errno;
+		(void)close(fd);
+		return e;
+	}
+
+	c->next = nullptr;
+	c->idle_since = 0;
+	c->off = 0;
+	c->len = 0;
+	c->fd = fd;
+	c->recvd = false;
+	*ret = c;
+	return 0;
+}
+
+/**
+ * @brief Take a connection to the endpoint of a request.
+ *
+ * @param[in,out] p    Pool.
+ * @param[in]     req  Request.
+ * @param[out]    host Endpoint the connection must be returned to.
+ * @param[out]    ret  Connection.
+ * @param[out]    warm Connection was reused.
+ * @return 0 on success, otherwise an error code.
+ */
+nonnull_in()
+static int
+http_acquire (struct http_pool          *p,
+              struct http_request const *req,
+              struct http_host         **host,
+              struct http_conn         **ret,
+              bool                      *warm)
+{
+	struct http_host *h = nullptr;
+
+	(void)pthread_mutex_lock(&p->lock);
+
+	int e = http_host_get(p, req->host, req->port, &h);
+	if (e) {
+		(void)pthread_mutex_unlock(&p->lock);
+		return e;
+	}
+	*host = h;
+
+	for (;;) {
+		(void)http_host_reap(p, h, mono_ms());
+
+		for (struct http_conn *c; (c = h->idle);) {
+			h->idle = c->next;
+			p->stats.idle -= 1U;
+			if (http_alive(c)) {
+				p->stats.reuses += 1U;
+				(void)pthread_mutex_unlock(&p->lock);
+				*ret = c;
+				*warm = true;
+				return 0;
+			}
+			http_close(c);
+			h->open -= 1U;
+		}
+
+		if (h->open < p->cfg.max_conns)
+			break;
+
+		(void)pthread_cond_wait(&h->cond, &p->lock);
+	}
+
+	h->open += 1U;
+	p->stats.connects += 1U;
+	(void)pthread_mutex_unlock(&p->lock);
+
+	*warm = false;
+	e = http_connect(req, p->cfg.timeout_ms, ret);
+	if (e) {
+		(void)pthread_mutex_lock(&p->lock);
+		h->open -= 1U;
+		(void)pthread_cond_signal(&h->cond);
+		(void)pthread_mutex_unlock(&p->lock);
+	}
+
+	return e;
+}
+
+/**
+ * @brief Return a connection to the pool, or close it.
+ */
+nonnull_in()
+static void
+http_release (struct http_pool *p,
+              struct http_host *h,
+              struct http_conn *c,
+              bool              keep)
+{
+	(void)pthread_mutex_lock(&p->lock);
+
+	if (keep) {
+		c->idle_since = mono_ms();
+		c->next = h->idle;
+		h->idle = c;
+		p->stats.idle += 1U;
+	} else {
+		http_close(c);
+		h->open -= 1U;
+	}
+
+	(void)pthread_cond_signal(&h->cond);
+	(void)pthread_mutex_unlock(&p->lock);
+}
+
+/**
+ * @brief Send pieces with as few system calls as possible.
+ */
+nonnull_in()
+static int
+http_send (int                 fd,
+           struct iovec const *src,
+           size_t              n)
+{
+	for (size_t i = 0, off = 0; i < n;) {
+		struct iovec v[HTTP_IOV_MAX];
+		size_t m = 0;
+
+		for (size_t j = i, skip = off; j < n && m < HTTP_IOV_MAX;
+		     ++j, skip = 0) {
+			if (src[j].iov_len > skip)
+				v[m++] = (struct iovec){
+					.iov_base = (char *)src[j].iov_base + skip,
+					.iov_len  = src[j].iov_len - skip,
+				};
+		}
+		if (!m)
+			break;
+
+		struct msghdr h = {.msg_iov = v, .msg_iovlen = m};
+		ssize_t w = sendmsg(fd, &h, MSG_NOSIGNAL);
+		if (w < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno == EAGAIN || errno == EWOULDBLOCK
+			       ? ETIMEDOUT : errno;
+		}
+
+		for (size_t k = (size_t)w; i < n; ++i, off = 0) {
+			size_t r = src[i].iov_len - off;
+			if (k < r) {
+				off += k;
+				break;
+			}
+			k -= r;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Receive into a buffer.
+ *
+ * @return Bytes received, or 0 at end of input. On error, -1 with the
+ *         error code in @p e.
+ */
+nonnull_in()
+static ssize_t
+http_recv (struct http_conn *c,
+           void             *buf,
+           size_t            size,
+           int              *e)
+{
+	for (;;) {
+		ssize_t n = recv(c->fd, buf, size, 0);
+		if (n > 0) {
+			c->recvd = true;
+			return n;
+		}
+		if (!n)
+			return 0;
+		if (errno != EINTR) {
+			*e = errno == EAGAIN || errno == EWOULDBLOCK
+			     ? ETIMEDOUT : errno;
+			return -1;
+		}
+	}
+}
+
+/**
+ * @brief Receive more input into the connection buffer.
+ *
+ * @return 0 on success, `ECONNRESET` at end of input, otherwise an
+ *         error code.
+ */
+nonnull_in()
+static int
+http_fill (struct http_conn *c)
+{
+	if (c->off) {
+		__builtin_memmove(c->buf, &c->buf[c->off], c->len - c->off);
+		c->len -= c->off;
+		c->off = 0;
+	}
+
+	if (c->len == sizeof c->buf)
+		return EPROTO;
+
+	int e = 0;
+	ssize_t n = http_recv(c, &c->buf[c->len], sizeof c->buf - c->len, &e);
+	if (n < 0)
+		return e;
+	if (!n)
+		return ECONNRESET;
+
+	c->len += (size_t)n;
+	return 0;
+}
+
+/**
+ * @brief Read a line, without its terminator.
+ *
+ * The line is only valid until the connection buffer is refilled.
+ */
+nonnull_in()
+static int
+http_line (struct http_conn  *c,
+           char const       **s,
+           size_t            *n)
+{
+	for (size_t i = c->off;;) {
+		for (; i < c->len; ++i) {
+			if (c->buf[i] != '\n')
+				continue;
+			size_t end = i > c->off && c->buf[i - 1U] == '\r'
+			             ? i - 1U : i;
+			*s = (char const *)&c->buf[c->off];
+			*n = end - c->off;
+			c->off = i + 1U;
+			return 0;
+		}
+
+		i -= c->off;
+		int e = http_fill(c);
+		if (e)
+			return e;
+	}
+}
+
+/**
+ * @brief Read a body of known size.
+ *
+ * Buffered input is copied first. Anything larger than the connection
+ * buffer is then received straight into the body.
+ */
+nonnull_in()
+static int
+http_read (struct http_conn *c,
+           struct http_buf  *b,
+           uint64_t          n)
+{
+	if (n > UINT_MAX)
+		return EFBIG;
+
+	int e = http_buf_reserve(b, (size_t)n);
+	if (e)
+		return e;
+
+	size_t k = c->len - c->off;
+	if (k > n)
+		k = (size_t)n;
+	__builtin_memcpy(&b->p[b->len], &c->buf[c->off], k);
+	b->len += k;
+	c->off += k;
+	n -= k;
+
+	while (n) {
+		ssize_t r = http_recv(c, &b->p[b->len], (size_t)n, &e);
+		if (r <= 0)
+			return r ? e : EPROTO;
+		b->len += (size_t)r;
+		n -= (uint64_t)r;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Read a chunked body, dropping any trailer.
+ */
+nonnull_in()
+static int
+http_read_chunked (struct http_conn *c,
+                   struct http_buf  *b)
+{
+	for (;;) {
+		char const *s;
+		size_t n;
+		int e = http_line(c, &s, &n);
+		if (e)
+			return e == ECONNRESET ? EPROTO : e;
+
+		uint64_t size;
+		e = http_chunk_size(s, n, &size);
+		if (e)
+			return e;
+		if (!size)
+			break;
+
+		e = http_read(c, b, size);
+		if (!e)
+			e = http_line(c, &s, &n);
+		if (e)
+			return e == ECONNRESET ? EPROTO : e;
+		if (n)
+			return EPROTO;
+	}
+
+	for (;;) {
+		char const *s;
+		size_t n;
+		int e = http_line(c, &s, &n);
+		if (e)
+			return e == ECONNRESET ? EPROTO : e;
+		if (!n)
+			return 0;
+	}
+}
+
+/**
+ * @brief Read a body that ends with the connection.
+ */
+nonnull_in()
+static int
+http_read_all (struct http_conn *c,
+               struct http_buf  *b)
+{
+	int e = http_buf_put(b, &c->buf[c->off], c->len - c->off);
+	c->off = c->len;
+
+	while (!e) {
+		e = http_buf_reserve(b, HTTP_BUF_SIZE);
+		if (e)
+			break;
+		ssize_t r = http_recv(c, &b->p[b->len], b->cap - b->len - 1U, &e);
+		if (r <= 0)
+			return r ? e : 0;
+		b->len += (size_t)r;
+	}
+
+	return e;
+}
+
+/**
+ * @brief Read the status line and headers.
+ *
+ * Interim 1xx responses are skipped.
+ */
+nonnull_in()
+static int
+http_read_head (struct http_conn     *c,
+                struct http_buf      *head,
+                struct http_frame    *f,
+                struct http_response *res)
+{
+	for (;;) {
+		char const *s;
+		size_t n;
+		int e = http_line(c, &s, &n);
+		if (e)
+			return e == ECONNRESET && c->recvd ? EPROTO : e;
+
+		e = http_frame_status(f, s, n);
+		if (e)
+			return e;
+		res->status = f->status;
+		head->len = 0;
+
+		for (;;) {
+			e = http_line(c, &s, &n);
+			if (e)
+				return e == ECONNRESET ? EPROTO : e;
+			if (!n)
+				break;
+
+			e = http_frame_header(f, s, n);
+			if (!e)
+				e = http_buf_put(head, s, n);
+			if (!e)
+				e = http_buf_put(head, "\r\n", 2U);
+			if (e)
+				return e;
+		}
+
+		if (f->status >= 200 || f->status == 101)
+			return 0;
+	}
+}
+
+bool
+http_request_closes (struct http_request const *req)
+{
+	for (size_t i = 0; i < req->nheaders; ++i) {
+		char const *s = dstr_get(&req->headers[i]);
+		size_t n = req->headers[i].len;
+		if (n > 11U && s[10] == ':' && http_caseeq(s, "connection", 10U) &&
+		    http_has_token(&s[11], n - 11U, "close"))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Send one request and read the response.
+ *
+ * @return 0 on success, otherwise an error code. @p keep is set if the
+ *         connection can be reused.
+ */
+nonnull_in()
+static int
+http_exchange (struct http_conn          *c,
+               struct iovec const        *iov,
+               size_t                     n,
+               struct http_request const *req,
+               struct http_response      *res,
+               bool                      *keep)
+{
+	struct http_buf head = {0}, body = {0};
+	struct http_frame f;
+
+	*keep = false;
+	c->recvd = false;
+
+	int e = http_send(c->fd, iov, n);
+	if (!e)
+		e = http_read_head(c, &head, &f, res);
+
+	if (!e) {
+		bool none = !http_frame_body(&f, req->method);
+		if (!none && f.chunked) {
+			e = http_read_chunked(c, &body);
+		} else if (!none && f.sized) {
+			e = http_read(c, &body, f.length);
+		} else if (!none) {
+			e = http_read_all(c, &body);
+			f.keep = false;
+		}
+
+		*keep = !e && f.keep && res->status != 101 &&
+		        c->off == c->len && !http_request_closes(req);
+	}
+
+	if (e) {
+		free(head.p);
+		free(body.p);
+		res->status = 0;
+		return e;
+	}
+
+	res->head = http_buf_take(&head);
+	res->body = http_buf_take(&body);
+	return 0;
+}
+
+/**
+ * @brief Append a string to the request head.
+ */
+nonnull_in()
+static char *
+http_cat (char       *d,
+          char const *s,
+          size_t      n)
+{
+	__builtin_memcpy(d, s, n);
+	return d + n;
+}
+
+int
+http_frame_status (struct http_frame *f,
+                   char const        *s,
+                   size_t             n)
+{
+	if (n < 12U || __builtin_memcmp(s, "HTTP/1.", 7U) ||
+	    (s[7] != '0' && s[7] != '1') || s[8] != ' ' ||
+	    (unsigned)(s[9] - '1') >= 5U ||
+	    (unsigned)(s[10] - '0') >= 10U ||
+	    (unsigned)(s[11] - '0') >= 10U ||
+	    (n > 12U && s[12] != ' '))
+		return EPROTO;
+
+	*f = (struct http_frame){
+		.status = (s[9] - '0') * 100 + (s[10] - '0') * 10
+		        + (s[11] - '0'),
+		.keep   = s[7] == '1',
+	};
+	return 0;
+}
+
+bool
+http_header_is (char const *s,
+                size_t      n,
+                char const *name,
+                dstr       *v)
+{
+	size_t k = strlen(name);
+	if (n <= k || s[k] != ':' || !http_caseeq(s, name, k))
+		return false;
+
+	size_t a = k + 1U;
+	while (a < n && (s[a] == ' ' || s[a] == '\t'))
+		++a;
+	while (n > a && (s[n - 1U] == ' ' || s[n - 1U] == '\t'))
+		--n;
+	*v = make_dstr_view_from_decay(&s[a], n - a);
+	return true;
+}
+
+int
+http_frame_header (struct http_frame *f,
+                   char const        *s,
+                   size_t             n)
+{
+	char const *colon = memchr(s, ':', n);
+	if (!colon || colon == s)
+		return EPROTO;
+
+	size_t k = (size_t)(colon - s);
+	char const *v = colon + 1;
+	size_t m = n - k - 1U;
+	for (; m && (*v == ' ' || *v == '\t'); --m)
+		++v;
+	while (m && (v[m - 1U] == ' ' || v[m - 1U] == '\t'))
+		--m;
+
+	if (k == 14U && http_caseeq(s, "content-length", k)) {
+		int64_t x;
+		if (!m || (unsigned)(v[0] - '0') >= 10U ||
+		    num_parse_i64(v, m, &x))
+			return EPROTO;
+		if (f->sized && f->length != (uint64_t)x)
+			return EPROTO;
+		f->length = (uint64_t)x;
+		f->sized = true;
+	} else if (k == 17U && http_caseeq(s, "transfer-encoding", k)) {
+		size_t a = m;
+		while (a && v[a - 1U] != ',')
+			--a;
+		f->chunked = http_has_token(&v[a], m - a, "chunked");
+	} else if (k == 10U && http_caseeq(s, "connection", k)) {
+		if (http_has_token(v, m, "close"))
+			f->keep = false;
+		else if (http_has_token(v, m, "keep-alive"))
+			f->keep = true;
+	} else if (k == 12U && http_caseeq(s, "content-type", k)) {
+		f->events = m >= 17U &&
+		            http_caseeq(v, "text/event-stream", 17U) &&
+		            (m == 17U || v[17] == ';' || v[17] == ' ');
+	}
+
+	return 0;
+}
+
+bool
+http_frame_body (struct http_frame const *f,
+                 char const              *method)
+{
+	return strcmp(method, "HEAD") && f->status >= 200 &&
+	       f->status != 204 && f->status != 304;
+}
+
+int
+http_chunk_size (char const *s,
+                 size_t      n,
+                 uint64_t   *size)
+{
+	uint64_t z = 0;
+	size_t i = 0;
+
+	for (; i < n; ++i) {
+		unsigned d = http_lower((uint8_t)s[i]);
+		unsigned v = d - '0' < 10U ? d - '0'
+		           : d - 'a' < 6U  ? d - 'a' + 10U
+		                           : 16U;
+		if (v > 15U)
+			break;
+		if (z >> 60U)
+			return EPROTO;
+		z = z << 4U | v;
+	}
+
+	if (!i || (i < n && s[i] != ';' && s[i] != ' ' && s[i] != '\t'))
+		return EPROTO;
+
+	*size = z;
+	return 0;
+}
+
+int
+http_request_head (struct http_request const  *req,
+                   size_t                      extra,
+                   char                      **ret,
+                   size_t                     *len)
+{
+	size_t body = 0;
+	for (size_t i = 0; i < req->nbody; ++i)
+		body += req->body[i].iov_len;
+
+	bool sized = body || (strcmp(req->method, "GET") &&
+	                      strcmp(req->method, "HEAD"));
+	bool v6 = strchr(req->host, ':');
+	bool port = strcmp(req->port, "80") && strcmp(req->port, "http");
+
+	/* The fixed parts of the request line and the generated headers
+	 * take 63 bytes at most. */
+	size_t n = strlen(req->method) + strlen(req->path)
+	         + strlen(req->host) + strlen(req->port) + 64U + extra;
+	for (size_t i = 0; i < req->nheaders; ++i)
+		n += req->headers[i].len + 2U;
+
+	char *head = malloc(n);
+	if (!head)
+		return errno;
+
+	char *d = head;
+	d = http_cat(d, req->method, strlen(req->method));
+	d = http_cat(d, " ", 1U);
+	d = http_cat(d, req->path, strlen(req->path));
+	d = http_cat(d, " HTTP/1.1\r\nHost: ", 17U);
+	d = v6 ? http_cat(d, "[", 1U) : d;
+	d = http_cat(d, req->host, strlen(req->host));
+	d = v6 ? http_cat(d, "]", 1U) : d;
+	if (port) {
+		d = http_cat(d, ":", 1U);
+		d = http_cat(d, req->port, strlen(req->port));
+	}
+	d = http_cat(d, "\r\n", 2U);
+	if (sized) {
+		d = http_cat(d, "Content-Length: ", 16U);
+		d += num_format_i64(d, (int64_t)body);
+		d = http_cat(d, "\r\n", 2U);
+	}
+	for (size_t i = 0; i < req->nheaders; ++i) {
+		d = http_cat(d, dstr_get(&req->headers[i]),
+		             req->headers[i].len);
+		d = http_cat(d, "\r\n", 2U);
+	}
+	d = http_cat(d, "\r\n", 2U);
+
+	*ret = head;
+	*len = (size_t)(d - head);
+	return 0;
+}
+
+int
+http_pool_init (struct http_pool           *p,
+                struct http_pool_cfg const *cfg)
+{
+	int e = pthread_mutex_init(&p->lock, nullptr);
+	if (e)
+		return e;
+
+	p->hosts = nullptr;
+	p->cfg = cfg ? *cfg : (struct http_pool_cfg){0};
+	p->stats = (struct http_stats){0};
+
+	if (!p->cfg.max_conns)
+		p->cfg.max_conns = HTTP_MAX_CONNS;
+	if (!p->cfg.idle_ms)
+		p->cfg.idle_ms = HTTP_IDLE_MS;
+	if (!p->cfg.timeout_ms)
+		p->cfg.timeout_ms = HTTP_TIMEOUT_MS;
+
+	return 0;
+}
+
+void
+http_pool_fini (struct http_pool *p)
+{
+	for (struct http_host *h; (h = p->hosts);) {
+		p->hosts = h->next;
+		for (struct http_conn *c; (c = h->idle);) {
+			h->idle = c->next;
+			http_close(c);
+		}
+		(void)pthread_cond_destroy(&h->cond);
+		free(h);
+	}
+
+	(void)pthread_mutex_destroy(&p->lock);
+}
+
+size_t
+http_pool_reap (struct http_pool *p)
+{
+	size_t n = 0;
+
+	(void)pthread_mutex_lock(&p->lock);
+	uint64_t now = mono_ms();
+	for (struct http_host *h = p->hosts; h; h = h->next)
+		n += http_host_reap(p, h, now);
+	(void)pthread_mutex_unlock(&p->lock);
+
+	return n;
+}
+
+struct http_stats
+http_pool_stats (struct http_pool *p)
+{
+	(void)pthread_mutex_lock(&p->lock);
+	struct http_stats st = p->stats;
+	(void)pthread_mutex_unlock(&p->lock);
+	return st;
+}
+
+int
+http_request (struct http_pool          *p,
+              struct http_request const *req,
+              struct http_response      *res)
+{
+	*res = (struct http_response){0};
+
+	char *head = nullptr;
+	size_t n = 0;
+	int e = http_request_head(req, 0, &head, &n);
+	if (e)
+		return e;
+
+	struct iovec one[2] = {{head, n}};
+	struct iovec *iov = one;
+	if (req->nbody > 1U) {
+		iov = malloc((req->nbody + 1U) * sizeof *iov);
+		if (!iov) {
+			e = errno;
+			free(head);
+			return e;
+		}
+		iov[0] = one[0];
+	}
+	for (size_t i = 0; i < req->nbody; ++i)
+		iov[i + 1U] = req->body[i];
+
+	for (bool retry = true;; retry = false) {
+		struct http_host *h = nullptr;
+		struct http_conn *c = nullptr;
+		bool warm, keep;
+
+		e = http_acquire(p, req, &h, &c, &warm);
+		if (e)
+			break;
+
+		e = http_exchange(c, iov, req->nbody + 1U, req, res, &keep);
+		bool stale = e && warm && !c->recvd &&
+		             (e == ECONNRESET || e == EPIPE ||
+		              e == ECONNABORTED);
+		http_release(p, h, c, keep);
+
+		if (!stale || !retry)
+			break;
+
+		(void)pthread_mutex_lock(&p->lock);
+		p->stats.retries += 1U;
+		(void)pthread_mutex_unlock(&p->lock);
+	}
+
+	if (!e) {
+		(void)pthread_mutex_lock(&p->lock);
+		p->stats.requests += 1U;
+		(void)pthread_mutex_unlock(&p->lock);
+	}
+
+	if (iov != one)
+		free(iov);
+	free(head);
+	return e;
+}
+
+bool
+http_response_header (struct http_response const *res,
+                      char const                 *name,
+                      dstr                       *v)
+{
+	char const *s = dstr_get(&res->head);
+	size_t len = res->head.len;
+
+	for (size_t i = 0; i < len;) {
+		char const *eol = memchr(&s[i], '\r', len - i);
+		size_t end = eol ? (size_t)(eol - s) : len;
+		if (http_header_is(&s[i], end - i, name, v))
+			return true;
+		i = end + 2U;
+	}
+
+	return false;
+}
+
+void
+http_response_fini (struct http_response *res)
+{
+	dstr_fini(&res->head);
+	dstr_fini(&res->body);
+}
@@ -0,0 +1,282 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file http.h
+ *
+ * @brief HTTP/1.1 client with a keep-alive connection pool.
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_HTTP_H_
+#define LIBCANTH_SRC_HTTP_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "dstr.h"
+#include "util.h"
+
+/**
+ * @brief Default connection limit per endpoint.
+ */
+#define HTTP_MAX_CONNS 8U
+
+/**
+ * @brief Default time after which an idle connection is closed.
+ */
+#define HTTP_IDLE_MS 30000U
+
+/**
+ * @brief Default send and receive timeout.
+ */
+#define HTTP_TIMEOUT_MS 600000U
+
+/**
+ * @brief Receive buffer size of a connection.
+ */
+#define HTTP_BUF_SIZE 16384U
+
+/**
+ * @brief Pool configuration. Zero fields take their defaults.
+ */
+struct http_pool_cfg {
+	uint32_t max_conns;  //!< Connection limit per endpoint.
+	uint32_t idle_ms;    //!< Idle time before a connection is closed.
+	uint32_t timeout_ms; //!< Send and receive timeout of a request.
+};
+
+/**
+ * @brief Pool statistics.
+ */
+struct http_stats {
+	size_t requests; //!< Requests completed.
+	size_t connects; //!< Connections opened.
+	size_t reuses;   //!< Requests sent on a warm connection.
+	size_t retries;  //!< Requests resent after a stale connection.
+	size_t reaped;   //!< Idle connections closed.
+	size_t idle;     //!< Connections currently idle.
+};
+
+struct http_host;
+
+/**
+ * @brief Connection pool.
+ *
+ * Connections are kept per endpoint, a host and port pair, and are
+ * shared by all threads using the pool.
+ */
+struct http_pool {
+	pthread_mutex_t      lock;  //!< Guards everything below.
+	struct http_host    *hosts; //!< Endpoints seen so far.
+	struct http_pool_cfg cfg;   //!< Configuration.
+	struct http_stats    stats; //!< Statistics.
+};
+
+/**
+ * @brief Request.
+ *
+ * The request line, `Host`, and `Content-Length` are generated. Other
+ * headers are given as complete `Name: value` lines without the line
+ * terminator.
+ */
+struct http_request {
+	char const         *method;   //!< Method, such as `POST`.
+	char const         *host;     //!< Host name or address.
+	char const         *port;     //!< Port number or service name.
+	char const         *path;     //!< Request target, such as `/v1/messages`.
+	dstr const         *headers;  //!< Extra header lines.
+	size_t              nheaders; //!< Number of @ref http_request::headers.
+	struct iovec const *body;     //!< Body pieces, sent with one `sendmsg()`.
+	size_t              nbody;    //!< Number of @ref http_request::body.
+};
+
+/**
+ * @brief Response.
+ */
+struct http_response {
+	dstr head;   //!< Header lines after the status line.
+	dstr body;   //!< Body with any chunked encoding removed.
+	int  status; //!< Status code.
+};
+
+/**
+ * @brief Response framing, as told by the status line and headers.
+ */
+struct http_frame {
+	uint64_t length;  //!< Content-Length if known.
+	int      status;  //!< Status code.
+	bool     sized;   //!< Content-Length was given.
+	bool     chunked; //!< Transfer-Encoding ends in chunked.
+	bool     keep;    //!< Connection may be reused.
+	bool     events;  //!< Content-Type is `text/event-stream`.
+};
+
+/**
+ * @brief Start the framing of a response from its status line.
+ *
+ * @param[out] f Framing, reset before use.
+ * @param[in]  s Status line without the line terminator.
+ * @param[in]  n Length of @p s.
+ * @return 0 on success, `EPROTO` if the line is malformed.
+ */
+extern int
+http_frame_status (struct http_frame *f,
+                   char const        *s,
+                   size_t             n) nonnull_in();
+
+/**
+ * @brief Update the framing of a response with a header line.
+ *
+ * @param[in,out] f Framing.
+ * @param[in]     s Header line without the line terminator.
+ * @param[in]     n Length of @p s.
+ * @return 0 on success, `EPROTO` if the line is malformed.
+ */
+extern int
+http_frame_header (struct http_frame *f,
+                   char const        *s,
+                   size_t             n) nonnull_in();
+
+/**
+ * @brief Check if a header line is a field of the given name.
+ *
+ * Names are compared as ASCII without regard to case, independent of
+ * the locale.
+ *
+ * @param[in]  s    Header line without the line terminator.
+ * @param[in]  n    Length of @p s.
+ * @param[in]  name Field name.
+ * @param[out] v    View of the value with surrounding space removed.
+ *                  Set only if the line matches.
+ * @return `true` if the line is a @p name field.
+ */
+extern bool
+http_header_is (char const *s,
+                size_t      n,
+                char const *name,
+                dstr       *v) nonnull_in();
+
+/**
+ * @brief Check if a response to a request made with @p method has a body.
+ */
+extern bool
+http_frame_body (struct http_frame const *f,
+                 char const              *method) nonnull_in();
+
+/**
+ * @brief Parse the size line of a chunk.
+ *
+ * @param[in]  s    Line without the line terminator.
+ * @param[in]  n    Length of @p s.
+ * @param[out] size Chunk size.
+ * @return 0 on success, `EPROTO` if the line is malformed.
+ */
+extern int
+http_chunk_size (char const *s,
+                 size_t      n,
+                 uint64_t   *size) nonnull_in();
+
+/**
+ * @brief Serialize the head of a request.
+ *
+ * @param[in]  req   Request.
+ * @param[in]  extra Spare bytes to allocate after the head.
+ * @param[out] ret   Head, to be released with `free()`.
+ * @param[out] len   Length of the head.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+http_request_head (struct http_request const  *req,
+                   size_t                      extra,
+                   char                      **ret,
+                   size_t                     *len) nonnull_in();
+
+/**
+ * @brief Check if a request asks for the connection to be closed.
+ */
+extern bool
+http_request_closes (struct http_request const *req) nonnull_in();
+
+/**
+ * @brief Initialize a connection pool.
+ *
+ * @param[out] p   Pool.
+ * @param[in]  cfg Configuration, or `NULL` for the defaults.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+http_pool_init (struct http_pool           *p,
+                struct http_pool_cfg const *cfg) nonnull_in(1);
+
+/**
+ * @brief Close every connection and release the pool.
+ *
+ * No request may be in progress.
+ */
+extern void
+http_pool_fini (struct http_pool *p) nonnull_in();
+
+/**
+ * @brief Close connections that have been idle for too long.
+ *
+ * Expired connections are also reaped whenever a request picks one
+ * from the pool, so this is only needed to release sockets of an
+ * endpoint that is no longer used.
+ *
+ * @return Number of connections closed.
+ */
+extern size_t
+http_pool_reap (struct http_pool *p) nonnull_in();
+
+/**
+ * @brief Get a snapshot of the pool statistics.
+ */
+extern struct http_stats
+http_pool_stats (struct http_pool *p) nonnull_in();
+
+/**
+ * @brief Send a request and receive the response.
+ *
+ * The most recently used idle connection to the endpoint is taken from
+ * the pool, or a new one is opened with `TCP_NODELAY` set. If the limit
+ * of connections is reached, the call waits for one to be returned.
+ * The connection goes back to the pool unless either side asked for it
+ * to be closed.
+ *
+ * A warm connection may have been closed by the server while it sat in
+ * the pool. If it fails before any of the response arrives, the request
+ * is sent once more on a new connection.
+ *
+ * @param[in,out] p   Pool.
+ * @param[in]     req Request.
+ * @param[out]    res Response. Release it with @ref http_response_fini()
+ *                    even on failure.
+ * @return 0 on success, otherwise an error code. A malformed response
+ *         is `EPROTO`, a timeout `ETIMEDOUT`, and a host name that
+ *         doesn't resolve `EHOSTUNREACH`.
+ */
+extern int
+http_request (struct http_pool           *p,
+              struct http_request const  *req,
+              struct http_response       *res) nonnull_in();
+
+/**
+ * @brief Look up a response header.
+ *
+ * @param[in]  res  Response.
+ * @param[in]  name Header name, matched without regard to case.
+ * @param[out] v    View of the value with surrounding space removed.
+ * @return `true` if the header was found.
+ */
+extern bool
+http_response_header (struct http_response const *res,
+                      char const                 *name,
+                      dstr                       *v) nonnull_in();
+
+/**
+ * @brief Release a response.
+ */
+extern void
+http_response_fini (struct http_response *res) nonnull_in();
+
+#endif /* LIBCANTH_SRC_HTTP_H_ */
@@ -0,0 +1,232 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file jdecode.h
+ *
+ * @brief Typed JSON object decoders generated from field tables.
+ *
+ * A type is described once with an X-macro table, in the same manner
+ * as the `OPTIONS(X)` table of letopt.h:
+ *
+ * @code
+ * #define USAGE_FIELDS(X)                          \
+ *         X(number, input_tokens,  "input_tokens") \
+ *         X(number, output_tokens, "output_tokens")
+ *
+ * JDECODE_STRUCT(usage, USAGE_FIELDS);
+ * JDECODE_PROTO(usage);
+ * @endcode
+ *
+ * which declares `struct usage` with the members `m_input_tokens` and
+ * `m_output_tokens`, a `has` member with a flag per field, and the
+ * function `usage_decode()`. One translation unit then defines the
+ * decoder with `JDECODE_FUNC(usage, USAGE_FIELDS)`.
+ *
+ * Each entry is `X(type, tag, "key")` or, for nested objects,
+ * `X(object, tag, "key", name)`. The types are
+ *
+ * | type      | member type   | accepts                            |
+ * |-----------|---------------|------------------------------------|
+ * | `boolean` | `bool`        | `true`, `false`                    |
+ * | `number`  | `int64_t`     | integers                           |
+ * | `real`    | `double`      | any number                         |
+ * | `string`  | @ref dstr     | strings, viewed in the tape        |
+ * | `object`  | `struct name` | objects, decoded by `name_decode()`|
+ * | `value`   | `size_t`      | anything, as its tape index        |
+ *
+ * Decoders read a @ref jtape directly. Member names are dispatched on a
+ * hash of their length and first, middle and last byte, which folds to
+ * a constant for every key in the table, so a name costs one integer
+ * compare per field and a single `memcmp()` for the field it selects.
+ * Unknown members are skipped in constant time, and `null` leaves a
+ * field unset.
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_JDECODE_H_
+#define LIBCANTH_SRC_JDECODE_H_
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dstr.h"
+#include "jtape.h"
+#include "util.h"
+
+static const_inline uint32_t
+jdecode_hash_ (size_t  n,
+               uint8_t a,
+               uint8_t b,
+               uint8_t c)
+{
+	return (uint32_t)n << 24U | (uint32_t)a << 16U
+	     | (uint32_t)b << 8U  | (uint32_t)c;
+}
+
+/**
+ * @brief Hash a member name given as a string literal.
+ */
+#define JDECODE_HASH(s) jdecode_hash_(sizeof s - 1U,              \
+        (uint8_t)s[0], (uint8_t)s[(sizeof s - 1U) / 2U],          \
+        (uint8_t)s[sizeof s > 1U ? sizeof s - 2U : 0])
+
+/**
+ * @brief Hash a member name, the same way as @ref JDECODE_HASH().
+ */
+nonnull_in()
+static force_inline uint32_t
+jdecode_hash (char const *s,
+              size_t      n)
+{
+	uint8_t const *u = (uint8_t const *)s;
+	return n ? jdecode_hash_(n, u[0], u[n / 2U], u[n - 1U]) : 0;
+}
+
+nonnull_in()
+static force_inline int
+jdecode_boolean (struct jtape const *t,
+                 size_t              i,
+                 bool               *p)
+{
+	enum jtape_type y = jtape_type(t, i);
+	if (y != jtape_true && y != jtape_false)
+		return EPROTO;
+	*p = y == jtape_true;
+	return 0;
+}
+
+nonnull_in()
+static force_inline int
+jdecode_number (struct jtape const *t,
+                size_t              i,
+                int64_t            *p)
+{
+	if (jtape_type(t, i) != jtape_int)
+		return EPROTO;
+	*p = jtape_i64(t, i);
+	return 0;
+}
+
+nonnull_in()
+static force_inline int
+jdecode_real (struct jtape const *t,
+              size_t              i,
+              double             *p)
+{
+	switch (jtape_type(t, i)) {
+	case jtape_int:
+		*p = (double)jtape_i64(t, i);
+		return 0;
+	case jtape_double:
+		*p = jtape_f64(t, i);
+		return 0;
+	default:
+		return EPROTO;
+	}
+}
+
+nonnull_in()
+static force_inline int
+jdecode_string (struct jtape const *t,
+                size_t              i,
+                dstr               *p)
+{
+	if (jtape_type(t, i) != jtape_string)
+		return EPROTO;
+	*p = jtape_str(t, i);
+	return 0;
+}
+
+nonnull_in()
+static force_inline int
+jdecode_value (struct jtape const *t,
+               size_t              i,
+               size_t             *p)
+{
+	(void)t;
+	*p = i;
+	return 0;
+}
+
+#define jdecode_type_boolean(...) bool
+#define jdecode_type_number(...)  int64_t
+#define jdecode_type_real(...)    double
+#define jdecode_type_string(...)  dstr
+#define jdecode_type_value(...)   size_t
+#define jdecode_type_object(name, ...) struct name
+
+#define jdecode_get_boolean(p, t, i, ...) jdecode_boolean(t, i, p)
+#define jdecode_get_number(p, t, i, ...)  jdecode_number(t, i, p)
+#define jdecode_get_real(p, t, i, ...)    jdecode_real(t, i, p)
+#define jdecode_get_string(p, t, i, ...)  jdecode_string(t, i, p)
+#define jdecode_get_value(p, t, i, ...)   jdecode_value(t, i, p)
+#define jdecode_get_object(p, t, i, name, ...) name##_decode(p, t, i)
+
+#define jdecode_member_(T, tag, key, ...) \
+        jdecode_type_##T(__VA_ARGS__) m_##tag;
+
+#define jdecode_has_(T, tag, ...) bool tag;
+
+#define jdecode_field_(T, tag, key, ...)                                  \
+        if (h == JDECODE_HASH(key) && n == sizeof key - 1U &&             \
+            !__builtin_memcmp(s, key, n)) {                               \
+                if (jtape_type(t, i) != jtape_null) {                     \
+                        int e = jdecode_get_##T(&v->m_##tag, t, i,        \
+                                                __VA_ARGS__);             \
+                        if (e)                                            \
+                                return e;                                 \
+                        v->has.tag = true;                                \
+                }                                                         \
+                i = jtape_skip(t, i);                                     \
+                continue;                                                 \
+        }
+
+/**
+ * @brief Define the struct of a field table.
+ */
+#define JDECODE_STRUCT(name, FIELDS)                                      \
+        struct name {                                                     \
+                FIELDS(jdecode_member_)                                   \
+                struct {                                                  \
+                        FIELDS(jdecode_has_)                              \
+                } has;                                                    \
+        }
+
+/**
+ * @brief Declare the decoder of a field table.
+ *
+ * The decoder fills `*v` from the object at tape index `i`. Strings
+ * are views of the tape and live as long as it does.
+ *
+ * It returns 0 on success, otherwise an error code. A value that isn't
+ * an object, or a field of the wrong type, is `EPROTO`.
+ */
+#define JDECODE_PROTO(name)                                               \
+        extern int                                                        \
+        name##_decode (struct name        *v,                             \
+                       struct jtape const *t,                             \
+                       size_t              i) nonnull_in()
+
+/**
+ * @brief Define the decoder of a field table.
+ */
+#define JDECODE_FUNC(name, FIELDS)                                        \
+        int                                                               \
+        name##_decode (struct name        *v,                             \
+                       struct jtape const *t,                             \
+                       size_t              i)                             \
+        {                                                                 \
+                *v = (struct name){0};                                    \
+                if (jtape_type(t, i) != jtape_object)                     \
+                        return EPROTO;                                    \
+                for (size_t end = jtape_payload(t, i++) - 1U; i < end;) { \
+                        dstr k = jtape_str(t, i++);                       \
+                        char const *s = dstr_get(&k);                     \
+                        size_t n = k.len;                                 \
+                        uint32_t h = jdecode_hash(s, n);                  \
+                        FIELDS(jdecode_field_)                            \
+                        i = jtape_skip(t, i);                             \
+                }                                                         \
+                return 0;                                                 \
+        }
+
+#endif /* LIBCANTH_SRC_JDECODE_H_ */
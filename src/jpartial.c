@@ -0,0 +1,191 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file jpartial.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <stdlib.h>
+
+#include "jpartial.h"
+
+/**
+ * @brief Copy a token into an owned @ref dstr.
+ */
+nonnull_in()
+static int
+jpartial_copy (dstr       *d,
+               dstr const *v)
+{
+	size_t n = v->len;
+
+	if (n < sizeof d->arr) {
+		*d = make_dstr_from_small_string(dstr_get(v), n);
+		return 0;
+	}
+
+	char *p = malloc(n + 1U);
+	if (!p)
+		return errno;
+
+	__builtin_memcpy(p, dstr_get(v), n);
+	p[n] = '\0';
+	*d = (dstr){.ptr = p, .size = (unsigned)n + 1U, .len = (unsigned)n};
+	return 0;
+}
+
+/**
+ * @brief Append a complete member, taking over @p value and the name
+ *        of the member in progress.
+ */
+nonnull_in()
+static int
+jpartial_push (struct jpartial *j,
+               dstr            *value,
+               enum json_tok    type)
+{
+	if (j->len == j->cap) {
+		size_t cap = j->cap ? j->cap * 2U : 8U;
+		struct jpartial_field *f = realloc(j->field, cap * sizeof *f);
+		if (!f)
+			return errno;
+		j->field = f;
+		j->cap = cap;
+	}
+
+	j->field[j->len++] = (struct jpartial_field){
+		.key   = j->key,
+		.value = *value,
+		.type  = type,
+	};
+	dstr_init(&j->key);
+	dstr_init(value);
+	return 0;
+}
+
+/**
+ * @brief Pass a token inside a nested value on to the writer.
+ */
+nonnull_in()
+static int
+jpartial_forward (struct jpartial *j,
+                  enum json_tok    tok,
+                  dstr const      *val)
+{
+	switch (tok) {
+	case json_object_begin:
+		return jwriter_object_begin(&j->w);
+	case json_object_end:
+		return jwriter_object_end(&j->w);
+	case json_array_begin:
+		return jwriter_array_begin(&j->w);
+	case json_array_end:
+		return jwriter_array_end(&j->w);
+	case json_key:
+		return jwriter_key(&j->w, dstr_get(val), val->len);
+	case json_string:
+		return jwriter_string(&j->w, dstr_get(val), val->len);
+	default:
+		return jwriter_raw(&j->w, dstr_get(val), val->len);
+	}
+}
+
+static int
+jpartial_token (void          *ctx,
+                enum json_tok  tok,
+                dstr const    *val)
+{
+	struct jpartial *j = ctx;
+	bool open = tok == json_object_begin || tok == json_array_begin;
+	bool close = tok == json_object_end || tok == json_array_end;
+
+	if (j->done || (!j->depth && tok != json_object_begin))
+		return EPROTO;
+
+	if (close && --j->depth < 2U) {
+		if (!j->depth) {
+			j->done = true;
+			return 0;
+		}
+		int e = jpartial_forward(j, tok, val);
+		if (e || (e = jwriter_end(&j->w)))
+			return e;
+		return jpartial_push(j, &j->nested,
+		                     tok == json_object_end ? json_object_begin
+		                                            : json_array_begin);
+	}
+
+	if (j->depth == 1U) {
+		if (tok == json_key) {
+			dstr_fini(&j->key);
+			return jpartial_copy(&j->key, val);
+		}
+		if (!open) {
+			dstr v;
+			int e = jpartial_copy(&v, val);
+			if (!e && (e = jpartial_push(j, &v, tok)))
+				dstr_fini(&v);
+			return e;
+		}
+		jwriter_init(&j->w, &j->nested, 0);
+	}
+
+	if (open && ++j->depth == 1U)
+		return 0;
+
+	return jpartial_forward(j, tok, val);
+}
+
+void
+jpartial_init (struct jpartial *j)
+{
+	*j = (struct jpartial){0};
+	json_init(&j->p, jpartial_token, j);
+}
+
+int
+jpartial_feed (struct jpartial *j,
+               void const      *src,
+               size_t           len)
+{
+	return json_feed(&j->p, src, len);
+}
+
+int
+jpartial_end (struct jpartial *j)
+{
+	int e = json_end(&j->p);
+	return e ? e : j->done ? 0 : EBADMSG;
+}
+
+struct jpartial_field const *
+jpartial_find (struct jpartial const *j,
+               char const            *key,
+               size_t                 len)
+{
+	for (size_t i = j->len; i--;) {
+		if (dstr_eq(&j->field[i].key, key, len))
+			return &j->field[i];
+	}
+	return nullptr;
+}
+
+void
+jpartial_fini (struct jpartial *j)
+{
+	if (!j)
+		return;
+
+	for (size_t i = 0; i < j->len; ++i) {
+		dstr_fini(&j->field[i].key);
+		dstr_fini(&j->field[i].value);
+	}
+
+	if (j->depth > 1U)
+		(void)jwriter_end(&j->w);
+
+	free(j->field);
+	dstr_fini(&j->key);
+	dstr_fini(&j->nested);
+	json_fini(&j->p);
+	*j = (struct jpartial){0};
+}
@@ -0,0 +1,100 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file jpartial.h
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_JPARTIAL_H_
+#define LIBCANTH_SRC_JPARTIAL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dstr.h"
+#include "json.h"
+#include "jwriter.h"
+#include "util.h"
+
+/**
+ * @brief Member of an object that has been received in full.
+ */
+struct jpartial_field {
+	dstr          key;   //!< Member name, unescaped.
+	dstr          value; //!< Unescaped string, number or literal text,
+	                     //!< or compact JSON of an object or array.
+	enum json_tok type;  //!< Value type. Containers are reported as
+	                     //!< @ref json_object_begin and
+	                     //!< @ref json_array_begin.
+};
+
+/**
+ * @brief Incremental parser for an object that arrives in fragments.
+ *
+ * Meant for the `partial_json` fragments of streamed tool input. Each
+ * fragment is fed to a @ref json push parser, which carries its state
+ * over to the next one, so nothing is parsed twice. Members of the
+ * top-level object become available in @ref jpartial::field as soon as
+ * their values are complete, long before the object itself is.
+ *
+ * Nested objects and arrays are serialized back into compact JSON with
+ * a @ref jwriter while they're parsed.
+ *
+ * Initialize with @ref jpartial_init() before first use.
+ */
+struct jpartial {
+	struct json            p;      //!< Push parser.
+	struct jwriter         w;      //!< Writer of a nested value.
+	struct jpartial_field *field;  //!< Complete members, in order.
+	size_t                 len;    //!< Complete member count.
+	size_t                 cap;    //!< Allocated size of @ref field.
+	dstr                   key;    //!< Name of the member in progress.
+	dstr                   nested; //!< Output of @ref jpartial::w.
+	uint32_t               depth;  //!< Current nesting depth.
+	bool                   done;   //!< Top-level object is complete.
+};
+
+/**
+ * @brief Initialize an incremental parser.
+ */
+extern void
+jpartial_init (struct jpartial *j) nonnull_in();
+
+/**
+ * @brief Parse the next fragment.
+ *
+ * @param[in,out] j   Parser.
+ * @param[in]     src Fragment.
+ * @param[in]     len Length of @p src.
+ * @return 0 on success, otherwise an error code as for @ref json_feed().
+ *         Input that isn't a single object is `EPROTO`.
+ */
+extern int
+jpartial_feed (struct jpartial *j,
+               void const      *src,
+               size_t           len) nonnull_in(1);
+
+/**
+ * @brief Signal the end of input.
+ *
+ * @return 0 if the object is complete, otherwise an error code.
+ */
+extern int
+jpartial_end (struct jpartial *j) nonnull_in();
+
+/**
+ * @brief Find a complete member by name.
+ *
+ * @return The last complete member named @p key, or `nullptr` if
+ *         there is none yet.
+ */
+extern struct jpartial_field const *
+jpartial_find (struct jpartial const *j,
+               char const            *key,
+               size_t                 len) nonnull_in(1);
+
+/**
+ * @brief Release an incremental parser and its members.
+ */
+extern void
+jpartial_fini (struct jpartial *j);
+
+#endif /* LIBCANTH_SRC_JPARTIAL_H_ */
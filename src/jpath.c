@@ -0,0 +1,379 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file jpath.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif /* __SSE2__ */
+
+#include "jpath.h"
+
+/**
+ * @brief Find the next quote or bracket.
+ *
+ * Brackets are matched by folding `[` and `]` onto `{` and `}` with a
+ * bitwise OR of 0x20, which maps no other byte onto either.
+ *
+ * @return Index of the first `"`, `[`, `]`, `{`, or `}` at or after
+ *         @p i, or @p len if there is none.
+ */
+nonnull_in()
+static force_inline size_t
+jpath_scan (uint8_t const *s,
+            size_t         i,
+            size_t         len)
+{
+#if defined(__SSE2__)
+	__m128i const q = _mm_set1_epi8('"');
+	__m128i const o = _mm_set1_epi8('{');
+	__m128i const c = _mm_set1_epi8('}');
+	__m128i const f = _mm_set1_epi8(0x20);
+
+	for (; len - i >= 16U; i += 16U) {
+		__m128i v = _mm_loadu_si128((__m128i const *)&s[i]);
+		__m128i u = _mm_or_si128(v, f);
+		unsigned m = (unsigned)_mm_movemask_epi8(
+			_mm_or_si128(_mm_cmpeq_epi8(v, q),
+			             _mm_or_si128(_mm_cmpeq_epi8(u, o),
+			                          _mm_cmpeq_epi8(u, c))));
+		if (m)
+			return i + (size_t)__builtin_ctz(m);
+	}
+#else
+	constexpr uint64_t ones = UINT64_C(0x0101010101010101);
+	constexpr uint64_t high = UINT64_C(0x8080808080808080);
+
+	for (; len - i >= 8U; i += 8U) {
+		uint64_t v;
+		__builtin_memcpy(&v, &s[i], 8U);
+		uint64_t q = v ^ (ones * '"');
+		uint64_t o = (v | (ones * 0x20U)) ^ (ones * '{');
+		uint64_t c = (v | (ones * 0x20U)) ^ (ones * '}');
+		uint64_t m = (((q - ones) & ~q) |
+		              ((o - ones) & ~o) |
+		              ((c - ones) & ~c)) & high;
+		if (m) {
+			if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+				return i + (size_t)__builtin_ctzll(m) / 8U;
+			break;
+		}
+	}
+#endif /* __SSE2__ */
+
+	for (; i < len; ++i) {
+		uint8_t b = s[i] | 0x20U;
+		if (s[i] == '"' || b == '{' || b == '}')
+			break;
+	}
+
+	return i;
+}
+
+nonnull_in()
+static force_inline size_t
+jpath_ws (uint8_t const *s,
+          size_t         i,
+          size_t         len)
+{
+	while (i < len && (s[i] == ' ' || s[i] == '\n' ||
+	                   s[i] == '\r' || s[i] == '\t'))
+		++i;
+	return i;
+}
+
+/**
+ * @brief Find the end of a string.
+ *
+ * @param s   Input.
+ * @param i   Index right after the opening quote.
+ * @param len Length of @p s.
+ * @param esc Set if the string contains escape sequences.
+ * @return Index of the closing quote, or @p len if there is none.
+ */
+nonnull_in()
+static size_t
+jpath_string (uint8_t const *s,
+              size_t         i,
+              size_t         len,
+              bool          *esc)
+{
+	for (;; ++i) {
+		i = json_scan_string(s, i, len);
+		if (i == len || s[i] == '"')
+			return i;
+		if (s[i] == '\\') {
+			*esc = true;
+			if (++i == len)
+				return len;
+		}
+	}
+}
+
+/**
+ * @brief Find the end of a value.
+ *
+ * @return Index right after the value, or `SIZE_MAX` if it's cut off
+ *         or unbalanced.
+ */
+nonnull_in()
+static size_t
+jpath_skip (uint8_t const *s,
+            size_t         i,
+            size_t         len)
+{
+	bool esc = false;
+	uint8_t c = s[i];
+
+	if (c == '"') {
+		i = jpath_string(s, i + 1U, len, &esc);
+		return i < len ? i + 1U : SIZE_MAX;
+	}
+
+	if ((c | 0x20U) == '{') {
+		for (size_t depth = 1U; ++i < len;) {
+			i = jpath_scan(s, i, len);
+			if (i == len)
+				break;
+			c = s[i];
+			if (c == '"') {
+				i = jpath_string(s, i + 1U, len, &esc);
+				if (i == len)
+					break;
+			} else if ((c | 0x20U) == '{') {
+				++depth;
+			} else if (!--depth) {
+				return i + 1U;
+			}
+		}
+		return SIZE_MAX;
+	}
+
+	for (; i < len; ++i) {
+		c = s[i];
+		if (c == ',' || c == ']' || c == '}' || c == ' ' ||
+		    c == '\n' || c == '\r' || c == '\t')
+			break;
+	}
+
+	return i;
+}
+
+/**
+ * @brief Compare an escaped member name to an unescaped one.
+ */
+nonnull_in()
+static bool
+jpath_key_eq (uint8_t const *s,
+              size_t         n,
+              dstr const    *key)
+{
+	char const *k = dstr_get(key);
+	size_t m = key->len, j = 0;
+
+	for (size_t i = 0; i < n;) {
+		uint8_t b[4] = {s[i]};
+		size_t w = 1U;
+
+		if (s[i++] == '\\') {
+			w = json_escape(s, &i, n, b);
+			if (!w)
+				return false;
+		}
+
+		if (m - j < w || __builtin_memcmp(&k[j], b, w))
+			return false;
+		j += w;
+	}
+
+	return j == m;
+}
+
+/**
+ * @brief Descend into the member of an object or element of an array.
+ *
+ * @param s   Input.
+ * @param i   Index of the container.
+ * @param len Length of @p s.
+ * @param t   Step to take.
+ * @param e   Error code on failure.
+ * @return Index of the value, or `SIZE_MAX` on failure.
+ */
+nonnull_in()
+static size_t
+jpath_step (uint8_t const           *s,
+            size_t                   i,
+            size_t                   len,
+            struct jpath_step const *t,
+            int                     *e)
+{
+	uint8_t const close = t->array ? ']' : '}';
+	*e = ENOENT;
+
+	if (s[i] != (t->array ? '[' : '{'))
+		return SIZE_MAX;
+
+	i = jpath_ws(s, i + 1U, len);
+	if (i < len && s[i] == close)
+		return SIZE_MAX;
+
+	for (uint32_t k = 0;; ++k) {
+		bool hit = t->array && k == t->index;
+
+		if (!t->array) {
+			bool esc = false;
+			if (i == len || s[i] != '"')
+				break;
+			size_t a = i + 1U;
+			i = jpath_string(s, a, len, &esc);
+			if (i == len)
+				break;
+			hit = esc ? jpath_key_eq(&s[a], i - a, &t->key)
+			          : dstr_eq(&t->key, (char const *)&s[a], i - a);
+			i = jpath_ws(s, i + 1U, len);
+			if (i == len || s[i] != ':')
+				break;
+			i = jpath_ws(s, i + 1U, len);
+		}
+
+		if (i == len)
+			break;
+		if (hit)
+			return i;
+
+		i = jpath_skip(s, i, len);
+		if (i == SIZE_MAX)
+			break;
+		i = jpath_ws(s, i, len);
+		if (i == len)
+			break;
+		if (s[i] == close)
+			return SIZE_MAX;
+		if (s[i] != ',')
+			break;
+		i = jpath_ws(s, i + 1U, len);
+	}
+
+	*e = EBADMSG;
+	return SIZE_MAX;
+}
+
+int
+jpath_compile (struct jpath *p,
+               char const   *expr)
+{
+	char const *s = expr;
+	p->len = 0;
+
+	if (*s == '$')
+		++s;
+
+	for (bool first = true; *s; first = false) {
+		struct jpath_step t = {0};
+
+		if (*s == '[' && s[1] == '"') {
+			char const *a = s += 2;
+			while (*s && *s != '"')
+				++s;
+			if (s[0] != '"' || s[1] != ']')
+				return EINVAL;
+			t.key = make_dstr_view_from_decay(a, (size_t)(s - a));
+			s += 2;
+		} else if (*s == '[') {
+			uint64_t n = 0;
+			if ((unsigned)(*++s - '0') >= 10U)
+				return EINVAL;
+			for (; (unsigned)(*s - '0') < 10U; ++s) {
+				n = n * 10U + (unsigned)(*s - '0');
+				if (n > UINT32_MAX)
+					return EINVAL;
+			}
+			if (*s++ != ']')
+				return EINVAL;
+			t.index = (uint32_t)n;
+			t.array = true;
+		} else {
+			if (*s == '.')
+				++s;
+			else if (!first)
+				return EINVAL;
+			char const *a = s;
+			while (*s && *s != '.' && *s != '[')
+				++s;
+			if (s == a)
+				return EINVAL;
+			t.key = make_dstr_view_from_decay(a, (size_t)(s - a));
+		}
+
+		if (p->len == JPATH_STEPS_MAX)
+			return E2BIG;
+		p->step[p->len++] = t;
+	}
+
+	return 0;
+}
+
+int
+jpath_get (struct jpath const *p,
+           void const         *src,
+           size_t              len,
+           struct jpath_value *v)
+{
+	uint8_t const *s = src;
+	int e = 0;
+
+	*v = (struct jpath_value){.type = json_null};
+
+	size_t i = jpath_ws(s, 0, len);
+	for (size_t k = 0; i < len && k < p->len; ++k)
+		i = jpath_step(s, i, len, &p->step[k], &e);
+
+	if (i >= len)
+		return e ? e : EBADMSG;
+
+	size_t end = jpath_skip(s, i, len);
+	if (end == SIZE_MAX)
+		return EBADMSG;
+
+	switch (s[i]) {
+	case '"':
+		v->type = json_string;
+		(void)jpath_string(s, ++i, len, &v->escaped);
+		--end;
+		break;
+	case '{':
+		v->type = json_object_begin;
+		break;
+	case '[':
+		v->type = json_array_begin;
+		break;
+	case 'n':
+		v->type = json_null;
+		break;
+	case 't':
+		v->type = json_true;
+		break;
+	case 'f':
+		v->type = json_false;
+		break;
+	default:
+		v->type = json_number;
+		if (s[i] != '-' && (unsigned)(s[i] - '0') >= 10U)
+			return EBADMSG;
+	}
+
+	if (v->type <= json_true) {
+		constexpr static char const lit[][6] = {
+			[json_null] = "null", [json_false] = "false",
+			[json_true] = "true",
+		};
+		size_t n = v->type == json_false ? 5U : 4U;
+		if (end - i != n || __builtin_memcmp(&s[i], lit[v->type], n))
+			return EBADMSG;
+	}
+
+	v->text = make_dstr_view_from_decay((char const *)&s[i], end - i);
+	return 0;
+}
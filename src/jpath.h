@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file jpath.h
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_JPATH_H_
+#define LIBCANTH_SRC_JPATH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dstr.h"
+#include "json.h"
+#include "util.h"
+
+/**
+ * @brief Maximum number of steps in a compiled path.
+ */
+#define JPATH_STEPS_MAX 16U
+
+/**
+ * @brief One step of a compiled path.
+ */
+struct jpath_step {
+	dstr     key;   //!< Member name.
+	uint32_t index; //!< Array index.
+	bool     array; //!< Step is an array index, not a member name.
+};
+
+/**
+ * @brief Compiled path expression.
+ */
+struct jpath {
+	size_t            len;                   //!< Step count.
+	struct jpath_step step[JPATH_STEPS_MAX]; //!< Steps from the root.
+};
+
+/**
+ * @brief Value found by @ref jpath_get().
+ */
+struct jpath_value {
+	dstr          text;    //!< View of the value in the input. For
+	                       //!< strings, the contents between quotes.
+	enum json_tok type;    //!< Value type. Containers are reported as
+	                       //!< @ref json_object_begin and
+	                       //!< @ref json_array_begin.
+	bool          escaped; //!< String contains escape sequences.
+};
+
+/**
+ * @brief Compile a path expression.
+ *
+ * Paths are member names separated by dots and array indices in square
+ * brackets, such as `usage.output_tokens` or `content[0].text`. A name
+ * that isn't a plain identifier can be given as `["name"]`. A leading
+ * `$` denotes the root and is optional.
+ *
+ * Names are referenced, not copied, so @p expr must outlive @p p.
+ *
+ * @param[out] p    Compiled path.
+ * @param[in]  expr Path expression.
+ * @return 0 on success, otherwise an error code. A malformed expression
+ *         is `EINVAL`, one with too many steps `E2BIG`.
+ */
+extern int
+jpath_compile (struct jpath *p,
+               char const   *expr) nonnull_in();
+
+/**
+ * @brief Look up a value in a JSON document without parsing it.
+ *
+ * Only the members and elements along the path are examined. Values in
+ * between are skipped by scanning for quotes and brackets, several
+ * bytes at a time, and are only checked for balance. The value found
+ * is checked the same way, so a malformed document may go undetected.
+ *
+ * @param[in]  p   Compiled path.
+ * @param[in]  src JSON document.
+ * @param[in]  len Length of @p src.
+ * @param[out] v   Value found, with a @ref dstr view of @p src.
+ * @return 0 on success, otherwise an error code. A path that doesn't
+ *         exist in the document is `ENOENT`, and input that is too
+ *         malformed to follow is `EBADMSG`.
+ */
+extern int
+jpath_get (struct jpath const *p,
+           void const         *src,
+           size_t              len,
+           struct jpath_value *v) nonnull_in(1,4);
+
+#endif /* LIBCANTH_SRC_JPATH_H_ */
@@ -0,0 +1,732 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file json.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <stdlib.h>
+
+#include "json.h"
+
+/**
+ * @brief Lexer states.
+ */
+fixed_enum(json_st8, uint8_t) {
+	json_st8_value,   //!< Expecting a value.
+	json_st8_first,   //!< After `[`, expecting a value or `]`.
+	json_st8_member,  //!< After `,` in an object, expecting a name.
+	json_st8_open,    //!< After `{`, expecting a name or `}`.
+	json_st8_colon,   //!< After a member name, expecting `:`.
+	json_st8_next,    //!< After a nested value, expecting `,` or a closer.
+	json_st8_gap,     //!< After a top-level value, expecting whitespace.
+	json_st8_string,  //!< Inside a string.
+	json_st8_escape,  //!< After a backslash inside a string.
+	json_st8_hex,     //!< Inside a `\u` escape.
+	json_st8_number,  //!< Inside a number.
+	json_st8_literal, //!< Inside `null`, `false`, or `true`.
+};
+
+/**
+ * @brief Number grammar states, stored in @ref json::sub.
+ */
+fixed_enum(json_num, uint8_t) {
+	json_num_minus, //!< After the sign, expecting a digit.
+	json_num_zero,  //!< After a leading zero.
+	json_num_int,   //!< Inside the integer part.
+	json_num_dot,   //!< After the decimal point, expecting a digit.
+	json_num_frac,  //!< Inside the fraction.
+	json_num_e,     //!< After the exponent marker.
+	json_num_sign,  //!< After the exponent sign, expecting a digit.
+	json_num_exp,   //!< Inside the exponent.
+};
+
+constexpr static char const json_lit[][6] = {
+	[json_null]  = "null",
+	[json_false] = "false",
+	[json_true]  = "true",
+};
+
+nonnull_in()
+static force_inline int
+json_fail (struct json *p,
+           int          e)
+{
+	if (!p->ec)
+		p->ec = e ? e : EIO;
+	return p->ec;
+}
+
+static const_inline bool
+json_ws (unsigned char c)
+{
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+/**
+ * @brief Advance the number grammar by one byte.
+ *
+ * @return The next state, or -1 if @p c doesn't continue the number.
+ */
+static const_inline int
+json_num_next (enum json_num  st,
+               unsigned char  c)
+{
+	bool digit = (unsigned)(c - '0') < 10U;
+	bool e = c == 'e' || c == 'E';
+
+	switch (st) {
+	case json_num_minus:
+		return c == '0' ? json_num_zero : digit ? json_num_int : -1;
+	case json_num_zero:
+		return c == '.' ? json_num_dot : e ? json_num_e : -1;
+	case json_num_int:
+		return digit ? json_num_int : c == '.' ? json_num_dot
+		     : e ? json_num_e : -1;
+	case json_num_dot:
+	case json_num_frac:
+		return digit ? json_num_frac : e && st == json_num_frac
+		     ? json_num_e : -1;
+	case json_num_e:
+		return c == '+' || c == '-' ? json_num_sign
+		     : digit ? json_num_exp : -1;
+	case json_num_sign:
+	case json_num_exp:
+		return digit ? json_num_exp : -1;
+	}
+
+	return -1;
+}
+
+static const_inline bool
+json_num_final (enum json_num st)
+{
+	return st == json_num_zero || st == json_num_int
+	    || st == json_num_frac || st == json_num_exp;
+}
+
+/**
+ * @brief Make room for @p n more bytes in the assembly buffer.
+ */
+nonnull_in()
+static int
+json_reserve (struct json *p,
+              size_t       n)
+{
+	if (p->cap - p->len < n) {
+		size_t c = p->cap ? p->cap : 256U;
+		while (c - p->len < n) {
+			if (c > SIZE_MAX / 2U)
+				return EOVERFLOW;
+			c <<= 1U;
+		}
+
+		char *b = realloc(p->buf, c);
+		if (!b)
+			return errno;
+		p->buf = b;
+		p->cap = c;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Append bytes to the assembly buffer.
+ */
+nonnull_in(1)
+static int
+json_append (struct json *p,
+             void const  *src,
+             size_t       n)
+{
+	int e = json_reserve(p, n);
+	if (e)
+		return e;
+
+	if (n) {
+		__builtin_memcpy(&p->buf[p->len], src, n);
+		p->len += n;
+	}
+	p->split = true;
+	return 0;
+}
+
+nonnull_in(1)
+static force_inline int
+json_emit (struct json   *p,
+           enum json_tok  tok,
+           char const    *src,
+           size_t         len)
+{
+	if (len > UINT_MAX - 1U)
+		return EOVERFLOW;
+
+	dstr v = make_dstr_view_from_decay(src, len);
+	return p->fn(p->ctx, tok, &v);
+}
+
+/**
+ * @brief Report a string or number which ends at `s[end]`.
+ *
+ * If an earlier part of the token is in the assembly buffer the rest
+ * is appended to it first, otherwise the token is passed as a view.
+ */
+nonnull_in()
+static int
+json_token (struct json         *p,
+            enum json_tok        tok,
+            unsigned char const *s,
+            size_t               start,
+            size_t               end)
+{
+	if (!p->split)
+		return json_emit(p, tok, (char const *)&s[start], end - start);
+
+	int e = json_append(p, &s[start], end - start);
+	if (!e)
+		e = json_emit(p, tok, p->buf, p->len);
+	p->len = 0;
+	p->split = false;
+	return e;
+}
+
+/**
+ * @brief Move on after a complete value.
+ */
+nonnull_in()
+static force_inline void
+json_done (struct json *p)
+{
+	if (p->depth) {
+		p->state = json_st8_next;
+	} else {
+		p->state = json_st8_gap;
+		++p->values;
+	}
+}
+
+/**
+ * @brief Report a string or member name which ends at `s[end]`.
+ */
+nonnull_in()
+static int
+json_string_end (struct json         *p,
+                 unsigned char const *s,
+                 size_t               start,
+                 size_t               end)
+{
+	int e = json_token(p, p->key ? json_key : json_string, s, start, end);
+	if (p->key)
+		p->state = json_st8_colon;
+	else
+		json_done(p);
+	return e;
+}
+
+/**
+ * @brief Decode a string with escapes in one go if it ends in this
+ *        chunk, with the same kernel as @ref json_unescape().
+ *
+ * UTF-8 isn't validated here, as it isn't on the byte-wise path.
+ *
+ * @param p   Parser.
+ * @param s   Input chunk.
+ * @param tok Start of the undecoded part of the string.
+ * @param len Length of @p s.
+ * @param i   Set to the index after the closing quote on success.
+ * @param e   Set to the error code of the token callback on success.
+ * @return Whether the string was completed. If not, nothing is
+ *         consumed and the string is decoded byte by byte instead.
+ */
+nonnull_in()
+static bool
+json_string_fast (struct json         *p,
+                  unsigned char const *s,
+                  size_t               tok,
+                  size_t               len,
+                  size_t              *i,
+                  int                 *e)
+{
+	size_t n = len - tok, end, w;
+	if (p->cp || json_reserve(p, n) ||
+	    json_unescape((uint8_t *)&p->buf[p->len], &s[tok], n, &end, &w,
+	                  false) ||
+	    end == n)
+		return false;
+
+	p->len += w;
+	p->split = true;
+	*e = json_string_end(p, s, tok + end, tok + end);
+	*i = tok + end + 1U;
+	return true;
+}
+
+nonnull_in()
+static int
+json_open (struct json *p,
+           bool         obj)
+{
+	if (p->depth == JSON_DEPTH_MAX)
+		return EOVERFLOW;
+
+	uint32_t d = p->depth++;
+	uint8_t bit = (uint8_t)(1U << (d & 7U));
+	if (obj)
+		p->stack[d >> 3U] |= bit;
+	else
+		p->stack[d >> 3U] &= (uint8_t)~bit;
+
+	p->state = obj ? json_st8_open : json_st8_first;
+	return p->fn(p->ctx, obj ? json_object_begin : json_array_begin,
+	             &(dstr){0});
+}
+
+nonnull_in()
+static int
+json_close (struct json *p)
+{
+	bool obj = json_in_object(p);
+	--p->depth;
+	json_done(p);
+	return p->fn(p->ctx, obj ? json_object_end : json_array_end,
+	             &(dstr){0});
+}
+
+/**
+ * @brief Encode a code point from a `\u` escape into the buffer.
+ */
+nonnull_in()
+static force_inline int
+json_put_cp (struct json *p,
+             uint32_t     cp)
+{
+	uint8_t u[4];
+	return json_append(p, u, utf8_encode(cp, u));
+}
+
+/**
+ * @brief Consume one hex digit of a `\u` escape.
+ *
+ * The digits accumulate in the low half of @ref json::cp. A high
+ * surrogate waits in the high half for the low surrogate escape
+ * which must follow it.
+ */
+nonnull_in()
+static int
+json_hex (struct json   *p,
+          unsigned char  c)
+{
+	uint32_t d = (uint32_t)c - '0';
+	uint32_t x = ((uint32_t)c | 0x20U) - 'a';
+	uint32_t v = d < 10U ? d : x < 6U ? x + 10U : UINT32_MAX;
+	if (v == UINT32_MAX)
+		return EBADMSG;
+
+	p->cp = (p->cp & 0xffff0000U) | ((p->cp << 4U) & 0xfff0U) | v;
+	if (++p->sub < 4U)
+		return 0;
+
+	uint32_t hi = p->cp >> 16U;
+	uint32_t lo = p->cp & 0xffffU;
+	p->cp = 0;
+	p->state = json_st8_string;
+
+	if (hi) {
+		if (lo - 0xdc00U >= 0x400U)
+			return EBADMSG;
+		return json_put_cp(p, 0x10000U + ((hi - 0xd800U) << 10U)
+		                               + (lo - 0xdc00U));
+	}
+
+	if (lo - 0xd800U < 0x400U) {
+		p->cp = lo << 16U;
+		return 0;
+	}
+
+	if (lo - 0xdc00U < 0x400U)
+		return EBADMSG;
+
+	return json_put_cp(p, lo);
+}
+
+int
+json_unescape (uint8_t       *dst,
+               uint8_t const *src,
+               size_t         len,
+               size_t        *end,
+               size_t        *out,
+               bool           utf8)
+{
+	struct utf8_text t = utf8_text(false);
+	size_t k = 0, w = 0;
+	int e = 0;
+
+	for (;;) {
+		size_t a = k;
+		bool high = false;
+		k = json_copy_string(&dst[w], src, k, len, &high);
+		w += k - a;
+
+		if (high && utf8) {
+			t.offset = a;
+			if (!utf8_text_check(&t, &src[a], k - a)) {
+				k = t.error;
+				e = EILSEQ;
+				break;
+			}
+		}
+
+		/* Escapes and the closing quote can't split a sequence. */
+		if (!utf8_text_at_boundary(&t)) {
+			e = EILSEQ;
+			break;
+		}
+
+		if (k == len || src[k] == '"')
+			break;
+
+		size_t j = k + 1U;
+		size_t n = src[k] == '\\' ? json_escape(src, &j, len, &dst[w]) : 0;
+		if (!n) {
+			e = EBADMSG;
+			break;
+		}
+
+		w += n;
+		k = j;
+	}
+
+	*end = k;
+	*out = w;
+	return e;
+}
+
+int
+json_unescape_dstr (dstr       *dst,
+                    void const *src,
+                    size_t      len)
+{
+	if (len > UINT_MAX - 1U)
+		return EOVERFLOW;
+
+	bool reuse = dstr_owns_memory(dst) && dst->size > len;
+	uint8_t *b = reuse ? (uint8_t *)dst->ptr : malloc(len + 1U);
+	if (!b)
+		return errno;
+
+	size_t end, n;
+	int e = json_unescape(b, src ? src : b, len, &end, &n, true);
+	if (!e && end != len)
+		e = EBADMSG;
+
+	if (e) {
+		if (!reuse)
+			free(b);
+		return e;
+	}
+
+	b[n] = '\0';
+	if (n >= sizeof dst->arr) {
+		if (!reuse) {
+			dstr_fini(dst);
+			dst->ptr = (char *)b;
+			dst->size = (unsigned)len + 1U;
+		}
+		dst->len = (unsigned)n;
+		return 0;
+	}
+
+	/* Short results live in the dstr itself. */
+	dstr d = make_dstr_view_from_decay((char const *)b, n);
+	if (!reuse)
+		free(b);
+	dstr_fini(dst);
+	*dst = d;
+	return 0;
+}
+
+void
+json_init (struct json *p,
+           json_fn     *fn,
+           void        *ctx)
+{
+	*p = (struct json){
+		.fn    = fn,
+		.ctx   = ctx,
+		.state = json_st8_value,
+	};
+}
+
+int
+json_feed (struct json *p,
+           void const  *src,
+           size_t       len)
+{
+	if (p->ec)
+		return p->ec;
+
+	unsigned char const *const s = src;
+	size_t tok = 0; // Start of a string or number in this chunk
+	size_t i = 0;
+	int e = 0;
+
+	while (!e && i < len) {
+		unsigned char c = s[i];
+
+		switch ((enum json_st8)p->state) {
+		case json_st8_gap:
+			if (!json_ws(c)) {
+				e = EBADMSG;
+				break;
+			}
+			p->state = json_st8_value;
+			++i;
+			break;
+
+		case json_st8_value:
+		case json_st8_first:
+			if (json_ws(c)) {
+				++i;
+				break;
+			}
+
+			switch (c) {
+			case ']':
+				if (p->state != json_st8_first) {
+					e = EBADMSG;
+					break;
+				}
+				e = json_close(p);
+				break;
+			case '{':
+			case '[':
+				e = json_open(p, c == '{');
+				break;
+			case '"':
+				p->key = false;
+				p->state = json_st8_string;
+				tok = i + 1U;
+				break;
+			case 'n':
+			case 'f':
+			case 't':
+				p->lit = c == 'n' ? json_null
+				       : c == 'f' ? json_false : json_true;
+				p->sub = 1U;
+				p->state = json_st8_literal;
+				break;
+			case '-': case '0': case '1': case '2': case '3':
+			case '4': case '5': case '6': case '7': case '8':
+			case '9':
+				p->sub = (uint8_t)(c == '-' ? json_num_minus
+				                 : c == '0' ? json_num_zero
+				                            : json_num_int);
+				p->state = json_st8_number;
+				tok = i;
+				break;
+			default:
+				e = EBADMSG;
+			}
+
+			if (!e)
+				++i;
+			break;
+
+		case json_st8_open:
+		case json_st8_member:
+			if (json_ws(c)) {
+				++i;
+				break;
+			}
+
+			if (c == '}' && p->state == json_st8_open) {
+				e = json_close(p);
+			} else if (c == '"') {
+				p->key = true;
+				p->state = json_st8_string;
+				tok = i + 1U;
+			} else {
+				e = EBADMSG;
+				break;
+			}
+			++i;
+			break;
+
+		case json_st8_colon:
+			if (json_ws(c)) {
+				++i;
+			} else if (c == ':') {
+				p->state = json_st8_value;
+				++i;
+			} else {
+				e = EBADMSG;
+			}
+			break;
+
+		case json_st8_next:
+			if (json_ws(c)) {
+				++i;
+				break;
+			}
+
+			if (c == ',') {
+				p->state = json_in_object(p) ? json_st8_member
+				                             : json_st8_value;
+			} else if (c == (json_in_object(p) ? '}' : ']')) {
+				e = json_close(p);
+			} else {
+				e = EBADMSG;
+				break;
+			}
+			++i;
+			break;
+
+		case json_st8_string: {
+			/* A high surrogate must be followed by another escape. */
+			if (p->cp && c != '\\') {
+				e = EBADMSG;
+				break;
+			}
+
+			size_t k = json_scan_string(s, i, len);
+			if (k == len) {
+				i = len;
+				break;
+			}
+
+			c = s[k];
+			if (c == '"') {
+				e = json_string_end(p, s, tok, k);
+				i = k + 1U;
+			} else if (c == '\\' && json_string_fast(p, s, tok, len,
+			                                          &i, &e)) {
+				break;
+			} else if (c == '\\') {
+				e = json_append(p, &s[tok], k - tok);
+				p->state = json_st8_escape;
+				i = k + 1U;
+			} else {
+				i = k;
+				e = EBADMSG;
+			}
+			break;
+		}
+
+		case json_st8_escape: {
+			char o = c == 'b' ? '\b' : c == 'f' ? '\f'
+			       : c == 'n' ? '\n' : c == 'r' ? '\r'
+			       : c == 't' ? '\t'
+			       : c == '"' || c == '\\' || c == '/' ? (char)c
+			       : 0;
+
+			if (c == 'u') {
+				p->sub = 0;
+				p->state = json_st8_hex;
+			} else if (!o || p->cp) {
+				e = EBADMSG;
+				break;
+			} else {
+				e = json_append(p, &o, 1U);
+				p->state = json_st8_string;
+			}
+			tok = ++i;
+			break;
+		}
+
+		case json_st8_hex:
+			e = json_hex(p, c);
+			if (!e)
+				tok = ++i;
+			break;
+
+		case json_st8_number: {
+			size_t k = i;
+			for (int n; k < len; ++k) {
+				n = json_num_next((enum json_num)p->sub, s[k]);
+				if (n < 0)
+					break;
+				p->sub = (uint8_t)n;
+			}
+
+			i = k;
+			if (k == len)
+				break;
+
+			if (!json_num_final((enum json_num)p->sub)) {
+				e = EBADMSG;
+				break;
+			}
+
+			/* The terminating byte is left for the next state. */
+			e = json_token(p, json_number, s, tok, k);
+			json_done(p);
+			break;
+		}
+
+		case json_st8_literal: {
+			char const *l = json_lit[p->lit];
+			if (c != (unsigned char)l[p->sub]) {
+				e = EBADMSG;
+				break;
+			}
+
+			++i;
+			if (!l[++p->sub]) {
+				e = json_emit(p, (enum json_tok)p->lit, l, p->sub);
+				json_done(p);
+			}
+			break;
+		}
+		}
+	}
+
+	/* Carry a partial string or number over to the next chunk. */
+	if (!e && tok < len && (p->state == json_st8_string ||
+	                        p->state == json_st8_number))
+		e = json_append(p, &s[tok], len - tok);
+
+	if (e) {
+		p->offset += i;
+		return json_fail(p, e);
+	}
+
+	p->offset += len;
+	return 0;
+}
+
+int
+json_end (struct json *p)
+{
+	if (p->ec)
+		return p->ec;
+
+	int e = 0;
+
+	if (p->state == json_st8_number && !p->depth) {
+		if (!json_num_final((enum json_num)p->sub)) {
+			e = EBADMSG;
+		} else {
+			e = json_emit(p, json_number, p->buf, p->len);
+			p->len = 0;
+			p->split = false;
+			json_done(p);
+		}
+	}
+
+	if (!e && (p->depth || !p->values || (p->state != json_st8_gap &&
+	                                      p->state != json_st8_value)))
+		e = EBADMSG;
+
+	return e ? json_fail(p, e) : 0;
+}
+
+void
+json_fini (struct json *p)
+{
+	if (p) {
+		free(p->buf);
+		p->buf = nullptr;
+		p->len = 0;
+		p->cap = 0;
+	}
+}
@@ -0,0 +1,423 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file json.h
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_JSON_H_
+#define LIBCANTH_SRC_JSON_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#endif /* __AVX2__ */
+
+#include "dstr.h"
+#include "utf8.h"
+#include "util.h"
+
+/**
+ * @brief Maximum nesting depth of objects and arrays.
+ */
+#define JSON_DEPTH_MAX 1024U
+
+/**
+ * @brief Tokens reported by the push parser.
+ */
+fixed_enum(json_tok, uint8_t) {
+	json_null,         //!< `null`
+	json_false,        //!< `false`
+	json_true,         //!< `true`
+	json_number,       //!< Number, verbatim as in the input.
+	json_string,       //!< String value, unescaped.
+	json_key,          //!< Object member name, unescaped.
+	json_object_begin, //!< `{`
+	json_object_end,   //!< `}`
+	json_array_begin,  //!< `[`
+	json_array_end,    //!< `]`
+};
+
+/**
+ * @brief Token callback.
+ *
+ * @param ctx Context pointer given to @ref json_init().
+ * @param tok Token type.
+ * @param val Token text. Empty for structural tokens, the literal
+ *            text for `null`, `false`, and `true`. Usually a view
+ *            into the input chunk, so not necessarily terminated,
+ *            and only valid until the callback returns.
+ * @return 0 to continue parsing, otherwise an error code which
+ *         stops the parser and is returned from @ref json_feed().
+ */
+typedef int (json_fn)(void           *ctx,
+                      enum json_tok   tok,
+                      dstr const     *val);
+
+/**
+ * @brief Incremental push parser.
+ *
+ * Input is fed in arbitrary chunks and tokens are reported through a
+ * callback as soon as they are complete, without building a tree. The
+ * state carried across chunks is kept in this object, the same way a
+ * @ref utf8 parser object carries a partial code point.
+ *
+ * Strings and numbers that lie within one chunk and need no unescaping
+ * are handed to the callback as views into the chunk. Only tokens that
+ * span chunks or contain escape sequences are assembled in a buffer.
+ * String bytes above 0x7f are passed on without UTF-8 validation.
+ */
+struct json {
+	json_fn  *fn;      //!< Token callback.
+	void     *ctx;     //!< Callback context.
+	char     *buf;     //!< Assembly buffer for split or escaped tokens.
+	size_t    len;     //!< Bytes in @ref json::buf.
+	size_t    cap;     //!< Allocated size of @ref json::buf.
+	size_t    offset;  //!< Input offset of the next chunk, or of the
+	                   //!< offending byte after a syntax error.
+	size_t    values;  //!< Completed top-level values.
+	uint32_t  depth;   //!< Current nesting depth.
+	uint32_t  cp;      //!< Partial `\u` escape or pending surrogate.
+	int       ec;      //!< Sticky error code.
+	uint8_t   state;   //!< Lexer state.
+	uint8_t   sub;     //!< Position inside a number or literal.
+	uint8_t   lit;     //!< Literal being matched, a @ref json_tok.
+	bool      key;     //!< Current string is an object member name.
+	bool      split;   //!< Current token is in @ref json::buf.
+	uint8_t   stack[JSON_DEPTH_MAX / 8U]; //!< Object bit per level.
+};
+
+/**
+ * @brief Initialize a push parser.
+ *
+ * @param[out] p   Parser to initialize.
+ * @param[in]  fn  Token callback.
+ * @param[in]  ctx Passed to @p fn as is.
+ */
+extern void
+json_init (struct json *p,
+           json_fn     *fn,
+           void        *ctx) nonnull_in(1,2);
+
+/**
+ * @brief Parse the next chunk of input.
+ *
+ * Any number of whitespace-separated top-level values is accepted, so
+ * a JSON Lines stream can be fed as one continuous input.
+ *
+ * @param[in,out] p   Parser.
+ * @param[in]     src Input chunk.
+ * @param[in]     len Length of @p src.
+ * @return 0 on success, otherwise an error code. Malformed input is
+ *         reported as `EBADMSG` and nesting deeper than
+ *         @ref JSON_DEPTH_MAX as `EOVERFLOW`.
+ */
+extern int
+json_feed (struct json *p,
+           void const  *src,
+           size_t       len) nonnull_in(1);
+
+/**
+ * @brief Signal the end of input.
+ *
+ * Completes a trailing top-level number, which can't be recognized as
+ * finished before this, and checks that no value was left incomplete.
+ *
+ * @param[in,out] p Parser.
+ * @return 0 on success, otherwise an error code. Input ending inside
+ *         a value or containing no values at all is `EBADMSG`.
+ */
+extern int
+json_end (struct json *p) nonnull_in();
+
+/**
+ * @brief Release a push parser.
+ */
+extern void
+json_fini (struct json *p);
+
+/**
+ * @brief Decode the contents of a string, optionally validating them
+ *        as UTF-8.
+ *
+ * Plain runs are copied a block at a time, 16 bytes with SSE2 and 8
+ * otherwise, while looking for quotes, backslashes, and control bytes.
+ * When validating, runs with bytes above 0x7f are checked with the
+ * UTF-8 state machine of @ref utf8_text_check() right after they're
+ * copied. Escapes, including surrogate pairs, are decoded in between.
+ *
+ * @param[out] dst  Output buffer of at least @p len bytes, which must
+ *                  not overlap @p src.
+ * @param[in]  src  String contents, starting after the opening quote.
+ * @param[in]  len  Length of @p src.
+ * @param[out] end  Index of the closing quote in @p src, or @p len if
+ *                  there is none. On failure, the offset of the first
+ *                  byte that couldn't be handled.
+ * @param[out] out  Number of bytes written to @p dst.
+ * @param[in]  utf8 Validate UTF-8, or copy bytes above 0x7f through
+ *                  unchecked for input that was validated already.
+ * @return 0 on success, otherwise an error code. Invalid UTF-8 is
+ *         `EILSEQ`, and control bytes, bad escapes, and unpaired
+ *         surrogates are `EBADMSG`.
+ */
+extern int
+json_unescape (uint8_t       *dst,
+               uint8_t const *src,
+               size_t         len,
+               size_t        *end,
+               size_t        *out,
+               bool           utf8) nonnull_in(1,4,5);
+
+/**
+ * @brief Decode complete string contents into a @ref dstr.
+ *
+ * The heap buffer of @p dst is reused if it is large enough.
+ *
+ * @param[in,out] dst Destination string. Not modified on failure.
+ * @param[in]     src String contents without quotes, such as the text
+ *                    of a string found with `jpath_get()`. Must not
+ *                    point into @p dst.
+ * @param[in]     len Length of @p src.
+ * @return 0 on success, otherwise an error code as for
+ *         @ref json_unescape(). An unescaped quote is `EBADMSG`.
+ */
+extern int
+json_unescape_dstr (dstr       *dst,
+                    void const *src,
+                    size_t      len) nonnull_in(1);
+
+/**
+ * @brief Check if the innermost open container is an object.
+ */
+nonnull_in()
+static force_inline bool
+json_in_object (struct json const *p)
+{
+	uint32_t d = p->depth - 1U;
+	return p->depth && (p->stack[d >> 3U] >> (d & 7U)) & 1U;
+}
+
+/**
+ * @brief Find the first byte that ends a plain run of string content.
+ *
+ * Eight bytes are checked at a time for the three kinds of bytes that
+ * need attention inside a string.
+ *
+ * @param s   Input buffer.
+ * @param i   Index to start at.
+ * @param len Length of @p s.
+ * @return Index of the first quote, backslash, or control character
+ *         at or after @p i, or @p len if there is none.
+ */
+nonnull_in()
+static force_inline size_t
+json_scan_string (unsigned char const *s,
+                  size_t               i,
+                  size_t               len)
+{
+	constexpr uint64_t ones = UINT64_C(0x0101010101010101);
+	constexpr uint64_t high = UINT64_C(0x8080808080808080);
+
+	for (; len - i >= 8U; i += 8U) {
+		uint64_t v;
+		__builtin_memcpy(&v, &s[i], 8U);
+		uint64_t q = v ^ (ones * '"');
+		uint64_t b = v ^ (ones * '\\');
+		if ((((q - ones) & ~q) |
+		     ((b - ones) & ~b) |
+		     ((v - ones * 0x20U) & ~v)) & high)
+			break;
+	}
+
+	for (; i < len; ++i) {
+		unsigned char c = s[i];
+		if (c == '"' || c == '\\' || c < 0x20U)
+			break;
+	}
+
+	return i;
+}
+
+/**
+ * @brief Copy a plain run of string content.
+ *
+ * Blocks of 32 bytes with AVX2, 16 with SSE2, or 8 with SWAR are
+ * copied with single stores. Whole blocks are stored before they're
+ * inspected, so up to a block past the end of the run may be written.
+ * That never reaches beyond `len - k` bytes from @p d, because no more
+ * than that is read.
+ *
+ * @param d    Output position of `s[k]`.
+ * @param s    Input.
+ * @param k    Index of the start of the run.
+ * @param len  Length of @p s.
+ * @param high Set if the run has any byte above 0x7f.
+ * @return Index of the first quote, backslash, or control byte at or
+ *         after @p k, or @p len if there is none.
+ */
+nonnull_in()
+static force_inline size_t
+json_copy_string (uint8_t       *d,
+                  uint8_t const *s,
+                  size_t         k,
+                  size_t         len,
+                  bool          *high)
+{
+	size_t i = k;
+
+#if defined(__AVX2__)
+	__m256i const q2 = _mm256_set1_epi8('"');
+	__m256i const b2 = _mm256_set1_epi8('\\');
+	__m256i const c2 = _mm256_set1_epi8(0x1f);
+
+	for (; len - i >= 32U; i += 32U) {
+		__m256i v = _mm256_loadu_si256((__m256i const *)&s[i]);
+		_mm256_storeu_si256((__m256i *)&d[i - k], v);
+		unsigned m = (unsigned)_mm256_movemask_epi8(
+			_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, q2),
+			                                _mm256_cmpeq_epi8(v, b2)),
+			                _mm256_cmpeq_epi8(_mm256_min_epu8(v, c2), v)));
+		unsigned h = (unsigned)_mm256_movemask_epi8(v);
+		if (m) {
+			*high |= (h & ((m & -m) - 1U)) != 0;
+			return i + (size_t)__builtin_ctz(m);
+		}
+		*high |= h != 0;
+	}
+#endif /* __AVX2__ */
+
+#if defined(__SSE2__)
+	__m128i const q = _mm_set1_epi8('"');
+	__m128i const b = _mm_set1_epi8('\\');
+	__m128i const c = _mm_set1_epi8(0x1f);
+
+	for (; len - i >= 16U; i += 16U) {
+		__m128i v = _mm_loadu_si128((__m128i const *)&s[i]);
+		_mm_storeu_si128((__m128i *)&d[i - k], v);
+		unsigned m = (unsigned)_mm_movemask_epi8(
+			_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, q),
+			                          _mm_cmpeq_epi8(v, b)),
+			             _mm_cmpeq_epi8(_mm_min_epu8(v, c), v)));
+		unsigned h = (unsigned)_mm_movemask_epi8(v);
+		if (m) {
+			*high |= (h & ((m & -m) - 1U)) != 0;
+			return i + (size_t)__builtin_ctz(m);
+		}
+		*high |= h != 0;
+	}
+#else
+	constexpr uint64_t ones = UINT64_C(0x0101010101010101);
+	constexpr uint64_t top = UINT64_C(0x8080808080808080);
+
+	for (; __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ &&
+	       len - i >= 8U; i += 8U) {
+		uint64_t v;
+		__builtin_memcpy(&v, &s[i], 8U);
+		__builtin_memcpy(&d[i - k], &v, 8U);
+		uint64_t x = v ^ (ones * '"');
+		uint64_t y = v ^ (ones * '\\');
+		uint64_t m = (((x - ones) & ~x) |
+		              ((y - ones) & ~y) |
+		              ((v - ones * 0x20U) & ~v)) & top;
+		if (m) {
+			*high |= (v & top & ((m & -m) - 1U)) != 0;
+			return i + (size_t)__builtin_ctzll(m) / 8U;
+		}
+		*high |= (v & top) != 0;
+	}
+#endif /* __SSE2__ */
+
+	for (; i < len; ++i) {
+		uint8_t u = s[i];
+		if (u == '"' || u == '\\' || u < 0x20U)
+			break;
+		*high |= u > 0x7fU;
+		d[i - k] = u;
+	}
+
+	return i;
+}
+
+/**
+ * @brief Decode the four hex digits of a `\u` escape.
+ *
+ * @return The value, or `UINT32_MAX` if a digit isn't hexadecimal.
+ */
+nonnull_in()
+static force_inline uint32_t
+json_hex4 (uint8_t const *s)
+{
+	uint32_t r = 0;
+	for (int j = 0; j < 4; ++j) {
+		uint32_t d = (uint32_t)s[j] - '0';
+		uint32_t x = ((uint32_t)s[j] | 0x20U) - 'a';
+		d = d < 10U ? d : x < 6U ? x + 10U : 16U;
+		if (d > 15U)
+			return UINT32_MAX;
+		r = r << 4U | d;
+	}
+	return r;
+}
+
+/**
+ * @brief Decode one escape sequence.
+ *
+ * A `\u` escape of a high surrogate must be followed by one of a low
+ * surrogate, and both are decoded together.
+ *
+ * @param s   Input.
+ * @param i   Index of the byte after the backslash, advanced past the
+ *            escape on success.
+ * @param len Length of @p s.
+ * @param d   Output buffer with room for 4 bytes.
+ * @return Number of bytes written to @p d, or 0 if the escape is
+ *         invalid or cut off.
+ */
+nonnull_in()
+static force_inline size_t
+json_escape (uint8_t const *s,
+             size_t        *i,
+             size_t         len,
+             uint8_t       *d)
+{
+	size_t k = *i;
+	if (k >= len)
+		return 0;
+
+	uint8_t c = s[k++];
+	uint8_t o = (uint8_t)(c == 'b' ? '\b' : c == 'f' ? '\f'
+	                    : c == 'n' ? '\n' : c == 'r' ? '\r'
+	                    : c == 't' ? '\t'
+	                    : c == '"' || c == '\\' || c == '/' ? c
+	                    : 0);
+	if (o) {
+		*d = o;
+		*i = k;
+		return 1U;
+	}
+
+	if (c != 'u' || len - k < 4U)
+		return 0;
+
+	uint32_t cp = json_hex4(&s[k]);
+	k += 4U;
+
+	if (cp - 0xd800U < 0x400U) {
+		if (len - k < 6U || s[k] != '\\' || s[k + 1U] != 'u')
+			return 0;
+		uint32_t lo = json_hex4(&s[k + 2U]);
+		if (lo - 0xdc00U >= 0x400U)
+			return 0;
+		k += 6U;
+		cp = 0x10000U + ((cp - 0xd800U) << 10U) + (lo - 0xdc00U);
+	} else if (cp - 0xdc00U < 0x400U || cp == UINT32_MAX) {
+		return 0;
+	}
+
+	*i = k;
+	return utf8_encode(cp, d);
+}
+
+#endif /* LIBCANTH_SRC_JSON_H_ */
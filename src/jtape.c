@@ -0,0 +1,557 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file jtape.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <stdlib.h>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
+#ifdef __PCLMUL__
+# include <wmmintrin.h>
+#endif /* __PCLMUL__ */
+
+#include "json.h"
+#include "jtape.h"
+#include "num.h"
+#include "utf8.h"
+
+/**
+ * @brief Character class bitmasks of a 64-byte block, one bit per byte.
+ */
+struct jtape_blk {
+	uint64_t quote; //!< `"`
+	uint64_t bs;    //!< `\`
+	uint64_t op;    //!< `{`, `}`, `[`, `]`, `:`, and `,`
+	uint64_t ws;    //!< Space, tab, line feed, and carriage return.
+	uint64_t high;  //!< Bytes with the high bit set.
+};
+
+#if defined(__SSE2__)
+static force_inline uint64_t
+jtape_eq (__m128i const v[4],
+          char          c)
+{
+	__m128i k = _mm_set1_epi8(c);
+	return (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[0], k))
+	     | (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[1], k)) << 16U
+	     | (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[2], k)) << 32U
+	     | (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[3], k)) << 48U;
+}
+
+nonnull_in()
+static force_inline void
+jtape_classify (uint8_t const    *p,
+                struct jtape_blk *b)
+{
+	__m128i v[4], u[4];
+	for (int i = 0; i < 4; ++i) {
+		v[i] = _mm_loadu_si128((__m128i const *)&p[i * 16]);
+		u[i] = _mm_or_si128(v[i], _mm_set1_epi8(0x20));
+	}
+
+	/* `[` and `]` are `{` and `}` with bit 5 clear. */
+	b->quote = jtape_eq(v, '"');
+	b->bs    = jtape_eq(v, '\\');
+	b->op    = jtape_eq(u, '{') | jtape_eq(u, '}')
+	         | jtape_eq(v, ':') | jtape_eq(v, ',');
+	b->ws    = jtape_eq(v, ' ') | jtape_eq(v, '\t')
+	         | jtape_eq(v, '\n') | jtape_eq(v, '\r');
+	b->high  = (uint64_t)(uint16_t)_mm_movemask_epi8(v[0])
+	         | (uint64_t)(uint16_t)_mm_movemask_epi8(v[1]) << 16U
+	         | (uint64_t)(uint16_t)_mm_movemask_epi8(v[2]) << 32U
+	         | (uint64_t)(uint16_t)_mm_movemask_epi8(v[3]) << 48U;
+}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+static force_inline uint64_t
+jtape_mask (uint8x16_t const c[4])
+{
+	uint8x16_t const bit = {
+		0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+		0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+	};
+
+	uint8x16_t s0 = vpaddq_u8(vandq_u8(c[0], bit), vandq_u8(c[1], bit));
+	uint8x16_t s1 = vpaddq_u8(vandq_u8(c[2], bit), vandq_u8(c[3], bit));
+	s0 = vpaddq_u8(s0, s1);
+	s0 = vpaddq_u8(s0, s0);
+	return vgetq_lane_u64(vreinterpretq_u64_u8(s0), 0);
+}
+
+static force_inline uint64_t
+jtape_eq (uint8x16_t const v[4],
+          uint8_t          c)
+{
+	uint8x16_t k = vdupq_n_u8(c);
+	uint8x16_t m[4] = {
+		vceqq_u8(v[0], k), vceqq_u8(v[1], k),
+		vceqq_u8(v[2], k), vceqq_u8(v[3], k),
+	};
+	return jtape_mask(m);
+}
+
+nonnull_in()
+static force_inline void
+jtape_classify (uint8_t const    *p,
+                struct jtape_blk *b)
+{
+	uint8x16_t v[4], u[4], h[4];
+	for (int i = 0; i < 4; ++i) {
+		v[i] = vld1q_u8(&p[i * 16]);
+		u[i] = vorrq_u8(v[i], vdupq_n_u8(0x20));
+		h[i] = vcgeq_u8(v[i], vdupq_n_u8(0x80));
+	}
+
+	/* `[` and `]` are `{` and `}` with bit 5 clear. */
+	b->quote = jtape_eq(v, '"');
+	b->bs    = jtape_eq(v, '\\');
+	b->op    = jtape_eq(u, '{') | jtape_eq(u, '}')
+	         | jtape_eq(v, ':') | jtape_eq(v, ',');
+	b->ws    = jtape_eq(v, ' ') | jtape_eq(v, '\t')
+	         | jtape_eq(v, '\n') | jtape_eq(v, '\r');
+	b->high  = jtape_mask(h);
+}
+#else
+nonnull_in()
+static force_inline void
+jtape_classify (uint8_t const    *p,
+                struct jtape_blk *b)
+{
+	*b = (struct jtape_blk){0};
+	for (unsigned i = 0; i < 64U; ++i) {
+		uint64_t bit = UINT64_C(1) << i;
+		switch (p[i]) {
+		case '"':
+			b->quote |= bit;
+			break;
+		case '\\':
+			b->bs |= bit;
+			break;
+		case '{': case '}': case '[': case ']': case ':': case ',':
+			b->op |= bit;
+			break;
+		case ' ': case '\t': case '\n': case '\r':
+			b->ws |= bit;
+			break;
+		default:
+			if (p[i] & 0x80U)
+				b->high |= bit;
+		}
+	}
+}
+#endif
+
+/**
+ * @brief Set every bit that has an odd number of set bits at or below it.
+ */
+static const_inline uint64_t
+jtape_prefix_xor (uint64_t x)
+{
+#ifdef __PCLMUL__
+	__m128i a = _mm_set_epi64x(0, (long long)x);
+	__m128i r = _mm_clmulepi64_si128(a, _mm_set1_epi8(-1), 0);
+	return (uint64_t)_mm_cvtsi128_si64(r);
+#else
+	x ^= x << 1U;
+	x ^= x << 2U;
+	x ^= x << 4U;
+	x ^= x << 8U;
+	x ^= x << 16U;
+	x ^= x << 32U;
+	return x;
+#endif /* __PCLMUL__ */
+}
+
+/**
+ * @brief Find the bytes escaped by a backslash.
+ *
+ * Runs of backslashes starting on odd and even positions are separated
+ * with an addition whose carries cancel out every other backslash. The
+ * carry out of the block tells whether the next block starts escaped.
+ *
+ * @param bs   Backslash mask of the block.
+ * @param prev Carry in and out, 0 or 1.
+ * @return Mask of escaped bytes.
+ */
+nonnull_in()
+static force_inline uint64_t
+jtape_escaped (uint64_t  bs,
+               uint64_t *prev)
+{
+	constexpr uint64_t even = UINT64_C(0x5555555555555555);
+
+	bs &= ~*prev;
+	uint64_t follows = bs << 1U | *prev;
+	uint64_t odd_starts = bs & ~even & ~follows;
+	uint64_t even_seqs;
+	*prev = __builtin_add_overflow(odd_starts, bs, &even_seqs);
+	return (even ^ (even_seqs << 1U)) & follows;
+}
+
+/**
+ * @brief Grow a buffer to hold at least @p n elements of size @p z.
+ */
+nonnull_in()
+static int
+jtape_reserve (void   **p,
+               size_t  *cap,
+               size_t   n,
+               size_t   z)
+{
+	if (*cap >= n)
+		return 0;
+
+	if (n > SIZE_MAX / z)
+		return EOVERFLOW;
+
+	void *q = realloc(*p, n * z);
+	if (!q)
+		return errno;
+
+	*p = q;
+	*cap = n;
+	return 0;
+}
+
+/**
+ * @brief Stage one: build the structural index and validate UTF-8.
+ */
+nonnull_in()
+static int
+jtape_index (struct jtape  *t,
+             uint8_t const *src,
+             size_t         len)
+{
+	struct utf8_text u = utf8_text(false);
+	uint64_t prev_esc = 0;    // Block starts escaped, 0 or 1
+	uint64_t prev_in = 0;     // Block starts in a string, 0 or ~0
+	uint64_t prev_scalar = 0; // Block starts mid-scalar, 0 or 1
+	uint32_t *idx = t->index;
+	size_t n = 0;
+
+	for (size_t base = 0; base < len; base += 64U) {
+		uint8_t const *p = &src[base];
+		size_t m = len - base < 64U ? len - base : 64U;
+
+		/* Pad the tail with whitespace, which is never structural. */
+		uint8_t tail[64];
+		if (m < 64U) {
+			__builtin_memset(tail, ' ', sizeof tail);
+			__builtin_memcpy(tail, p, m);
+			p = tail;
+		}
+
+		struct jtape_blk b;
+		jtape_classify(p, &b);
+
+		if (b.high || !utf8_text_at_boundary(&u)) {
+			u.offset = base;
+			if (!utf8_text_check(&u, p, m)) {
+				t->error = u.error;
+				return EILSEQ;
+			}
+		}
+
+		uint64_t quote = b.quote & ~jtape_escaped(b.bs, &prev_esc);
+		uint64_t in = jtape_prefix_xor(quote) ^ prev_in;
+		prev_in = (uint64_t)((int64_t)in >> 63U);
+
+		/* Scalars are runs of anything else outside strings. */
+		uint64_t scalar = ~(b.op | b.ws | b.quote | in);
+		uint64_t starts = scalar & ~(scalar << 1U | prev_scalar);
+		prev_scalar = scalar >> 63U;
+
+		/* A string starts at a quote that ends up inside it. */
+		uint64_t s = (b.op & ~in) | (quote & in) | starts;
+		for (; s; s &= s - 1U)
+			idx[n++] = (uint32_t)(base + (unsigned)__builtin_ctzll(s));
+	}
+
+	if (prev_in) {
+		t->error = len;
+		return EBADMSG;
+	}
+
+	uint8_t cr;
+	(void)utf8_text_end(&u, &cr);
+	if (u.error != SIZE_MAX) {
+		t->error = u.error;
+		return EILSEQ;
+	}
+
+	t->count = n;
+	return 0;
+}
+
+static const_inline bool
+jtape_delim (uint8_t c)
+{
+	switch (c) {
+	case ' ': case '\t': case '\n': case '\r':
+	case '{': case '}': case '[': case ']': case ':': case ',': case '"':
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ * @brief Unescape a string into the string buffer.
+ *
+ * @param s   Input.
+ * @param len Length of @p s.
+ * @param i   Offset of the opening quote on input, of the first byte
+ *            that couldn't be handled on error.
+ * @param d   String buffer position, updated on success.
+ * @return 0 on success, otherwise `EBADMSG`.
+ */
+nonnull_in()
+static int
+jtape_unescape (uint8_t const  *s,
+                size_t          len,
+                size_t         *i,
+                char          **d)
+{
+	char *const hdr = *d;
+	size_t k = *i + 1U, end, n;
+
+	/* Stage one has validated the input already. */
+	int e = json_unescape((uint8_t *)hdr + sizeof (uint32_t), &s[k],
+	                      len - k, &end, &n, false);
+	if (!e && end == len - k)
+		e = EBADMSG;
+	if (e) {
+		*i = k + end;
+		return e;
+	}
+
+	uint32_t u = (uint32_t)n;
+	__builtin_memcpy(hdr, &u, sizeof u);
+	hdr[sizeof u + n] = '\0';
+	*d = hdr + sizeof u + n + 1U;
+	*i = k + end + 1U;
+	return 0;
+}
+
+/**
+ * @brief Parse a number into two tape entries.
+ *
+ * @return 0 on success, otherwise `EBADMSG` with @p i pointing to the
+ *         first byte that doesn't fit the number grammar.
+ */
+nonnull_in()
+static int
+jtape_number (uint8_t const *s,
+              size_t         len,
+              size_t        *i,
+              uint64_t      *tape)
+{
+	struct num v;
+	size_t n;
+	int e = num_parse(&s[*i], len - *i, &n, &v);
+	*i += n;
+	if (e)
+		return e;
+
+	if (*i < len && !jtape_delim(s[*i]))
+		return EBADMSG;
+
+	if (v.flt) {
+		tape[0] = (uint64_t)jtape_double << 56U;
+		__builtin_memcpy(&tape[1], &v.d, sizeof v.d);
+	} else {
+		tape[0] = (uint64_t)jtape_int << 56U;
+		tape[1] = (uint64_t)v.i;
+	}
+	return 0;
+}
+
+/**
+ * @brief Parser states of stage two.
+ */
+fixed_enum(jtape_st8, uint8_t) {
+	jtape_st8_value,  //!< Expecting a value.
+	jtape_st8_first,  //!< After `[`, expecting a value or `]`.
+	jtape_st8_open,   //!< After `{`, expecting a name or `}`.
+	jtape_st8_member, //!< After `,` in an object, expecting a name.
+	jtape_st8_colon,  //!< After a member name, expecting `:`.
+	jtape_st8_next,   //!< After a nested value, expecting `,` or a closer.
+	jtape_st8_done,   //!< After the root value.
+};
+
+/**
+ * @brief Stage two: walk the structural index and build the tape.
+ */
+nonnull_in()
+static int
+jtape_build (struct jtape  *t,
+             uint8_t const *s,
+             size_t         len)
+{
+	uint32_t open[JSON_DEPTH_MAX];
+	uint32_t depth = 0;
+	uint64_t *tape = t->tape;
+	char *d = t->strs;
+	size_t w = 1U;
+	enum jtape_st8 st = jtape_st8_value;
+
+	for (size_t k = 0; k < t->count; ++k) {
+		size_t i = t->index[k];
+		uint8_t c = s[i];
+		int e = 0;
+
+		if ((st == jtape_st8_first && c == ']') ||
+		    (st == jtape_st8_open && c == '}') ||
+		    (st == jtape_st8_next && c == (jtape_type(t, open[depth - 1U])
+		                                   == jtape_object ? '}' : ']'))) {
+			size_t o = open[--depth];
+			tape[o] |= w + 1U;
+			tape[w++] = (uint64_t)c << 56U | o;
+			st = depth ? jtape_st8_next : jtape_st8_done;
+			continue;
+		}
+
+		switch (st) {
+		case jtape_st8_open:
+		case jtape_st8_member:
+			if (c != '"') {
+				e = EBADMSG;
+				break;
+			}
+			tape[w++] = (uint64_t)jtape_string << 56U
+			          | (uint64_t)(d - t->strs);
+			e = jtape_unescape(s, len, &i, &d);
+			st = jtape_st8_colon;
+			break;
+
+		case jtape_st8_colon:
+			if (c != ':')
+				e = EBADMSG;
+			st = jtape_st8_value;
+			break;
+
+		case jtape_st8_next:
+			if (c != ',') {
+				e = EBADMSG;
+				break;
+			}
+			st = jtape_type(t, open[depth - 1U]) == jtape_object
+			     ? jtape_st8_member : jtape_st8_value;
+			break;
+
+		case jtape_st8_done:
+			e = EBADMSG;
+			break;
+
+		case jtape_st8_first:
+		case jtape_st8_value:
+			st = jtape_st8_done;
+
+			switch (c) {
+			case '{':
+			case '[':
+				if (depth == JSON_DEPTH_MAX) {
+					e = EOVERFLOW;
+					break;
+				}
+				open[depth++] = (uint32_t)w;
+				tape[w++] = (uint64_t)c << 56U;
+				st = c == '{' ? jtape_st8_open : jtape_st8_first;
+				continue;
+
+			case '"':
+				tape[w++] = (uint64_t)jtape_string << 56U
+				          | (uint64_t)(d - t->strs);
+				e = jtape_unescape(s, len, &i, &d);
+				break;
+
+			case 't':
+			case 'f':
+			case 'n': {
+				char const *l = c == 't' ? "true"
+				              : c == 'f' ? "false" : "null";
+				size_t n = c == 'f' ? 5U : 4U;
+				if (len - i < n || __builtin_memcmp(&s[i], l, n) ||
+				    (len - i > n && !jtape_delim(s[i + n]))) {
+					e = EBADMSG;
+					break;
+				}
+				tape[w++] = (uint64_t)c << 56U;
+				break;
+			}
+
+			default:
+				e = jtape_number(s, len, &i, &tape[w]);
+				w += 2U;
+			}
+
+			if (depth)
+				st = jtape_st8_next;
+			break;
+		}
+
+		if (e) {
+			t->error = i;
+			return e;
+		}
+	}
+
+	if (st != jtape_st8_done) {
+		t->error = len;
+		return EBADMSG;
+	}
+
+	tape[0] = (uint64_t)jtape_root << 56U | w;
+	tape[w++] = (uint64_t)jtape_root << 56U;
+	t->len = w;
+	return 0;
+}
+
+int
+jtape_parse (struct jtape *t,
+             void const   *src,
+             size_t        len)
+{
+	t->len = 0;
+	t->count = 0;
+	t->error = 0;
+
+	if (len >= UINT32_MAX)
+		return EOVERFLOW;
+
+	int e = jtape_reserve((void **)&t->index, &t->index_cap,
+	                      len + 1U, sizeof *t->index);
+	if (!e)
+		e = jtape_index(t, src, len);
+	if (e)
+		return e;
+
+	/* Every structural character yields at most two tape entries and
+	 * every string takes at most its input length plus a 32-bit length
+	 * and a terminator, so stage two never needs to check for space.
+	 */
+	e = jtape_reserve((void **)&t->tape, &t->tape_cap,
+	                  2U * t->count + 2U, sizeof *t->tape);
+	if (!e)
+		e = jtape_reserve((void **)&t->strs, &t->strs_cap,
+		                  len + 5U * t->count + 1U, 1U);
+	if (e)
+		return e;
+
+	return jtape_build(t, src, len);
+}
+
+void
+jtape_fini (struct jtape *t)
+{
+	if (t) {
+		free(t->index);
+		free(t->strs);
+		free(t->tape);
+		*t = (struct jtape){0};
+	}
+}
@@ -0,0 +1,154 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file jtape.h
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_JTAPE_H_
+#define LIBCANTH_SRC_JTAPE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dstr.h"
+#include "util.h"
+
+/**
+ * @brief Tape entry types, stored in the top byte of each entry.
+ */
+fixed_enum(jtape_type, uint8_t) {
+	jtape_root       = 'r', //!< First and last entry. The first one
+	                        //!< holds the index of the last one.
+	jtape_object     = '{', //!< Holds the index after its `}` entry.
+	jtape_object_end = '}', //!< Holds the index of its `{` entry.
+	jtape_array      = '[', //!< Holds the index after its `]` entry.
+	jtape_array_end  = ']', //!< Holds the index of its `[` entry.
+	jtape_string     = '"', //!< Holds an offset into @ref jtape::strs.
+	jtape_int        = 'l', //!< Next entry is an `int64_t`.
+	jtape_double     = 'd', //!< Next entry is a `double`.
+	jtape_null       = 'n', //!< `null`
+	jtape_true       = 't', //!< `true`
+	jtape_false      = 'f', //!< `false`
+};
+
+/**
+ * @brief Parsed JSON document.
+ *
+ * The document is flattened into a tape of 64-bit entries in document
+ * order. Containers link to their ends, so any value can be skipped in
+ * constant time. Object members are a string entry for the name right
+ * before the entry of the value.
+ *
+ * Zero-initialize before first use. Buffers are reused across parses.
+ */
+struct jtape {
+	uint64_t *tape;      //!< Tape entries.
+	size_t    len;       //!< Tape entries in use.
+	char     *strs;      //!< Unescaped strings, each a 32-bit length
+	                     //!< followed by the bytes and a terminator.
+	uint32_t *index;     //!< Structural character offsets.
+	size_t    count;     //!< Structural character count.
+	size_t    error;     //!< Input offset of the first error.
+	size_t    tape_cap;  //!< Allocated entries of @ref jtape::tape.
+	size_t    strs_cap;  //!< Allocated size of @ref jtape::strs.
+	size_t    index_cap; //!< Allocated entries of @ref jtape::index.
+};
+
+/**
+ * @brief Parse a complete JSON document.
+ *
+ * Stage one classifies the input 64 bytes at a time with SIMD compares
+ * where available, resolves escapes and string boundaries with carry-
+ * propagating bit operations, records the offset of every structural
+ * character and scalar, and validates UTF-8 on the same blocks while
+ * they're in registers. Stage two walks the structural offsets and
+ * writes the tape, decoding strings with @ref json_unescape() without
+ * validating them a second time.
+ *
+ * @param[in,out] t   Tape to fill.
+ * @param[in]     src Document.
+ * @param[in]     len Length of @p src, less than 4 GiB.
+ * @return 0 on success, otherwise an error code. Invalid UTF-8 is
+ *         `EILSEQ`, any other malformed input is `EBADMSG`, and
+ *         nesting deeper than @ref JSON_DEPTH_MAX is `EOVERFLOW`. The
+ *         input offset of the problem is stored in @ref jtape::error.
+ */
+extern int
+jtape_parse (struct jtape *t,
+             void const   *src,
+             size_t        len) nonnull_in(1);
+
+/**
+ * @brief Release the buffers of a tape.
+ */
+extern void
+jtape_fini (struct jtape *t);
+
+nonnull_in()
+static force_inline enum jtape_type
+jtape_type (struct jtape const *t,
+            size_t              i)
+{
+	return (enum jtape_type)(t->tape[i] >> 56U);
+}
+
+nonnull_in()
+static force_inline size_t
+jtape_payload (struct jtape const *t,
+               size_t              i)
+{
+	return (size_t)(t->tape[i] & UINT64_C(0x00ffffffffffffff));
+}
+
+/**
+ * @brief Get the index of the entry after the value at index @p i.
+ */
+nonnull_in()
+static force_inline size_t
+jtape_skip (struct jtape const *t,
+            size_t              i)
+{
+	switch (jtape_type(t, i)) {
+	case jtape_object:
+	case jtape_array:
+		return jtape_payload(t, i);
+	case jtape_int:
+	case jtape_double:
+		return i + 2U;
+	default:
+		return i + 1U;
+	}
+}
+
+/**
+ * @brief Get a string entry as a @ref dstr view.
+ */
+nonnull_in()
+static force_inline dstr
+jtape_str (struct jtape const *t,
+           size_t              i)
+{
+	char const *p = &t->strs[jtape_payload(t, i)];
+	uint32_t n;
+	__builtin_memcpy(&n, p, sizeof n);
+	return make_dstr_view_from_decay(p + sizeof n, n);
+}
+
+nonnull_in()
+static force_inline int64_t
+jtape_i64 (struct jtape const *t,
+           size_t              i)
+{
+	return (int64_t)t->tape[i + 1U];
+}
+
+nonnull_in()
+static force_inline double
+jtape_f64 (struct jtape const *t,
+           size_t              i)
+{
+	double d;
+	__builtin_memcpy(&d, &t->tape[i + 1U], sizeof d);
+	return d;
+}
+
+#endif /* LIBCANTH_SRC_JTAPE_H_ */
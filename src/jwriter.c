@@ -0,0 +1,616 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file jwriter.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "jwriter.h"
+#include "num.h"
+
+/**
+ * @brief Input bytes escaped per output space reservation.
+ */
+#define JWRITER_STEP 1024U
+
+/**
+ * @brief Initial buffer size of a string writer without a hint.
+ */
+#define JWRITER_MIN 256U
+
+/**
+ * @brief Buffer size of a file writer. Large enough that flushed
+ *        pieces usually bypass the @ref file_out staging buffer.
+ */
+#define JWRITER_FILE_CAP (FILE_OUT_BUF_SIZE * 2U)
+
+/**
+ * @brief Two-character escapes of control characters, 0 where there
+ *        is none and a `\u` escape is needed.
+ */
+constexpr static char const jwriter_esc[0x20] = {
+	['\b'] = 'b', ['\t'] = 't', ['\n'] = 'n', ['\f'] = 'f', ['\r'] = 'r',
+};
+
+nonnull_in()
+static force_inline int
+jwriter_fail (struct jwriter *w,
+              int             e)
+{
+	if (!w->ec)
+		w->ec = e;
+	return w->ec;
+}
+
+nonnull_in()
+static int
+jwriter_flush (struct jwriter *w)
+{
+	if (!w->len)
+		return 0;
+
+	int e = file_out_write(w->out, w->buf, w->len);
+	if (e)
+		return jwriter_fail(w, e);
+
+	w->flushed += w->len;
+	w->len = 0;
+	return 0;
+}
+
+/**
+ * @brief Make room for @p n more bytes, flushing or growing the buffer.
+ */
+nonnull_in()
+static char *
+jwriter_grow (struct jwriter *w,
+              size_t          n)
+{
+	if (w->ec)
+		return nullptr;
+
+	if (w->out && jwriter_flush(w))
+		return nullptr;
+
+	if (w->cap - w->len >= n)
+		return &w->buf[w->len];
+
+	if (n > SIZE_MAX / 2U - w->len) {
+		(void)jwriter_fail(w, ENOMEM);
+		return nullptr;
+	}
+
+	size_t cap = w->cap ? w->cap * 2U : JWRITER_MIN;
+	if (cap < w->len + n)
+		cap = w->len + n;
+
+	char *p = realloc(w->buf, cap);
+	if (!p) {
+		(void)jwriter_fail(w, errno);
+		return nullptr;
+	}
+
+	w->buf = p;
+	w->cap = cap;
+	return &p[w->len];
+}
+
+nonnull_in()
+static force_inline char *
+jwriter_room (struct jwriter *w,
+              size_t          n)
+{
+	return w->cap - w->len >= n ? &w->buf[w->len] : jwriter_grow(w, n);
+}
+
+nonnull_in(1)
+static void
+jwriter_put (struct jwriter *w,
+             char const     *s,
+             size_t          n)
+{
+	if (w->sizing) {
+		w->len += n;
+		return;
+	}
+
+	if (w->out && n >= FILE_OUT_BUF_SIZE) {
+		if (!jwriter_flush(w)) {
+			int e = file_out_write(w->out, s, n);
+			if (e)
+				(void)jwriter_fail(w, e);
+			else
+				w->flushed += n;
+		}
+		return;
+	}
+
+	char *d = jwriter_room(w, n);
+	if (d) {
+		__builtin_memcpy(d, s, n);
+		w->len += n;
+	}
+}
+
+nonnull_in()
+static force_inline void
+jwriter_putc (struct jwriter *w,
+              char            c)
+{
+	if (w->sizing) {
+		++w->len;
+		return;
+	}
+
+	char *d = jwriter_room(w, 1U);
+	if (d) {
+		*d = c;
+		++w->len;
+	}
+}
+
+/**
+ * @brief Escape string content.
+ *
+ * Plain runs are copied a block at a time by @ref json_copy_string(),
+ * which leaves only the bytes that need escaping to the loop here.
+ *
+ * @param d Output buffer of at least @p n bytes plus what
+ *          @ref jwriter_escape_extra() counts for @p s.
+ * @param s String content.
+ * @param n Length of @p s.
+ * @param t UTF-8 validator state, or `nullptr` to copy bytes above
+ *          0x7f through unchecked.
+ * @return Bytes written, or `SIZE_MAX` if @p t found invalid UTF-8.
+ */
+nonnull_in(1)
+static size_t
+jwriter_escape (char             *d,
+                char const       *s,
+                size_t            n,
+                struct utf8_text *t)
+{
+	constexpr static char const hex[] = "0123456789abcdef";
+	uint8_t const *u = (uint8_t const *)s;
+	uint8_t *o = (uint8_t *)d;
+	size_t w = 0;
+
+	for (size_t i = 0;;) {
+		size_t a = i;
+		bool high = false;
+		i = json_copy_string(&o[w], u, i, n, &high);
+		w += i - a;
+
+		if (t && (high || !utf8_text_at_boundary(t)) &&
+		    !utf8_text_check(t, &u[a], i - a))
+			return SIZE_MAX;
+
+		if (i == n)
+			break;
+
+		/* Escaped bytes can't be part of a multi-byte sequence. */
+		if (t && !utf8_text_at_boundary(t))
+			return SIZE_MAX;
+
+		uint8_t c = u[i++];
+		o[w++] = '\\';
+		if (c >= 0x20U) {
+			o[w++] = c;
+		} else if (jwriter_esc[c]) {
+			o[w++] = (uint8_t)jwriter_esc[c];
+		} else {
+			__builtin_memcpy(&o[w], "u00", 3U);
+			o[w + 3U] = (uint8_t)hex[c >> 4U];
+			o[w + 4U] = (uint8_t)hex[c & 15U];
+			w += 5U;
+		}
+	}
+
+	return w;
+}
+
+/**
+ * @brief Count the bytes @ref jwriter_escape() would add to a string.
+ */
+nonnull_in(1)
+static size_t
+jwriter_escape_extra (char const *s,
+                      size_t      n)
+{
+	unsigned char const *u = (unsigned char const *)s;
+	size_t extra = 0;
+
+	for (size_t i = 0;; ++i) {
+		i = json_scan_string(u, i, n);
+		if (i == n)
+			break;
+		extra += u[i] >= 0x20U || jwriter_esc[u[i]] ? 1U : 5U;
+	}
+
+	return extra;
+}
+
+/**
+ * @brief Write a quoted string.
+ *
+ * @param w     Writer.
+ * @param s     String content.
+ * @param n     Length of @p s.
+ * @param clean @p s is known to need no escaping or validation.
+ */
+nonnull_in(1)
+static void
+jwriter_quoted (struct jwriter *w,
+                char const     *s,
+                size_t          n,
+                bool            clean)
+{
+	if (w->sizing) {
+		w->len += 2U + n + (clean ? 0 : jwriter_escape_extra(s, n));
+		return;
+	}
+
+	jwriter_putc(w, '"');
+
+	if (clean) {
+		jwriter_put(w, s, n);
+	} else {
+		struct utf8_text u = utf8_text(false);
+		struct utf8_text *t = w->utf8 ? &u : nullptr;
+
+		for (size_t i = 0, k; i < n; i += k) {
+			k = n - i < JWRITER_STEP ? n - i : JWRITER_STEP;
+			size_t x = jwriter_escape_extra(&s[i], k);
+			char *d = jwriter_room(w, k + x);
+			if (!d)
+				return;
+			size_t r = jwriter_escape(d, &s[i], k, t);
+			if (r == SIZE_MAX) {
+				(void)jwriter_fail(w, EILSEQ);
+				return;
+			}
+			w->len += r;
+		}
+
+		if (t && !utf8_text_at_boundary(t)) {
+			(void)jwriter_fail(w, EILSEQ);
+			return;
+		}
+	}
+
+	jwriter_putc(w, '"');
+}
+
+nonnull_in()
+static force_inline bool
+jwriter_in_object (struct jwriter const *w)
+{
+	uint32_t d = w->depth - 1U;
+	return w->depth && (w->stack[d >> 3U] >> (d & 7U)) & 1U;
+}
+
+/**
+ * @brief Check that a key or value is allowed here, and write the
+ *        separator preceding it.
+ */
+nonnull_in()
+static bool
+jwriter_next (struct jwriter *w,
+              bool            key)
+{
+	if (w->ec)
+		return false;
+
+	if (key ? !jwriter_in_object(w) || w->key
+	        : jwriter_in_object(w) && !w->key) {
+		(void)jwriter_fail(w, EINVAL);
+		return false;
+	}
+
+	if (w->comma)
+		jwriter_putc(w, w->depth ? ',' : '\n');
+
+	w->comma = false;
+	w->key = key;
+	return true;
+}
+
+nonnull_in()
+static int
+jwriter_begin (struct jwriter *w,
+               bool            obj)
+{
+	if (!jwriter_next(w, false))
+		return w->ec;
+
+	uint32_t d = w->depth;
+	if (d >= JSON_DEPTH_MAX)
+		return jwriter_fail(w, EOVERFLOW);
+
+	uint8_t m = (uint8_t)(1U << (d & 7U));
+	w->stack[d >> 3U] = obj ? w->stack[d >> 3U] | m
+	                        : w->stack[d >> 3U] & (uint8_t)~m;
+	w->depth = d + 1U;
+	jwriter_putc(w, obj ? '{' : '[');
+	return w->ec;
+}
+
+nonnull_in()
+static int
+jwriter_close (struct jwriter *w,
+               bool            obj)
+{
+	if (w->ec)
+		return w->ec;
+
+	if (!w->depth || jwriter_in_object(w) != obj || w->key)
+		return jwriter_fail(w, EINVAL);
+
+	--w->depth;
+	w->comma = true;
+	jwriter_putc(w, obj ? '}' : ']');
+	return w->ec;
+}
+
+void
+jwriter_size (struct jwriter *w)
+{
+	*w = (struct jwriter){.sizing = true};
+}
+
+void
+jwriter_init (struct jwriter *w,
+              dstr           *dst,
+              size_t          hint)
+{
+	*w = (struct jwriter){.dst = dst};
+
+	if (dstr_owns_memory(dst)) {
+		w->buf = dst->ptr;
+		w->cap = dst->size;
+		dstr_init(dst);
+	} else {
+		dstr_fini(dst);
+	}
+
+	if (hint && hint + 1U > w->cap) {
+		char *p = realloc(w->buf, hint + 1U);
+		if (p) {
+			w->buf = p;
+			w->cap = hint + 1U;
+		}
+	}
+}
+
+void
+jwriter_init_file (struct jwriter  *w,
+                   struct file_out *out,
+                   size_t           hint)
+{
+	*w = (struct jwriter){.out = out};
+
+	if (hint) {
+		int e = file_out_reserve(out, hint);
+		if (e)
+			(void)jwriter_fail(w, e);
+	}
+
+	w->buf = malloc(JWRITER_FILE_CAP);
+	if (w->buf)
+		w->cap = JWRITER_FILE_CAP;
+}
+
+void
+jwriter_check_utf8 (struct jwriter *w,
+                    bool            on)
+{
+	w->utf8 = on;
+}
+
+int
+jwriter_end (struct jwriter *w)
+{
+	if (w->depth || w->key)
+		(void)jwriter_fail(w, EINVAL);
+
+	if (w->out) {
+		if (!w->ec)
+			(void)jwriter_flush(w);
+	} else if (w->dst && !w->ec && w->len) {
+		if (w->len > UINT_MAX - 1U) {
+			(void)jwriter_fail(w, EOVERFLOW);
+		} else if (w->len < sizeof w->dst->arr) {
+			*w->dst = make_dstr_from_small_string(w->buf, w->len);
+		} else if (jwriter_room(w, 1U)) {
+			w->buf[w->len] = '\0';
+			w->dst->ptr = w->buf;
+			w->dst->size = w->cap < UINT_MAX ? (unsigned)w->cap
+			                                 : UINT_MAX;
+			w->dst->len = (unsigned)w->len;
+			w->buf = nullptr;
+		}
+	}
+
+	free(w->buf);
+	w->buf = nullptr;
+	w->cap = 0;
+	w->dst = nullptr;
+	w->out = nullptr;
+	return w->ec;
+}
+
+int
+jwriter_object_begin (struct jwriter *w)
+{
+	return jwriter_begin(w, true);
+}
+
+int
+jwriter_object_end (struct jwriter *w)
+{
+	return jwriter_close(w, true);
+}
+
+int
+jwriter_array_begin (struct jwriter *w)
+{
+	return jwriter_begin(w, false);
+}
+
+int
+jwriter_array_end (struct jwriter *w)
+{
+	return jwriter_close(w, false);
+}
+
+int
+jwriter_key (struct jwriter *w,
+             char const     *s,
+             size_t          len)
+{
+	if (jwriter_next(w, true)) {
+		jwriter_quoted(w, s, len, false);
+		jwriter_putc(w, ':');
+	}
+	return w->ec;
+}
+
+int
+jwriter_string (struct jwriter *w,
+                char const     *s,
+                size_t          len)
+{
+	if (jwriter_next(w, false)) {
+		jwriter_quoted(w, s, len, false);
+		w->comma = true;
+	}
+	return w->ec;
+}
+
+int
+jwriter_string_clean (struct jwriter *w,
+                      char const     *s,
+                      size_t          len)
+{
+	if (jwriter_next(w, false)) {
+		jwriter_quoted(w, s, len, true);
+		w->comma = true;
+	}
+	return w->ec;
+}
+
+int
+jwriter_int (struct jwriter *w,
+             int64_t         v)
+{
+	if (jwriter_next(w, false)) {
+		char buf[NUM_I64_SIZE];
+		jwriter_put(w, buf, num_format_i64(buf, v));
+		w->comma = true;
+	}
+	return w->ec;
+}
+
+int
+jwriter_double (struct jwriter *w,
+                double          v)
+{
+	if (!isfinite(v))
+		return jwriter_fail(w, EDOM);
+
+	if (jwriter_next(w, false)) {
+		char buf[NUM_DOUBLE_SIZE];
+		jwriter_put(w, buf, num_format_double(buf, v));
+		w->comma = true;
+	}
+	return w->ec;
+}
+
+int
+jwriter_bool (struct jwriter *w,
+              bool            v)
+{
+	if (jwriter_next(w, false)) {
+		jwriter_put(w, v ? "true" : "false", v ? 4U : 5U);
+		w->comma = true;
+	}
+	return w->ec;
+}
+
+int
+jwriter_null (struct jwriter *w)
+{
+	if (jwriter_next(w, false)) {
+		jwriter_put(w, "null", 4U);
+		w->comma = true;
+	}
+	return w->ec;
+}
+
+int
+jwriter_raw (struct jwriter *w,
+             char const     *s,
+             size_t          len)
+{
+	if (!len)
+		return jwriter_fail(w, EINVAL);
+
+	if (jwriter_next(w, false)) {
+		jwriter_put(w, s, len);
+		w->comma = true;
+	}
+	return w->ec;
+}
+
+int
+jwriter_tape (struct jwriter     *w,
+              struct jtape const *t,
+              size_t              i)
+{
+	for (size_t end = jtape_skip(t, i); !w->ec && i < end;) {
+		dstr s;
+		switch (jtape_type(t, i)) {
+		case jtape_object:
+			(void)jwriter_object_begin(w);
+			break;
+		case jtape_object_end:
+			(void)jwriter_object_end(w);
+			break;
+		case jtape_array:
+			(void)jwriter_array_begin(w);
+			break;
+		case jtape_array_end:
+			(void)jwriter_array_end(w);
+			break;
+		case jtape_string:
+			s = jtape_str(t, i);
+			if (jwriter_in_object(w) && !w->key)
+				(void)jwriter_key(w, dstr_get(&s), s.len);
+			else
+				(void)jwriter_string(w, dstr_get(&s), s.len);
+			break;
+		case jtape_int:
+			(void)jwriter_int(w, jtape_i64(t, i));
+			break;
+		case jtape_double:
+			(void)jwriter_double(w, jtape_f64(t, i));
+			break;
+		case jtape_null:
+			(void)jwriter_null(w);
+			break;
+		case jtape_true:
+		case jtape_false:
+			(void)jwriter_bool(w, jtape_type(t, i) == jtape_true);
+			break;
+		default:
+			return jwriter_fail(w, EINVAL);
+		}
+		i = jtape_type(t, i) == jtape_object ||
+		    jtape_type(t, i) == jtape_array ? i + 1U : jtape_skip(t, i);
+	}
+	return w->ec;
+}
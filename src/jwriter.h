@@ -0,0 +1,237 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file jwriter.h
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_JWRITER_H_
+#define LIBCANTH_SRC_JWRITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dstr.h"
+#include "file.h"
+#include "json.h"
+#include "jtape.h"
+#include "util.h"
+
+/**
+ * @brief Streaming JSON writer.
+ *
+ * Values are serialized straight into an output buffer as they're
+ * written, without building a tree first. The buffer either becomes
+ * the contents of a @ref dstr, or is handed over to a @ref file_out in
+ * large pieces.
+ *
+ * A writer can also run without any output and only count bytes. To
+ * build a string with exactly one allocation, run the same sequence of
+ * calls twice: first on a writer from @ref jwriter_size(), then on one
+ * from @ref jwriter_init() with the counted length as the hint.
+ *
+ * Object keys and values must alternate, and containers must be closed
+ * in order. Misuse is reported as `EINVAL`. Every function returns the
+ * sticky error code of the writer, so checking the result of
+ * @ref jwriter_end() alone is enough. Consecutive top-level values are
+ * separated by newlines, which makes the output JSON Lines.
+ *
+ * String input must be valid UTF-8, which is copied through as is
+ * unless @ref jwriter_check_utf8() is used to have it validated too.
+ */
+struct jwriter {
+	char            *buf;     //!< Output buffer.
+	size_t           len;     //!< Bytes in @ref jwriter::buf, or all
+	                          //!< bytes counted by a sizing writer.
+	size_t           cap;     //!< Allocated size of @ref jwriter::buf.
+	size_t           flushed; //!< Bytes passed on to @ref jwriter::out.
+	dstr            *dst;     //!< Destination string, or `nullptr`.
+	struct file_out *out;     //!< Destination file, or `nullptr`.
+	int              ec;      //!< Sticky error code.
+	uint32_t         depth;   //!< Current nesting depth.
+	bool             sizing;  //!< Count bytes instead of writing them.
+	bool             comma;   //!< Next value needs a separator.
+	bool             key;     //!< Key written, value expected.
+	bool             utf8;    //!< Validate string input as UTF-8.
+	uint8_t          stack[JSON_DEPTH_MAX / 8U]; //!< Object bit per level.
+};
+
+/**
+ * @brief Initialize a writer that only counts bytes.
+ *
+ * @param[out] w Writer to initialize.
+ */
+extern void
+jwriter_size (struct jwriter *w) nonnull_in();
+
+/**
+ * @brief Initialize a writer that replaces the contents of a string.
+ *
+ * The heap buffer of @p dst, if it has one, is taken over and reused.
+ * The result is moved into @p dst by @ref jwriter_end().
+ *
+ * @param[out]    w    Writer to initialize.
+ * @param[in,out] dst  Destination string. Left empty on failure.
+ * @param[in]     hint Expected output length, for instance from a
+ *                     sizing writer, or 0 if unknown.
+ */
+extern void
+jwriter_init (struct jwriter *w,
+              dstr           *dst,
+              size_t          hint) nonnull_in();
+
+/**
+ * @brief Initialize a writer that appends to an output file.
+ *
+ * @param[out]    w    Writer to initialize.
+ * @param[in,out] out  Destination file.
+ * @param[in]     hint Expected output length, which is preallocated
+ *                     with @ref file_out_reserve(), or 0 if unknown.
+ */
+extern void
+jwriter_init_file (struct jwriter  *w,
+                   struct file_out *out,
+                   size_t           hint) nonnull_in();
+
+/**
+ * @brief Turn UTF-8 validation of strings and keys on or off.
+ *
+ * Validation happens in the same pass as escaping, and only touches
+ * blocks with bytes above 0x7f. Invalid input is `EILSEQ`. A sizing
+ * writer doesn't validate, so the error surfaces on the writing pass.
+ *
+ * @param[in,out] w  Writer.
+ * @param[in]     on Whether to validate.
+ */
+extern void
+jwriter_check_utf8 (struct jwriter *w,
+                    bool            on) nonnull_in();
+
+/**
+ * @brief Finish writing and release the writer.
+ *
+ * Moves the output into the destination string, or passes the rest of
+ * it on to the destination file. The length stays available through
+ * @ref jwriter_length().
+ *
+ * @param[in,out] w Writer.
+ * @return 0 on success, otherwise an error code. Unclosed containers
+ *         and keys without values are `EINVAL`.
+ */
+extern int
+jwriter_end (struct jwriter *w) nonnull_in();
+
+/** @brief Open an object. */
+extern int
+jwriter_object_begin (struct jwriter *w) nonnull_in();
+
+/** @brief Close the innermost object. */
+extern int
+jwriter_object_end (struct jwriter *w) nonnull_in();
+
+/** @brief Open an array. */
+extern int
+jwriter_array_begin (struct jwriter *w) nonnull_in();
+
+/** @brief Close the innermost array. */
+extern int
+jwriter_array_end (struct jwriter *w) nonnull_in();
+
+/**
+ * @brief Write an object member name.
+ *
+ * @param[in,out] w   Writer.
+ * @param[in]     s   Name, escaped as needed.
+ * @param[in]     len Length of @p s.
+ */
+extern int
+jwriter_key (struct jwriter *w,
+             char const     *s,
+             size_t          len) nonnull_in(1);
+
+/**
+ * @brief Write a string value.
+ *
+ * @param[in,out] w   Writer.
+ * @param[in]     s   String, escaped as needed.
+ * @param[in]     len Length of @p s.
+ */
+extern int
+jwriter_string (struct jwriter *w,
+                char const     *s,
+                size_t          len) nonnull_in(1);
+
+/**
+ * @brief Write a string value that needs no escaping.
+ *
+ * For text known to be printable ASCII without quotes or backslashes,
+ * such as identifiers and enumeration names, which is copied without
+ * being looked at.
+ *
+ * @param[in,out] w   Writer.
+ * @param[in]     s   String. Not checked.
+ * @param[in]     len Length of @p s.
+ */
+extern int
+jwriter_string_clean (struct jwriter *w,
+                      char const     *s,
+                      size_t          len) nonnull_in(1);
+
+/** @brief Write an integer value. */
+extern int
+jwriter_int (struct jwriter *w,
+             int64_t         v) nonnull_in();
+
+/**
+ * @brief Write a floating point value.
+ *
+ * The value is written with the fewest digits that parse back to it.
+ *
+ * @return `EDOM` for infinities and NaNs, which JSON can't represent.
+ */
+extern int
+jwriter_double (struct jwriter *w,
+                double          v) nonnull_in();
+
+/** @brief Write `true` or `false`. */
+extern int
+jwriter_bool (struct jwriter *w,
+              bool            v) nonnull_in();
+
+/** @brief Write `null`. */
+extern int
+jwriter_null (struct jwriter *w) nonnull_in();
+
+/**
+ * @brief Write a serialized JSON value verbatim.
+ *
+ * @param[in,out] w   Writer.
+ * @param[in]     s   Complete JSON value. Not checked.
+ * @param[in]     len Length of @p s.
+ */
+extern int
+jwriter_raw (struct jwriter *w,
+             char const     *s,
+             size_t          len) nonnull_in(1);
+
+/**
+ * @brief Write a value from a parsed document.
+ *
+ * @param[in,out] w Writer.
+ * @param[in]     t Parsed document.
+ * @param[in]     i Tape index of the value, 1 for the whole document.
+ */
+extern int
+jwriter_tape (struct jwriter     *w,
+              struct jtape const *t,
+              size_t              i) nonnull_in();
+
+/**
+ * @brief Get the number of bytes written or counted so far.
+ */
+nonnull_in()
+static force_inline size_t
+jwriter_length (struct jwriter const *w)
+{
+	return w->flushed + w->len;
+}
+
+#endif /* LIBCANTH_SRC_JWRITER_H_ */
@@ -9,6 +9,8 @@
 #include "letopt.h"
 #undef INCLUDED_FROM_LETOPT_C_
 
+#include "num.h"
+
 extern_letopt_state_init();
 extern_letopt_get_number_arg();
 extern_letopt_get_string_arg();
@@ -46,19 +48,29 @@ letopt_get_number_arg (struct letopt_state *const state,
 		return false;
 	}
 
-	errno = 0;
-
-	char *end = state->p;
-	int64_t n = _Generic(n
-		, long: strtol
-		, long long: strtoll
-	)(state->p, &end, 0);
+	char const *s = state->p;
+	size_t k = *s == '-' || *s == '+';
+	int64_t n;
+	int e;
+
+	/* Plain decimal is by far the most common, and needs neither
+	 * errno nor locale. Base prefixes and octal go to strtol(). */
+	if ((s[k] > '0' && s[k] <= '9') || (s[k] == '0' && !s[k + 1U])) {
+		e = num_parse_i64(s, strlen(s), &n);
+	} else {
+		errno = 0;
+		char *end = state->p;
+		n = _Generic(n
+			, long: strtol
+			, long long: strtoll
+		)(state->p, &end, 0);
+		e = errno;
+		if (!e && *end)
+			e = EINVAL;
+	}
 
-	int e = errno;
 	if (!e) {
-		if (*end) {
-			e = EINVAL;
-		} else if (n < min || n > max) {
+		if (n < min || n > max) {
 			e = ERANGE;
 		} else {
 			*dest = n;
@@ -0,0 +1,119 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file message.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <stdlib.h>
+
+#include "json.h"
+#include "message.h"
+
+JDECODE_FUNC(message_usage, MESSAGE_USAGE_FIELDS)
+JDECODE_FUNC(message_block, MESSAGE_BLOCK_FIELDS)
+JDECODE_FUNC(message, MESSAGE_FIELDS)
+JDECODE_FUNC(message_delta, MESSAGE_DELTA_FIELDS)
+JDECODE_FUNC(message_event, MESSAGE_EVENT_FIELDS)
+
+/**
+ * @brief Try the exact layout of a text delta.
+ *
+ * @return `true` if @p src has the expected layout and was decoded.
+ */
+nonnull_in()
+static bool
+message_text_fast (struct message_text_parser *p,
+                   uint8_t const              *s,
+                   size_t                      len,
+                   struct message_text        *d)
+{
+	constexpr static char const head[] =
+		"{\"type\":\"content_block_delta\",\"index\":";
+	constexpr static char const body[] =
+		",\"delta\":{\"type\":\"text_delta\",\"text\":\"";
+	constexpr size_t h = sizeof head - 1U;
+	constexpr size_t b = sizeof body - 1U;
+
+	if (len < h + 1U + b + 3U || __builtin_memcmp(s, head, h))
+		return false;
+
+	size_t i = h;
+	uint64_t n = 0;
+	for (size_t e = i + 9U; i < e && (unsigned)(s[i] - '0') < 10U; ++i)
+		n = n * 10U + (unsigned)(s[i] - '0');
+
+	if (i == h || (s[h] == '0' && i > h + 1U) || len - i < b + 3U ||
+	    __builtin_memcmp(&s[i], body, b))
+		return false;
+
+	i += b;
+	if (p->cap < len - i) {
+		uint8_t *q = realloc(p->buf, len - i);
+		if (!q)
+			return false;
+		p->buf = q;
+		p->cap = len - i;
+	}
+
+	size_t end, out;
+	if (json_unescape(p->buf, &s[i], len - i, &end, &out, true))
+		return false;
+
+	i += end;
+	if (len - i != 3U || __builtin_memcmp(&s[i], "\"}}", 3U))
+		return false;
+
+	d->index = (int64_t)n;
+	d->type = make_dstr_view_from_literal("text_delta");
+	d->text = make_dstr_view_from_decay((char const *)p->buf, out);
+	return true;
+}
+
+int
+message_text_parse (struct message_text_parser *p,
+                    void const                 *src,
+                    size_t                      len,
+                    struct message_text        *d)
+{
+	*d = (struct message_text){0};
+
+	if (src && message_text_fast(p, src, len, d)) {
+		++p->hits;
+		return 0;
+	}
+
+	++p->misses;
+
+	int e = jtape_parse(&p->tape, src, len);
+	if (e)
+		return e;
+
+	struct message_event v;
+	e = message_event_decode(&v, &p->tape, 1U);
+	if (e)
+		return e;
+
+	if (!v.has.type || !dstr_eq(&v.m_type, "content_block_delta",
+	                            sizeof "content_block_delta" - 1U))
+		return ENOMSG;
+
+	if (!v.has.index || !v.has.delta || !v.m_delta.has.type)
+		return EPROTO;
+
+	d->index = v.m_index;
+	d->type = v.m_delta.m_type;
+	d->text = v.m_delta.has.text ? v.m_delta.m_text
+	                             : v.m_delta.m_partial_json;
+	return 0;
+}
+
+void
+message_text_parser_fini (struct message_text_parser *p)
+{
+	if (p) {
+		jtape_fini(&p->tape);
+		free(p->buf);
+		p->buf = nullptr;
+		p->cap = 0;
+	}
+}
@@ -0,0 +1,139 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file message.h
+ *
+ * @brief Messages API response types.
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_MESSAGE_H_
+#define LIBCANTH_SRC_MESSAGE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dstr.h"
+#include "jdecode.h"
+#include "jtape.h"
+#include "util.h"
+
+/**
+ * @brief Token counts of a request.
+ */
+#define MESSAGE_USAGE_FIELDS(X)                                               \
+	X(number, input_tokens,                "input_tokens")                \
+	X(number, output_tokens,               "output_tokens")               \
+	X(number, cache_creation_input_tokens, "cache_creation_input_tokens") \
+	X(number, cache_read_input_tokens,     "cache_read_input_tokens")
+
+/**
+ * @brief Content block of a message. Which fields are set depends on
+ *        the block type: `text` has text, `tool_use` has an ID, a tool
+ *        name and an input object.
+ */
+#define MESSAGE_BLOCK_FIELDS(X)                                           \
+	X(string, type,  "type")                                          \
+	X(string, text,  "text")                                          \
+	X(string, id,    "id")                                            \
+	X(string, name,  "name")                                          \
+	X(value,  input, "input")
+
+/**
+ * @brief Message object, as returned by the Messages API. Content
+ *        blocks are left in the tape for @ref message_block_decode().
+ */
+#define MESSAGE_FIELDS(X)                                                 \
+	X(string, id,            "id")                                    \
+	X(string, type,          "type")                                  \
+	X(string, role,          "role")                                  \
+	X(string, model,         "model")                                 \
+	X(value,  content,       "content")                               \
+	X(string, stop_reason,   "stop_reason")                           \
+	X(string, stop_sequence, "stop_sequence")                         \
+	X(object, usage,         "usage", message_usage)
+
+/**
+ * @brief Delta of a `content_block_delta` stream event.
+ */
+#define MESSAGE_DELTA_FIELDS(X)                                           \
+	X(string, type,         "type")                                   \
+	X(string, text,         "text")                                   \
+	X(string, partial_json, "partial_json")
+
+/**
+ * @brief Streaming event. Only the fields of `content_block_delta`
+ *        events are decoded.
+ */
+#define MESSAGE_EVENT_FIELDS(X)                                           \
+	X(string, type,  "type")                                          \
+	X(number, index, "index")                                         \
+	X(object, delta, "delta", message_delta)
+
+JDECODE_STRUCT(message_usage, MESSAGE_USAGE_FIELDS);
+JDECODE_STRUCT(message_block, MESSAGE_BLOCK_FIELDS);
+JDECODE_STRUCT(message, MESSAGE_FIELDS);
+JDECODE_STRUCT(message_delta, MESSAGE_DELTA_FIELDS);
+JDECODE_STRUCT(message_event, MESSAGE_EVENT_FIELDS);
+
+JDECODE_PROTO(message_usage);
+JDECODE_PROTO(message_block);
+JDECODE_PROTO(message);
+JDECODE_PROTO(message_delta);
+JDECODE_PROTO(message_event);
+
+/**
+ * @brief Content block delta, as extracted by @ref message_text_parse().
+ */
+struct message_text {
+	int64_t index; //!< Content block index.
+	dstr    type;  //!< Delta type, such as `text_delta`.
+	dstr    text;  //!< Unescaped text, or partial JSON of an
+	               //!< `input_json_delta`.
+};
+
+/**
+ * @brief Parser for the data of `content_block_delta` events.
+ *
+ * Nearly every event of a streamed response is a text delta with the
+ * same members in the same order, so the parser first assumes exactly
+ * that layout. The fixed parts are matched with a few wide compares,
+ * the index is read in place, and the text is unescaped straight into
+ * a scratch buffer. Any deviation, even in whitespace, falls back to
+ * @ref jtape_parse() and @ref message_event_decode(), which accept any
+ * layout.
+ *
+ * Zero-initialize before first use.
+ */
+struct message_text_parser {
+	struct jtape tape;   //!< Fallback parser state.
+	uint8_t     *buf;    //!< Unescaped text of the fast path.
+	size_t       cap;    //!< Allocated size of @ref buf.
+	uint64_t     hits;   //!< Events taken by the fast path.
+	uint64_t     misses; //!< Events that fell back.
+};
+
+/**
+ * @brief Extract the delta of a `content_block_delta` event.
+ *
+ * @param[in,out] p   Parser.
+ * @param[in]     src Event data.
+ * @param[in]     len Length of @p src.
+ * @param[out]    d   Delta. The strings are views of @p p and remain
+ *                    valid until the next call.
+ * @return 0 on success, otherwise an error code. An event of another
+ *         type is `ENOMSG`, one with fields of the wrong type or no
+ *         delta is `EPROTO`, and errors of @ref jtape_parse() are
+ *         passed on.
+ */
+extern int
+message_text_parse (struct message_text_parser *p,
+                    void const                 *src,
+                    size_t                      len,
+                    struct message_text        *d) nonnull_in(1,4);
+
+/**
+ * @brief Release the buffers of a parser.
+ */
+extern void
+message_text_parser_fini (struct message_text_parser *p);
+
+#endif /* LIBCANTH_SRC_MESSAGE_H_ */
@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file mono.h
+ *
+ * @brief Monotonic clock readings for timeouts, deadlines, and
+ *        latency measurements, and sleeping for a while.
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_MONO_H_
+#define LIBCANTH_SRC_MONO_H_
+
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "util.h"
+
+/**
+ * @brief Read the monotonic clock.
+ *
+ * @return Microseconds since an unspecified starting point.
+ */
+static force_inline uint64_t
+mono_us (void)
+{
+	struct timespec t;
+	(void)clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000U + (uint64_t)t.tv_nsec / 1000U;
+}
+
+/**
+ * @brief Read the monotonic clock with millisecond resolution.
+ *
+ * @return Milliseconds since the same starting point as @ref mono_us().
+ */
+static force_inline uint64_t
+mono_ms (void)
+{
+	return mono_us() / 1000U;
+}
+
+/**
+ * @brief Sleep for at least @p us microseconds, resuming after signals.
+ */
+static force_inline void
+mono_sleep_us (uint64_t us)
+{
+	struct timespec t = {
+		.tv_sec  = (time_t)(us / 1000000U),
+		.tv_nsec = (long)(us % 1000000U) * 1000L,
+	};
+	while (nanosleep(&t, &t) && errno == EINTR);
+}
+
+/**
+ * @brief Sleep for at least @p ms milliseconds, resuming after signals.
+ */
+static force_inline void
+mono_sleep_ms (uint64_t ms)
+{
+	mono_sleep_us(ms * 1000U);
+}
+
+#endif /* LIBCANTH_SRC_MONO_H_ */
@@ -0,0 +1,1849 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file num.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <stdlib.h>
+
+#include "num.h"
+
+/**
+ * @brief 128-bit approximations of 5^q for q from -342 to 308, shifted
+ *        so that the top bit is set, for the Eisel-Lemire algorithm.
+ *        Positive powers are truncated, negative ones rounded up.
+ */
+constexpr static uint64_t const num_pow5[651][2] = {
+	{0xeef453d6923bd65aU, 0x113faa2906a13b3fU},
+	{0x9558b4661b6565f8U, 0x4ac7ca59a424c507U},
+	{0xbaaee17fa23ebf76U, 0x5d79bcf00d2df649U},
+	{0xe95a99df8ace6f53U, 0xf4d82c2c107973dcU},
+	{0x91d8a02bb6c10594U, 0x79071b9b8a4be869U},
+	{0xb64ec836a47146f9U, 0x9748e2826cdee284U},
+	{0xe3e27a444d8d98b7U, 0xfd1b1b2308169b25U},
+	{0x8e6d8c6ab0787f72U, 0xfe30f0f5e50e20f7U},
+	{0xb208ef855c969f4fU, 0xbdbd2d335e51a935U},
+	{0xde8b2b66b3bc4723U, 0xad2c788035e61382U},
+	{0x8b16fb203055ac76U, 0x4c3bcb5021afcc31U},
+	{0xaddcb9e83c6b1793U, 0xdf4abe242a1bbf3dU},
+	{0xd953e8624b85dd78U, 0xd71d6dad34a2af0dU},
+	{0x87d4713d6f33aa6bU, 0x8672648c40e5ad68U},
+	{0xa9c98d8ccb009506U, 0x680efdaf511f18c2U},
+	{0xd43bf0effdc0ba48U, 0x0212bd1b2566def2U},
+	{0x84a57695fe98746dU, 0x014bb630f7604b57U},
+	{0xa5ced43b7e3e9188U, 0x419ea3bd35385e2dU},
+	{0xcf42894a5dce35eaU, 0x52064cac828675b9U},
+	{0x818995ce7aa0e1b2U, 0x7343efebd1940993U},
+	{0xa1ebfb4219491a1fU, 0x1014ebe6c5f90bf8U},
+	{0xca66fa129f9b60a6U, 0xd41a26e077774ef6U},
+	{0xfd00b897478238d0U, 0x8920b098955522b4U},
+	{0x9e20735e8cb16382U, 0x55b46e5f5d5535b0U},
+	{0xc5a890362fddbc62U, 0xeb2189f734aa831dU},
+	{0xf712b443bbd52b7bU, 0xa5e9ec7501d523e4U},
+	{0x9a6bb0aa55653b2dU, 0x47b233c92125366eU},
+	{0xc1069cd4eabe89f8U, 0x999ec0bb696e840aU},
+	{0xf148440a256e2c76U, 0xc00670ea43ca250dU},
+	{0x96cd2a865764dbcaU, 0x380406926a5e5728U},
+	{0xbc807527ed3e12bcU, 0xc605083704f5ecf2U},
+	{0xeba09271e88d976bU, 0xf7864a44c633682eU},
+	{0x93445b8731587ea3U, 0x7ab3ee6afbe0211dU},
+	{0xb8157268fdae9e4cU, 0x5960ea05bad82964U},
+	{0xe61acf033d1a45dfU, 0x6fb92487298e33bdU},
+	{0x8fd0c16206306babU, 0xa5d3b6d479f8e056U},
+	{0xb3c4f1ba87bc8696U, 0x8f48a4899877186cU},
+	{0xe0b62e2929aba83cU, 0x331acdabfe94de87U},
+	{0x8c71dcd9ba0b4925U, 0x9ff0c08b7f1d0b14U},
+	{0xaf8e5410288e1b6fU, 0x07ecf0ae5ee44dd9U},
+	{0xdb71e91432b1a24aU, 0xc9e82cd9f69d6150U},
+	{0x892731ac9faf056eU, 0xbe311c083a225cd2U},
+	{0xab70fe17c79ac6caU, 0x6dbd630a48aaf406U},
+	{0xd64d3d9db981787dU, 0x092cbbccdad5b108U},
+	{0x85f0468293f0eb4eU, 0x25bbf56008c58ea5U},
+	{0xa76c582338ed2621U, 0xaf2af2b80af6f24eU},
+	{0xd1476e2c07286faaU, 0x1af5af660db4aee1U},
+	{0x82cca4db847945caU, 0x50d98d9fc890ed4dU},
+	{0xa37fce126597973cU, 0xe50ff107bab528a0U},
+	{0xcc5fc196fefd7d0cU, 0x1e53ed49a96272c8U},
+	{0xff77b1fcbebcdc4fU, 0x25e8e89c13bb0f7aU},
+	{0x9faacf3df73609b1U, 0x77b191618c54e9acU},
+	{0xc795830d75038c1dU, 0xd59df5b9ef6a2417U},
+	{0xf97ae3d0d2446f25U, 0x4b0573286b44ad1dU},
+	{0x9becce62836ac577U, 0x4ee367f9430aec32U},
+	{0xc2e801fb244576d5U, 0x229c41f793cda73fU},
+	{0xf3a20279ed56d48aU, 0x6b43527578c1110fU},
+	{0x9845418c345644d6U, 0x830a13896b78aaa9U},
+	{0xbe5691ef416bd60cU, 0x23cc986bc656d553U},
+	{0xedec366b11c6cb8fU, 0x2cbfbe86b7ec8aa8U},
+	{0x94b3a202eb1c3f39U, 0x7bf7d71432f3d6a9U},
+	{0xb9e08a83a5e34f07U, 0xdaf5ccd93fb0cc53U},
+	{0xe858ad248f5c22c9U, 0xd1b3400f8f9cff68U},
+	{0x91376c36d99995beU, 0x23100809b9c21fa1U},
+	{0xb58547448ffffb2dU, 0xabd40a0c2832a78aU},
+	{0xe2e69915b3fff9f9U, 0x16c90c8f323f516cU},
+	{0x8dd01fad907ffc3bU, 0xae3da7d97f6792e3U},
+	{0xb1442798f49ffb4aU, 0x99cd11cfdf41779cU},
+	{0xdd95317f31c7fa1dU, 0x40405643d711d583U},
+	{0x8a7d3eef7f1cfc52U, 0x482835ea666b2572U},
+	{0xad1c8eab5ee43b66U, 0xda3243650005eecfU},
+	{0xd863b256369d4a40U, 0x90bed43e40076a82U},
+	{0x873e4f75e2224e68U, 0x5a7744a6e804a291U},
+	{0xa90de3535aaae202U, 0x711515d0a205cb36U},
+	{0xd3515c2831559a83U, 0x0d5a5b44ca873e03U},
+	{0x8412d9991ed58091U, 0xe858790afe9486c2U},
+	{0xa5178fff668ae0b6U, 0x626e974dbe39a872U},
+	{0xce5d73ff402d98e3U, 0xfb0a3d212dc8128fU},
+	{0x80fa687f881c7f8eU, 0x7ce66634bc9d0b99U},
+	{0xa139029f6a239f72U, 0x1c1fffc1ebc44e80U},
+	{0xc987434744ac874eU, 0xa327ffb266b56220U},
+	{0xfbe9141915d7a922U, 0x4bf1ff9f0062baa8U},
+	{0x9d71ac8fada6c9b5U, 0x6f773fc3603db4a9U},
+	{0xc4ce17b399107c22U, 0xcb550fb4384d21d3U},
+	{0xf6019da07f549b2bU, 0x7e2a53a146606a48U},
+	{0x99c102844f94e0fbU, 0x2eda7444cbfc426dU},
+	{0xc0314325637a1939U, 0xfa911155fefb5308U},
+	{0xf03d93eebc589f88U, 0x793555ab7eba27caU},
+	{0x96267c7535b763b5U, 0x4bc1558b2f3458deU},
+	{0xbbb01b9283253ca2U, 0x9eb1aaedfb016f16U},
+	{0xea9c227723ee8bcbU, 0x465e15a979c1cadcU},
+	{0x92a1958a7675175fU, 0x0bfacd89ec191ec9U},
+	{0xb749faed14125d36U, 0xcef980ec671f667bU},
+	{0xe51c79a85916f484U, 0x82b7e12780e7401aU},
+	{0x8f31cc0937ae58d2U, 0xd1b2ecb8b0908810U},
+	{0xb2fe3f0b8599ef07U, 0x861fa7e6dcb4aa15U},
+	{0xdfbdcece67006ac9U, 0x67a791e093e1d49aU},
+	{0x8bd6a141006042bdU, 0xe0c8bb2c5c6d24e0U},
+	{0xaecc49914078536dU, 0x58fae9f773886e18U},
+	{0xda7f5bf590966848U, 0xaf39a475506a899eU},
+	{0x888f99797a5e012dU, 0x6d8406c952429603U},
+	{0xaab37fd7d8f58178U, 0xc8e5087ba6d33b83U},
+	{0xd5605fcdcf32e1d6U, 0xfb1e4a9a90880a64U},
+	{0x855c3be0a17fcd26U, 0x5cf2eea09a55067fU},
+	{0xa6b34ad8c9dfc06fU, 0xf42faa48c0ea481eU},
+	{0xd0601d8efc57b08bU, 0xf13b94daf124da26U},
+	{0x823c12795db6ce57U, 0x76c53d08d6b70858U},
+	{0xa2cb1717b52481edU, 0x54768c4b0c64ca6eU},
+	{0xcb7ddcdda26da268U, 0xa9942f5dcf7dfd09U},
+	{0xfe5d54150b090b02U, 0xd3f93b35435d7c4cU},
+	{0x9efa548d26e5a6e1U, 0xc47bc5014a1a6dafU},
+	{0xc6b8e9b0709f109aU, 0x359ab6419ca1091bU},
+	{0xf867241c8cc6d4c0U, 0xc30163d203c94b62U},
+	{0x9b407691d7fc44f8U, 0x79e0de63425dcf1dU},
+	{0xc21094364dfb5636U, 0x985915fc12f542e4U},
+	{0xf294b943e17a2bc4U, 0x3e6f5b7b17b2939dU},
+	{0x979cf3ca6cec5b5aU, 0xa705992ceecf9c42U},
+	{0xbd8430bd08277231U, 0x50c6ff782a838353U},
+	{0xece53cec4a314ebdU, 0xa4f8bf5635246428U},
+	{0x940f4613ae5ed136U, 0x871b7795e136be99U},
+	{0xb913179899f68584U, 0x28e2557b59846e3fU},
+	{0xe757dd7ec07426e5U, 0x331aeada2fe589cfU},
+	{0x9096ea6f3848984fU, 0x3ff0d2c85def7621U},
+	{0xb4bca50b065abe63U, 0x0fed077a756b53a9U},
+	{0xe1ebce4dc7f16dfbU, 0xd3e8495912c62894U},
+	{0x8d3360f09cf6e4bdU, 0x64712dd7abbbd95cU},
+	{0xb080392cc4349decU, 0xbd8d794d96aacfb3U},
+	{0xdca04777f541c567U, 0xecf0d7a0fc5583a0U},
+	{0x89e42caaf9491b60U, 0xf41686c49db57244U},
+	{0xac5d37d5b79b6239U, 0x311c2875c522ced5U},
+	{0xd77485cb25823ac7U, 0x7d633293366b828bU},
+	{0x86a8d39ef77164bcU, 0xae5dff9c02033197U},
+	{0xa8530886b54dbdebU, 0xd9f57f830283fdfcU},
+	{0xd267caa862a12d66U, 0xd072df63c324fd7bU},
+	{0x8380dea93da4bc60U, 0x4247cb9e59f71e6dU},
+	{0xa46116538d0deb78U, 0x52d9be85f074e608U},
+	{0xcd795be870516656U, 0x67902e276c921f8bU},
+	{0x806bd9714632dff6U, 0x00ba1cd8a3db53b6U},
+	{0xa086cfcd97bf97f3U, 0x80e8a40eccd228a4U},
+	{0xc8a883c0fdaf7df0U, 0x6122cd128006b2cdU},
+	{0xfad2a4b13d1b5d6cU, 0x796b805720085f81U},
+	{0x9cc3a6eec6311a63U, 0xcbe3303674053bb0U},
+	{0xc3f490aa77bd60fcU, 0xbedbfc4411068a9cU},
+	{0xf4f1b4d515acb93bU, 0xee92fb5515482d44U},
+	{0x991711052d8bf3c5U, 0x751bdd152d4d1c4aU},
+	{0xbf5cd54678eef0b6U, 0xd262d45a78a0635dU},
+	{0xef340a98172aace4U, 0x86fb897116c87c34U},
+	{0x9580869f0e7aac0eU, 0xd45d35e6ae3d4da0U},
+	{0xbae0a846d2195712U, 0x8974836059cca109U},
+	{0xe998d258869facd7U, 0x2bd1a438703fc94bU},
+	{0x91ff83775423cc06U, 0x7b6306a34627ddcfU},
+	{0xb67f6455292cbf08U, 0x1a3bc84c17b1d542U},
+	{0xe41f3d6a7377eecaU, 0x20caba5f1d9e4a93U},
+	{0x8e938662882af53eU, 0x547eb47b7282ee9cU},
+	{0xb23867fb2a35b28dU, 0xe99e619a4f23aa43U},
+	{0xdec681f9f4c31f31U, 0x6405fa00e2ec94d4U},
+	{0x8b3c113c38f9f37eU, 0xde83bc408dd3dd04U},
+	{0xae0b158b4738705eU, 0x9624ab50b148d445U},
+	{0xd98ddaee19068c76U, 0x3badd624dd9b0957U},
+	{0x87f8a8d4cfa417c9U, 0xe54ca5d70a80e5d6U},
+	{0xa9f6d30a038d1dbcU, 0x5e9fcf4ccd211f4cU},
+	{0xd47487cc8470652bU, 0x7647c3200069671fU},
+	{0x84c8d4dfd2c63f3bU, 0x29ecd9f40041e073U},
+	{0xa5fb0a17c777cf09U, 0xf468107100525890U},
+	{0xcf79cc9db955c2ccU, 0x7182148d4066eeb4U},
+	{0x81ac1fe293d599bfU, 0xc6f14cd848405530U},
+	{0xa21727db38cb002fU, 0xb8ada00e5a506a7cU},
+	{0xca9cf1d206fdc03bU, 0xa6d90811f0e4851cU},
+	{0xfd442e4688bd304aU, 0x908f4a166d1da663U},
+	{0x9e4a9cec15763e2eU, 0x9a598e4e043287feU},
+	{0xc5dd44271ad3cdbaU, 0x40eff1e1853f29fdU},
+	{0xf7549530e188c128U, 0xd12bee59e68ef47cU},
+	{0x9a94dd3e8cf578b9U, 0x82bb74f8301958ceU},
+	{0xc13a148e3032d6e7U, 0xe36a52363c1faf01U},
+	{0xf18899b1bc3f8ca1U, 0xdc44e6c3cb279ac1U},
+	{0x96f5600f15a7b7e5U, 0x29ab103a5ef8c0b9U},
+	{0xbcb2b812db11a5deU, 0x7415d448f6b6f0e7U},
+	{0xebdf661791d60f56U, 0x111b495b3464ad21U},
+	{0x936b9fcebb25c995U, 0xcab10dd900beec34U},
+	{0xb84687c269ef3bfbU, 0x3d5d514f40eea742U},
+	{0xe65829b3046b0afaU, 0x0cb4a5a3112a5112U},
+	{0x8ff71a0fe2c2e6dcU, 0x47f0e785eaba72abU},
+	{0xb3f4e093db73a093U, 0x59ed216765690f56U},
+	{0xe0f218b8d25088b8U, 0x306869c13ec3532cU},
+	{0x8c974f7383725573U, 0x1e414218c73a13fbU},
+	{0xafbd2350644eeacfU, 0xe5d1929ef90898faU},
+	{0xdbac6c247d62a583U, 0xdf45f746b74abf39U},
+	{0x894bc396ce5da772U, 0x6b8bba8c328eb783U},
+	{0xab9eb47c81f5114fU, 0x066ea92f3f326564U},
+	{0xd686619ba27255a2U, 0xc80a537b0efefebdU},
+	{0x8613fd0145877585U, 0xbd06742ce95f5f36U},
+	{0xa798fc4196e952e7U, 0x2c48113823b73704U},
+	{0xd17f3b51fca3a7a0U, 0xf75a15862ca504c5U},
+	{0x82ef85133de648c4U, 0x9a984d73dbe722fbU},
+	{0xa3ab66580d5fdaf5U, 0xc13e60d0d2e0ebbaU},
+	{0xcc963fee10b7d1b3U, 0x318df905079926a8U},
+	{0xffbbcfe994e5c61fU, 0xfdf17746497f7052U},
+	{0x9fd561f1fd0f9bd3U, 0xfeb6ea8bedefa633U},
+	{0xc7caba6e7c5382c8U, 0xfe64a52ee96b8fc0U},
+	{0xf9bd690a1b68637bU, 0x3dfdce7aa3c673b0U},
+	{0x9c1661a651213e2dU, 0x06bea10ca65c084eU},
+	{0xc31bfa0fe5698db8U, 0x486e494fcff30a62U},
+	{0xf3e2f893dec3f126U, 0x5a89dba3c3efccfaU},
+	{0x986ddb5c6b3a76b7U, 0xf89629465a75e01cU},
+	{0xbe89523386091465U, 0xf6bbb397f1135823U},
+	{0xee2ba6c0678b597fU, 0x746aa07ded582e2cU},
+	{0x94db483840b717efU, 0xa8c2a44eb4571cdcU},
+	{0xba121a4650e4ddebU, 0x92f34d62616ce413U},
+	{0xe896a0d7e51e1566U, 0x77b020baf9c81d17U},
+	{0x915e2486ef32cd60U, 0x0ace1474dc1d122eU},
+	{0xb5b5ada8aaff80b8U, 0x0d819992132456baU},
+	{0xe3231912d5bf60e6U, 0x10e1fff697ed6c69U},
+	{0x8df5efabc5979c8fU, 0xca8d3ffa1ef463c1U},
+	{0xb1736b96b6fd83b3U, 0xbd308ff8a6b17cb2U},
+	{0xddd0467c64bce4a0U, 0xac7cb3f6d05ddbdeU},
+	{0x8aa22c0dbef60ee4U, 0x6bcdf07a423aa96bU},
+	{0xad4ab7112eb3929dU, 0x86c16c98d2c953c6U},
+	{0xd89d64d57a607744U, 0xe871c7bf077ba8b7U},
+	{0x87625f056c7c4a8bU, 0x11471cd764ad4972U},
+	{0xa93af6c6c79b5d2dU, 0xd598e40d3dd89bcfU},
+	{0xd389b47879823479U, 0x4aff1d108d4ec2c3U},
+	{0x843610cb4bf160cbU, 0xcedf722a585139baU},
+	{0xa54394fe1eedb8feU, 0xc2974eb4ee658828U},
+	{0xce947a3da6a9273eU, 0x733d226229feea32U},
+	{0x811ccc668829b887U, 0x0806357d5a3f525fU},
+	{0xa163ff802a3426a8U, 0xca07c2dcb0cf26f7U},
+	{0xc9bcff6034c13052U, 0xfc89b393dd02f0b5U},
+	{0xfc2c3f3841f17c67U, 0xbbac2078d443ace2U},
+	{0x9d9ba7832936edc0U, 0xd54b944b84aa4c0dU},
+	{0xc5029163f384a931U, 0x0a9e795e65d4df11U},
+	{0xf64335bcf065d37dU, 0x4d4617b5ff4a16d5U},
+	{0x99ea0196163fa42eU, 0x504bced1bf8e4e45U},
+	{0xc06481fb9bcf8d39U, 0xe45ec2862f71e1d6U},
+	{0xf07da27a82c37088U, 0x5d767327bb4e5a4cU},
+	{0x964e858c91ba2655U, 0x3a6a07f8d510f86fU},
+	{0xbbe226efb628afeaU, 0x890489f70a55368bU},
+	{0xeadab0aba3b2dbe5U, 0x2b45ac74ccea842eU},
+	{0x92c8ae6b464fc96fU, 0x3b0b8bc90012929dU},
+	{0xb77ada0617e3bbcbU, 0x09ce6ebb40173744U},
+	{0xe55990879ddcaabdU, 0xcc420a6a101d0515U},
+	{0x8f57fa54c2a9eab6U, 0x9fa946824a12232dU},
+	{0xb32df8e9f3546564U, 0x47939822dc96abf9U},
+	{0xdff9772470297ebdU, 0x59787e2b93bc56f7U},
+	{0x8bfbea76c619ef36U, 0x57eb4edb3c55b65aU},
+	{0xaefae51477a06b03U, 0xede622920b6b23f1U},
+	{0xdab99e59958885c4U, 0xe95fab368e45ecedU},
+	{0x88b402f7fd75539bU, 0x11dbcb0218ebb414U},
+	{0xaae103b5fcd2a881U, 0xd652bdc29f26a119U},
+	{0xd59944a37c0752a2U, 0x4be76d3346f0495fU},
+	{0x857fcae62d8493a5U, 0x6f70a4400c562ddbU},
+	{0xa6dfbd9fb8e5b88eU, 0xcb4ccd500f6bb952U},
+	{0xd097ad07a71f26b2U, 0x7e2000a41346a7a7U},
+	{0x825ecc24c873782fU, 0x8ed400668c0c28c8U},
+	{0xa2f67f2dfa90563bU, 0x728900802f0f32faU},
+	{0xcbb41ef979346bcaU, 0x4f2b40a03ad2ffb9U},
+	{0xfea126b7d78186bcU, 0xe2f610c84987bfa8U},
+	{0x9f24b832e6b0f436U, 0x0dd9ca7d2df4d7c9U},
+	{0xc6ede63fa05d3143U, 0x91503d1c79720dbbU},
+	{0xf8a95fcf88747d94U, 0x75a44c6397ce912aU},
+	{0x9b69dbe1b548ce7cU, 0xc986afbe3ee11abaU},
+	{0xc24452da229b021bU, 0xfbe85badce996168U},
+	{0xf2d56790ab41c2a2U, 0xfae27299423fb9c3U},
+	{0x97c560ba6b0919a5U, 0xdccd879fc967d41aU},
+	{0xbdb6b8e905cb600fU, 0x5400e987bbc1c920U},
+	{0xed246723473e3813U, 0x290123e9aab23b68U},
+	{0x9436c0760c86e30bU, 0xf9a0b6720aaf6521U},
+	{0xb94470938fa89bceU, 0xf808e40e8d5b3e69U},
+	{0xe7958cb87392c2c2U, 0xb60b1d1230b20e04U},
+	{0x90bd77f3483bb9b9U, 0xb1c6f22b5e6f48c2U},
+	{0xb4ecd5f01a4aa828U, 0x1e38aeb6360b1af3U},
+	{0xe2280b6c20dd5232U, 0x25c6da63c38de1b0U},
+	{0x8d590723948a535fU, 0x579c487e5a38ad0eU},
+	{0xb0af48ec79ace837U, 0x2d835a9df0c6d851U},
+	{0xdcdb1b2798182244U, 0xf8e431456cf88e65U},
+	{0x8a08f0f8bf0f156bU, 0x1b8e9ecb641b58ffU},
+	{0xac8b2d36eed2dac5U, 0xe272467e3d222f3fU},
+	{0xd7adf884aa879177U, 0x5b0ed81dcc6abb0fU},
+	{0x86ccbb52ea94baeaU, 0x98e947129fc2b4e9U},
+	{0xa87fea27a539e9a5U, 0x3f2398d747b36224U},
+	{0xd29fe4b18e88640eU, 0x8eec7f0d19a03aadU},
+	{0x83a3eeeef9153e89U, 0x1953cf68300424acU},
+	{0xa48ceaaab75a8e2bU, 0x5fa8c3423c052dd7U},
+	{0xcdb02555653131b6U, 0x3792f412cb06794dU},
+	{0x808e17555f3ebf11U, 0xe2bbd88bbee40bd0U},
+	{0xa0b19d2ab70e6ed6U, 0x5b6aceaeae9d0ec4U},
+	{0xc8de047564d20a8bU, 0xf245825a5a445275U},
+	{0xfb158592be068d2eU, 0xeed6e2f0f0d56712U},
+	{0x9ced737bb6c4183dU, 0x55464dd69685606bU},
+	{0xc428d05aa4751e4cU, 0xaa97e14c3c26b886U},
+	{0xf53304714d9265dfU, 0xd53dd99f4b3066a8U},
+	{0x993fe2c6d07b7fabU, 0xe546a8038efe4029U},
+	{0xbf8fdb78849a5f96U, 0xde98520472bdd033U},
+	{0xef73d256a5c0f77cU, 0x963e66858f6d4440U},
+	{0x95a8637627989aadU, 0xdde7001379a44aa8U},
+	{0xbb127c53b17ec159U, 0x5560c018580d5d52U},
+	{0xe9d71b689dde71afU, 0xaab8f01e6e10b4a6U},
+	{0x9226712162ab070dU, 0xcab3961304ca70e8U},
+	{0xb6b00d69bb55c8d1U, 0x3d607b97c5fd0d22U},
+	{0xe45c10c42a2b3b05U, 0x8cb89a7db77c506aU},
+	{0x8eb98a7a9a5b04e3U, 0x77f3608e92adb242U},
+	{0xb267ed1940f1c61cU, 0x55f038b237591ed3U},
+	{0xdf01e85f912e37a3U, 0x6b6c46dec52f6688U},
+	{0x8b61313bbabce2c6U, 0x2323ac4b3b3da015U},
+	{0xae397d8aa96c1b77U, 0xabec975e0a0d081aU},
+	{0xd9c7dced53c72255U, 0x96e7bd358c904a21U},
+	{0x881cea14545c7575U, 0x7e50d64177da2e54U},
+	{0xaa242499697392d2U, 0xdde50bd1d5d0b9e9U},
+	{0xd4ad2dbfc3d07787U, 0x955e4ec64b44e864U},
+	{0x84ec3c97da624ab4U, 0xbd5af13bef0b113eU},
+	{0xa6274bbdd0fadd61U, 0xecb1ad8aeacdd58eU},
+	{0xcfb11ead453994baU, 0x67de18eda5814af2U},
+	{0x81ceb32c4b43fcf4U, 0x80eacf948770ced7U},
+	{0xa2425ff75e14fc31U, 0xa1258379a94d028dU},
+	{0xcad2f7f5359a3b3eU, 0x096ee45813a04330U},
+	{0xfd87b5f28300ca0dU, 0x8bca9d6e188853fcU},
+	{0x9e74d1b791e07e48U, 0x775ea264cf55347eU},
+	{0xc612062576589ddaU, 0x95364afe032a819eU},
+	{0xf79687aed3eec551U, 0x3a83ddbd83f52205U},
+	{0x9abe14cd44753b52U, 0xc4926a9672793543U},
+	{0xc16d9a0095928a27U, 0x75b7053c0f178294U},
+	{0xf1c90080baf72cb1U, 0x5324c68b12dd6339U},
+	{0x971da05074da7beeU, 0xd3f6fc16ebca5e04U},
+	{0xbce5086492111aeaU, 0x88f4bb1ca6bcf585U},
+	{0xec1e4a7db69561a5U, 0x2b31e9e3d06c32e6U},
+	{0x9392ee8e921d5d07U, 0x3aff322e62439fd0U},
+	{0xb877aa3236a4b449U, 0x09befeb9fad487c3U},
+	{0xe69594bec44de15bU, 0x4c2ebe687989a9b4U},
+	{0x901d7cf73ab0acd9U, 0x0f9d37014bf60a11U},
+	{0xb424dc35095cd80fU, 0x538484c19ef38c95U},
+	{0xe12e13424bb40e13U, 0x2865a5f206b06fbaU},
+	{0x8cbccc096f5088cbU, 0xf93f87b7442e45d4U},
+	{0xafebff0bcb24aafeU, 0xf78f69a51539d749U},
+	{0xdbe6fecebdedd5beU, 0xb573440e5a884d1cU},
+	{0x89705f4136b4a597U, 0x31680a88f8953031U},
+	{0xabcc77118461cefcU, 0xfdc20d2b36ba7c3eU},
+	{0xd6bf94d5e57a42bcU, 0x3d32907604691b4dU},
+	{0x8637bd05af6c69b5U, 0xa63f9a49c2c1b110U},
+	{0xa7c5ac471b478423U, 0x0fcf80dc33721d54U},
+	{0xd1b71758e219652bU, 0xd3c36113404ea4a9U},
+	{0x83126e978d4fdf3bU, 0x645a1cac083126eaU},
+	{0xa3d70a3d70a3d70aU, 0x3d70a3d70a3d70a4U},
+	{0xccccccccccccccccU, 0xcccccccccccccccdU},
+	{0x8000000000000000U, 0x0000000000000000U},
+	{0xa000000000000000U, 0x0000000000000000U},
+	{0xc800000000000000U, 0x0000000000000000U},
+	{0xfa00000000000000U, 0x0000000000000000U},
+	{0x9c40000000000000U, 0x0000000000000000U},
+	{0xc350000000000000U, 0x0000000000000000U},
+	{0xf424000000000000U, 0x0000000000000000U},
+	{0x9896800000000000U, 0x0000000000000000U},
+	{0xbebc200000000000U, 0x0000000000000000U},
+	{0xee6b280000000000U, 0x0000000000000000U},
+	{0x9502f90000000000U, 0x0000000000000000U},
+	{0xba43b74000000000U, 0x0000000000000000U},
+	{0xe8d4a51000000000U, 0x0000000000000000U},
+	{0x9184e72a00000000U, 0x0000000000000000U},
+	{0xb5e620f480000000U, 0x0000000000000000U},
+	{0xe35fa931a0000000U, 0x0000000000000000U},
+	{0x8e1bc9bf04000000U, 0x0000000000000000U},
+	{0xb1a2bc2ec5000000U, 0x0000000000000000U},
+	{0xde0b6b3a76400000U, 0x0000000000000000U},
+	{0x8ac7230489e80000U, 0x0000000000000000U},
+	{0xad78ebc5ac620000U, 0x0000000000000000U},
+	{0xd8d726b7177a8000U, 0x0000000000000000U},
+	{0x878678326eac9000U, 0x0000000000000000U},
+	{0xa968163f0a57b400U, 0x0000000000000000U},
+	{0xd3c21bcecceda100U, 0x0000000000000000U},
+	{0x84595161401484a0U, 0x0000000000000000U},
+	{0xa56fa5b99019a5c8U, 0x0000000000000000U},
+	{0xcecb8f27f4200f3aU, 0x0000000000000000U},
+	{0x813f3978f8940984U, 0x4000000000000000U},
+	{0xa18f07d736b90be5U, 0x5000000000000000U},
+	{0xc9f2c9cd04674edeU, 0xa400000000000000U},
+	{0xfc6f7c4045812296U, 0x4d00000000000000U},
+	{0x9dc5ada82b70b59dU, 0xf020000000000000U},
+	{0xc5371912364ce305U, 0x6c28000000000000U},
+	{0xf684df56c3e01bc6U, 0xc732000000000000U},
+	{0x9a130b963a6c115cU, 0x3c7f400000000000U},
+	{0xc097ce7bc90715b3U, 0x4b9f100000000000U},
+	{0xf0bdc21abb48db20U, 0x1e86d40000000000U},
+	{0x96769950b50d88f4U, 0x1314448000000000U},
+	{0xbc143fa4e250eb31U, 0x17d955a000000000U},
+	{0xeb194f8e1ae525fdU, 0x5dcfab0800000000U},
+	{0x92efd1b8d0cf37beU, 0x5aa1cae500000000U},
+	{0xb7abc627050305adU, 0xf14a3d9e40000000U},
+	{0xe596b7b0c643c719U, 0x6d9ccd05d0000000U},
+	{0x8f7e32ce7bea5c6fU, 0xe4820023a2000000U},
+	{0xb35dbf821ae4f38bU, 0xdda2802c8a800000U},
+	{0xe0352f62a19e306eU, 0xd50b2037ad200000U},
+	{0x8c213d9da502de45U, 0x4526f422cc340000U},
+	{0xaf298d050e4395d6U, 0x9670b12b7f410000U},
+	{0xdaf3f04651d47b4cU, 0x3c0cdd765f114000U},
+	{0x88d8762bf324cd0fU, 0xa5880a69fb6ac800U},
+	{0xab0e93b6efee0053U, 0x8eea0d047a457a00U},
+	{0xd5d238a4abe98068U, 0x72a4904598d6d880U},
+	{0x85a36366eb71f041U, 0x47a6da2b7f864750U},
+	{0xa70c3c40a64e6c51U, 0x999090b65f67d924U},
+	{0xd0cf4b50cfe20765U, 0xfff4b4e3f741cf6dU},
+	{0x82818f1281ed449fU, 0xbff8f10e7a8921a4U},
+	{0xa321f2d7226895c7U, 0xaff72d52192b6a0dU},
+	{0xcbea6f8ceb02bb39U, 0x9bf4f8a69f764490U},
+	{0xfee50b7025c36a08U, 0x02f236d04753d5b4U},
+	{0x9f4f2726179a2245U, 0x01d762422c946590U},
+	{0xc722f0ef9d80aad6U, 0x424d3ad2b7b97ef5U},
+	{0xf8ebad2b84e0d58bU, 0xd2e0898765a7deb2U},
+	{0x9b934c3b330c8577U, 0x63cc55f49f88eb2fU},
+	{0xc2781f49ffcfa6d5U, 0x3cbf6b71c76b25fbU},
+	{0xf316271c7fc3908aU, 0x8bef464e3945ef7aU},
+	{0x97edd871cfda3a56U, 0x97758bf0e3cbb5acU},
+	{0xbde94e8e43d0c8ecU, 0x3d52eeed1cbea317U},
+	{0xed63a231d4c4fb27U, 0x4ca7aaa863ee4bddU},
+	{0x945e455f24fb1cf8U, 0x8fe8caa93e74ef6aU},
+	{0xb975d6b6ee39e436U, 0xb3e2fd538e122b44U},
+	{0xe7d34c64a9c85d44U, 0x60dbbca87196b616U},
+	{0x90e40fbeea1d3a4aU, 0xbc8955e946fe31cdU},
+	{0xb51d13aea4a488ddU, 0x6babab6398bdbe41U},
+	{0xe264589a4dcdab14U, 0xc696963c7eed2dd1U},
+	{0x8d7eb76070a08aecU, 0xfc1e1de5cf543ca2U},
+	{0xb0de65388cc8ada8U, 0x3b25a55f43294bcbU},
+	{0xdd15fe86affad912U, 0x49ef0eb713f39ebeU},
+	{0x8a2dbf142dfcc7abU, 0x6e3569326c784337U},
+	{0xacb92ed9397bf996U, 0x49c2c37f07965404U},
+	{0xd7e77a8f87daf7fbU, 0xdc33745ec97be906U},
+	{0x86f0ac99b4e8dafdU, 0x69a028bb3ded71a3U},
+	{0xa8acd7c0222311bcU, 0xc40832ea0d68ce0cU},
+	{0xd2d80db02aabd62bU, 0xf50a3fa490c30190U},
+	{0x83c7088e1aab65dbU, 0x792667c6da79e0faU},
+	{0xa4b8cab1a1563f52U, 0x577001b891185938U},
+	{0xcde6fd5e09abcf26U, 0xed4c0226b55e6f86U},
+	{0x80b05e5ac60b6178U, 0x544f8158315b05b4U},
+	{0xa0dc75f1778e39d6U, 0x696361ae3db1c721U},
+	{0xc913936dd571c84cU, 0x03bc3a19cd1e38e9U},
+	{0xfb5878494ace3a5fU, 0x04ab48a04065c723U},
+	{0x9d174b2dcec0e47bU, 0x62eb0d64283f9c76U},
+	{0xc45d1df942711d9aU, 0x3ba5d0bd324f8394U},
+	{0xf5746577930d6500U, 0xca8f44ec7ee36479U},
+	{0x9968bf6abbe85f20U, 0x7e998b13cf4e1ecbU},
+	{0xbfc2ef456ae276e8U, 0x9e3fedd8c321a67eU},
+	{0xefb3ab16c59b14a2U, 0xc5cfe94ef3ea101eU},
+	{0x95d04aee3b80ece5U, 0xbba1f1d158724a12U},
+	{0xbb445da9ca61281fU, 0x2a8a6e45ae8edc97U},
+	{0xea1575143cf97226U, 0xf52d09d71a3293bdU},
+	{0x924d692ca61be758U, 0x593c2626705f9c56U},
+	{0xb6e0c377cfa2e12eU, 0x6f8b2fb00c77836cU},
+	{0xe498f455c38b997aU, 0x0b6dfb9c0f956447U},
+	{0x8edf98b59a373fecU, 0x4724bd4189bd5eacU},
+	{0xb2977ee300c50fe7U, 0x58edec91ec2cb657U},
+	{0xdf3d5e9bc0f653e1U, 0x2f2967b66737e3edU},
+	{0x8b865b215899f46cU, 0xbd79e0d20082ee74U},
+	{0xae67f1e9aec07187U, 0xecd8590680a3aa11U},
+	{0xda01ee641a708de9U, 0xe80e6f4820cc9495U},
+	{0x884134fe908658b2U, 0x3109058d147fdcddU},
+	{0xaa51823e34a7eedeU, 0xbd4b46f0599fd415U},
+	{0xd4e5e2cdc1d1ea96U, 0x6c9e18ac7007c91aU},
+	{0x850fadc09923329eU, 0x03e2cf6bc604ddb0U},
+	{0xa6539930bf6bff45U, 0x84db8346b786151cU},
+	{0xcfe87f7cef46ff16U, 0xe612641865679a63U},
+	{0x81f14fae158c5f6eU, 0x4fcb7e8f3f60c07eU},
+	{0xa26da3999aef7749U, 0xe3be5e330f38f09dU},
+	{0xcb090c8001ab551cU, 0x5cadf5bfd3072cc5U},
+	{0xfdcb4fa002162a63U, 0x73d9732fc7c8f7f6U},
+	{0x9e9f11c4014dda7eU, 0x2867e7fddcdd9afaU},
+	{0xc646d63501a1511dU, 0xb281e1fd541501b8U},
+	{0xf7d88bc24209a565U, 0x1f225a7ca91a4226U},
+	{0x9ae757596946075fU, 0x3375788de9b06958U},
+	{0xc1a12d2fc3978937U, 0x0052d6b1641c83aeU},
+	{0xf209787bb47d6b84U, 0xc0678c5dbd23a49aU},
+	{0x9745eb4d50ce6332U, 0xf840b7ba963646e0U},
+	{0xbd176620a501fbffU, 0xb650e5a93bc3d898U},
+	{0xec5d3fa8ce427affU, 0xa3e51f138ab4cebeU},
+	{0x93ba47c980e98cdfU, 0xc66f336c36b10137U},
+	{0xb8a8d9bbe123f017U, 0xb80b0047445d4184U},
+	{0xe6d3102ad96cec1dU, 0xa60dc059157491e5U},
+	{0x9043ea1ac7e41392U, 0x87c89837ad68db2fU},
+	{0xb454e4a179dd1877U, 0x29babe4598c311fbU},
+	{0xe16a1dc9d8545e94U, 0xf4296dd6fef3d67aU},
+	{0x8ce2529e2734bb1dU, 0x1899e4a65f58660cU},
+	{0xb01ae745b101e9e4U, 0x5ec05dcff72e7f8fU},
+	{0xdc21a1171d42645dU, 0x76707543f4fa1f73U},
+	{0x899504ae72497ebaU, 0x6a06494a791c53a8U},
+	{0xabfa45da0edbde69U, 0x0487db9d17636892U},
+	{0xd6f8d7509292d603U, 0x45a9d2845d3c42b6U},
+	{0x865b86925b9bc5c2U, 0x0b8a2392ba45a9b2U},
+	{0xa7f26836f282b732U, 0x8e6cac7768d7141eU},
+	{0xd1ef0244af2364ffU, 0x3207d795430cd926U},
+	{0x8335616aed761f1fU, 0x7f44e6bd49e807b8U},
+	{0xa402b9c5a8d3a6e7U, 0x5f16206c9c6209a6U},
+	{0xcd036837130890a1U, 0x36dba887c37a8c0fU},
+	{0x802221226be55a64U, 0xc2494954da2c9789U},
+	{0xa02aa96b06deb0fdU, 0xf2db9baa10b7bd6cU},
+	{0xc83553c5c8965d3dU, 0x6f92829494e5acc7U},
+	{0xfa42a8b73abbf48cU, 0xcb772339ba1f17f9U},
+	{0x9c69a97284b578d7U, 0xff2a760414536efbU},
+	{0xc38413cf25e2d70dU, 0xfef5138519684abaU},
+	{0xf46518c2ef5b8cd1U, 0x7eb258665fc25d69U},
+	{0x98bf2f79d5993802U, 0xef2f773ffbd97a61U},
+	{0xbeeefb584aff8603U, 0xaafb550ffacfd8faU},
+	{0xeeaaba2e5dbf6784U, 0x95ba2a53f983cf38U},
+	{0x952ab45cfa97a0b2U, 0xdd945a747bf26183U},
+	{0xba756174393d88dfU, 0x94f971119aeef9e4U},
+	{0xe912b9d1478ceb17U, 0x7a37cd5601aab85dU},
+	{0x91abb422ccb812eeU, 0xac62e055c10ab33aU},
+	{0xb616a12b7fe617aaU, 0x577b986b314d6009U},
+	{0xe39c49765fdf9d94U, 0xed5a7e85fda0b80bU},
+	{0x8e41ade9fbebc27dU, 0x14588f13be847307U},
+	{0xb1d219647ae6b31cU, 0x596eb2d8ae258fc8U},
+	{0xde469fbd99a05fe3U, 0x6fca5f8ed9aef3bbU},
+	{0x8aec23d680043beeU, 0x25de7bb9480d5854U},
+	{0xada72ccc20054ae9U, 0xaf561aa79a10ae6aU},
+	{0xd910f7ff28069da4U, 0x1b2ba1518094da04U},
+	{0x87aa9aff79042286U, 0x90fb44d2f05d0842U},
+	{0xa99541bf57452b28U, 0x353a1607ac744a53U},
+	{0xd3fa922f2d1675f2U, 0x42889b8997915ce8U},
+	{0x847c9b5d7c2e09b7U, 0x69956135febada11U},
+	{0xa59bc234db398c25U, 0x43fab9837e699095U},
+	{0xcf02b2c21207ef2eU, 0x94f967e45e03f4bbU},
+	{0x8161afb94b44f57dU, 0x1d1be0eebac278f5U},
+	{0xa1ba1ba79e1632dcU, 0x6462d92a69731732U},
+	{0xca28a291859bbf93U, 0x7d7b8f7503cfdcfeU},
+	{0xfcb2cb35e702af78U, 0x5cda735244c3d43eU},
+	{0x9defbf01b061adabU, 0x3a0888136afa64a7U},
+	{0xc56baec21c7a1916U, 0x088aaa1845b8fdd0U},
+	{0xf6c69a72a3989f5bU, 0x8aad549e57273d45U},
+	{0x9a3c2087a63f6399U, 0x36ac54e2f678864bU},
+	{0xc0cb28a98fcf3c7fU, 0x84576a1bb416a7ddU},
+	{0xf0fdf2d3f3c30b9fU, 0x656d44a2a11c51d5U},
+	{0x969eb7c47859e743U, 0x9f644ae5a4b1b325U},
+	{0xbc4665b596706114U, 0x873d5d9f0dde1feeU},
+	{0xeb57ff22fc0c7959U, 0xa90cb506d155a7eaU},
+	{0x9316ff75dd87cbd8U, 0x09a7f12442d588f2U},
+	{0xb7dcbf5354e9beceU, 0x0c11ed6d538aeb2fU},
+	{0xe5d3ef282a242e81U, 0x8f1668c8a86da5faU},
+	{0x8fa475791a569d10U, 0xf96e017d694487bcU},
+	{0xb38d92d760ec4455U, 0x37c981dcc395a9acU},
+	{0xe070f78d3927556aU, 0x85bbe253f47b1417U},
+	{0x8c469ab843b89562U, 0x93956d7478ccec8eU},
+	{0xaf58416654a6babbU, 0x387ac8d1970027b2U},
+	{0xdb2e51bfe9d0696aU, 0x06997b05fcc0319eU},
+	{0x88fcf317f22241e2U, 0x441fece3bdf81f03U},
+	{0xab3c2fddeeaad25aU, 0xd527e81cad7626c3U},
+	{0xd60b3bd56a5586f1U, 0x8a71e223d8d3b074U},
+	{0x85c7056562757456U, 0xf6872d5667844e49U},
+	{0xa738c6bebb12d16cU, 0xb428f8ac016561dbU},
+	{0xd106f86e69d785c7U, 0xe13336d701beba52U},
+	{0x82a45b450226b39cU, 0xecc0024661173473U},
+	{0xa34d721642b06084U, 0x27f002d7f95d0190U},
+	{0xcc20ce9bd35c78a5U, 0x31ec038df7b441f4U},
+	{0xff290242c83396ceU, 0x7e67047175a15271U},
+	{0x9f79a169bd203e41U, 0x0f0062c6e984d386U},
+	{0xc75809c42c684dd1U, 0x52c07b78a3e60868U},
+	{0xf92e0c3537826145U, 0xa7709a56ccdf8a82U},
+	{0x9bbcc7a142b17ccbU, 0x88a66076400bb691U},
+	{0xc2abf989935ddbfeU, 0x6acff893d00ea435U},
+	{0xf356f7ebf83552feU, 0x0583f6b8c4124d43U},
+	{0x98165af37b2153deU, 0xc3727a337a8b704aU},
+	{0xbe1bf1b059e9a8d6U, 0x744f18c0592e4c5cU},
+	{0xeda2ee1c7064130cU, 0x1162def06f79df73U},
+	{0x9485d4d1c63e8be7U, 0x8addcb5645ac2ba8U},
+	{0xb9a74a0637ce2ee1U, 0x6d953e2bd7173692U},
+	{0xe8111c87c5c1ba99U, 0xc8fa8db6ccdd0437U},
+	{0x910ab1d4db9914a0U, 0x1d9c9892400a22a2U},
+	{0xb54d5e4a127f59c8U, 0x2503beb6d00cab4bU},
+	{0xe2a0b5dc971f303aU, 0x2e44ae64840fd61dU},
+	{0x8da471a9de737e24U, 0x5ceaecfed289e5d2U},
+	{0xb10d8e1456105dadU, 0x7425a83e872c5f47U},
+	{0xdd50f1996b947518U, 0xd12f124e28f77719U},
+	{0x8a5296ffe33cc92fU, 0x82bd6b70d99aaa6fU},
+	{0xace73cbfdc0bfb7bU, 0x636cc64d1001550bU},
+	{0xd8210befd30efa5aU, 0x3c47f7e05401aa4eU},
+	{0x8714a775e3e95c78U, 0x65acfaec34810a71U},
+	{0xa8d9d1535ce3b396U, 0x7f1839a741a14d0dU},
+	{0xd31045a8341ca07cU, 0x1ede48111209a050U},
+	{0x83ea2b892091e44dU, 0x934aed0aab460432U},
+	{0xa4e4b66b68b65d60U, 0xf81da84d5617853fU},
+	{0xce1de40642e3f4b9U, 0x36251260ab9d668eU},
+	{0x80d2ae83e9ce78f3U, 0xc1d72b7c6b426019U},
+	{0xa1075a24e4421730U, 0xb24cf65b8612f81fU},
+	{0xc94930ae1d529cfcU, 0xdee033f26797b627U},
+	{0xfb9b7cd9a4a7443cU, 0x169840ef017da3b1U},
+	{0x9d412e0806e88aa5U, 0x8e1f289560ee864eU},
+	{0xc491798a08a2ad4eU, 0xf1a6f2bab92a27e2U},
+	{0xf5b5d7ec8acb58a2U, 0xae10af696774b1dbU},
+	{0x9991a6f3d6bf1765U, 0xacca6da1e0a8ef29U},
+	{0xbff610b0cc6edd3fU, 0x17fd090a58d32af3U},
+	{0xeff394dcff8a948eU, 0xddfc4b4cef07f5b0U},
+	{0x95f83d0a1fb69cd9U, 0x4abdaf101564f98eU},
+	{0xbb764c4ca7a4440fU, 0x9d6d1ad41abe37f1U},
+	{0xea53df5fd18d5513U, 0x84c86189216dc5edU},
+	{0x92746b9be2f8552cU, 0x32fd3cf5b4e49bb4U},
+	{0xb7118682dbb66a77U, 0x3fbc8c33221dc2a1U},
+	{0xe4d5e82392a40515U, 0x0fabaf3feaa5334aU},
+	{0x8f05b1163ba6832dU, 0x29cb4d87f2a7400eU},
+	{0xb2c71d5bca9023f8U, 0x743e20e9ef511012U},
+	{0xdf78e4b2bd342cf6U, 0x914da9246b255416U},
+	{0x8bab8eefb6409c1aU, 0x1ad089b6c2f7548eU},
+	{0xae9672aba3d0c320U, 0xa184ac2473b529b1U},
+	{0xda3c0f568cc4f3e8U, 0xc9e5d72d90a2741eU},
+	{0x8865899617fb1871U, 0x7e2fa67c7a658892U},
+	{0xaa7eebfb9df9de8dU, 0xddbb901b98feeab7U},
+	{0xd51ea6fa85785631U, 0x552a74227f3ea565U},
+	{0x8533285c936b35deU, 0xd53a88958f87275fU},
+	{0xa67ff273b8460356U, 0x8a892abaf368f137U},
+	{0xd01fef10a657842cU, 0x2d2b7569b0432d85U},
+	{0x8213f56a67f6b29bU, 0x9c3b29620e29fc73U},
+	{0xa298f2c501f45f42U, 0x8349f3ba91b47b8fU},
+	{0xcb3f2f7642717713U, 0x241c70a936219a73U},
+	{0xfe0efb53d30dd4d7U, 0xed238cd383aa0110U},
+	{0x9ec95d1463e8a506U, 0xf4363804324a40aaU},
+	{0xc67bb4597ce2ce48U, 0xb143c6053edcd0d5U},
+	{0xf81aa16fdc1b81daU, 0xdd94b7868e94050aU},
+	{0x9b10a4e5e9913128U, 0xca7cf2b4191c8326U},
+	{0xc1d4ce1f63f57d72U, 0xfd1c2f611f63a3f0U},
+	{0xf24a01a73cf2dccfU, 0xbc633b39673c8cecU},
+	{0x976e41088617ca01U, 0xd5be0503e085d813U},
+	{0xbd49d14aa79dbc82U, 0x4b2d8644d8a74e18U},
+	{0xec9c459d51852ba2U, 0xddf8e7d60ed1219eU},
+	{0x93e1ab8252f33b45U, 0xcabb90e5c942b503U},
+	{0xb8da1662e7b00a17U, 0x3d6a751f3b936243U},
+	{0xe7109bfba19c0c9dU, 0x0cc512670a783ad4U},
+	{0x906a617d450187e2U, 0x27fb2b80668b24c5U},
+	{0xb484f9dc9641e9daU, 0xb1f9f660802dedf6U},
+	{0xe1a63853bbd26451U, 0x5e7873f8a0396973U},
+	{0x8d07e33455637eb2U, 0xdb0b487b6423e1e8U},
+	{0xb049dc016abc5e5fU, 0x91ce1a9a3d2cda62U},
+	{0xdc5c5301c56b75f7U, 0x7641a140cc7810fbU},
+	{0x89b9b3e11b6329baU, 0xa9e904c87fcb0a9dU},
+	{0xac2820d9623bf429U, 0x546345fa9fbdcd44U},
+	{0xd732290fbacaf133U, 0xa97c177947ad4095U},
+	{0x867f59a9d4bed6c0U, 0x49ed8eabcccc485dU},
+	{0xa81f301449ee8c70U, 0x5c68f256bfff5a74U},
+	{0xd226fc195c6a2f8cU, 0x73832eec6fff3111U},
+	{0x83585d8fd9c25db7U, 0xc831fd53c5ff7eabU},
+	{0xa42e74f3d032f525U, 0xba3e7ca8b77f5e55U},
+	{0xcd3a1230c43fb26fU, 0x28ce1bd2e55f35ebU},
+	{0x80444b5e7aa7cf85U, 0x7980d163cf5b81b3U},
+	{0xa0555e361951c366U, 0xd7e105bcc332621fU},
+	{0xc86ab5c39fa63440U, 0x8dd9472bf3fefaa7U},
+	{0xfa856334878fc150U, 0xb14f98f6f0feb951U},
+	{0x9c935e00d4b9d8d2U, 0x6ed1bf9a569f33d3U},
+	{0xc3b8358109e84f07U, 0x0a862f80ec4700c8U},
+	{0xf4a642e14c6262c8U, 0xcd27bb612758c0faU},
+	{0x98e7e9cccfbd7dbdU, 0x8038d51cb897789cU},
+	{0xbf21e44003acdd2cU, 0xe0470a63e6bd56c3U},
+	{0xeeea5d5004981478U, 0x1858ccfce06cac74U},
+	{0x95527a5202df0ccbU, 0x0f37801e0c43ebc8U},
+	{0xbaa718e68396cffdU, 0xd30560258f54e6baU},
+	{0xe950df20247c83fdU, 0x47c6b82ef32a2069U},
+	{0x91d28b7416cdd27eU, 0x4cdc331d57fa5441U},
+	{0xb6472e511c81471dU, 0xe0133fe4adf8e952U},
+	{0xe3d8f9e563a198e5U, 0x58180fddd97723a6U},
+	{0x8e679c2f5e44ff8fU, 0x570f09eaa7ea7648U},
+};
+
+/**
+ * @brief Schubfach multipliers floor(10^-k * 2^-r) + 1 for k from -324
+ *        to 292, with r chosen to make them 126 bits, split into the
+ *        high and low 63 bits.
+ */
+constexpr static uint64_t const num_g[617][2] = {
+	{0x4f0cedc95a718dd4U, 0x5b01e8b09aa0d1b5U},
+	{0x7e7b160ef71c1621U, 0x119ca780f767b5eeU},
+	{0x652f44d8c5b011b4U, 0x0e16ec672c52f7f2U},
+	{0x50f29d7a37c00e29U, 0x581256b8f0425ff5U},
+	{0x40c21794f96671baU, 0x79a84560c0351991U},
+	{0x679cf287f570b5f7U, 0x75da089acd21c281U},
+	{0x52e3f5399126f7f9U, 0x44ae6d48a41b0201U},
+	{0x424ff76140ebf994U, 0x36f1f106e9af34cdU},
+	{0x6a198bcece465c20U, 0x57e981a4a918547bU},
+	{0x54e13ca571d1e34dU, 0x2cbace1d541376c9U},
+	{0x43e763b78e4182a4U, 0x23c8a4e44342c56eU},
+	{0x6ca56c58e39c043aU, 0x060dd4a06b9e08b0U},
+	{0x56eabd13e9499cfbU, 0x1e7176e6bc7e6d59U},
+	{0x458897432107b0c8U, 0x7ec12bebc9febde1U},
+	{0x6f40f20501a5e7a7U, 0x7e01dfdfa9979635U},
+	{0x5900c19d9aeb1fb9U, 0x4b34b319547944f7U},
+	{0x4733ce17af227fc7U, 0x55c3c27aa9fa9d93U},
+	{0x71ec7cf2b1d0cc72U, 0x560603f7765dc8eaU},
+	{0x5b2397288e40a38eU, 0x7804cff92b7e3a55U},
+	{0x48e945ba0b66e93fU, 0x13370cc755fe9511U},
+	{0x74a86f90123e41feU, 0x51f1ae0bbcca881bU},
+	{0x5d538c7341cb67feU, 0x74c1580963d539afU},
+	{0x4aa93d29016f8665U, 0x43cde0078310faf3U},
+	{0x77752ea8024c0a3cU, 0x0616333f381b2b1eU},
+	{0x5f90f22001d66e96U, 0x3811c298f9af55b1U},
+	{0x4c73f4e667debedeU, 0x600e35472e25de28U},
+	{0x7a532170a6313164U, 0x3349eed849d6303fU},
+	{0x61dc1ac084f42783U, 0x42a18be03b11c033U},
+	{0x4e49af006a5cec69U, 0x1bb46fe695a7ccf5U},
+	{0x7d42b19a43c7e0a8U, 0x2c53e63dbc3fae55U},
+	{0x64355ae1cfd31a20U, 0x237651cafcffbeaaU},
+	{0x502aaf1b0ca8e1b3U, 0x35f8416f30cc9888U},
+	{0x402225af3d53e7c2U, 0x5e603458f3d6e06dU},
+	{0x669d0918621fd937U, 0x4a3386f4b957cd7bU},
+	{0x52173a79e8197a92U, 0x6e8f9f2a2ddfd796U},
+	{0x41ac2ec7ece12edbU, 0x720c7f54f17fdfabU},
+	{0x69137e0cae3517c6U, 0x1ce0cbbb1bffcc45U},
+	{0x540f980a24f74638U, 0x171a3c95afffd69eU},
+	{0x433facd4ea5f6b60U, 0x127b63aaf3331218U},
+	{0x6b991487dd657899U, 0x6a5f05de51eb5026U},
+	{0x5614106cb11dfa14U, 0x5518d17ea7ef7352U},
+	{0x44dcd9f08db194ddU, 0x2a7a41321ff2c2a8U},
+	{0x6e2e2980e2b5bafbU, 0x5d906850331e043fU},
+	{0x5824ee00b55e2f2fU, 0x647386a68f4b3699U},
+	{0x4683f19a2ab1bf59U, 0x36c2d21ed908f87bU},
+	{0x70d31c29dde93228U, 0x579e1cfe280e5a5dU},
+	{0x5a427cee4b20f4edU, 0x2c7e7d98200b7b7eU},
+	{0x483530bea280c3f1U, 0x09fecae019a2c932U},
+	{0x73884dfdd0ce064eU, 0x43314499c29e0eb6U},
+	{0x5c6d0b3173d8050bU, 0x4f5a9d47cee4d891U},
+	{0x49f0d5c129799da2U, 0x72aee4397250ad41U},
+	{0x764e22cea8c295d1U, 0x377e39f583b44868U},
+	{0x5ea4e8a553cede41U, 0x12cb61913629d387U},
+	{0x4bb72084430be500U, 0x756f8140f8217605U},
+	{0x792500d39e796e67U, 0x6f18cece59cf233cU},
+	{0x60ea670fb1fabeb9U, 0x3f470bd847d8e8fdU},
+	{0x4d885272f4c89894U, 0x329f3cad064720caU},
+	{0x7c0d50b7ee0dc0edU, 0x37652de1a3a50143U},
+	{0x633dda2cbe716724U, 0x2c50f1814fb73436U},
+	{0x4f64ae8a31f45283U, 0x3d0d8e010c92902bU},
+	{0x7f077da9e986ea6bU, 0x7b48e334e0ea8045U},
+	{0x659f97bb2138bb89U, 0x49071c2a4d88669dU},
+	{0x514c796280fa2fa1U, 0x20d27ceea46d1ee4U},
+	{0x4109fab533fb594dU, 0x670eca58838a7f1dU},
+	{0x680ff788532bc216U, 0x0b4add5a6c10cb62U},
+	{0x533ff939dc2301abU, 0x22a24aaebcda3c4eU},
+	{0x4299942e49b59aefU, 0x354ea22563e1c9d8U},
+	{0x6a8f537d42bc2b18U, 0x554a9d089fcfa95aU},
+	{0x553f75fdcefcef46U, 0x776ee406e63fbaaeU},
+	{0x4432c4cb0bfd8c38U, 0x5f8be99f1e996225U},
+	{0x6d1e07ab466279f4U, 0x327975cb64289d08U},
+	{0x574b3955d1e86190U, 0x28612b091ced4a6dU},
+	{0x45d5c777db204e0dU, 0x06b4226db0bdd524U},
+	{0x6fbc72595e9a167bU, 0x24536a491ac95506U},
+	{0x59638eade54811fcU, 0x1d0f883a7bd44405U},
+	{0x4782d88b1dd34196U, 0x4a72d361fca9d004U},
+	{0x726af411c952028aU, 0x43eaebcffaa94cd3U},
+	{0x5b88c3416ddb353bU, 0x4fef230cc88770a9U},
+	{0x493a35cdf17c2a96U, 0x0cbf4f3d6d3926eeU},
+	{0x7529efafe8c6aa89U, 0x61321862485b717cU},
+	{0x5dbb262653d22207U, 0x675b46b506af8dfdU},
+	{0x4afc1e850fdb4e6cU, 0x52af6bc405593e64U},
+	{0x77f9ca6e7fc54a47U, 0x377f12d33bc1fd6dU},
+	{0x5ffb085866376e9fU, 0x45ff42429634cabdU},
+	{0x4cc8d379eb5f8bb2U, 0x6b329b68782a3bcbU},
+	{0x7adaebf64565ac51U, 0x2b842bda59dd2c77U},
+	{0x6248bcc5045156a7U, 0x3c69bcaeae4a89f9U},
+	{0x4ea0970403744552U, 0x6387ca25583ba194U},
+	{0x7dcdbe6cd253a21eU, 0x05a6103bc05f68edU},
+	{0x64a498570ea94e7eU, 0x37b80cfc99e5ed8aU},
+	{0x5083ad1272210b98U, 0x2c933d96e184be08U},
+	{0x40695741f4e73c79U, 0x7075cadf1ad09807U},
+	{0x670ef2032171fa5cU, 0x4d8944982ae759a4U},
+	{0x52725b35b45b2eb0U, 0x3e076a135585e150U},
+	{0x41f515c49048f226U, 0x64d2bb42aad1810dU},
+	{0x698822d41a0e503eU, 0x07b7920444826815U},
+	{0x546ce8a9ae71d9cbU, 0x1fc60e69d0685344U},
+	{0x438a53baf1f4ae3cU, 0x196b3ebb0d20429dU},
+	{0x6c1085f7e9877d2dU, 0x0f11fdf815006a94U},
+	{0x56739e5fee05fdbdU, 0x58db319344005543U},
+	{0x45294b7ff19e6497U, 0x60af5adc3666aa9cU},
+	{0x6ea878ccb5ca3a8cU, 0x344bc4938a3dddc7U},
+	{0x5886c70a2b082ed6U, 0x5d096a0fa1cb17d2U},
+	{0x46d238d4ef39bf12U, 0x173abb3fb4a27975U},
+	{0x71505aee4b8f981dU, 0x0b912b992103f588U},
+	{0x5aa6af25093face4U, 0x0940efadb4032ad3U},
+	{0x488558ea6dcc8a50U, 0x07672624900288a9U},
+	{0x74088e43e2e0dd4cU, 0x723ea36db337410eU},
+	{0x5cd3a5031be71770U, 0x5b654f8af5c5cda5U},
+	{0x4a42ea68e31f45f3U, 0x62b772d5916b0aebU},
+	{0x76d1770e38320986U, 0x0458b7bc1bde77ddU},
+	{0x5f0df8d82cf4d46bU, 0x1d13c630164b9318U},
+	{0x4c0b2d79bd90a9efU, 0x30dc9e8cdea2dc13U},
+	{0x79ab7bf5fc1aa97fU, 0x0160fdae31049351U},
+	{0x6155fcc4c9aeedffU, 0x1ab3fe24f403a90eU},
+	{0x4dde63d0a158be65U, 0x6229981d9002eda5U},
+	{0x7c97061a9bc130a2U, 0x69dc2695b337e2a1U},
+	{0x63ac04e2163426e8U, 0x54b01ede28f9821bU},
+	{0x4fbcd0b4de901f20U, 0x43c018b1ba6134e2U},
+	{0x7f9481216419cb67U, 0x1f99c11c5d68549dU},
+	{0x6610674de9ae3c52U, 0x4c7b00e37ded107eU},
+	{0x51a6b90b21583042U, 0x09fc00b5fe574065U},
+	{0x41522da2811359ceU, 0x3b3000919845cd1dU},
+	{0x68837c3734ebc2e3U, 0x784ccdb5c06fae95U},
+	{0x539c635f5d8968b6U, 0x2d0a3e2b00595877U},
+	{0x42e382b2b13aba2bU, 0x3da1cb5599e11393U},
+	{0x6b059deab52ac378U, 0x629c7888f634ec1eU},
+	{0x559e17eef755692dU, 0x3549fa072b5d89b1U},
+	{0x447e798bf91120f1U, 0x1107fb38ef7e07c1U},
+	{0x6d9728dff4e834b5U, 0x01a65ec17f300c68U},
+	{0x57ac20b32a535d5dU, 0x4e1eb23465c009edU},
+	{0x46234d5c21dc4ab1U, 0x24e55b5d1e333b24U},
+	{0x70387bc69c93aab5U, 0x216ef894fd1ec506U},
+	{0x59c6c96bb076222aU, 0x4df2607730e56a6cU},
+	{0x47d23abc8d2b4e88U, 0x3e5b805f5a5121f0U},
+	{0x72e9f79415121740U, 0x63c59a322a1b697fU},
+	{0x5bee5fa9aa74df67U, 0x03047b5b54e2baccU},
+	{0x498b7fbaeec3e5ecU, 0x0269fc4910b5623dU},
+	{0x75abff917e063cacU, 0x6a432d41b45569fbU},
+	{0x5e2332dacb38308aU, 0x21cf5767c37787fcU},
+	{0x4b4f5be23c2cf3a1U, 0x67d912b9692c6ccaU},
+	{0x787ef969f9e185cfU, 0x595b5128a8471476U},
+	{0x60659454c7e79e3fU, 0x6115da86ed05a9f8U},
+	{0x4d1e1043d31fb1ccU, 0x4dab1538bd9e2193U},
+	{0x7b634d3951cc4fadU, 0x62ab552795c9cf52U},
+	{0x62b5d7610e3d0c8bU, 0x0222aa86116e3f75U},
+	{0x4ef7df80d830d6d5U, 0x4e822204dabe992aU},
+	{0x7e59659af38157bcU, 0x17369cd49130f510U},
+	{0x65145148c2cddfc9U, 0x5f5ee3dd40f3f740U},
+	{0x50dd0dd3cf0b196eU, 0x1918b64a9a5cc5cdU},
+	{0x40b0d7dca5a27abeU, 0x4746f83baeb09e3eU},
+	{0x678159610903f797U, 0x253e59f91780fd2fU},
+	{0x52cde11a6d9cc612U, 0x50feae60df9a6426U},
+	{0x423e4daebe1704dbU, 0x5a65584d7faeb685U},
+	{0x69fd4917968b3af9U, 0x10a226e265e4573bU},
+	{0x54caa0dfaba29594U, 0x0d4e8581eb1d1295U},
+	{0x43d54d7fbc821143U, 0x243ed134bc174211U},
+	{0x6c887bff94034ed2U, 0x06cae85460253682U},
+	{0x56d396661002a574U, 0x6bd586a9e6842b9bU},
+	{0x457611eb40021df7U, 0x09779eee52035616U},
+	{0x6f234fdeccd02ff1U, 0x5bf297e3b66bbcefU},
+	{0x58e90cb23d73598eU, 0x165bacb62b8963f3U},
+	{0x4720d6f4fdf5e13eU, 0x451623c4efa11cc2U},
+	{0x71ce24bb2fefcecaU, 0x3b569fa17f682e03U},
+	{0x5b0b5095bff30bd5U, 0x15dee61acc535803U},
+	{0x48d5da11665c0977U, 0x2b18b8157042accfU},
+	{0x74895ce8a3c6758bU, 0x5e8df355806aae18U},
+	{0x5d3ab0ba1c9ec46fU, 0x653e5c4466bbbe7aU},
+	{0x4a955a2e7d4bd059U, 0x3765169d1efc9861U},
+	{0x77555d172edfb3c2U, 0x256e8a94fe60f3cfU},
+	{0x5f777dac257fc301U, 0x6abed543feb3f63fU},
+	{0x4c5f97bceacc9c01U, 0x3bcbddcffef65e99U},
+	{0x7a328c6177adc668U, 0x5fac961997f0975bU},
+	{0x61c209e792f16b86U, 0x7fbd44e1465a12afU},
+	{0x4e34d4b9425abc6bU, 0x7fca9d810514dbbfU},
+	{0x7d21545b9d5dfa46U, 0x32ddc8ce6e87c5ffU},
+	{0x641aa9e2e44b2e9eU, 0x5be4a0a525396b32U},
+	{0x501554b5836f587eU, 0x7cb6e6ea842def5cU},
+	{0x4011109135f2ad32U, 0x30925255368b25e3U},
+	{0x6681b41b89844850U, 0x4db6ea21f0dea304U},
+	{0x52015ce2d469d373U, 0x57c5881b2718826aU},
+	{0x419ab0b576bb0f8fU, 0x5fd139af527a01efU},
+	{0x68f781225791b27fU, 0x4c81f5e550c3364aU},
+	{0x53f9341b79415b99U, 0x239b2b1dda35c508U},
+	{0x432dc3492dcde2e1U, 0x02e288e4ae916a6dU},
+	{0x6b7c6ba849496b01U, 0x516a74a1174f10aeU},
+	{0x55fd22ed076def34U, 0x4121f6e745d8da25U},
+	{0x44ca82573924bf5dU, 0x1a8192529e4714ebU},
+	{0x6e10d08b8ea1322eU, 0x5d9c1d50fd3e87ddU},
+	{0x580d73a2d880f4f2U, 0x17b01773fdcb9fe4U},
+	{0x4671294f139a5d8eU, 0x4626792997d61984U},
+	{0x70b50ee4ec2a2f4aU, 0x3d0a5b75bfbcf59fU},
+	{0x5a2a7250bcee8c3bU, 0x4a6eaf916630c47fU},
+	{0x4821f50d63f209c9U, 0x21f2260deb5a36ccU},
+	{0x736988156cb6760eU, 0x69837016455d247aU},
+	{0x5c546cddf091f80bU, 0x6e02c011d1175062U},
+	{0x49dd23e4c074c66fU, 0x719bccdb0dac404eU},
+	{0x762e9fd467213d7fU, 0x68f947c4e2ad33b0U},
+	{0x5e8bb3105280fdffU, 0x6d94396a4ef0f627U},
+	{0x4ba2f5a6a8673199U, 0x3e102deea58d91b9U},
+	{0x7904bc3dda3eb5c2U, 0x3019e3176f48e927U},
+	{0x60d09697e1cbc49bU, 0x4014b5ac590720ecU},
+	{0x4d73abacb4a303afU, 0x4cdd5e237a6c1a57U},
+	{0x7bec45e12104d2b2U, 0x47c8969f2a46908aU},
+	{0x63236b1a80d0a88eU, 0x6ca0787f5505406fU},
+	{0x4f4f88e200a6ed3fU, 0x0a19f9ff773766bfU},
+	{0x7ee5a7d0010b1531U, 0x5cf65ccbf1f23dfeU},
+	{0x6584864000d5aa8eU, 0x172b7d6ff4c1cb32U},
+	{0x5136d1cccd77bba4U, 0x78ef978cc3ce3c28U},
+	{0x40f8a7d70ac62fb7U, 0x13f2dfa3cfd83020U},
+	{0x67f43fbe77a37f8bU, 0x398499061959e699U},
+	{0x5329cc985fb5ffa2U, 0x6136e0d1ade18548U},
+	{0x4287d6e04c91994fU, 0x00f8b3daf181376dU},
+	{0x6a72f166e0e8f54bU, 0x1b27862b1c01f247U},
+	{0x5528c11f1a53f76fU, 0x2f52d1bc1667f506U},
+	{0x44209a7f48432c59U, 0x0c424163451ff738U},
+	{0x6d00f7320d3846f4U, 0x7a039bd208332526U},
+	{0x5733f8f4d76038c3U, 0x7b361641a028ea85U},
+	{0x45c32d90ac4cfa36U, 0x2f5e78348020bb9eU},
+	{0x6f9eaf4de07b29f0U, 0x4bca59ed99cdf8fcU},
+	{0x594bbf71806287f3U, 0x563b7b247b0b2d96U},
+	{0x476fcc5acd1b9ff6U, 0x11c92f50626f57acU},
+	{0x724c7a2ae1c5ccbdU, 0x02db7ee703e55912U},
+	{0x5b7061bbe7d17097U, 0x1be2cbec031de0dcU},
+	{0x4926b496530df3acU, 0x164f09899c17e716U},
+	{0x750aba8a1e7cb913U, 0x3d4b4275c68ca4f0U},
+	{0x5da22ed4e530940fU, 0x4aa29b916ba3b726U},
+	{0x4ae825771dc07672U, 0x6ee87c74561c9285U},
+	{0x77d9d58b62cd8a51U, 0x3173fa53bcfa8408U},
+	{0x5fe177a2b5713b74U, 0x278ffb7630c869a0U},
+	{0x4cb45fb55df42f90U, 0x1fa662c4f3d387b3U},
+	{0x7aba32bbc986b280U, 0x32a3d13b1fb8d91fU},
+	{0x622e8efca1388ecdU, 0x0ee9742f4c93e0e6U},
+	{0x4e8ba596e760723dU, 0x58bac3590a0fe71eU},
+	{0x7dac3c24a5671d2fU, 0x412ad228101971c9U},
+	{0x6489c9b6eab8e426U, 0x00ef0e8673478e3bU},
+	{0x506e3af8bbc71cebU, 0x1a58d86b8f6c71c9U},
+	{0x40582f2d6305b0bcU, 0x1513e0560c56c16eU},
+	{0x66f37eaf04d5e793U, 0x3b530089ad579be2U},
+	{0x525c6558d0ab1fa9U, 0x15dc006e2446164fU},
+	{0x41e384470d55b2edU, 0x5e4999f1b69e783fU},
+	{0x696c06d81555eb15U, 0x7d428fe92430c065U},
+	{0x54566be0111188deU, 0x31020cba835a3384U},
+	{0x4378564cda746d7eU, 0x5a680a2ecf7b5c69U},
+	{0x6bf3bd47c3ed7bfdU, 0x770cdd17b25efa42U},
+	{0x565c976c9cbdfccbU, 0x1270b0dfc1e59502U},
+	{0x4516df8a16fe63d5U, 0x5b8d5a4c9b1e10ceU},
+	{0x6e8aff4357fd6c89U, 0x127bc3adc4fce7b0U},
+	{0x586f329c466456d4U, 0x0ec96957d0ca52f3U},
+	{0x46bf5bb038504576U, 0x3f07877973d50f29U},
+	{0x71322c4d26e6d58aU, 0x31a5a58f1fbb4b75U},
+	{0x5a8e89d75252446eU, 0x5aeaead8e62f6f91U},
+	{0x487207df750e9d25U, 0x2f22557a51bf8c74U},
+	{0x73e9a63254e42ea2U, 0x1836ef2a1c65ad86U},
+	{0x5cbaeb5b771cf21bU, 0x2cf8bf54e3848ad2U},
+	{0x4a2f22af927d8e7cU, 0x23fa32aa4f9d3bdbU},
+	{0x76b1d118ea627d93U, 0x5329eaaa18fb92f8U},
+	{0x5ef4a74721e86476U, 0x0f54bbbb472fa8c6U},
+	{0x4bf6ec38e7ed1d2bU, 0x25dd62fc38f2ed6cU},
+	{0x798b138e3fe1c845U, 0x22fbd1938e517bdfU},
+	{0x613c0fa4ffe7d36aU, 0x4f2fdadc71dac97fU},
+	{0x4dc9a61d998642bbU, 0x58f3157d27e23accU},
+	{0x7c75d695c2706ac5U, 0x74b82261d969f7adU},
+	{0x63917877cec0556bU, 0x10934eb4adee5fbeU},
+	{0x4fa793930bcd1122U, 0x4075d8908b251965U},
+	{0x7f7285b812e1b504U, 0x00bc8db411d4f56eU},
+	{0x65f537c675815d9cU, 0x66fd3e29a7dd9125U},
+	{0x5190f96b91344ae3U, 0x6bfdcb54864ada84U},
+	{0x4140c78940f6a24fU, 0x6ffe3c439ea2486aU},
+	{0x6867a5a867f103b2U, 0x7ffd2d38fdd073dcU},
+	{0x53861e2053273628U, 0x6664242d97d9f64aU},
+	{0x42d1b1b375b8f820U, 0x51e9b68adfe191d5U},
+	{0x6ae91c5255f4c034U, 0x1ca924116635b621U},
+	{0x558749db77f70029U, 0x63ba83411e915e81U},
+	{0x446c3b15f9926687U, 0x6962029a7edab201U},
+	{0x6d79f82328ea3da6U, 0x0f03375d97c45001U},
+	{0x5794c6828721caebU, 0x259c2c4adfd04001U},
+	{0x46109eced2816f22U, 0x5149bd08b30d0001U},
+	{0x701a97b150cf1837U, 0x3542c80deb480001U},
+	{0x59aedfc10d7279c5U, 0x7768a00b22a00001U},
+	{0x47bf19673df52e37U, 0x79208008e8800001U},
+	{0x72cb5bd86321e38cU, 0x5b67334174000001U},
+	{0x5bd5e313828182d6U, 0x7c528f6790000001U},
+	{0x4977e8dc68679bdfU, 0x16a872b940000001U},
+	{0x758ca7c70d7292feU, 0x5773eac200000001U},
+	{0x5e0a1fd271287598U, 0x45f6556800000001U},
+	{0x4b3b4ca85a86c47aU, 0x04c5112000000001U},
+	{0x785ee10d5da46d90U, 0x07a1b50000000001U},
+	{0x604be73de4838ad9U, 0x52e7c40000000001U},
+	{0x4d0985cb1d3608aeU, 0x0f1fd00000000001U},
+	{0x7b426fab61f00de3U, 0x31cc800000000001U},
+	{0x629b8c891b267182U, 0x5b0a000000000001U},
+	{0x4ee2d6d415b85aceU, 0x7c08000000000001U},
+	{0x7e37be2022c0914bU, 0x1340000000000001U},
+	{0x64f964e68233a76fU, 0x2900000000000001U},
+	{0x50c783eb9b5c85f2U, 0x5400000000000001U},
+	{0x409f9cbc7c4a04c2U, 0x1000000000000001U},
+	{0x6765c793fa10079dU, 0x0000000000000001U},
+	{0x52b7d2dcc80cd2e4U, 0x0000000000000001U},
+	{0x422ca8b0a00a4250U, 0x0000000000000001U},
+	{0x69e10de76676d080U, 0x0000000000000001U},
+	{0x54b40b1f852bda00U, 0x0000000000000001U},
+	{0x43c33c1937564800U, 0x0000000000000001U},
+	{0x6c6b935b8bbd4000U, 0x0000000000000001U},
+	{0x56bc75e2d6310000U, 0x0000000000000001U},
+	{0x4563918244f40000U, 0x0000000000000001U},
+	{0x6f05b59d3b200000U, 0x0000000000000001U},
+	{0x58d15e1762800000U, 0x0000000000000001U},
+	{0x470de4df82000000U, 0x0000000000000001U},
+	{0x71afd498d0000000U, 0x0000000000000001U},
+	{0x5af3107a40000000U, 0x0000000000000001U},
+	{0x48c2739500000000U, 0x0000000000000001U},
+	{0x746a528800000000U, 0x0000000000000001U},
+	{0x5d21dba000000000U, 0x0000000000000001U},
+	{0x4a817c8000000000U, 0x0000000000000001U},
+	{0x7735940000000000U, 0x0000000000000001U},
+	{0x5f5e100000000000U, 0x0000000000000001U},
+	{0x4c4b400000000000U, 0x0000000000000001U},
+	{0x7a12000000000000U, 0x0000000000000001U},
+	{0x61a8000000000000U, 0x0000000000000001U},
+	{0x4e20000000000000U, 0x0000000000000001U},
+	{0x7d00000000000000U, 0x0000000000000001U},
+	{0x6400000000000000U, 0x0000000000000001U},
+	{0x5000000000000000U, 0x0000000000000001U},
+	{0x4000000000000000U, 0x0000000000000001U},
+	{0x6666666666666666U, 0x3333333333333334U},
+	{0x51eb851eb851eb85U, 0x0f5c28f5c28f5c29U},
+	{0x4189374bc6a7ef9dU, 0x5916872b020c49bbU},
+	{0x68db8bac710cb295U, 0x74f0d844d013a92bU},
+	{0x53e2d6238da3c211U, 0x43f3e0370cdc8755U},
+	{0x431bde82d7b634daU, 0x698fe69270b06c44U},
+	{0x6b5fca6af2bd215eU, 0x0f4ca41d811a46d4U},
+	{0x55e63b88c230e77eU, 0x3f70834acdae9f10U},
+	{0x44b82fa09b5a52cbU, 0x4c5a02a23e254c0dU},
+	{0x6df37f675ef6eadfU, 0x2d5cd10396a21347U},
+	{0x57f5ff85e592557fU, 0x3de3da69454e75d3U},
+	{0x465e6604b7a84465U, 0x7e4fe1edd10b9175U},
+	{0x709709a125da0709U, 0x4a19697c81ac1befU},
+	{0x5a126e1a84ae6c07U, 0x54e1213067bce326U},
+	{0x480ebe7b9d58566cU, 0x43e74dc052fd8285U},
+	{0x734aca5f6226f0adU, 0x530baf9a1e626a6dU},
+	{0x5c3bd5191b525a24U, 0x426fbfae7eb521f1U},
+	{0x49c97747490eae83U, 0x4ebfcc8b9890e7f4U},
+	{0x760f253edb4ab0d2U, 0x4acc7a78f41b0cbaU},
+	{0x5e72843249088d75U, 0x223d2ec729af3d62U},
+	{0x4b8ed0283a6d3df7U, 0x34fdbf05baf29781U},
+	{0x78e480405d7b9658U, 0x54c931a2c4b758cfU},
+	{0x60b6cd004ac94513U, 0x5d6dc14f03c5e0a5U},
+	{0x4d5f0a66a23a9da9U, 0x31249aa59c9e4d51U},
+	{0x7bcb43d769f762a8U, 0x4ea0f76f60fd4882U},
+	{0x63090312bb2c4eedU, 0x254d92bf80caa068U},
+	{0x4f3a68dbc8f03f24U, 0x1dd7a89933d54d20U},
+	{0x7ec3daf941806506U, 0x62f2a75b86221500U},
+	{0x65697bfa9acd1d9fU, 0x025bb91604e810cdU},
+	{0x51212ffbaf0a7e18U, 0x684960de6a5340a4U},
+	{0x40e7599625a1fe7aU, 0x203ab3e521dc33b6U},
+	{0x67d88f56a29cca5dU, 0x19f7863b696052bdU},
+	{0x5313a5dee87d6eb0U, 0x7b2c6b62bab37564U},
+	{0x42761e4bed31255aU, 0x2f56bc4efbc2c450U},
+	{0x6a5696dfe1e83bc3U, 0x655793b192d13a1aU},
+	{0x5512124cb4b9c969U, 0x377942f475742e7bU},
+	{0x440e750a2a2e3abaU, 0x5f9435905df68b96U},
+	{0x6ce3ee76a9e3912aU, 0x65b9ef4d63241289U},
+	{0x571cbec554b60dbbU, 0x6afb25d782834207U},
+	{0x45b0989ddd5e7163U, 0x08c8eb12cecf6806U},
+	{0x6f80f42fc8971bd1U, 0x5adb11b7b14bd9a3U},
+	{0x5933f68ca078e30eU, 0x157c0e2c8dd647b5U},
+	{0x475cc53d4d2d8271U, 0x5dfcd823a4ab6c91U},
+	{0x722e086215159d82U, 0x632e269f6ddf141bU},
+	{0x5b5806b4ddaae468U, 0x4f581ee5f17f4349U},
+	{0x49133890b1558386U, 0x72ace584c1329c3bU},
+	{0x74eb8db44eef38d7U, 0x6aae3c079b842d2aU},
+	{0x5d893e29d8bf60acU, 0x5558300616035755U},
+	{0x4ad431bb13cc4d56U, 0x7779c004de6912abU},
+	{0x77b9e92b52e07bbeU, 0x258f99a163db5111U},
+	{0x5fc7edbc424d2fcbU, 0x37a614811caf740dU},
+	{0x4c9ff163683dbfd5U, 0x7951aa00e3bf900bU},
+	{0x7a998238a6c932efU, 0x754f7667d2cc19abU},
+	{0x6214682d523a8f26U, 0x2aa5f8530f09ae22U},
+	{0x4e76b9bddb620c1eU, 0x55519375a5a1581bU},
+	{0x7d8ac2c95f034697U, 0x3bb5b8bc3c3559c5U},
+	{0x646f023ab2690545U, 0x7c9160969691149eU},
+	{0x5058ce955b87376bU, 0x16dab3ababa743b2U},
+	{0x40470baaaf9f5f88U, 0x78aef622efb902f5U},
+	{0x66d812aab29898dbU, 0x0de4bd04b2c19e54U},
+	{0x524675555bad4715U, 0x57ea30d08f014b76U},
+	{0x41d1f7777c8a9f44U, 0x4654f3da0c01092cU},
+	{0x694ff258c7443207U, 0x23bb1fc346680eacU},
+	{0x543ff513d29cf4d2U, 0x4fc8e635d1ecd88aU},
+	{0x43665da9754a5d75U, 0x263a51c4a7f0ad3bU},
+	{0x6bd6fc425543c8bbU, 0x56c3b607731aaec4U},
+	{0x5645969b77696d62U, 0x789c919f8f488bd0U},
+	{0x4504787c5f878ab5U, 0x46e3a7b2d906d640U},
+	{0x6e6d8d93cc0c1122U, 0x3e390c515b3e239aU},
+	{0x5857a4763cd6741bU, 0x4b60d6a77c31b615U},
+	{0x46ac8391ca4529afU, 0x55e7121f968e2b44U},
+	{0x711405b6106ea919U, 0x0971b698f0e3786dU},
+	{0x5a766af80d255414U, 0x078e2bad8d82c6bdU},
+	{0x485ebbf9a41ddcdcU, 0x6c71bc8ad79bd231U},
+	{0x73cac65c39c96161U, 0x2d82c7448c2c8382U},
+	{0x5ca23849c7d44de7U, 0x3e023903a356cf9bU},
+	{0x4a1b603b06437185U, 0x7e682d9c82abd949U},
+	{0x76923391a39f1c09U, 0x4a4048fa6aac8edbU},
+	{0x5edb5c7482e5b007U, 0x55003a61eef07249U},
+	{0x4be2b05d35848cd2U, 0x773361e7f259f507U},
+	{0x796ab3c855a0e151U, 0x3eb89ca6508fee71U},
+	{0x6122296d114d810dU, 0x7efa16eb73a6585bU},
+	{0x4db4edf0daa4673eU, 0x3261abef8fb846afU},
+	{0x7c54afe7c43a3ecaU, 0x1d691318e5f3a44bU},
+	{0x6376f31fd02e98a1U, 0x64540f471e5c836fU},
+	{0x4f925c1973587a1bU, 0x0376729f4b7d35f3U},
+	{0x7f50935bebc0c35eU, 0x38bd84321261efebU},
+	{0x65da0f7cbc9a35e5U, 0x13cad0280eb4bfefU},
+	{0x517b3f96fd482b1dU, 0x5ca240200bc3ccbfU},
+	{0x412f66126439bc17U, 0x63b50019a3030a33U},
+	{0x684bd683d38f9359U, 0x1f88002904d1a9eaU},
+	{0x536fdecfdc72dc47U, 0x32d3335403daee55U},
+	{0x42bfe57316c249d2U, 0x5bdc291003158b77U},
+	{0x6acca251be03a951U, 0x12f9db4cd1bc1258U},
+	{0x557081dafe695440U, 0x7594af70a7c9a847U},
+	{0x445a017bfebaa9cdU, 0x4476f2c0863aed06U},
+	{0x6d5ccf2ccac442e2U, 0x3a57eacda3917b3cU},
+	{0x577d728a3bd03581U, 0x7b7988a482dac8fdU},
+	{0x45fdf53b630cf79bU, 0x15fad3b6cf156d97U},
+	{0x6ffcbb923814bf5eU, 0x565e1f8ae4ef15beU},
+	{0x5996fc74f9aa32b2U, 0x11e4e608b725aaffU},
+	{0x47abfd2a6154f55bU, 0x27ea51a0928488ccU},
+	{0x72acc843ceee555eU, 0x7310829a84074146U},
+	{0x5bbd6d030bf1dde5U, 0x42739baed005cdd2U},
+	{0x49645735a327e4b7U, 0x4ec2e2f24004a4a8U},
+	{0x756d5855d1d96df2U, 0x4ad16b1d333aa10cU},
+	{0x5df11377db1457f5U, 0x2241227dc2954da3U},
+	{0x4b2742c648dd132aU, 0x4e9a81fe35443e1cU},
+	{0x783ed13d4161b844U, 0x175d9cc9eed39694U},
+	{0x603240fdcde7c69cU, 0x7917b0a18bdc7876U},
+	{0x4cf500cb0b1fd217U, 0x1412f3b46fe39392U},
+	{0x7b219ade7832e9beU, 0x535185ed7fd285b6U},
+	{0x628148b1f9c25498U, 0x42a79e57997537c5U},
+	{0x4ecdd3c1949b76e0U, 0x3552e512e12a9304U},
+	{0x7e161f9c20f8be33U, 0x6eeb081e3510eb39U},
+	{0x64de7fb01a609829U, 0x3f226ce4f740bc2eU},
+	{0x50b1ffc0151a1354U, 0x3281f0b72c33c9beU},
+	{0x408e66334414dc43U, 0x42018d5f568fd498U},
+	{0x674a3d1ed354939fU, 0x1ccf48988a7fba8dU},
+	{0x52a1ca7f0f76dc7fU, 0x30a5d3ad3b99620bU},
+	{0x421b0865a5f8b065U, 0x73b7dc8a96144e6fU},
+	{0x69c4da3c3cc11a3cU, 0x52bfc7442353b0b1U},
+	{0x549d7b6363cdae96U, 0x756639034f7626f4U},
+	{0x43b12f82b63e2545U, 0x4451c735d92b525dU},
+	{0x6c4eb26abd303ba2U, 0x3a1c71efc1deea2eU},
+	{0x56a55b889759c94eU, 0x61b05b2634b254f2U},
+	{0x45511606df7b0772U, 0x1af37c1e908eaa5bU},
+	{0x6ee8233e325e7250U, 0x2b1f2cfdb41776f8U},
+	{0x58b9b5cb5b7ec1d9U, 0x6f4c23fe29ac5f2dU},
+	{0x46faf7d5e2cbce47U, 0x72a34ffe87bd18f1U},
+	{0x71918c896adfb073U, 0x04387ffda5fb5b1bU},
+	{0x5adad6d4557fc05cU, 0x0360666484c915afU},
+	{0x48af1243779966b0U, 0x02b3851d3707448cU},
+	{0x744b506bf28f0ab3U, 0x1dec082ebe720746U},
+	{0x5d090d2328726ef5U, 0x64bcd358985b3905U},
+	{0x4a6da41c205b8bf7U, 0x6a30a913ad15c738U},
+	{0x7715d36033c5acbfU, 0x5d1aa81f7b560b8cU},
+	{0x5f44a919c3048a32U, 0x7daeece5fc44d609U},
+	{0x4c36edae359d3b5bU, 0x7e258a51969d7808U},
+	{0x79f17c49ef61f893U, 0x16a276e8f0fbf33fU},
+	{0x618dfd07f2b4c6dcU, 0x121b9253f3fcc299U},
+	{0x4e0b30d328909f16U, 0x41afa84329970214U},
+	{0x7cdeb4850db431bdU, 0x4f7f739ea8f19cedU},
+	{0x63e55d373e29c164U, 0x3f99294bba5ae3f1U},
+	{0x4feab0f8fe87cde9U, 0x7fadbaa2fb7be98dU},
+	{0x7fdde7f4ca72e30fU, 0x7f7c5dd1925fdc15U},
+	{0x664b1ff7085be8d9U, 0x4c637e4141e649abU},
+	{0x51d5b32c06afed7aU, 0x704f983434b83aefU},
+	{0x4177c2899ef32462U, 0x26a6135cf6f9c8bfU},
+	{0x68bf9da8fe51d3d0U, 0x3dd685618b294132U},
+	{0x53cc7e20cb74a973U, 0x4b12044e08edcdc2U},
+	{0x4309fe80a2c3bac2U, 0x6f419d0b3a57d7ceU},
+	{0x6b4330cdd1392ad1U, 0x320294dec3bfbfb0U},
+	{0x55cf5a3e40fa88a7U, 0x419baa4bcfcc995aU},
+	{0x44a5e1cb672ed3b9U, 0x1ae2eea30ca3ade1U},
+	{0x6dd636123eb152c1U, 0x77d17dd1add2afcfU},
+	{0x57de91a832277567U, 0x797464a7be42263fU},
+	{0x464ba7b9c1b92ab9U, 0x4790508631ce84ffU},
+	{0x70790c5c6928445cU, 0x0c1a1a704fb0d4ccU},
+	{0x59fa7049edb9d049U, 0x567b4859d95a43d6U},
+	{0x47fb8d07f161736eU, 0x11fc39e17aae9cabU},
+	{0x732c14d98235857dU, 0x032d2968c44a9445U},
+	{0x5c2343e134f79dfdU, 0x4f575453d03ba9d1U},
+	{0x49b5cfe75d92e4caU, 0x72ac4376402fbb0eU},
+	{0x75efb30bc8eb07abU, 0x0446d256cd192b49U},
+	{0x5e595c096d88d2efU, 0x1d0575123dadbc3aU},
+	{0x4b7ab0078ad3dbf2U, 0x4a6ac40e97be302fU},
+	{0x78c44cd8de1fc650U, 0x771139b0f2c9e6b1U},
+	{0x609d0a4718196b73U, 0x78da948d8f07ebc1U},
+	{0x4d4a6e9f467abc5cU, 0x60aedd3e0c065634U},
+	{0x7baa4a9870c46094U, 0x344afb9679a3bd20U},
+	{0x62eea2138d69e6ddU, 0x103bfc78614fca80U},
+	{0x4f254e760abb1f17U, 0x26966393810ca200U},
+	{0x7ea21723445e9825U, 0x2423d2859b476999U},
+	{0x654e78e9037ee01dU, 0x69b642047c392148U},
+	{0x510b93ed9c658017U, 0x6e2b680396941aa0U},
+	{0x40d60ff149eaccdfU, 0x71bc53361210154dU},
+	{0x67bce64edcaae166U, 0x1c6085235019bbaeU},
+	{0x52fd850be3bbe784U, 0x7d1a041c40149625U},
+	{0x42646a6fe9631f9dU, 0x4a7b367d0010781dU},
+	{0x6a3a43e642383295U, 0x5d91f0c8001a59c8U},
+	{0x54fb698501c68edeU, 0x17a7f3d3334847d4U},
+	{0x43fc546a67d20be4U, 0x79532975c2a03976U},
+	{0x6cc6ed770c83463bU, 0x0eeb75893766c256U},
+	{0x57058ac5a39c382fU, 0x25892ad42c523512U},
+	{0x459e089e1c7cf9bfU, 0x37a0ef102374f742U},
+	{0x6f6340fcfa618f98U, 0x59017e8038bb2536U},
+	{0x591c33fd951ad946U, 0x7a67986693c8ea91U},
+	{0x4749c33144157a9fU, 0x151fad1edca0bba8U},
+	{0x720f9eb539bbf765U, 0x0832ae97c76792a5U},
+	{0x5b3fb22a94965f84U, 0x068ef21305ec7551U},
+	{0x48ffc1bbaa11e603U, 0x1ed8c1a8d189f774U},
+	{0x74cc692c434fd66bU, 0x4af4690e1c0ff253U},
+	{0x5d705423690cab89U, 0x225d20d816732843U},
+	{0x4ac0434f873d5607U, 0x35174d79ab8f5369U},
+	{0x779a054c0b955672U, 0x21bee25c45b21f0eU},
+	{0x5fae6aa33c77785bU, 0x3498b5169e2818d8U},
+	{0x4c8b888296c5f9e2U, 0x5d46f7454b534713U},
+	{0x7a78da6a8ad65c9dU, 0x7ba4bed545520b52U},
+	{0x61fa48553bdeb07eU, 0x2fb6ff110441a2a8U},
+	{0x4e61d37763188d31U, 0x72f8cc0d9d014eedU},
+	{0x7d6952589e8daeb6U, 0x1e5ae015c80217e1U},
+	{0x645441e07ed7bef8U, 0x1848b344a001acb4U},
+	{0x504367e6cbdfcbf9U, 0x603a2903b3348a2aU},
+	{0x4035ecb8a3196ffbU, 0x002e873628f6d4eeU},
+	{0x66bcadf43828b32bU, 0x19e40b89db2487e3U},
+	{0x52308b29c686f5bcU, 0x14b66fa17c1d3983U},
+	{0x41c06f549ed25e30U, 0x1091f2e7967dc79cU},
+	{0x6933e554315096b3U, 0x341cb7d8f0c93f5fU},
+	{0x542984435aa6def5U, 0x767d5fe0c0a0ff80U},
+	{0x435469cf7bb8b25eU, 0x2b977fe70080cc66U},
+	{0x6bba42e592c11d63U, 0x5f58cca4cd9ae0a3U},
+	{0x562e9beadbcdb11cU, 0x4c470a1d7148b3b6U},
+	{0x44f216557ca48db0U, 0x3d05a1b1276d5c92U},
+	{0x6e5023bbfaa0e2b3U, 0x7b3c35e83f1560e9U},
+	{0x58401c96621a4ef6U, 0x2f635e5365aab3edU},
+	{0x4699b0784e7b725eU, 0x591c4b75eaeef658U},
+	{0x70f5e726e3f8b6fdU, 0x74fa125644b18a26U},
+	{0x5a5e5285832d5f31U, 0x43fb41de9d5ad4ebU},
+	{0x484b75379c244c27U, 0x4ffc34b2177bdd89U},
+	{0x73abeebf603a1372U, 0x4cc6bab68bf96274U},
+	{0x5c898bcc4cfb42c2U, 0x0a38955ed6611b90U},
+	{0x4a07a309d72f689bU, 0x21c6dde5784dafa7U},
+	{0x76729e762518a75eU, 0x693e2fd58d49190bU},
+	{0x5ec2185e8413b918U, 0x5431bfde0aa0e0d5U},
+	{0x4bce79e536762dadU, 0x29c1664b3bb3e711U},
+	{0x794a5ca1f0bd15e2U, 0x0f9bd6dec5eca4e8U},
+	{0x61084a1b26fdab1bU, 0x2616457f04bd50baU},
+	{0x4da03b48ebfe227cU, 0x1e783798d09773c8U},
+	{0x7c33920e46636a60U, 0x30c058f480f252d9U},
+	{0x635c74d8384f884dU, 0x0d66ad9067284247U},
+	{0x4f7d2a469372d370U, 0x711ef14052869b6cU},
+	{0x7f2eaa0a85848581U, 0x34fe4ecd50d75f14U},
+	{0x65beee6ed136d134U, 0x2a650bd773df7f43U},
+	{0x51658b8bda9240f6U, 0x551da312c319329cU},
+	{0x411e093caedb672bU, 0x5db14f4235adc217U},
+	{0x68300ec77e2bd845U, 0x7c4ee536bc49368aU},
+	{0x5359a56c64efe037U, 0x7d0bea92303a9208U},
+	{0x42ae1df050bfe693U, 0x173cbba8269541a0U},
+	{0x6ab02fe6e79970ebU, 0x3ec792a6a422029aU},
+	{0x5559bfebec7ac0bcU, 0x3239421ee9b4cee1U},
+	{0x4447ccbcbd2f0096U, 0x5b6101b25490a581U},
+	{0x6d3fadfac84b3424U, 0x2bce691d541aa268U},
+	{0x576624c8a03c29b6U, 0x563eba7ddce21b87U},
+	{0x45eb50a08030215eU, 0x78322ecb171b4939U},
+	{0x6fdee76733803564U, 0x59e9e47824f87527U},
+	{0x597f1f85c2ccf783U, 0x6187e9f9b72d2a86U},
+	{0x4798e6049bd72c69U, 0x346cbb2e2c242205U},
+	{0x728e3cd42c8b7a42U, 0x20adf849e039d007U},
+	{0x5ba4fd768a092e9bU, 0x33be603b19c7d99fU},
+	{0x4950cac53b3a8bafU, 0x42feb3627b0647b3U},
+	{0x754e113b91f745e5U, 0x5197856a5e7072b8U},
+	{0x5dd80dc941929e51U, 0x27ac6abb7ec05bc6U},
+	{0x4b133e3a9adbb1daU, 0x52f05562cbcd1638U},
+	{0x781ec9f75e2c4fc4U, 0x1e4d556adfae89f3U},
+	{0x6018a192b1bd0c9cU, 0x7ea444557fbed4c3U},
+	{0x4ce0814227ca707dU, 0x4bb69d1132ff109cU},
+	{0x7b00ced03faa4d95U, 0x5f8a94e851981a93U},
+	{0x62670bd9cc883e11U, 0x32d543ed0e134875U},
+	{0x4eb8d647d6d364daU, 0x5bddcff0d80f6d2bU},
+	{0x7df48a0c8aebd491U, 0x12fc7fe7c018aeabU},
+	{0x64c3a1a3a25643a7U, 0x28c9ffec99ad5889U},
+	{0x509c814fb511cfb9U, 0x0707fff07af113a1U},
+	{0x407d343fc40e3fc7U, 0x1f39998d2f2742e7U},
+	{0x672eb9ffa016cc71U, 0x7ec28f484b7204a4U},
+	{0x528bc7ffb345705bU, 0x189ba5d36f8e6a1dU},
+	{0x42096ccc8f6ac048U, 0x7a161e42bfa521b1U},
+	{0x69a8ae1418aacd41U, 0x435696d132a1cf81U},
+	{0x5486f1a9ad557101U, 0x1c454574288172ceU},
+	{0x439f27baf1112734U, 0x169dd129ba0128a5U},
+	{0x6c31d92b1b4ea520U, 0x242fb50f9001daa1U},
+	{0x568e4755af721db3U, 0x368c90d940017bb4U},
+	{0x453e9f77bf8e7e29U, 0x120a0d7a999ac95dU},
+	{0x6eca98bf98e3fd0eU, 0x50101590f5c47561U},
+	{0x58a213cc7a4ffda5U, 0x26734473f7d05de8U},
+	{0x46e80fd6c83ffe1dU, 0x6b8f69f65fd9e4b9U},
+	{0x71734c8ad9fffcfcU, 0x45b24323cc8fd45cU},
+	{0x5ac2a3a247fffd96U, 0x6af502830a0ca9e3U},
+	{0x489bb61b6ccccadfU, 0x08c402026e7087e9U},
+	{0x742c569247ae1164U, 0x746cd003e3e73fdbU},
+	{0x5cf04541d2f1a783U, 0x76bd73364fec3315U},
+	{0x4a59d101758e1f9cU, 0x5efdf5c50cbcf5abU},
+	{0x76f61b3588e365c7U, 0x4b2fefa1adfb22abU},
+	{0x5f2b48f7a0b5eb06U, 0x08f3261af195b555U},
+	{0x4c22a0c61a2b226bU, 0x20c284e25ade2aabU},
+	{0x79d1013cf6ab6a45U, 0x1ad0d49d5e304444U},
+	{0x617400fd9222bb6aU, 0x48a7107de4f369d0U},
+	{0x4df6673141b562bbU, 0x53b8d9fe50c2bb0dU},
+	{0x7cbd71e869223792U, 0x52c15cca1ad12b48U},
+	{0x63cac186ba81c60eU, 0x75677d6e7bda8906U},
+	{0x4fd5679efb9b04d8U, 0x5dec645863153a6cU},
+	{0x7fbbd8fe5f5e6e27U, 0x497a3a2704eec3dfU},
+};
+
+constexpr static char const num_digits[200] =
+	"00010203040506070809101112131415161718192021222324"
+	"25262728293031323334353637383940414243444546474849"
+	"50515253545556575859606162636465666768697071727374"
+	"75767778798081828384858687888990919293949596979899";
+
+constexpr static double const num_exact[23] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+	1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+	1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static const_inline bool
+num_digit (uint8_t c)
+{
+	return (unsigned)(c - '0') < 10U;
+}
+
+/**
+ * @brief Full 64 by 64-bit multiplication.
+ *
+ * @return High half of the product. The low half goes to @p lo.
+ */
+nonnull_in()
+static force_inline uint64_t
+num_mul (uint64_t  a,
+         uint64_t  b,
+         uint64_t *lo)
+{
+#if defined(__SIZEOF_INT128__)
+	__extension__ typedef unsigned __int128 u128;
+	u128 r = (u128)a * b;
+	*lo = (uint64_t)r;
+	return (uint64_t)(r >> 64U);
+#else
+	uint64_t al = a & UINT32_MAX, ah = a >> 32U;
+	uint64_t bl = b & UINT32_MAX, bh = b >> 32U;
+	uint64_t ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+	uint64_t mid = (ll >> 32U) + (lh & UINT32_MAX) + (hl & UINT32_MAX);
+	*lo = (mid << 32U) | (ll & UINT32_MAX);
+	return hh + (lh >> 32U) + (hl >> 32U) + (mid >> 32U);
+#endif /* __SIZEOF_INT128__ */
+}
+
+/**
+ * @brief Accumulate a run of digits.
+ *
+ * Eight digits at a time are checked and converted with SWAR
+ * arithmetic on little-endian targets.
+ *
+ * @return Index of the first non-digit at or after @p i.
+ */
+nonnull_in()
+static force_inline size_t
+num_run (uint8_t const *s,
+         size_t         i,
+         size_t         len,
+         uint64_t      *w)
+{
+	constexpr uint64_t ones = UINT64_C(0x0101010101010101);
+	uint64_t v = *w;
+
+	for (; __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ &&
+	       len - i >= 8U; i += 8U) {
+		uint64_t x;
+		__builtin_memcpy(&x, &s[i], 8U);
+		if (((x & (ones * 0xf0U)) |
+		     (((x + ones * 0x06U) & (ones * 0xf0U)) >> 4U)) != ones * 0x33U)
+			break;
+		x -= ones * '0';
+		x = x * 10U + (x >> 8U);
+		x = ((x & UINT64_C(0x000000ff000000ff)) *
+		     (UINT64_C(100) + (UINT64_C(1000000) << 32U)) +
+		     ((x >> 16U) & UINT64_C(0x000000ff000000ff)) *
+		     (UINT64_C(1) + (UINT64_C(10000) << 32U))) >> 32U;
+		v = v * 100000000U + x;
+	}
+
+	for (; i < len && num_digit(s[i]); ++i)
+		v = v * 10U + (s[i] - '0');
+
+	*w = v;
+	return i;
+}
+
+/**
+ * @brief Convert w * 10^q to the nearest double with the Eisel-Lemire
+ *        algorithm.
+ *
+ * @param w Significand, nonzero.
+ * @param q Power of ten, from -342 to 308.
+ * @param v Result.
+ * @return `false` if the rounding couldn't be decided.
+ */
+nonnull_in()
+static bool
+num_lemire (uint64_t  w,
+            int64_t   q,
+            double   *v)
+{
+	int lz = __builtin_clzll(w);
+	w <<= lz;
+
+	uint64_t const *p = num_pow5[q + 342];
+	uint64_t lo, hi = num_mul(w, p[0], &lo);
+
+	if ((hi & 0x1ffU) == 0x1ffU) {
+		uint64_t y, x = num_mul(w, p[1], &y);
+		lo += x;
+		hi += x > lo;
+		if (lo == UINT64_MAX && (q < -27 || q > 55))
+			return false;
+	}
+
+	int up = (int)(hi >> 63U);
+	uint64_t m = hi >> (up + 9);
+	int64_t e = ((217706 * q) >> 16) + 63 + up - lz + 1023;
+
+	if (e <= 0) {
+		if (1 - e >= 64) {
+			*v = 0.0;
+			return true;
+		}
+		m >>= 1 - e;
+		m += m & 1U;
+		m >>= 1U;
+		e = (int64_t)(m >> 52U);
+	} else {
+		/* A product ending in zeros may be an exact tie, which
+		 * must round to even instead of up. */
+		if (lo <= 1U && q >= -4 && q <= 23 && (m & 3U) == 1U &&
+		    m << (up + 9) == hi)
+			m &= ~UINT64_C(1);
+		m += m & 1U;
+		m >>= 1U;
+		if (m >> 53U) {
+			m = UINT64_C(1) << 52U;
+			++e;
+		}
+		if (e >= 0x7ff) {
+			m = 0;
+			e = 0x7ff;
+		}
+	}
+
+	uint64_t bits = (m & ((UINT64_C(1) << 52U) - 1U)) | (uint64_t)e << 52U;
+	__builtin_memcpy(v, &bits, sizeof *v);
+	return true;
+}
+
+/**
+ * @brief Convert w * 10^q to a double.
+ *
+ * @param w Significand of at most 19 digits.
+ * @param q Power of ten.
+ * @param v Result.
+ * @return `false` if the conversion wasn't exact enough to decide.
+ */
+nonnull_in()
+static bool
+num_decimal (uint64_t  w,
+             int64_t   q,
+             double   *v)
+{
+	if (!w || q < -342) {
+		*v = 0.0;
+		return true;
+	}
+
+	if (q > 308) {
+		*v = __builtin_inf();
+		return true;
+	}
+
+	if (w <= UINT64_C(1) << 53U && q >= -22 && q <= 22) {
+		*v = q < 0 ? (double)w / num_exact[-q] : (double)w * num_exact[q];
+		return true;
+	}
+
+	return num_lemire(w, q, v);
+}
+
+/**
+ * @brief Convert a number too long or too ambiguous for the fast paths.
+ *
+ * @param s   Number without a sign.
+ * @param len Length of @p s.
+ * @param v   Result.
+ * @return 0 on success, otherwise an error code.
+ */
+nonnull_in()
+static int
+num_slow (uint8_t const *s,
+          size_t         len,
+          double        *v)
+{
+	char buf[64];
+	char *p = len < sizeof buf ? buf : malloc(len + 1U);
+	if (!p)
+		return errno;
+
+	__builtin_memcpy(p, s, len);
+	p[len] = '\0';
+
+	*v = strtod(p, nullptr);
+	if (p != buf)
+		free(p);
+
+	return 0;
+}
+
+int
+num_parse (uint8_t const *s,
+           size_t         len,
+           size_t        *end,
+           struct num    *v)
+{
+	size_t i = 0;
+	bool neg = len && s[0] == '-';
+	i += neg;
+
+	if (i == len || !num_digit(s[i])) {
+		*end = i;
+		return EBADMSG;
+	}
+
+	size_t a = i;
+	uint64_t w = 0;
+	i = s[i] == '0' ? i + 1U : num_run(s, i, len, &w);
+	size_t nd = i - a;
+	size_t nf = 0;
+	bool flt = false;
+
+	if (i < len && s[i] == '.') {
+		if (++i == len || !num_digit(s[i])) {
+			*end = i;
+			return EBADMSG;
+		}
+		size_t f = i;
+		i = num_run(s, i, len, &w);
+		nf = i - f;
+		flt = true;
+	}
+
+	int64_t x = 0;
+	if (i < len && (s[i] | 0x20U) == 'e') {
+		bool minus = false;
+		if (++i < len && (s[i] == '+' || s[i] == '-'))
+			minus = s[i++] == '-';
+		if (i == len || !num_digit(s[i])) {
+			*end = i;
+			return EBADMSG;
+		}
+		for (; i < len && num_digit(s[i]); ++i) {
+			if (x < 0x10000000)
+				x = x * 10 + (s[i] - '0');
+		}
+		if (minus)
+			x = -x;
+		flt = true;
+	}
+
+	*end = i;
+
+	if (!flt && nd <= 19U && w <= (uint64_t)INT64_MAX + neg) {
+		v->i = (int64_t)(neg ? -w : w);
+		v->flt = false;
+		return 0;
+	}
+
+	/* Count significant digits, leaving out the leading zeros of a
+	 * fraction whose integer part is zero. */
+	size_t z = 0;
+	if (s[a] == '0')
+		for (z = 1U; z <= nf && s[a + 1U + z] == '0'; ++z);
+
+	double d;
+	int e = 0;
+	if (nd + nf - z <= 19U) {
+		if (!num_decimal(w, x - (int64_t)nf, &d))
+			e = num_slow(&s[a], i - a, &d);
+	} else {
+		/* Take the first 19 significant digits and check if the
+		 * next larger significand rounds the same way. */
+		uint64_t t = 0;
+		size_t n = 0;
+		for (size_t k = z ? a + 1U + z : a; n < 19U; ++k) {
+			if (s[k] != '.') {
+				t = t * 10U + (s[k] - '0');
+				++n;
+			}
+		}
+		int64_t q = x + (int64_t)nd - (int64_t)z - 19;
+		double u;
+		if (!num_decimal(t, q, &d) || !num_decimal(t + 1U, q, &u) ||
+		    d != u)
+			e = num_slow(&s[a], i - a, &d);
+	}
+
+	v->d = neg ? -d : d;
+	v->flt = true;
+	return e;
+}
+
+int
+num_parse_i64 (char const *s,
+               size_t      len,
+               int64_t    *v)
+{
+	uint8_t const *u = (uint8_t const *)s;
+	size_t i = len && (u[0] == '-' || u[0] == '+');
+	bool neg = i && u[0] == '-';
+
+	if (i == len)
+		return EINVAL;
+
+	while (i < len - 1U && u[i] == '0')
+		++i;
+
+	size_t a = i;
+	uint64_t w = 0;
+	if (num_run(u, i, len, &w) != len)
+		return EINVAL;
+
+	if (len - a > 19U || w > (uint64_t)INT64_MAX + neg)
+		return ERANGE;
+
+	*v = (int64_t)(neg ? -w : w);
+	return 0;
+}
+
+/**
+ * @brief Write the digits of an integer at the end of a buffer.
+ *
+ * @param e End of the buffer.
+ * @param v Value.
+ * @return Start of the digits.
+ */
+nonnull_in()
+static force_inline char *
+num_utoa (char     *e,
+          uint64_t  v)
+{
+	for (; v >= 100U; v /= 100U) {
+		e -= 2;
+		__builtin_memcpy(e, &num_digits[v % 100U * 2U], 2U);
+	}
+
+	if (v >= 10U) {
+		e -= 2;
+		__builtin_memcpy(e, &num_digits[v * 2U], 2U);
+	} else {
+		*--e = (char)('0' + v);
+	}
+
+	return e;
+}
+
+size_t
+num_format_i64 (char    *d,
+                int64_t  v)
+{
+	char buf[NUM_I64_SIZE];
+	char *p = num_utoa(&buf[sizeof buf],
+	                   v < 0 ? -(uint64_t)v : (uint64_t)v);
+	if (v < 0)
+		*--p = '-';
+
+	size_t n = (size_t)(&buf[sizeof buf] - p);
+	__builtin_memcpy(d, p, n);
+	return n;
+}
+
+static const_inline int
+num_flog10pow2 (int q)
+{
+	return (int)((int64_t)q * 661971961083 >> 41);
+}
+
+static const_inline int
+num_flog10three4pow2 (int q)
+{
+	return (int)(((int64_t)q * 661971961083 - 274743187321) >> 41);
+}
+
+static const_inline int
+num_flog2pow10 (int e)
+{
+	return (int)((int64_t)e * 913124641741 >> 38);
+}
+
+/**
+ * @brief Multiply by a Schubfach multiplier and round to odd.
+ */
+nonnull_in()
+static force_inline uint64_t
+num_rop (uint64_t const *g,
+         uint64_t        cp)
+{
+	constexpr uint64_t m63 = (UINT64_C(1) << 63U) - 1U;
+	uint64_t x0, x1 = num_mul(g[1], cp, &x0);
+	uint64_t y0, y1 = num_mul(g[0], cp, &y0);
+	uint64_t z = (y0 >> 1U) + x1;
+	uint64_t vbp = y1 + (z >> 63U);
+	return vbp | (((z & m63) + m63) >> 63U);
+}
+
+/**
+ * @brief Find the shortest decimal c * 2^q rounds back from.
+ *
+ * @param c Binary significand.
+ * @param q Binary exponent.
+ * @param f Decimal significand.
+ * @return Decimal exponent.
+ */
+nonnull_in()
+static int
+num_schubfach (uint64_t  c,
+               int       q,
+               uint64_t *f)
+{
+	constexpr uint64_t c_min = UINT64_C(1) << 52U;
+	uint64_t out = c & 1U;
+	uint64_t cb = c << 2U;
+	uint64_t cbr = cb + 2U;
+	uint64_t cbl;
+	int k;
+
+	if (c != c_min || q == -1074) {
+		cbl = cb - 2U;
+		k = num_flog10pow2(q);
+	} else {
+		cbl = cb - 1U;
+		k = num_flog10three4pow2(q);
+	}
+
+	int h = q + num_flog2pow10(-k) + 2;
+	uint64_t const *g = num_g[k + 324];
+	uint64_t vb = num_rop(g, cb << h);
+	uint64_t vbl = num_rop(g, cbl << h);
+	uint64_t vbr = num_rop(g, cbr << h);
+
+	uint64_t s = vb >> 2U;
+	uint64_t lo, sp10 = num_mul(s, UINT64_C(1844674407370955168), &lo) * 10U;
+	uint64_t tp10 = sp10 + 10U;
+	bool upin = vbl + out <= sp10 << 2U;
+	bool wpin = (tp10 << 2U) + out <= vbr;
+	if (upin != wpin) {
+		*f = upin ? sp10 : tp10;
+		return k;
+	}
+
+	uint64_t t = s + 1U;
+	bool uin = vbl + out <= s << 2U;
+	bool win = (t << 2U) + out <= vbr;
+	if (uin != win) {
+		*f = uin ? s : t;
+		return k;
+	}
+
+	int64_t cmp = (int64_t)(vb - ((s + t) << 1U));
+	*f = cmp < 0 || (cmp == 0 && !(s & 1U)) ? s : t;
+	return k;
+}
+
+/**
+ * @brief Print f * 10^e like `JSON.stringify()` does, but switch to an
+ *        exponent from 10^16 up, where integers stop being exact.
+ */
+nonnull_in()
+static size_t
+num_chars (char     *d,
+           uint64_t  f,
+           int       e)
+{
+	for (; f % 10U == 0; f /= 10U)
+		++e;
+
+	char buf[NUM_I64_SIZE];
+	char *s = num_utoa(&buf[sizeof buf], f);
+	int n = (int)(&buf[sizeof buf] - s);
+	int x = e + n;
+	char *p = d;
+
+	if (e >= 0 && x <= 16) {
+		__builtin_memcpy(p, s, (size_t)n);
+		p += n;
+		__builtin_memset(p, '0', (size_t)e);
+		p += e;
+	} else if (x > 0 && x <= 16) {
+		__builtin_memcpy(p, s, (size_t)x);
+		p += x;
+		*p++ = '.';
+		__builtin_memcpy(p, &s[x], (size_t)(n - x));
+		p += n - x;
+	} else if (x > -6 && x <= 0) {
+		*p++ = '0';
+		*p++ = '.';
+		__builtin_memset(p, '0', (size_t)-x);
+		p -= x;
+		__builtin_memcpy(p, s, (size_t)n);
+		p += n;
+	} else {
+		*p++ = s[0];
+		if (n > 1) {
+			*p++ = '.';
+			__builtin_memcpy(p, &s[1], (size_t)(n - 1));
+			p += n - 1;
+		}
+		*p++ = 'e';
+		*p++ = x > 0 ? '+' : '-';
+		x = x > 0 ? x - 1 : 1 - x;
+		char *q = num_utoa(&buf[sizeof buf], (uint64_t)x);
+		n = (int)(&buf[sizeof buf] - q);
+		__builtin_memcpy(p, q, (size_t)n);
+		p += n;
+	}
+
+	return (size_t)(p - d);
+}
+
+size_t
+num_format_double (char   *d,
+                   double  v)
+{
+	uint64_t bits;
+	__builtin_memcpy(&bits, &v, sizeof bits);
+
+	char *p = d;
+	if (bits >> 63U)
+		*p++ = '-';
+
+	uint64_t t = bits & ((UINT64_C(1) << 52U) - 1U);
+	int bq = (int)(bits >> 52U) & 0x7ff;
+	uint64_t f;
+	int e;
+
+	if (bq) {
+		int mq = 1075 - bq;
+		uint64_t c = t | UINT64_C(1) << 52U;
+		if (mq > 0 && mq < 53 && !(c & ((UINT64_C(1) << mq) - 1U))) {
+			f = c >> mq;
+			e = 0;
+		} else {
+			e = num_schubfach(c, -mq, &f);
+		}
+	} else if (t) {
+		e = num_schubfach(t, -1074, &f);
+	} else {
+		*p++ = '0';
+		return (size_t)(p - d);
+	}
+
+	return (size_t)(p - d) + num_chars(p, f, e);
+}
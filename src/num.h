@@ -0,0 +1,104 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file num.h
+ *
+ * @brief Locale-independent number parsing and formatting.
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_NUM_H_
+#define LIBCANTH_SRC_NUM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util.h"
+
+/**
+ * @brief Output buffer size for @ref num_format_i64().
+ */
+#define NUM_I64_SIZE 20U
+
+/**
+ * @brief Output buffer size for @ref num_format_double().
+ */
+#define NUM_DOUBLE_SIZE 25U
+
+/**
+ * @brief Parsed JSON number.
+ */
+struct num {
+	union {
+		int64_t i; //!< Value if @ref num::flt is clear.
+		double  d; //!< Value if @ref num::flt is set.
+	}; //!< @anon
+	bool flt; //!< Number has a fraction or an exponent, or doesn't
+	          //!< fit in an `int64_t`.
+};
+
+/**
+ * @brief Parse a JSON number.
+ *
+ * Digits are consumed eight at a time with SWAR arithmetic. Doubles are
+ * converted exactly with Clinger's fast path when the significand and
+ * power of ten are both exact in a double, and with the Eisel-Lemire
+ * algorithm otherwise, so `strtod()` is only needed in the rare cases
+ * where 19 significant digits don't decide the rounding.
+ *
+ * @param[in]  s   Input.
+ * @param[in]  len Length of @p s.
+ * @param[out] end Index after the number, or of the offending byte.
+ * @param[out] v   Value. Out of range doubles become zero or infinity.
+ * @return 0 on success, otherwise an error code. `EBADMSG` means @p s
+ *         doesn't start with a number as defined by the JSON grammar.
+ *         What follows the number isn't looked at.
+ */
+extern int
+num_parse (uint8_t const *s,
+           size_t         len,
+           size_t        *end,
+           struct num    *v) nonnull_in(3,4);
+
+/**
+ * @brief Parse a decimal integer.
+ *
+ * @param[in]  s   Input, an optional sign followed by digits only.
+ * @param[in]  len Length of @p s.
+ * @param[out] v   Value.
+ * @return 0 on success, `ERANGE` if the value doesn't fit, or `EINVAL`
+ *         if @p s isn't an integer.
+ */
+extern int
+num_parse_i64 (char const *s,
+               size_t      len,
+               int64_t    *v) nonnull_in(3);
+
+/**
+ * @brief Format an integer.
+ *
+ * @param[out] d Output buffer of at least @ref NUM_I64_SIZE bytes.
+ * @param[in]  v Value.
+ * @return Number of bytes written. No terminator is written.
+ */
+extern size_t
+num_format_i64 (char    *d,
+                int64_t  v) nonnull_in();
+
+/**
+ * @brief Format a finite double with as few digits as parse back to it.
+ *
+ * The shortest representation is found with the Schubfach algorithm.
+ * It is printed much like `JSON.stringify()` prints numbers: in plain
+ * notation if the decimal exponent is from -6 to 15, with an exponent
+ * like `1e+16` or `1e-7` otherwise, and without a fraction for
+ * integral values. Below 10^16 every integral double is printed
+ * exactly, so it parses back as the same integer.
+ *
+ * @param[out] d Output buffer of at least @ref NUM_DOUBLE_SIZE bytes.
+ * @param[in]  v Finite value. Not checked.
+ * @return Number of bytes written. No terminator is written.
+ */
+extern size_t
+num_format_double (char   *d,
+                   double  v) nonnull_in();
+
+#endif /* LIBCANTH_SRC_NUM_H_ */
@@ -0,0 +1,416 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file pcache.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pcache.h"
+
+__extension__ typedef unsigned __int128 u128;
+
+/**
+ * @brief Hash chain of a remembered request.
+ */
+struct pcache_req {
+	uint64_t *h; //!< Hash of each prefix, by its last block.
+	size_t    n; //!< Number of blocks.
+};
+
+/**
+ * @brief Remembered conversation.
+ */
+struct pcache_conv {
+	struct pcache_conv *next;  //!< Next in the same bucket.
+	struct pcache_conv *older; //!< Previous in LRU order.
+	struct pcache_conv *newer; //!< Next in LRU order.
+	uint64_t            id;    //!< Conversation ID.
+	uint32_t            head;  //!< Slot of the next request.
+	struct pcache_req   req[]; //!< Last requests, oldest at head.
+};
+
+static char const pcache_marker[] =
+	"\"cache_control\":{\"type\":\"ephemeral\"}}";
+
+static const_inline uint64_t
+pcache_fold (uint64_t a,
+             uint64_t b)
+{
+	u128 m = (u128)a * b;
+	return (uint64_t)m ^ (uint64_t)(m >> 64U);
+}
+
+static force_inline uint64_t
+pcache_load (uint8_t const *s)
+{
+	uint64_t v;
+	memcpy(&v, s, sizeof v);
+	return v;
+}
+
+/**
+ * @brief Hash a block onto the chain hash of the blocks before it.
+ *
+ * Sixteen bytes are folded in per multiply, so a block costs little
+ * more than reading it.
+ */
+static uint64_t
+pcache_hash (void const *data,
+             size_t      len,
+             uint64_t    seed)
+{
+	uint8_t const *s = data;
+	uint64_t h = seed ^ pcache_fold(len ^ 0xa0761d6478bd642fU,
+	                                0xe7037ed1a0b428dbU);
+
+	for (; len > 16U; s += 16U, len -= 16U)
+		h = pcache_fold(pcache_load(s) ^ 0x8ebc6af09c88c6e3U,
+		                pcache_load(&s[8]) ^ h);
+
+	uint8_t t[16] = {0};
+	if (len)
+		memcpy(t, s, len);
+	h = pcache_fold(pcache_load(t) ^ 0x589965cc75374cc3U,
+	                pcache_load(&t[8]) ^ h);
+	return pcache_fold(h ^ 0xa0761d6478bd642fU, h ^ 0xe7037ed1a0b428dbU);
+}
+
+static const_inline size_t
+pcache_bucket (struct pcache const *p,
+               uint64_t             id)
+{
+	id ^= id >> 31U;
+	id *= 0x7fb5d329728ea185U;
+	id ^= id >> 27U;
+	return (size_t)id & (p->cap - 1U);
+}
+
+nonnull_in()
+static void
+pcache_unlink (struct pcache      *p,
+               struct pcache_conv *c)
+{
+	if (c->older)
+		c->older->newer = c->newer;
+	else
+		p->lru = c->newer;
+	if (c->newer)
+		c->newer->older = c->older;
+	else
+		p->mru = c->older;
+	c->older = c->newer = nullptr;
+}
+
+nonnull_in()
+static void
+pcache_touch (struct pcache      *p,
+              struct pcache_conv *c)
+{
+	if (p->mru == c)
+		return;
+	if (c->older || c->newer || p->lru == c)
+		pcache_unlink(p, c);
+	c->older = p->mru;
+	if (p->mru)
+		p->mru->newer = c;
+	else
+		p->lru = c;
+	p->mru = c;
+}
+
+/**
+ * @brief Unlink a conversation from its bucket and free it.
+ */
+nonnull_in()
+static void
+pcache_drop (struct pcache       *p,
+             struct pcache_conv **pp)
+{
+	struct pcache_conv *c = *pp;
+	*pp = c->next;
+	pcache_unlink(p, c);
+	for (uint32_t i = 0; i < p->cfg.history; ++i)
+		free(c->req[i].h);
+	free(c);
+	p->count -= 1U;
+}
+
+nonnull_in()
+static struct pcache_conv **
+pcache_find (struct pcache *p,
+             uint64_t       id)
+{
+	struct pcache_conv **pp = &p->tab[pcache_bucket(p, id)];
+	while (*pp && (*pp)->id != id)
+		pp = &(*pp)->next;
+	return pp;
+}
+
+nonnull_in()
+static struct pcache_conv *
+pcache_get (struct pcache *p,
+            uint64_t       id)
+{
+	struct pcache_conv **pp = pcache_find(p, id);
+	struct pcache_conv *c = *pp;
+	if (c) {
+		pcache_touch(p, c);
+		return c;
+	}
+
+	c = calloc(1U, sizeof *c + p->cfg.history * sizeof *c->req);
+	if (!c)
+		return nullptr;
+
+	if (p->count >= p->cfg.conversations) {
+		pcache_drop(p, pcache_find(p, p->lru->id));
+		p->stats.evicted += 1U;
+		pp = pcache_find(p, id);
+	}
+
+	c->id = id;
+	*pp = c;
+	pcache_touch(p, c);
+	p->count += 1U;
+	return c;
+}
+
+/**
+ * @brief Find the number of leading blocks two chains agree on.
+ *
+ * Each hash covers every block before it too, so the chains agree up
+ * to some point and not after it, which makes the point easy to find
+ * by bisection.
+ */
+static size_t
+pcache_common (uint64_t const *a,
+               size_t          na,
+               uint64_t const *b,
+               size_t          nb)
+{
+	size_t lo = 0, hi = na < nb ? na : nb;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo + 1U) / 2U;
+		if (a[mid - 1U] == b[mid - 1U])
+			lo = mid;
+		else
+			hi = mid - 1U;
+	}
+	return lo;
+}
+
+static const_inline bool
+pcache_space (char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static size_t
+pcache_bytes (struct pcache_block const *b,
+              size_t                     n)
+{
+	size_t len = 0;
+	for (size_t i = 0; i < n; ++i)
+		len += b[i].len;
+	return len;
+}
+
+int
+pcache_init (struct pcache           *p,
+             struct pcache_cfg const *cfg)
+{
+	*p = (struct pcache){
+		.cfg = cfg ? *cfg : (struct pcache_cfg){0},
+	};
+	struct pcache_cfg *c = &p->cfg;
+	if (!c->min_bytes)
+		c->min_bytes = PCACHE_MIN_BYTES;
+	if (!c->breakpoints || c->breakpoints > PCACHE_BREAKPOINTS)
+		c->breakpoints = PCACHE_BREAKPOINTS;
+	if (!c->history)
+		c->history = PCACHE_HISTORY;
+	if (!c->conversations)
+		c->conversations = PCACHE_CONVERSATIONS;
+	/* Buckets for 3/4 load at most. */
+	for (p->cap = 16U; p->cap * 3U / 4U < c->conversations;)
+		p->cap *= 2U;
+	p->tab = calloc(p->cap, sizeof *p->tab);
+	if (!p->tab)
+		return errno;
+
+	int e = pthread_mutex_init(&p->lock, nullptr);
+	if (e) {
+		free(p->tab);
+		p->tab = nullptr;
+	}
+	return e;
+}
+
+void
+pcache_fini (struct pcache *p)
+{
+	for (size_t i = 0; p->tab && i < p->cap; ++i) {
+		while (p->tab[i])
+			pcache_drop(p, &p->tab[i]);
+	}
+	free(p->tab);
+	p->tab = nullptr;
+	(void)pthread_mutex_destroy(&p->lock);
+}
+
+int
+pcache_plan (struct pcache             *p,
+             uint64_t                   conv,
+             struct pcache_block const *b,
+             size_t                     n,
+             struct pcache_plan        *plan)
+{
+	*plan = (struct pcache_plan){0};
+	if (!n)
+		return 0;
+	if (n > UINT32_MAX)
+		return EOVERFLOW;
+
+	uint64_t *h = malloc(n * sizeof *h);
+	if (!h)
+		return errno;
+	for (size_t i = 0; i < n; ++i) {
+		h[i] = pcache_hash(b[i].data, b[i].len, i ? h[i - 1U] : 0);
+		plan->bytes += b[i].len;
+	}
+
+	(void)pthread_mutex_lock(&p->lock);
+	struct pcache_cfg const *cfg = &p->cfg;
+	struct pcache_conv *c = pcache_get(p, conv);
+	if (!c) {
+		(void)pthread_mutex_unlock(&p->lock);
+		free(h);
+		return ENOMEM;
+	}
+
+	/* Prefix lengths in blocks, the end of the request first and the
+	 * longest shared prefixes after it. */
+	size_t cand[PCACHE_BREAKPOINTS] = {0};
+	uint32_t nc = 0;
+	if (plan->bytes >= cfg->min_bytes)
+		cand[nc++] = n;
+
+	for (uint32_t i = 0; i < cfg->history; ++i) {
+		struct pcache_req const *r = &c->req[i];
+		size_t k = pcache_common(r->h, r->n, h, n);
+		if (k > plan->stable)
+			plan->stable = k;
+	}
+	plan->stable_bytes = pcache_bytes(b, plan->stable);
+
+	for (size_t prev = n; nc < cfg->breakpoints;) {
+		size_t best = 0;
+		for (uint32_t i = 0; i < cfg->history; ++i) {
+			struct pcache_req const *r = &c->req[i];
+			size_t k = pcache_common(r->h, r->n, h, n);
+			if (k > best && k < prev)
+				best = k;
+		}
+		if (!best || pcache_bytes(b, best) < cfg->min_bytes)
+			break;
+		cand[nc++] = best;
+		prev = best;
+	}
+
+	/* Insertion sort into ascending order of blocks. */
+	for (uint32_t i = 0; i < nc; ++i) {
+		size_t k = cand[i];
+		uint32_t j = i;
+		for (; j && plan->at[j - 1U] > k - 1U; --j)
+			plan->at[j] = plan->at[j - 1U];
+		plan->at[j] = (uint32_t)(k - 1U);
+	}
+	plan->n = nc;
+
+	p->stats.requests += 1U;
+	p->stats.bytes += plan->bytes;
+	if (plan->stable && plan->stable_bytes >= cfg->min_bytes) {
+		p->stats.hits += 1U;
+		p->stats.stable_bytes += plan->stable_bytes;
+	}
+
+	struct pcache_req *r = &c->req[c->head];
+	free(r->h);
+	*r = (struct pcache_req){.h = h, .n = n};
+	c->head = (c->head + 1U) % cfg->history;
+	(void)pthread_mutex_unlock(&p->lock);
+	return 0;
+}
+
+void
+pcache_forget (struct pcache *p,
+               uint64_t       conv)
+{
+	(void)pthread_mutex_lock(&p->lock);
+	struct pcache_conv **pp = pcache_find(p, conv);
+	if (*pp)
+		pcache_drop(p, pp);
+	(void)pthread_mutex_unlock(&p->lock);
+}
+
+void
+pcache_usage (struct pcache *p,
+              int64_t        input,
+              int64_t        cache_read,
+              int64_t        cache_write)
+{
+	(void)pthread_mutex_lock(&p->lock);
+	p->stats.input += input > 0 ? (uint64_t)input : 0;
+	p->stats.cache_read += cache_read > 0 ? (uint64_t)cache_read : 0;
+	p->stats.cache_write += cache_write > 0 ? (uint64_t)cache_write : 0;
+	(void)pthread_mutex_unlock(&p->lock);
+}
+
+struct pcache_stats
+pcache_stats (struct pcache *p)
+{
+	(void)pthread_mutex_lock(&p->lock);
+	struct pcache_stats st = p->stats;
+	(void)pthread_mutex_unlock(&p->lock);
+	return st;
+}
+
+int
+pcache_write (struct jwriter            *w,
+              struct pcache_block const *b,
+              bool                       mark)
+{
+	if (!mark)
+		return jwriter_raw(w, b->data, b->len);
+
+	/* Splice the marker in before the closing brace. */
+	char const *s = b->data;
+	size_t end = b->len, beg = 0;
+	while (end && pcache_space(s[end - 1U]))
+		--end;
+	while (beg < end && pcache_space(s[beg]))
+		++beg;
+	if (end - beg < 2U || s[beg] != '{' || s[end - 1U] != '}')
+		return EINVAL;
+
+	size_t last = end - 1U, body = last;
+	while (body > beg && pcache_space(s[body - 1U]))
+		--body;
+	bool empty = s[body - 1U] == '{';
+
+	char *buf = malloc(last + 1U + sizeof pcache_marker);
+	if (!buf)
+		return errno;
+	memcpy(buf, s, last);
+	size_t len = last;
+	if (!empty)
+		buf[len++] = ',';
+	memcpy(&buf[len], pcache_marker, sizeof pcache_marker - 1U);
+	len += sizeof pcache_marker - 1U;
+
+	int e = jwriter_raw(w, buf, len);
+	free(buf);
+	return e;
+}
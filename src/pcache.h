@@ -0,0 +1,202 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file pcache.h
+ *
+ * @brief Prompt cache breakpoint planner.
+ *
+ * The API caches a prompt prefix at each block marked with
+ * `cache_control`, and a later request reads it back only if its bytes
+ * up to that point are identical. The planner sees each request as the
+ * serialized blocks of its prefix order (tools, system, messages) and
+ * hashes them into a chain, so that the hash at a block stands for all
+ * bytes up to and including it. Per conversation it remembers the
+ * chains of the last few requests, finds the longest prefix the new
+ * request shares with each by binary search, and marks the ends of
+ * those stable prefixes along with the end of the request itself for
+ * the next turn to build on.
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_PCACHE_H_
+#define LIBCANTH_SRC_PCACHE_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "jwriter.h"
+#include "util.h"
+
+/**
+ * @brief Most breakpoints the API accepts in one request.
+ */
+#define PCACHE_BREAKPOINTS 4U
+
+/**
+ * @brief Default shortest prefix worth a breakpoint, in bytes. That is
+ *        about the 1024 tokens the API caches at the least.
+ */
+#define PCACHE_MIN_BYTES 4096U
+
+/**
+ * @brief Default number of requests remembered per conversation.
+ */
+#define PCACHE_HISTORY 4U
+
+/**
+ * @brief Default number of conversations remembered.
+ */
+#define PCACHE_CONVERSATIONS 1024U
+
+/**
+ * @brief Serialized block of a request.
+ */
+struct pcache_block {
+	void const *data; //!< JSON of the block, without `cache_control`.
+	size_t      len;  //!< Length of @ref pcache_block::data.
+};
+
+/**
+ * @brief Configuration. Zero fields take their defaults.
+ */
+struct pcache_cfg {
+	uint32_t min_bytes;     //!< Shortest prefix worth a breakpoint.
+	uint32_t breakpoints;   //!< Most breakpoints per request.
+	uint32_t history;       //!< Requests remembered per conversation.
+	uint32_t conversations; //!< Conversations remembered.
+};
+
+/**
+ * @brief Breakpoints of a request.
+ */
+struct pcache_plan {
+	uint32_t n;                      //!< Number of breakpoints.
+	uint32_t at[PCACHE_BREAKPOINTS]; //!< Marked blocks, ascending.
+	size_t   stable;                 //!< Blocks in the longest prefix
+	                                 //!< sent before.
+	size_t   stable_bytes;           //!< Bytes in that prefix.
+	size_t   bytes;                  //!< Bytes in the request.
+};
+
+/**
+ * @brief Statistics.
+ */
+struct pcache_stats {
+	size_t   requests;     //!< Requests planned.
+	size_t   hits;         //!< Requests with a stable prefix marked.
+	size_t   evicted;      //!< Conversations forgotten.
+	uint64_t bytes;        //!< Bytes planned.
+	uint64_t stable_bytes; //!< Bytes in marked stable prefixes.
+	uint64_t input;        //!< Uncached input tokens reported.
+	uint64_t cache_read;   //!< Input tokens reported read from cache.
+	uint64_t cache_write;  //!< Input tokens reported written to cache.
+};
+
+struct pcache_conv;
+
+/**
+ * @brief Planner, shared by any number of threads.
+ */
+struct pcache {
+	pthread_mutex_t      lock;  //!< Guards everything below.
+	struct pcache_cfg    cfg;   //!< Configuration.
+	struct pcache_conv **tab;   //!< Conversations by ID.
+	struct pcache_conv  *lru;   //!< Least recently used conversation.
+	struct pcache_conv  *mru;   //!< Most recently used conversation.
+	size_t               count; //!< Conversations remembered.
+	size_t               cap;   //!< Size of @ref pcache::tab.
+	struct pcache_stats  stats; //!< Statistics.
+};
+
+/**
+ * @brief Initialize a planner.
+ *
+ * @param[out] p   Planner.
+ * @param[in]  cfg Configuration, or `NULL` for the defaults.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+pcache_init (struct pcache           *p,
+             struct pcache_cfg const *cfg) nonnull_in(1);
+
+/**
+ * @brief Release a planner.
+ */
+extern void
+pcache_fini (struct pcache *p) nonnull_in();
+
+/**
+ * @brief Place the breakpoints of a request.
+ *
+ * The end of the longest prefix shared with each remembered request is
+ * a candidate, as is the end of the request. Candidates shorter than
+ * the configured minimum are dropped, and of the rest the end of the
+ * request and then the longest prefixes are kept. The request is then
+ * remembered in place of the oldest one of the conversation.
+ *
+ * @param[in,out] p    Planner.
+ * @param[in]     conv Conversation ID, any value the caller chooses.
+ * @param[in]     b    Blocks of the request, in prefix order.
+ * @param[in]     n    Number of blocks.
+ * @param[out]    plan Breakpoints.
+ * @return 0 on success, otherwise an error code. The plan is empty
+ *         after an error.
+ */
+extern int
+pcache_plan (struct pcache             *p,
+             uint64_t                   conv,
+             struct pcache_block const *b,
+             size_t                     n,
+             struct pcache_plan        *plan) nonnull_in(1,5);
+
+/**
+ * @brief Forget a conversation.
+ */
+extern void
+pcache_forget (struct pcache *p,
+               uint64_t       conv) nonnull_in();
+
+/**
+ * @brief Count the `usage` of a response.
+ *
+ * @param[in,out] p           Planner.
+ * @param[in]     input       `input_tokens`
+ * @param[in]     cache_read  `cache_read_input_tokens`
+ * @param[in]     cache_write `cache_creation_input_tokens`
+ */
+extern void
+pcache_usage (struct pcache *p,
+              int64_t        input,
+              int64_t        cache_read,
+              int64_t        cache_write) nonnull_in();
+
+/**
+ * @brief Get a snapshot of the statistics.
+ */
+extern struct pcache_stats
+pcache_stats (struct pcache *p) nonnull_in();
+
+/**
+ * @brief Get the share of input tokens read from cache, in permille.
+ */
+static const_inline uint32_t
+pcache_hit_rate (struct pcache_stats const *s)
+{
+	uint64_t all = s->input + s->cache_read + s->cache_write;
+	return all ? (uint32_t)(s->cache_read * 1000U / all) : 0;
+}
+
+/**
+ * @brief Write a block, marked with `cache_control` or not.
+ *
+ * @param[in,out] w    Writer.
+ * @param[in]     b    Block. A marked one must be a JSON object.
+ * @param[in]     mark Whether to mark the block.
+ * @return The error code of the writer, or `EINVAL` if a marked block
+ *         isn't an object.
+ */
+extern int
+pcache_write (struct jwriter            *w,
+              struct pcache_block const *b,
+              bool                       mark) nonnull_in();
+
+#endif /* LIBCANTH_SRC_PCACHE_H_ */
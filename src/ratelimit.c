@@ -0,0 +1,411 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file ratelimit.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include "mono.h"
+#include "num.h"
+#include "ratelimit.h"
+
+/**
+ * @brief Request waiting for admission.
+ */
+struct ratelimit_waiter {
+	struct ratelimit_waiter *next;   //!< Next in arrival order.
+	pthread_cond_t           cond;   //!< Signaled at the head.
+	uint32_t                 input;  //!< Estimated input tokens.
+	uint32_t                 output; //!< Output token limit.
+};
+
+/**
+ * @brief Wait time meaning until something changes.
+ */
+#define RATELIMIT_FOREVER UINT64_MAX
+
+nonnull_in()
+static void
+ratelimit_refill (struct ratelimit *r,
+                  uint64_t          now)
+{
+	if (now <= r->last)
+		return;
+	double dt = (double)(now - r->last);
+	r->last = now;
+	for (unsigned i = 0; i < ratelimit_kinds; ++i) {
+		struct ratelimit_bucket *b = &r->b[i];
+		if (b->rate > 0.0 && b->avail < b->cap) {
+			b->avail += b->rate * dt;
+			if (b->avail > b->cap)
+				b->avail = b->cap;
+		}
+	}
+}
+
+/**
+ * @brief Get the time until a request can be admitted.
+ *
+ * A request larger than a bucket only needs the bucket to be full, and
+ * overdraws it.
+ *
+ * @return 0 if it can be admitted now, otherwise microseconds to wait
+ *         or @ref RATELIMIT_FOREVER.
+ */
+nonnull_in()
+static uint64_t
+ratelimit_delay (struct ratelimit const *r,
+                 uint32_t                input,
+                 uint32_t                output,
+                 uint64_t                now)
+{
+	if (now < r->pause)
+		return r->pause - now;
+	if (!r->seen && r->stats.inflight)
+		return RATELIMIT_FOREVER;
+
+	double const cost[ratelimit_kinds] = {1.0, input, output};
+	uint64_t d = 0;
+	for (unsigned i = 0; i < ratelimit_kinds; ++i) {
+		struct ratelimit_bucket const *b = &r->b[i];
+		double need = cost[i] < b->cap ? cost[i] : b->cap;
+		if (b->rate > 0.0 && b->avail < need) {
+			uint64_t t = (uint64_t)((need - b->avail) / b->rate)
+			             + 1U;
+			if (t > d)
+				d = t;
+		}
+	}
+	return d;
+}
+
+nonnull_in()
+static void
+ratelimit_charge (struct ratelimit *r,
+                  uint32_t          input,
+                  uint32_t          output)
+{
+	r->b[ratelimit_requests].avail -= 1.0;
+	r->b[ratelimit_input].avail -= input;
+	r->b[ratelimit_output].avail -= output;
+	r->stats.admitted += 1U;
+	r->stats.inflight += 1U;
+}
+
+/**
+ * @brief Let the first waiting request recheck its wait.
+ */
+nonnull_in()
+static void
+ratelimit_wake (struct ratelimit *r)
+{
+	if (r->head)
+		(void)pthread_cond_signal(&r->head->cond);
+}
+
+nonnull_in()
+static void
+ratelimit_unlink (struct ratelimit        *r,
+                  struct ratelimit_waiter *w)
+{
+	struct ratelimit_waiter **p = &r->head, *prev = nullptr;
+	for (; *p != w; p = &(*p)->next)
+		prev = *p;
+	*p = w->next;
+	if (r->tail == w)
+		r->tail = prev;
+}
+
+nonnull_in()
+static void
+ratelimit_set_limit (struct ratelimit *r,
+                     unsigned          i,
+                     uint32_t          limit)
+{
+	struct ratelimit_bucket *b = &r->b[i];
+	if (b->limit == limit)
+		return;
+
+	b->limit = limit;
+	r->stats.limit[i] = limit;
+	b->rate = (double)limit * r->target / 1000.0 / 60e6;
+	b->cap = b->rate * r->burst_ms * 1000.0;
+	if (b->avail > b->cap)
+		b->avail = b->cap;
+}
+
+int
+ratelimit_init (struct ratelimit           *r,
+                struct ratelimit_cfg const *cfg)
+{
+	*r = (struct ratelimit){
+		.target   = cfg && cfg->target ? cfg->target : RATELIMIT_TARGET,
+		.burst_ms = cfg && cfg->burst_ms ? cfg->burst_ms
+		                                 : RATELIMIT_BURST_MS,
+	};
+	if (r->target > 1000U)
+		r->target = 1000U;
+
+	int e = pthread_condattr_init(&r->attr);
+	if (e)
+		return e;
+	e = pthread_condattr_setclock(&r->attr, CLOCK_MONOTONIC);
+	if (!e)
+		e = pthread_mutex_init(&r->lock, nullptr);
+	if (e) {
+		(void)pthread_condattr_destroy(&r->attr);
+		return e;
+	}
+
+	/* Buckets start empty so that pacing is smooth from the start. */
+	r->last = mono_us();
+	for (unsigned i = 0; cfg && i < ratelimit_kinds; ++i)
+		ratelimit_set_limit(r, i, cfg->limit[i]);
+	r->seen = cfg && cfg->limit[ratelimit_requests];
+	return 0;
+}
+
+void
+ratelimit_fini (struct ratelimit *r)
+{
+	(void)pthread_mutex_destroy(&r->lock);
+	(void)pthread_condattr_destroy(&r->attr);
+}
+
+uint32_t
+ratelimit_estimate (char const *s,
+                    size_t      n)
+{
+	size_t ascii = 0, chars = 0;
+	for (size_t i = 0; i < n; ++i) {
+		uint8_t c = (uint8_t)s[i];
+		ascii += c < 0x80U;
+		chars += c >= 0xc0U;
+	}
+	size_t t = (ascii + 3U) / 4U + chars;
+	return t < UINT32_MAX ? (uint32_t)t : UINT32_MAX;
+}
+
+int
+ratelimit_acquire (struct ratelimit *r,
+                   uint32_t          input,
+                   uint32_t          output,
+                   uint32_t          timeout_ms)
+{
+	(void)pthread_mutex_lock(&r->lock);
+	uint64_t now = mono_us();
+	ratelimit_refill(r, now);
+	if (!r->head && !ratelimit_delay(r, input, output, now)) {
+		ratelimit_charge(r, input, output);
+		(void)pthread_mutex_unlock(&r->lock);
+		return 0;
+	}
+
+	struct ratelimit_waiter w = {.input = input, .output = output};
+	int e = pthread_cond_init(&w.cond, &r->attr);
+	if (e) {
+		(void)pthread_mutex_unlock(&r->lock);
+		return e;
+	}
+	if (r->tail)
+		r->tail->next = &w;
+	else
+		r->head = &w;
+	r->tail = &w;
+	r->stats.waited += 1U;
+
+	uint64_t deadline = timeout_ms ? now + timeout_ms * UINT64_C(1000)
+	                               : RATELIMIT_FOREVER;
+	for (;;) {
+		uint64_t until = deadline;
+		if (r->head == &w) {
+			ratelimit_refill(r, now);
+			uint64_t d = ratelimit_delay(r, input, output, now);
+			if (!d) {
+				ratelimit_charge(r, input, output);
+				break;
+			}
+			if (d != RATELIMIT_FOREVER && now + d < until)
+				until = now + d;
+		}
+
+		if (now >= deadline) {
+			e = ETIMEDOUT;
+			r->stats.timeouts += 1U;
+			break;
+		}
+
+		if (until == RATELIMIT_FOREVER) {
+			(void)pthread_cond_wait(&w.cond, &r->lock);
+		} else {
+			struct timespec ts = {
+				.tv_sec  = (time_t)(until / 1000000U),
+				.tv_nsec = (long)(until % 1000000U) * 1000L,
+			};
+			(void)pthread_cond_timedwait(&w.cond, &r->lock, &ts);
+		}
+		now = mono_us();
+	}
+
+	ratelimit_unlink(r, &w);
+	ratelimit_wake(r);
+	(void)pthread_mutex_unlock(&r->lock);
+	(void)pthread_cond_destroy(&w.cond);
+	return e;
+}
+
+int
+ratelimit_try (struct ratelimit *r,
+               uint32_t          input,
+               uint32_t          output,
+               uint32_t         *wait_ms)
+{
+	(void)pthread_mutex_lock(&r->lock);
+	uint64_t now = mono_us();
+	ratelimit_refill(r, now);
+	uint64_t d = r->head ? 1000U : ratelimit_delay(r, input, output, now);
+	if (!d)
+		ratelimit_charge(r, input, output);
+	(void)pthread_mutex_unlock(&r->lock);
+
+	if (!d)
+		return 0;
+	d = d == RATELIMIT_FOREVER ? RATELIMIT_PAUSE_MS : (d + 999U) / 1000U;
+	*wait_ms = d < UINT32_MAX ? (uint32_t)d : UINT32_MAX;
+	return EAGAIN;
+}
+
+void
+ratelimit_settle (struct ratelimit *r,
+                  uint32_t          input,
+                  uint32_t          output,
+                  uint32_t          used_in,
+                  uint32_t          used_out)
+{
+	(void)pthread_mutex_lock(&r->lock);
+	ratelimit_refill(r, mono_us());
+
+	struct ratelimit_bucket *b = &r->b[ratelimit_input];
+	b->avail += (double)input - (double)used_in;
+	if (b->avail > b->cap)
+		b->avail = b->cap;
+	b = &r->b[ratelimit_output];
+	b->avail += (double)output - (double)used_out;
+	if (b->avail > b->cap)
+		b->avail = b->cap;
+
+	if (r->stats.inflight)
+		r->stats.inflight -= 1U;
+	r->seen = true;
+	ratelimit_wake(r);
+	(void)pthread_mutex_unlock(&r->lock);
+}
+
+int
+ratelimit_header (struct ratelimit *r,
+                  char const       *s,
+                  size_t            n)
+{
+	/* The limit and the remaining count of each kind, in kind order. */
+	static char const *const names[ratelimit_kinds * 2U] = {
+		"anthropic-ratelimit-requests-limit",
+		"anthropic-ratelimit-requests-remaining",
+		"anthropic-ratelimit-input-tokens-limit",
+		"anthropic-ratelimit-input-tokens-remaining",
+		"anthropic-ratelimit-output-tokens-limit",
+		"anthropic-ratelimit-output-tokens-remaining",
+	};
+
+	dstr val;
+	unsigned i = ratelimit_kinds;
+	bool remaining = false;
+	bool retry = http_header_is(s, n, "retry-after", &val);
+	for (unsigned j = 0; !retry && j < ratelimit_kinds * 2U; ++j) {
+		if (http_header_is(s, n, names[j], &val)) {
+			i = j / 2U;
+			remaining = j & 1U;
+			break;
+		}
+	}
+	if (!retry && i == ratelimit_kinds)
+		return 0;
+
+	char const *v = dstr_get(&val);
+	size_t m = val.len;
+
+	int64_t x;
+	if (!m || (unsigned)(v[0] - '0') >= 10U || num_parse_i64(v, m, &x))
+		return EPROTO;
+	if (x > UINT32_MAX)
+		x = UINT32_MAX;
+
+	(void)pthread_mutex_lock(&r->lock);
+	uint64_t now = mono_us();
+	ratelimit_refill(r, now);
+	if (retry) {
+		uint64_t until = now + (uint64_t)x * 1000000U;
+		if (until > r->pause)
+			r->pause = until;
+		for (i = 0; i < ratelimit_kinds; ++i) {
+			if (r->b[i].avail > 0.0)
+				r->b[i].avail = 0.0;
+		}
+		r->stats.throttled += 1U;
+	} else if (remaining) {
+		/* Leave the same share of what remains as of the limit. */
+		struct ratelimit_bucket *b = &r->b[i];
+		double cap = (double)x * r->target / 1000.0;
+		if (b->limit && b->avail > cap)
+			b->avail = cap;
+	} else {
+		ratelimit_set_limit(r, i, (uint32_t)x);
+	}
+	r->seen = true;
+	ratelimit_wake(r);
+	(void)pthread_mutex_unlock(&r->lock);
+	return 0;
+}
+
+int
+ratelimit_response (struct ratelimit           *r,
+                    struct http_response const *res)
+{
+	char const *s = dstr_get(&res->head);
+	size_t len = res->head.len;
+	size_t throttled = ratelimit_stats(r).throttled;
+	int e = 0;
+
+	for (size_t i = 0; i < len;) {
+		char const *eol = memchr(&s[i], '\r', len - i);
+		size_t end = eol ? (size_t)(eol - s) : len;
+		int f = ratelimit_header(r, &s[i], end - i);
+		if (!e)
+			e = f;
+		i = end + 2U;
+	}
+
+	if (res->status == 429) {
+		(void)pthread_mutex_lock(&r->lock);
+		if (r->stats.throttled == throttled) {
+			uint64_t until = mono_us() +
+			                 RATELIMIT_PAUSE_MS * UINT64_C(1000);
+			if (until > r->pause)
+				r->pause = until;
+			r->stats.throttled += 1U;
+		}
+		(void)pthread_mutex_unlock(&r->lock);
+	}
+
+	return e;
+}
+
+struct ratelimit_stats
+ratelimit_stats (struct ratelimit *r)
+{
+	(void)pthread_mutex_lock(&r->lock);
+	struct ratelimit_stats st = r->stats;
+	(void)pthread_mutex_unlock(&r->lock);
+	return st;
+}
@@ -0,0 +1,233 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file ratelimit.h
+ *
+ * @brief Client-side pacing against API rate limits.
+ *
+ * Requests, input tokens, and output tokens each have a token bucket
+ * that refills continuously at a target share of the per-minute limit
+ * and holds at most a short burst of it. A request is admitted once
+ * every bucket can cover its estimated cost, which is charged up front
+ * and corrected when the actual usage is known. The rate-limit headers
+ * of every response update the limits and cap the buckets at what the
+ * server says remains, so capacity used by other clients of the same
+ * key is accounted for, and a `retry-after` stops all admission until
+ * it has passed.
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_RATELIMIT_H_
+#define LIBCANTH_SRC_RATELIMIT_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "http.h"
+#include "util.h"
+
+/**
+ * @brief Default share of the limits to use, in permille.
+ */
+#define RATELIMIT_TARGET 950U
+
+/**
+ * @brief Default burst a bucket holds, as time of refill.
+ */
+#define RATELIMIT_BURST_MS 1000U
+
+/**
+ * @brief Default pause after a `429` without `retry-after`.
+ */
+#define RATELIMIT_PAUSE_MS 1000U
+
+/**
+ * @brief Rate-limited quantities.
+ */
+fixed_enum(ratelimit_kind, uint8_t) {
+	ratelimit_requests, //!< Requests per minute.
+	ratelimit_input,    //!< Input tokens per minute.
+	ratelimit_output,   //!< Output tokens per minute.
+	ratelimit_kinds,
+};
+
+/**
+ * @brief Configuration. Zero fields take their defaults.
+ *
+ * A limit left at zero is learned from the first response that has it.
+ * Until any response has been seen, only one request is let through.
+ */
+struct ratelimit_cfg {
+	uint32_t limit[ratelimit_kinds]; //!< Per-minute limits.
+	uint32_t target;                 //!< Share to use, in permille.
+	uint32_t burst_ms;               //!< Burst a bucket holds.
+};
+
+/**
+ * @brief Statistics.
+ */
+struct ratelimit_stats {
+	size_t   admitted;               //!< Requests admitted.
+	size_t   waited;                 //!< Requests that had to wait.
+	size_t   timeouts;               //!< Requests that gave up waiting.
+	size_t   throttled;              //!< Responses with `retry-after`.
+	size_t   inflight;               //!< Requests not yet settled.
+	uint32_t limit[ratelimit_kinds]; //!< Current limits.
+};
+
+/**
+ * @brief Token bucket of one quantity.
+ */
+struct ratelimit_bucket {
+	double   avail; //!< Tokens available, negative if overdrawn.
+	double   cap;   //!< Most tokens held.
+	double   rate;  //!< Refill per microsecond, 0 if unlimited.
+	uint32_t limit; //!< Per-minute limit, 0 if unknown.
+};
+
+struct ratelimit_waiter;
+
+/**
+ * @brief Scheduler.
+ *
+ * Waiting requests are admitted in arrival order, so a large request
+ * isn't starved by a stream of small ones.
+ */
+struct ratelimit {
+	pthread_mutex_t          lock;     //!< Guards everything below.
+	pthread_condattr_t       attr;     //!< Monotonic clock for waits.
+	struct ratelimit_bucket  b[ratelimit_kinds]; //!< Buckets.
+	struct ratelimit_waiter *head;     //!< First waiting request.
+	struct ratelimit_waiter *tail;     //!< Last waiting request.
+	uint64_t                 last;     //!< Time of last refill, in us.
+	uint64_t                 pause;    //!< No admission before this.
+	uint32_t                 target;   //!< Share to use, in permille.
+	uint32_t                 burst_ms; //!< Burst a bucket holds.
+	bool                     seen;     //!< A response has been seen.
+	struct ratelimit_stats   stats;    //!< Statistics.
+};
+
+/**
+ * @brief Initialize a scheduler.
+ *
+ * @param[out] r   Scheduler.
+ * @param[in]  cfg Configuration, or `NULL` for the defaults.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+ratelimit_init (struct ratelimit           *r,
+                struct ratelimit_cfg const *cfg) nonnull_in(1);
+
+/**
+ * @brief Release a scheduler. No request may be waiting.
+ */
+extern void
+ratelimit_fini (struct ratelimit *r) nonnull_in();
+
+/**
+ * @brief Estimate the input tokens of a text.
+ *
+ * Counts about four ASCII bytes per token and a token per non-ASCII
+ * character, which errs on the high side for most text. The estimate
+ * is only charged up front, so it needn't be exact.
+ *
+ * @param[in] s Text, UTF-8.
+ * @param[in] n Length of @p s.
+ * @return Estimated tokens.
+ */
+extern uint32_t
+ratelimit_estimate (char const *s,
+                    size_t      n);
+
+/**
+ * @brief Wait until a request can be sent, and charge it.
+ *
+ * Every admitted request must be settled with @ref ratelimit_settle().
+ *
+ * @param[in,out] r          Scheduler.
+ * @param[in]     input      Estimated input tokens.
+ * @param[in]     output     Output token limit of the request.
+ * @param[in]     timeout_ms Longest wait, or 0 to wait indefinitely.
+ * @return 0 once admitted, `ETIMEDOUT` if the wait timed out.
+ */
+extern int
+ratelimit_acquire (struct ratelimit *r,
+                   uint32_t          input,
+                   uint32_t          output,
+                   uint32_t          timeout_ms) nonnull_in();
+
+/**
+ * @brief Admit a request if it can be sent right away.
+ *
+ * For callers that can't block, such as event loop callbacks. A request
+ * is never admitted ahead of a waiting one.
+ *
+ * @param[in,out] r       Scheduler.
+ * @param[in]     input   Estimated input tokens.
+ * @param[in]     output  Output token limit of the request.
+ * @param[out]    wait_ms Time after which to try again, if not
+ *                        admitted.
+ * @return 0 if admitted, otherwise `EAGAIN`.
+ */
+extern int
+ratelimit_try (struct ratelimit *r,
+               uint32_t          input,
+               uint32_t          output,
+               uint32_t         *wait_ms) nonnull_in();
+
+/**
+ * @brief Settle a request with its actual usage.
+ *
+ * The difference to what was charged is returned to or taken from the
+ * buckets. A request that failed before reaching the server should be
+ * settled with zero usage.
+ *
+ * @param[in,out] r        Scheduler.
+ * @param[in]     input    Input tokens charged.
+ * @param[in]     output   Output tokens charged.
+ * @param[in]     used_in  Input tokens used.
+ * @param[in]     used_out Output tokens used.
+ */
+extern void
+ratelimit_settle (struct ratelimit *r,
+                  uint32_t          input,
+                  uint32_t          output,
+                  uint32_t          used_in,
+                  uint32_t          used_out) nonnull_in();
+
+/**
+ * @brief Update the scheduler from a response header line.
+ *
+ * Reads `anthropic-ratelimit-{requests,input-tokens,output-tokens}-
+ * {limit,remaining}` and `retry-after`, and ignores other headers.
+ * Meant to be called from the header callback of an event loop stream
+ * as well as by @ref ratelimit_response().
+ *
+ * @param[in,out] r Scheduler.
+ * @param[in]     s Header line without the line terminator.
+ * @param[in]     n Length of @p s.
+ * @return 0 on success, `EPROTO` if a rate-limit header is malformed.
+ */
+extern int
+ratelimit_header (struct ratelimit *r,
+                  char const       *s,
+                  size_t            n) nonnull_in();
+
+/**
+ * @brief Update the scheduler from every header of a response.
+ *
+ * A `429` without `retry-after` pauses admission for
+ * @ref RATELIMIT_PAUSE_MS.
+ *
+ * @return 0 on success, `EPROTO` if a rate-limit header is malformed.
+ */
+extern int
+ratelimit_response (struct ratelimit           *r,
+                    struct http_response const *res) nonnull_in();
+
+/**
+ * @brief Get a snapshot of the statistics.
+ */
+extern struct ratelimit_stats
+ratelimit_stats (struct ratelimit *r) nonnull_in();
+
+#endif /* LIBCANTH_SRC_RATELIMIT_H_ */
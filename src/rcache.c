@@ -0,0 +1,909 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file rcache.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "jtape.h"
+#include "jwriter.h"
+#include "mono.h"
+#include "rcache.h"
+
+__extension__ typedef unsigned __int128 u128;
+
+/**
+ * @brief First bytes of the segment and index files.
+ */
+static char const rcache_seg_magic[8] = "RCSEG01\n";
+static char const rcache_idx_magic[8] = "RCIDX01\n";
+
+/**
+ * @brief First word of a record.
+ */
+#define RCACHE_REC_MAGIC 0x31524352U
+
+/**
+ * @brief What an item of a record holds.
+ */
+fixed_enum(rcache_kind, uint8_t) {
+	rcache_header = 1U, //!< Header line.
+	rcache_head,        //!< Response framing.
+	rcache_event,       //!< Event type, data and ID.
+	rcache_data,        //!< Body bytes.
+};
+
+/**
+ * @brief Record as laid out in the segment, followed by its items.
+ */
+struct rcache_head {
+	uint32_t          magic; //!< @ref RCACHE_REC_MAGIC
+	uint32_t          items; //!< Number of items.
+	struct rcache_key key;   //!< Key of the request.
+	uint64_t          size;  //!< Bytes of items.
+	uint64_t          sum;   //!< Hash of the items.
+};
+
+/**
+ * @brief Item as laid out in a record, followed by its bytes and
+ *        padding to a multiple of eight.
+ */
+struct rcache_item {
+	uint32_t us;     //!< Time since the previous item.
+	uint8_t  kind;   //!< @ref rcache_kind
+	uint8_t  pad[3];
+	uint32_t len[3]; //!< Lengths of the parts of the bytes.
+	uint32_t pad2;
+	int64_t  retry;  //!< Retry field of an event.
+};
+
+/**
+ * @brief Response framing as laid out in a @ref rcache_head item.
+ */
+struct rcache_frame {
+	uint64_t length;
+	int32_t  status;
+	uint8_t  sized;
+	uint8_t  chunked;
+	uint8_t  keep;
+	uint8_t  events;
+};
+
+/**
+ * @brief Index entry, also as laid out in the index file.
+ */
+struct rcache_slot {
+	struct rcache_key key;
+	uint64_t          off; //!< Record offset, 0 for a free slot.
+};
+
+static const_inline uint64_t
+rcache_fold (uint64_t a,
+             uint64_t b)
+{
+	u128 m = (u128)a * b;
+	return (uint64_t)m ^ (uint64_t)(m >> 64U);
+}
+
+static force_inline uint64_t
+rcache_word (uint8_t const *s)
+{
+	uint64_t v;
+	memcpy(&v, s, sizeof v);
+	return v;
+}
+
+/**
+ * @brief Hash bytes into two independent 64-bit lanes.
+ */
+static void
+rcache_hash (void const *data,
+             size_t      len,
+             uint64_t    seed,
+             uint64_t    h[2])
+{
+	uint8_t const *s = data;
+	uint64_t a = seed ^ 0xa0761d6478bd642fU;
+	uint64_t b = seed ^ 0xe7037ed1a0b428dbU ^ len;
+
+	for (size_t n = len; n; ) {
+		uint8_t t[16] = {0};
+		uint8_t const *p = s;
+		if (n < 16U) {
+			memcpy(t, s, n);
+			p = t;
+		}
+		uint64_t x = rcache_word(p), y = rcache_word(&p[8]);
+		a = rcache_fold(x ^ a ^ 0x8ebc6af09c88c6e3U,
+		                y ^ 0x589965cc75374cc3U);
+		b = rcache_fold(y ^ b ^ 0x1d8e4e27c47d124fU,
+		                x ^ 0x2d358dccaa6c78a5U);
+		s += 16U;
+		n -= n < 16U ? n : 16U;
+	}
+
+	h[0] = rcache_fold(a ^ 0xe7037ed1a0b428dbU, b ^ len);
+	h[1] = rcache_fold(b ^ 0xa0761d6478bd642fU, a ^ h[0]);
+}
+
+static const_inline bool
+rcache_key_eq (struct rcache_key const *a,
+               struct rcache_key const *b)
+{
+	return a->h[0] == b->h[0] && a->h[1] == b->h[1];
+}
+
+/**
+ * @brief Compare the names of two object members.
+ */
+static int
+rcache_cmp (struct jtape const *t,
+            size_t              a,
+            size_t              b)
+{
+	dstr x = jtape_str(t, a), y = jtape_str(t, b);
+	int d = memcmp(dstr_get(&x), dstr_get(&y),
+	               x.len < y.len ? x.len : y.len);
+	return d ? d : (x.len > y.len) - (x.len < y.len);
+}
+
+/**
+ * @brief Write a value in canonical form.
+ */
+static int
+rcache_canon (struct jwriter     *w,
+              struct jtape const *t,
+              size_t              i)
+{
+	enum jtape_type y = jtape_type(t, i);
+	size_t end = y == jtape_object || y == jtape_array
+	             ? jtape_payload(t, i) - 1U : i;
+
+	if (y == jtape_array) {
+		(void)jwriter_array_begin(w);
+		for (size_t j = i + 1U; !w->ec && j < end; j = jtape_skip(t, j))
+			(void)rcache_canon(w, t, j);
+		return jwriter_array_end(w);
+	}
+
+	if (y != jtape_object)
+		return jwriter_tape(w, t, i);
+
+	size_t n = 0;
+	for (size_t j = i + 1U; j < end; j = jtape_skip(t, j + 1U))
+		++n;
+
+	size_t *m = n ? malloc(n * sizeof *m) : nullptr;
+	if (n && !m)
+		return errno;
+
+	/* Insertion sort, stable for repeated names. */
+	n = 0;
+	for (size_t j = i + 1U; j < end; j = jtape_skip(t, j + 1U)) {
+		size_t k = n++;
+		for (; k && rcache_cmp(t, m[k - 1U], j) > 0; --k)
+			m[k] = m[k - 1U];
+		m[k] = j;
+	}
+
+	(void)jwriter_object_begin(w);
+	for (size_t k = 0; !w->ec && k < n; ++k) {
+		dstr s = jtape_str(t, m[k]);
+		(void)jwriter_key(w, dstr_get(&s), s.len);
+		(void)rcache_canon(w, t, m[k] + 1U);
+	}
+	free(m);
+	return jwriter_object_end(w);
+}
+
+int
+rcache_key (struct rcache_key *k,
+            char const        *path,
+            void const        *body,
+            size_t             len)
+{
+	struct jtape t = {0};
+	dstr s = {0};
+	struct jwriter w;
+
+	int e = jtape_parse(&t, body, len);
+	jwriter_init(&w, &s, len);
+	if (!e)
+		(void)rcache_canon(&w, &t, 1U);
+	int we = jwriter_end(&w);
+	if (!e)
+		e = we;
+
+	if (!e) {
+		uint64_t seed = 0;
+		if (path) {
+			rcache_hash(path, strlen(path), 0, k->h);
+			seed = k->h[0];
+		}
+		rcache_hash(dstr_get(&s), s.len, seed, k->h);
+	}
+
+	dstr_fini(&s);
+	jtape_fini(&t);
+	return e;
+}
+
+static int
+rcache_pwrite (int         fd,
+               void const *src,
+               size_t      len,
+               uint64_t    off)
+{
+	for (char const *p = src; len;) {
+		ssize_t n = pwrite(fd, p, len, (off_t)off);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		p += n;
+		len -= (size_t)n;
+		off += (uint64_t)n;
+	}
+	return 0;
+}
+
+static int
+rcache_pread (int       fd,
+              void     *dst,
+              size_t    len,
+              uint64_t  off)
+{
+	for (char *p = dst; len;) {
+		ssize_t n = pread(fd, p, len, (off_t)off);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		if (!n)
+			return EIO;
+		p += n;
+		len -= (size_t)n;
+		off += (uint64_t)n;
+	}
+	return 0;
+}
+
+nonnull_in()
+static struct rcache_slot *
+rcache_find (struct rcache const     *c,
+             struct rcache_key const *k)
+{
+	size_t mask = c->cap - 1U;
+	for (size_t i = (size_t)k->h[0] & mask;; i = (i + 1U) & mask) {
+		struct rcache_slot *s = &c->tab[i];
+		if (!s->off || rcache_key_eq(&s->key, k))
+			return s;
+	}
+}
+
+nonnull_in()
+static int
+rcache_insert (struct rcache           *c,
+               struct rcache_key const *k,
+               uint64_t                 off)
+{
+	if ((c->stats.records + 1U) * 2U > c->cap) {
+		size_t cap = c->cap ? c->cap * 2U : 1024U;
+		struct rcache_slot *tab = calloc(cap, sizeof *tab);
+		if (!tab)
+			return errno;
+		struct rcache_slot *old = c->tab;
+		size_t n = c->cap;
+		c->tab = tab;
+		c->cap = cap;
+		for (size_t i = 0; i < n; ++i) {
+			if (old[i].off)
+				*rcache_find(c, &old[i].key) = old[i];
+		}
+		free(old);
+	}
+
+	struct rcache_slot *s = rcache_find(c, k);
+	if (s->off)
+		return EEXIST;
+	*s = (struct rcache_slot){.key = *k, .off = off};
+	c->stats.records += 1U;
+	return 0;
+}
+
+/**
+ * @brief Check that a whole record lies at @p off.
+ *
+ * @param[in]  c    Cache.
+ * @param[in]  fsz  Size of the segment file.
+ * @param[in]  off  Record offset.
+ * @param[in]  k    Expected key, or `NULL` to accept any.
+ * @param[in]  sum  Whether to verify the hash of the items as well.
+ * @param[out] h    Record head.
+ * @return Whether the record is intact.
+ */
+static bool
+rcache_valid (struct rcache const     *c,
+              uint64_t                 fsz,
+              uint64_t                 off,
+              struct rcache_key const *k,
+              bool                     sum,
+              struct rcache_head      *h)
+{
+	if (off < sizeof rcache_seg_magic || off % 8U ||
+	    fsz < sizeof *h || off > fsz - sizeof *h)
+		return false;
+
+	memcpy(h, &c->map[off], sizeof *h);
+	if (h->magic != RCACHE_REC_MAGIC || h->size % 8U ||
+	    h->size > fsz - off - sizeof *h ||
+	    (k && !rcache_key_eq(k, &h->key)))
+		return false;
+
+	if (sum) {
+		uint64_t v[2];
+		rcache_hash(&c->map[off + sizeof *h], (size_t)h->size, 0, v);
+		if (v[0] != h->sum)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Load the index, drop entries that don't match a record, and
+ *        index any intact records past the last entry.
+ */
+nonnull_in()
+static int
+rcache_load (struct rcache *c,
+             uint64_t       fsz)
+{
+	struct stat st;
+	if (fstat(c->ifd, &st))
+		return errno;
+
+	uint64_t isz = (uint64_t)st.st_size;
+	char magic[sizeof rcache_idx_magic] = {0};
+	int e = 0;
+	if (isz >= sizeof magic)
+		e = rcache_pread(c->ifd, magic, sizeof magic, 0);
+	if (e)
+		return e;
+
+	c->size = sizeof rcache_seg_magic;
+	c->isize = sizeof rcache_idx_magic;
+	if (memcmp(magic, rcache_idx_magic, sizeof magic)) {
+		isz = 0;
+		e = rcache_pwrite(c->ifd, rcache_idx_magic,
+		                  sizeof rcache_idx_magic, 0);
+	}
+
+	struct rcache_slot buf[256];
+	struct rcache_head h;
+	for (uint64_t off = c->isize; !e && off + sizeof *buf <= isz;) {
+		size_t n = (size_t)((isz - off) / sizeof *buf);
+		if (n > sizeof buf / sizeof *buf)
+			n = sizeof buf / sizeof *buf;
+		e = rcache_pread(c->ifd, buf, n * sizeof *buf, off);
+		for (size_t i = 0; !e && i < n; ++i) {
+			if (buf[i].off != c->size ||
+			    !rcache_valid(c, fsz, buf[i].off, &buf[i].key,
+			                  false, &h))
+				goto scan;
+			e = rcache_insert(c, &buf[i].key, buf[i].off);
+			if (e == EEXIST)
+				e = 0;
+			c->size += sizeof h + h.size;
+			c->isize += sizeof *buf;
+		}
+		off += n * sizeof *buf;
+	}
+
+scan:
+	if (!e && isz > c->isize && ftruncate(c->ifd, (off_t)c->isize))
+		e = errno;
+
+	/* Records the index lost in a crash. */
+	while (!e && rcache_valid(c, fsz, c->size, nullptr, true, &h)) {
+		struct rcache_slot s = {.key = h.key, .off = c->size};
+		e = rcache_insert(c, &h.key, c->size);
+		if (!e) {
+			e = rcache_pwrite(c->ifd, &s, sizeof s, c->isize);
+			c->isize += sizeof s;
+			c->stats.recovered += 1U;
+		} else if (e == EEXIST) {
+			e = 0;
+		}
+		c->size += sizeof h + h.size;
+	}
+
+	/* Torn record at the end. */
+	if (!e && fsz > c->size) {
+		c->stats.corrupt += 1U;
+		if (ftruncate(c->fd, (off_t)c->size))
+			e = errno;
+	}
+
+	c->stats.bytes = c->size;
+	return e;
+}
+
+int
+rcache_open (struct rcache *c,
+             char const    *path,
+             uint64_t       max)
+{
+	*c = (struct rcache){
+		.map = MAP_FAILED,
+		.max = max ? max : RCACHE_MAX_BYTES,
+		.fd  = -1,
+		.ifd = -1,
+	};
+	if (c->max > SIZE_MAX)
+		return EFBIG;
+
+	size_t n = strlen(path);
+	char *ipath = malloc(n + sizeof ".idx");
+	if (!ipath)
+		return errno;
+	memcpy(ipath, path, n);
+	memcpy(&ipath[n], ".idx", sizeof ".idx");
+
+	int e = 0;
+	struct stat st;
+	c->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+	if (c->fd < 0)
+		e = errno;
+	else if (flock(c->fd, LOCK_EX | LOCK_NB))
+		e = errno == EWOULDBLOCK ? EBUSY : errno;
+	else if (fstat(c->fd, &st))
+		e = errno;
+	if (!e && (c->ifd = open(ipath, O_RDWR | O_CREAT | O_CLOEXEC,
+	                         0666)) < 0)
+		e = errno;
+	free(ipath);
+
+	uint64_t fsz = e ? 0 : (uint64_t)st.st_size;
+	if (!e && !fsz) {
+		e = rcache_pwrite(c->fd, rcache_seg_magic,
+		                  sizeof rcache_seg_magic, 0);
+		fsz = sizeof rcache_seg_magic;
+	} else if (!e && fsz > c->max) {
+		e = EFBIG;
+	}
+
+	if (!e) {
+		void *m = mmap(nullptr, (size_t)c->max, PROT_READ, MAP_SHARED,
+		               c->fd, 0);
+		if (m == MAP_FAILED)
+			e = errno;
+		else
+			c->map = m;
+	}
+	if (!e && (fsz < sizeof rcache_seg_magic ||
+	           memcmp(c->map, rcache_seg_magic, sizeof rcache_seg_magic)))
+		e = EINVAL;
+
+	if (!e)
+		e = rcache_load(c, fsz);
+	if (!e)
+		e = pthread_mutex_init(&c->lock, nullptr);
+	if (e) {
+		if (c->map != MAP_FAILED)
+			(void)munmap((void *)c->map, (size_t)c->max);
+		if (c->fd >= 0)
+			(void)close(c->fd);
+		if (c->ifd >= 0)
+			(void)close(c->ifd);
+		free(c->tab);
+		*c = (struct rcache){.map = MAP_FAILED, .fd = -1, .ifd = -1};
+	}
+	return e;
+}
+
+void
+rcache_close (struct rcache *c)
+{
+	if (c->map == MAP_FAILED)
+		return;
+	(void)munmap((void *)c->map, (size_t)c->max);
+	(void)close(c->fd);
+	(void)close(c->ifd);
+	free(c->tab);
+	(void)pthread_mutex_destroy(&c->lock);
+	*c = (struct rcache){.map = MAP_FAILED, .fd = -1, .ifd = -1};
+}
+
+/**
+ * @brief Append a record and index it.
+ */
+nonnull_in()
+static int
+rcache_append (struct rcache           *c,
+               struct rcache_key const *k,
+               void const              *items,
+               size_t                   size,
+               uint32_t                 count)
+{
+	struct rcache_head h = {
+		.magic = RCACHE_REC_MAGIC,
+		.items = count,
+		.key   = *k,
+		.size  = size,
+	};
+	uint64_t v[2];
+	rcache_hash(items, size, 0, v);
+	h.sum = v[0];
+
+	(void)pthread_mutex_lock(&c->lock);
+	int e = c->tab && rcache_find(c, k)->off ? EEXIST
+	      : c->size + sizeof h + size > c->max ? EFBIG : 0;
+	if (!e)
+		e = rcache_pwrite(c->fd, &h, sizeof h, c->size);
+	if (!e)
+		e = rcache_pwrite(c->fd, items, size, c->size + sizeof h);
+
+	struct rcache_slot s = {.key = *k, .off = c->size};
+	if (!e)
+		e = rcache_pwrite(c->ifd, &s, sizeof s, c->isize);
+	if (!e)
+		e = rcache_insert(c, k, c->size);
+
+	if (!e) {
+		c->size += sizeof h + size;
+		c->isize += sizeof s;
+		c->stats.stored += 1U;
+		c->stats.bytes = c->size;
+	} else {
+		if (e != EEXIST)
+			(void)ftruncate(c->fd, (off_t)c->size);
+		c->stats.skipped += 1U;
+	}
+	(void)pthread_mutex_unlock(&c->lock);
+	return e;
+}
+
+int
+rcache_get (struct rcache           *c,
+            struct rcache_key const *k,
+            struct rcache_hit       *h)
+{
+	*h = (struct rcache_hit){0};
+
+	(void)pthread_mutex_lock(&c->lock);
+	uint64_t off = c->tab ? rcache_find(c, k)->off : 0;
+	if (!off)
+		c->stats.misses += 1U;
+	uint64_t size = c->size;
+	(void)pthread_mutex_unlock(&c->lock);
+	if (!off)
+		return ENOENT;
+
+	/* Records never change once written, so no lock is needed. */
+	struct rcache_head rh;
+	bool ok = rcache_valid(c, size, off, k, true, &rh);
+
+	(void)pthread_mutex_lock(&c->lock);
+	if (ok)
+		c->stats.hits += 1U;
+	else
+		c->stats.corrupt += 1U;
+	(void)pthread_mutex_unlock(&c->lock);
+	if (!ok)
+		return EBADMSG;
+
+	*h = (struct rcache_hit){
+		.p     = &c->map[off + sizeof rh],
+		.size  = rh.size,
+		.items = rh.items,
+	};
+	return 0;
+}
+
+int
+rcache_replay (struct rcache_hit const *h,
+               uint32_t                 pace,
+               struct hloop_ops const  *ops,
+               void                    *ctx)
+{
+	int e = 0, status = 0;
+	uint64_t off = 0;
+
+	for (uint32_t i = 0; i < h->items; ++i) {
+		struct rcache_item it;
+		if (h->size - off < sizeof it) {
+			e = EBADMSG;
+			break;
+		}
+		memcpy(&it, &h->p[off], sizeof it);
+		off += sizeof it;
+
+		uint64_t len = (uint64_t)it.len[0] + it.len[1] + it.len[2];
+		if (h->size - off < len) {
+			e = EBADMSG;
+			break;
+		}
+		char const *s = (char const *)&h->p[off];
+		off += (len + 7U) & ~UINT64_C(7);
+
+		if (pace && it.us)
+			mono_sleep_us((uint64_t)it.us * pace / 1000U);
+
+		switch (it.kind) {
+		case rcache_header:
+			if (ops->header)
+				ops->header(ctx, s, it.len[0]);
+			break;
+		case rcache_head: {
+			struct rcache_frame rf;
+			if (it.len[0] != sizeof rf) {
+				e = EBADMSG;
+				break;
+			}
+			memcpy(&rf, s, sizeof rf);
+			struct http_frame f = {
+				.length  = rf.length,
+				.status  = rf.status,
+				.sized   = rf.sized,
+				.chunked = rf.chunked,
+				.keep    = rf.keep,
+				.events  = rf.events,
+			};
+			status = f.status;
+			if (ops->head)
+				ops->head(ctx, &f);
+			break;
+		}
+		case rcache_event: {
+			struct sse_event ev = {
+				.event = make_dstr_view_from_decay(s, it.len[0]),
+				.data  = make_dstr_view_from_decay(
+				                 &s[it.len[0]], it.len[1]),
+				.id    = make_dstr_view_from_decay(
+				                 &s[it.len[0] + it.len[1]], it.len[2]),
+				.retry = it.retry,
+			};
+			if (ops->event)
+				ops->event(ctx, &ev);
+			break;
+		}
+		case rcache_data:
+			if (ops->data)
+				ops->data(ctx, s, it.len[0]);
+			break;
+		default:
+			e = EBADMSG;
+			break;
+		}
+		if (e)
+			break;
+	}
+
+	if (ops->done)
+		ops->done(ctx, e, status);
+	return e;
+}
+
+/**
+ * @brief Append an item of up to three parts to a recording.
+ */
+nonnull_in(1)
+static void
+rcache_rec_add (struct rcache_rec *r,
+                enum rcache_kind   kind,
+                void const        *a,
+                size_t             na,
+                void const        *b,
+                size_t             nb,
+                void const        *c,
+                size_t             nc,
+                int64_t            retry)
+{
+	if (r->e)
+		return;
+	if (na > UINT32_MAX || nb > UINT32_MAX || nc > UINT32_MAX) {
+		r->e = EMSGSIZE;
+		return;
+	}
+
+	size_t len = na + nb + nc, need = sizeof (struct rcache_item) +
+	                                  ((len + 7U) & ~(size_t)7U);
+	if (r->cap - r->len < need) {
+		size_t cap = r->cap ? r->cap : 4096U;
+		while (cap - r->len < need)
+			cap *= 2U;
+		uint8_t *p = realloc(r->buf, cap);
+		if (!p) {
+			r->e = ENOMEM;
+			return;
+		}
+		r->buf = p;
+		r->cap = cap;
+	}
+
+	uint64_t now = mono_us();
+	struct rcache_item it = {
+		.us    = now - r->last > UINT32_MAX
+		         ? UINT32_MAX : (uint32_t)(now - r->last),
+		.kind  = kind,
+		.len   = {(uint32_t)na, (uint32_t)nb, (uint32_t)nc},
+		.retry = retry,
+	};
+	r->last = now;
+
+	uint8_t *p = &r->buf[r->len];
+	memcpy(p, &it, sizeof it);
+	p += sizeof it;
+	if (na)
+		memcpy(p, a, na);
+	if (nb)
+		memcpy(&p[na], b, nb);
+	if (nc)
+		memcpy(&p[na + nb], c, nc);
+	memset(&p[len], 0, need - sizeof it - len);
+
+	r->len += need;
+	r->items += 1U;
+}
+
+void
+rcache_rec_init (struct rcache_rec       *r,
+                 struct rcache           *c,
+                 struct rcache_key const *k,
+                 struct hloop_ops const  *ops,
+                 void                    *ctx)
+{
+	*r = (struct rcache_rec){
+		.c    = c,
+		.key  = *k,
+		.ops  = ops,
+		.ctx  = ctx,
+		.last = mono_us(),
+	};
+}
+
+void
+rcache_rec_fini (struct rcache_rec *r)
+{
+	free(r->buf);
+	r->buf = nullptr;
+	r->len = r->cap = 0;
+	r->items = 0;
+}
+
+static void
+rcache_on_header (void       *ctx,
+                  char const *s,
+                  size_t      n)
+{
+	struct rcache_rec *r = ctx;
+	rcache_rec_add(r, rcache_header, s, n, nullptr, 0, nullptr, 0, 0);
+	if (r->ops->header)
+		r->ops->header(r->ctx, s, n);
+}
+
+static void
+rcache_on_head (void                    *ctx,
+                struct http_frame const *f)
+{
+	struct rcache_rec *r = ctx;
+	struct rcache_frame rf = {
+		.length  = f->length,
+		.status  = f->status,
+		.sized   = f->sized,
+		.chunked = f->chunked,
+		.keep    = f->keep,
+		.events  = f->events,
+	};
+	rcache_rec_add(r, rcache_head, &rf, sizeof rf, nullptr, 0, nullptr,
+	               0, 0);
+	if (r->ops->head)
+		r->ops->head(r->ctx, f);
+}
+
+static void
+rcache_on_event (void                   *ctx,
+                 struct sse_event const *ev)
+{
+	struct rcache_rec *r = ctx;
+	rcache_rec_add(r, rcache_event,
+	               dstr_get(&ev->event), ev->event.len,
+	               dstr_get(&ev->data), ev->data.len,
+	               dstr_get(&ev->id), ev->id.len, ev->retry);
+	if (r->ops->event)
+		r->ops->event(r->ctx, ev);
+}
+
+static void
+rcache_on_data (void       *ctx,
+                void const *s,
+                size_t      n)
+{
+	struct rcache_rec *r = ctx;
+	rcache_rec_add(r, rcache_data, s, n, nullptr, 0, nullptr, 0, 0);
+	if (r->ops->data)
+		r->ops->data(r->ctx, s, n);
+}
+
+static void
+rcache_on_done (void *ctx,
+                int   e,
+                int   status)
+{
+	struct rcache_rec *r = ctx;
+	if (!e && !r->e && status >= 200 && status < 300) {
+		(void)rcache_append(r->c, &r->key, r->buf, r->len, r->items);
+	} else {
+		(void)pthread_mutex_lock(&r->c->lock);
+		r->c->stats.skipped += 1U;
+		(void)pthread_mutex_unlock(&r->c->lock);
+	}
+	rcache_rec_fini(r);
+
+	if (r->ops->done)
+		r->ops->done(r->ctx, e, status);
+}
+
+struct hloop_ops const rcache_rec_ops = {
+	.header = rcache_on_header,
+	.head   = rcache_on_head,
+	.event  = rcache_on_event,
+	.data   = rcache_on_data,
+	.done   = rcache_on_done,
+};
+
+int
+rcache_put_response (struct rcache              *c,
+                     struct rcache_key const    *k,
+                     struct http_response const *res)
+{
+	static struct hloop_ops const none = {0};
+	struct rcache_rec r;
+	rcache_rec_init(&r, c, k, &none, nullptr);
+
+	char const *s = dstr_get(&res->head);
+	for (size_t i = 0, n = res->head.len; i < n;) {
+		char const *eol = memchr(&s[i], '\n', n - i);
+		size_t end = eol ? (size_t)(eol - s) : n, len = end - i;
+		if (len && s[end - 1U] == '\r')
+			--len;
+		if (len)
+			rcache_rec_add(&r, rcache_header, &s[i], len, nullptr,
+			               0, nullptr, 0, 0);
+		i = end + 1U;
+	}
+
+	struct rcache_frame rf = {
+		.length = res->body.len,
+		.status = res->status,
+		.sized  = 1U,
+		.keep   = 1U,
+	};
+	rcache_rec_add(&r, rcache_head, &rf, sizeof rf, nullptr, 0, nullptr,
+	               0, 0);
+	if (res->body.len)
+		rcache_rec_add(&r, rcache_data, dstr_get(&res->body),
+		               res->body.len, nullptr, 0, nullptr, 0, 0);
+
+	int e = r.e ? r.e : rcache_append(c, k, r.buf, r.len, r.items);
+	rcache_rec_fini(&r);
+	return e;
+}
+
+struct rcache_stats
+rcache_stats (struct rcache *c)
+{
+	(void)pthread_mutex_lock(&c->lock);
+	struct rcache_stats st = c->stats;
+	(void)pthread_mutex_unlock(&c->lock);
+	return st;
+}
@@ -0,0 +1,233 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file rcache.h
+ *
+ * @brief Content-addressed on-disk response cache.
+ *
+ * Responses are keyed by a hash of the request path and body, the body
+ * canonicalized first so that whitespace and member order don't
+ * matter. A response is recorded as the sequence of callbacks a
+ * @ref hloop stream makes, header lines, head, events or body data,
+ * each with the time since the previous one, and replayed through the
+ * same callbacks with the original timing, scaled timing, or none.
+ *
+ * Records are appended to a segment file, which is mapped once with
+ * room to grow so that records can be replayed in place for as long as
+ * the cache is open. A second file indexes the records by key. Either
+ * file may be cut short by a crash: index entries that don't match a
+ * record are dropped, records past the last indexed one are checked
+ * and indexed again, and a torn record at the end is cut off.
+ *
+ * The index is loaded only when opening, so a cache is open in at most
+ * one place at a time. Opening takes an exclusive lock on the segment
+ * file, held until the cache is closed, and another process or another
+ * @ref rcache in the same one fails to open it meanwhile. Threads share
+ * one open cache instead.
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_RCACHE_H_
+#define LIBCANTH_SRC_RCACHE_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hloop.h"
+#include "http.h"
+#include "sse.h"
+#include "util.h"
+
+/**
+ * @brief Default size the segment file can grow to, and the size of
+ *        address space its mapping reserves.
+ */
+#define RCACHE_MAX_BYTES ((uint64_t)1 << 36U)
+
+/**
+ * @brief Response cache key.
+ */
+struct rcache_key {
+	uint64_t h[2];
+};
+
+/**
+ * @brief Statistics.
+ */
+struct rcache_stats {
+	size_t   records;   //!< Records in the cache.
+	size_t   hits;      //!< Lookups that found a record.
+	size_t   misses;    //!< Lookups that didn't.
+	size_t   stored;    //!< Records appended since opening.
+	size_t   skipped;   //!< Responses not stored: failed, not 2xx,
+	                    //!< or already cached.
+	size_t   recovered; //!< Records indexed again when opening.
+	size_t   corrupt;   //!< Records found damaged.
+	uint64_t bytes;     //!< Size of the segment file.
+};
+
+struct rcache_slot;
+
+/**
+ * @brief Response cache, shared by any number of threads.
+ */
+struct rcache {
+	pthread_mutex_t     lock;  //!< Guards everything below.
+	uint8_t const      *map;   //!< Mapping of the segment file.
+	uint64_t            max;   //!< Size of @ref rcache::map.
+	uint64_t            size;  //!< Bytes of records in the segment.
+	uint64_t            isize; //!< Bytes of entries in the index.
+	int                 fd;    //!< Segment file.
+	int                 ifd;   //!< Index file.
+	struct rcache_slot *tab;   //!< Records by key.
+	size_t              cap;   //!< Size of @ref rcache::tab.
+	struct rcache_stats stats; //!< Statistics.
+};
+
+/**
+ * @brief Cached response, valid while the cache is open.
+ */
+struct rcache_hit {
+	uint8_t const *p;     //!< Items of the record.
+	uint64_t       size;  //!< Bytes of items.
+	uint32_t       items; //!< Number of items.
+};
+
+/**
+ * @brief Recorder of a response, to be passed as the context of
+ *        @ref rcache_rec_ops.
+ */
+struct rcache_rec {
+	struct rcache          *c;     //!< Cache.
+	struct rcache_key       key;   //!< Key of the request.
+	struct hloop_ops const *ops;   //!< Callbacks to pass everything to.
+	void                   *ctx;   //!< Context of @ref rcache_rec::ops.
+	uint8_t                *buf;   //!< Items recorded so far.
+	size_t                  len;   //!< Bytes in @ref rcache_rec::buf.
+	size_t                  cap;   //!< Size of @ref rcache_rec::buf.
+	uint64_t                last;  //!< Time of the last item, in us.
+	uint32_t                items; //!< Items recorded so far.
+	int                     e;     //!< Sticky recording error.
+};
+
+/**
+ * @brief Stream callbacks that record everything, pass it on to
+ *        @ref rcache_rec::ops, and store the response once it has
+ *        finished successfully with a 2xx status.
+ */
+extern struct hloop_ops const rcache_rec_ops;
+
+/**
+ * @brief Compute the key of a request.
+ *
+ * The body is parsed and written back out without whitespace and with
+ * the members of each object sorted by name, strings and numbers in
+ * their shortest form, so that equal requests get equal keys however
+ * they were serialized.
+ *
+ * @param[out] k    Key.
+ * @param[in]  path Request path, or `NULL`.
+ * @param[in]  body JSON body.
+ * @param[in]  len  Length of @p body.
+ * @return 0 on success, otherwise an error code of @ref jtape_parse().
+ */
+extern int
+rcache_key (struct rcache_key *k,
+            char const        *path,
+            void const        *body,
+            size_t             len) nonnull_in(1,3);
+
+/**
+ * @brief Open a cache, creating it if needed.
+ *
+ * @param[out] c    Cache.
+ * @param[in]  path Segment file path. The index is `PATH.idx`.
+ * @param[in]  max  Largest segment size, 0 for
+ *                  @ref RCACHE_MAX_BYTES.
+ * @return 0 on success, otherwise an error code. A file that isn't a
+ *         cache segment is `EINVAL`, and one that is already open is
+ *         `EBUSY`.
+ */
+extern int
+rcache_open (struct rcache *c,
+             char const    *path,
+             uint64_t       max) nonnull_in();
+
+/**
+ * @brief Close a cache. Hits become invalid.
+ */
+extern void
+rcache_close (struct rcache *c) nonnull_in();
+
+/**
+ * @brief Look up a response.
+ *
+ * @param[in,out] c Cache.
+ * @param[in]     k Key.
+ * @param[out]    h Response.
+ * @return 0 on a hit, `ENOENT` on a miss, `EBADMSG` if the record is
+ *         damaged.
+ */
+extern int
+rcache_get (struct rcache           *c,
+            struct rcache_key const *k,
+            struct rcache_hit       *h) nonnull_in();
+
+/**
+ * @brief Replay a response.
+ *
+ * @param[in] h    Response.
+ * @param[in] pace Delays to keep, in permille of the recorded ones. 0
+ *                 replays without delays.
+ * @param[in] ops  Callbacks, including `done` at the end.
+ * @param[in] ctx  Context of the callbacks.
+ * @return 0 on success, `EBADMSG` if the record is malformed.
+ */
+extern int
+rcache_replay (struct rcache_hit const *h,
+               uint32_t                 pace,
+               struct hloop_ops const  *ops,
+               void                    *ctx) nonnull_in(1,3);
+
+/**
+ * @brief Start recording a response.
+ *
+ * @param[out] r   Recorder.
+ * @param[in]  c   Cache.
+ * @param[in]  k   Key of the request.
+ * @param[in]  ops Callbacks to pass everything to.
+ * @param[in]  ctx Context of @p ops.
+ */
+extern void
+rcache_rec_init (struct rcache_rec       *r,
+                 struct rcache           *c,
+                 struct rcache_key const *k,
+                 struct hloop_ops const  *ops,
+                 void                    *ctx) nonnull_in(1,2,3,4);
+
+/**
+ * @brief Release a recorder.
+ */
+extern void
+rcache_rec_fini (struct rcache_rec *r) nonnull_in();
+
+/**
+ * @brief Store a complete response, as from @ref http_request().
+ *
+ * @param[in,out] c   Cache.
+ * @param[in]     k   Key of the request.
+ * @param[in]     res Response.
+ * @return 0 on success, `EEXIST` if the key is already cached,
+ *         otherwise an error code.
+ */
+extern int
+rcache_put_response (struct rcache              *c,
+                     struct rcache_key const    *k,
+                     struct http_response const *res) nonnull_in();
+
+/**
+ * @brief Get a snapshot of the statistics.
+ */
+extern struct rcache_stats
+rcache_stats (struct rcache *c) nonnull_in();
+
+#endif /* LIBCANTH_SRC_RCACHE_H_ */
@@ -0,0 +1,296 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file retry.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <string.h>
+
+#include "mono.h"
+#include "num.h"
+#include "retry.h"
+
+/**
+ * @brief How safe an attempt is to retry.
+ */
+fixed_enum(retry_class, uint8_t) {
+	retry_final, //!< Not retryable.
+	retry_safe,  //!< Not processed by the server.
+	retry_maybe, //!< May have been processed.
+};
+
+static const_inline enum retry_class
+retry_classify (int e,
+                int status)
+{
+	switch (e) {
+	case 0:
+		break;
+	case ECONNREFUSED:
+	case EHOSTUNREACH:
+	case ENETUNREACH:
+	case EADDRNOTAVAIL:
+		return retry_safe;
+	case ECONNRESET:
+	case ECONNABORTED:
+	case EPIPE:
+	case ETIMEDOUT:
+	case EPROTO:
+		return retry_maybe;
+	default:
+		return retry_final;
+	}
+
+	switch (status) {
+	case 408:
+	case 429:
+	case 503:
+	case 529:
+		return retry_safe;
+	case 500:
+	case 502:
+	case 504:
+		return retry_maybe;
+	default:
+		return retry_final;
+	}
+}
+
+/**
+ * @brief Draw a uniform random number below @p n with xorshift64*.
+ */
+nonnull_in()
+static uint32_t
+retry_random (struct retry *r,
+              uint32_t      n)
+{
+	uint64_t x = r->rng;
+	x ^= x >> 12U;
+	x ^= x << 25U;
+	x ^= x >> 27U;
+	r->rng = x;
+	return (uint32_t)(((x * UINT64_C(0x2545f4914f6cdd1d)) >> 32U) * n
+	                  >> 32U);
+}
+
+/**
+ * @brief Age the retry budget.
+ *
+ * The balance decays towards ten seconds of the floor with a time
+ * constant of ten seconds, so it holds about ten seconds of deposits
+ * and refills at the floor rate once they are spent.
+ */
+nonnull_in()
+static void
+retry_refill (struct retry *r,
+              uint64_t      now)
+{
+	if (now <= r->last)
+		return;
+	double keep = 1.0 / (1.0 + (double)(now - r->last) / 10e6);
+	r->tokens = r->tokens * keep + 10.0 * r->cfg.budget_min * (1.0 - keep);
+	r->last = now;
+}
+
+int
+retry_init (struct retry           *r,
+            struct retry_cfg const *cfg)
+{
+	*r = (struct retry){
+		.cfg = cfg ? *cfg : (struct retry_cfg){0},
+	};
+	struct retry_cfg *c = &r->cfg;
+	if (!c->attempts)
+		c->attempts = RETRY_ATTEMPTS;
+	if (!c->base_ms)
+		c->base_ms = RETRY_BASE_MS;
+	if (!c->cap_ms)
+		c->cap_ms = RETRY_CAP_MS;
+	if (c->cap_ms < c->base_ms)
+		c->cap_ms = c->base_ms;
+	if (!c->budget)
+		c->budget = RETRY_BUDGET;
+	if (!c->budget_min)
+		c->budget_min = RETRY_BUDGET_MIN;
+
+	r->tokens = 10.0 * c->budget_min;
+	r->last = mono_us();
+	r->rng = r->last | 1U;
+	return pthread_mutex_init(&r->lock, nullptr);
+}
+
+void
+retry_fini (struct retry *r)
+{
+	(void)pthread_mutex_destroy(&r->lock);
+}
+
+bool
+retry_idempotent (struct http_request const *req)
+{
+	static char const *const methods[] = {
+		"GET", "HEAD", "PUT", "DELETE", "OPTIONS", "TRACE",
+	};
+	for (size_t i = 0; i < sizeof methods / sizeof *methods; ++i) {
+		if (!strcmp(req->method, methods[i]))
+			return true;
+	}
+
+	for (size_t i = 0; i < req->nheaders; ++i) {
+		dstr v;
+		if (http_header_is(dstr_get(&req->headers[i]),
+		                   req->headers[i].len, "idempotency-key", &v) &&
+		    v.len)
+			return true;
+	}
+	return false;
+}
+
+uint32_t
+retry_after (struct http_response const *res)
+{
+	dstr v;
+	double scale = 1.0;
+	if (!http_response_header(res, "retry-after-ms", &v)) {
+		if (!http_response_header(res, "retry-after", &v))
+			return 0;
+		scale = 1000.0;
+	}
+
+	struct num x;
+	size_t end;
+	if (num_parse((uint8_t const *)dstr_get(&v), v.len, &end, &x) ||
+	    end != v.len)
+		return 0;
+
+	double ms = (x.flt ? x.d : (double)x.i) * scale;
+	if (!(ms >= 0.0))
+		return 0;
+	return ms < UINT32_MAX ? (uint32_t)(ms + 0.999) : UINT32_MAX;
+}
+
+void
+retry_begin (struct retry       *r,
+             struct retry_state *s,
+             bool                idempotent)
+{
+	*s = (struct retry_state){
+		.start      = mono_us(),
+		.idempotent = idempotent,
+	};
+
+	(void)pthread_mutex_lock(&r->lock);
+	retry_refill(r, s->start);
+	r->tokens += r->cfg.budget / 1000.0;
+	r->stats.requests += 1U;
+	(void)pthread_mutex_unlock(&r->lock);
+}
+
+enum retry_verdict
+retry_next (struct retry       *r,
+            struct retry_state *s,
+            int                 e,
+            int                 status,
+            uint32_t            after_ms,
+            uint32_t           *delay_ms)
+{
+	uint64_t now = mono_us();
+	enum retry_class c = retry_classify(e, status);
+	enum retry_verdict v = retry_again;
+	uint32_t d = 0;
+
+	(void)pthread_mutex_lock(&r->lock);
+	struct retry_cfg const *cfg = &r->cfg;
+	r->stats.attempts += 1U;
+	s->attempt += 1U;
+
+	if (c == retry_final) {
+		v = retry_done;
+	} else if (c == retry_maybe && !s->idempotent) {
+		v = retry_unsafe;
+		r->stats.unsafe += 1U;
+	} else if (s->attempt >= cfg->attempts) {
+		v = retry_attempts;
+		r->stats.gave_up += 1U;
+	} else {
+		/* Decorrelated jitter: anywhere from the base delay up to
+		 * three times the previous one, within the cap. */
+		uint32_t prev = s->prev_ms ? s->prev_ms : cfg->base_ms;
+		uint64_t hi = (uint64_t)prev * 3U;
+		if (hi > cfg->cap_ms)
+			hi = cfg->cap_ms;
+		d = cfg->base_ms +
+		    retry_random(r, (uint32_t)hi - cfg->base_ms + 1U);
+		if (after_ms > d)
+			d = after_ms;
+
+		uint64_t end = now + (uint64_t)d * 1000U;
+		if (after_ms > cfg->cap_ms ||
+		    (cfg->deadline_ms &&
+		     end > s->start + cfg->deadline_ms * UINT64_C(1000))) {
+			v = retry_deadline;
+			r->stats.gave_up += 1U;
+		} else {
+			retry_refill(r, now);
+			if (r->tokens < 1.0) {
+				v = retry_budget;
+				r->stats.denied += 1U;
+			} else {
+				r->tokens -= 1.0;
+				r->stats.retries += 1U;
+				s->prev_ms = d;
+			}
+		}
+	}
+	(void)pthread_mutex_unlock(&r->lock);
+
+	if (v != retry_again)
+		d = 0;
+	*delay_ms = d;
+
+	if (cfg->trace) {
+		struct retry_attempt a = {
+			.elapsed_us = now - s->start,
+			.attempt    = s->attempt,
+			.delay_ms   = d,
+			.after_ms   = after_ms,
+			.e          = e,
+			.status     = status,
+			.verdict    = v,
+		};
+		cfg->trace(cfg->ctx, &a);
+	}
+
+	return v;
+}
+
+int
+retry_request (struct retry              *r,
+               struct http_pool          *p,
+               struct http_request const *req,
+               struct http_response      *res)
+{
+	struct retry_state s;
+	retry_begin(r, &s, retry_idempotent(req));
+
+	for (;;) {
+		int e = http_request(p, req, res);
+		uint32_t after = e ? 0 : retry_after(res);
+		uint32_t d = 0;
+		if (retry_next(r, &s, e, e ? 0 : res->status, after, &d) !=
+		    retry_again)
+			return e;
+
+		http_response_fini(res);
+		mono_sleep_ms(d);
+	}
+}
+
+struct retry_stats
+retry_stats (struct retry *r)
+{
+	(void)pthread_mutex_lock(&r->lock);
+	struct retry_stats st = r->stats;
+	(void)pthread_mutex_unlock(&r->lock);
+	return st;
+}
@@ -0,0 +1,226 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file retry.h
+ *
+ * @brief Retries with decorrelated jitter and a shared retry budget.
+ *
+ * Each failed attempt is classified as final, safe to retry, or only
+ * safe to retry if the request is idempotent. Delays grow by
+ * decorrelated jitter, a random pick between the base delay and three
+ * times the previous one, so clients that failed together don't come
+ * back together, and a `retry-after` from the server is never cut
+ * short. Retries are further limited by a budget that every request
+ * pays into, so that during an outage the retries add at most a set
+ * share on top of the first attempts instead of multiplying them.
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_RETRY_H_
+#define LIBCANTH_SRC_RETRY_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "http.h"
+#include "util.h"
+
+/**
+ * @brief Default number of attempts, the first one included.
+ */
+#define RETRY_ATTEMPTS 4U
+
+/**
+ * @brief Default base and longest delay.
+ */
+#define RETRY_BASE_MS 100U
+#define RETRY_CAP_MS  20000U
+
+/**
+ * @brief Default retries per request the budget allows, in permille.
+ */
+#define RETRY_BUDGET 100U
+
+/**
+ * @brief Default retries per second the budget allows regardless of
+ *        traffic. The budget starts out with ten seconds of these, and
+ *        holds about ten seconds of what requests pay into it.
+ */
+#define RETRY_BUDGET_MIN 10U
+
+/**
+ * @brief Outcome of an attempt.
+ */
+fixed_enum(retry_verdict, uint8_t) {
+	retry_done,     //!< Succeeded, or failed for good.
+	retry_again,    //!< Retry after the delay.
+	retry_unsafe,   //!< Retryable, but may have been processed.
+	retry_attempts, //!< Retryable, but out of attempts.
+	retry_budget,   //!< Retryable, but the budget is spent.
+	retry_deadline, //!< Retryable, but the delay is too long.
+};
+
+/**
+ * @brief Record of an attempt, handed to @ref retry_cfg::trace.
+ */
+struct retry_attempt {
+	uint64_t           elapsed_us; //!< Time since the first attempt.
+	uint32_t           attempt;    //!< Attempt number, from 1.
+	uint32_t           delay_ms;   //!< Delay before the next attempt.
+	uint32_t           after_ms;   //!< Delay the server asked for.
+	int                e;          //!< Error code of the attempt.
+	int                status;     //!< Status code, 0 without one.
+	enum retry_verdict verdict;    //!< What happens next.
+};
+
+/**
+ * @brief Configuration. Zero fields take their defaults.
+ */
+struct retry_cfg {
+	uint32_t attempts;    //!< Attempts, the first one included.
+	uint32_t base_ms;     //!< Shortest delay.
+	uint32_t cap_ms;      //!< Longest delay, also for `retry-after`.
+	uint32_t budget;      //!< Retries per request, in permille.
+	uint32_t budget_min;  //!< Retries per second always allowed.
+	uint32_t deadline_ms; //!< Time for all attempts, 0 for no limit.
+
+	/**
+	 * @brief Called after every attempt, or `NULL`.
+	 * @param ctx @ref retry_cfg::ctx
+	 * @param a   Attempt, valid during the call.
+	 */
+	void (*trace)(void *ctx, struct retry_attempt const *a);
+	void  *ctx; //!< Passed to @ref retry_cfg::trace.
+};
+
+/**
+ * @brief Statistics.
+ */
+struct retry_stats {
+	size_t requests; //!< Requests started.
+	size_t attempts; //!< Attempts made.
+	size_t retries;  //!< Retries allowed.
+	size_t unsafe;   //!< Retries refused as not idempotent.
+	size_t denied;   //!< Retries refused by the budget.
+	size_t gave_up;  //!< Retries refused by attempts or deadline.
+};
+
+/**
+ * @brief Retry policy, shared by any number of threads.
+ */
+struct retry {
+	pthread_mutex_t    lock;   //!< Guards everything below.
+	struct retry_cfg   cfg;    //!< Configuration.
+	double             tokens; //!< Retries the budget allows now.
+	uint64_t           last;   //!< Time of last budget refill, in us.
+	uint64_t           rng;    //!< Jitter state.
+	struct retry_stats stats;  //!< Statistics.
+};
+
+/**
+ * @brief Progress of one request.
+ */
+struct retry_state {
+	uint64_t start;      //!< Time of the first attempt, in us.
+	uint32_t attempt;    //!< Attempts made.
+	uint32_t prev_ms;    //!< Previous delay.
+	bool     idempotent; //!< Safe to send more than once.
+};
+
+/**
+ * @brief Initialize a retry policy.
+ *
+ * @param[out] r   Policy.
+ * @param[in]  cfg Configuration, or `NULL` for the defaults.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+retry_init (struct retry           *r,
+            struct retry_cfg const *cfg) nonnull_in(1);
+
+/**
+ * @brief Release a retry policy.
+ */
+extern void
+retry_fini (struct retry *r) nonnull_in();
+
+/**
+ * @brief Check if a request can safely be sent more than once.
+ *
+ * That is the case for the idempotent methods, and for any request with
+ * an `Idempotency-Key` header.
+ */
+extern bool
+retry_idempotent (struct http_request const *req) nonnull_in();
+
+/**
+ * @brief Get the delay a response asks for.
+ *
+ * @return The `retry-after-ms` or `retry-after` delay in milliseconds,
+ *         or 0 if there is none or it isn't a number, such as an HTTP
+ *         date.
+ */
+extern uint32_t
+retry_after (struct http_response const *res) nonnull_in();
+
+/**
+ * @brief Start a request, paying into the retry budget.
+ *
+ * @param[in,out] r          Policy.
+ * @param[out]    s          Request state.
+ * @param[in]     idempotent Whether the request is idempotent.
+ */
+extern void
+retry_begin (struct retry       *r,
+             struct retry_state *s,
+             bool                idempotent) nonnull_in();
+
+/**
+ * @brief Decide what to do after an attempt.
+ *
+ * Connection failures before anything was sent, `408`, `429`, `503`,
+ * and `529` mean the request wasn't processed and are always safe to
+ * retry. Other connection failures, timeouts, `500`, `502`, and `504`
+ * are only retried if the request is idempotent. Everything else is
+ * final.
+ *
+ * @param[in,out] r        Policy.
+ * @param[in,out] s        Request state.
+ * @param[in]     e        Error code of the attempt.
+ * @param[in]     status   Status code, or 0 if there was no response.
+ * @param[in]     after_ms Delay the server asked for, from
+ *                         @ref retry_after(), or 0.
+ * @param[out]    delay_ms Delay before the next attempt.
+ * @return What to do next. Only @ref retry_again means to retry.
+ */
+extern enum retry_verdict
+retry_next (struct retry       *r,
+            struct retry_state *s,
+            int                 e,
+            int                 status,
+            uint32_t            after_ms,
+            uint32_t           *delay_ms) nonnull_in();
+
+/**
+ * @brief Send a request, retrying as the policy allows.
+ *
+ * @param[in,out] r   Policy.
+ * @param[in,out] p   Connection pool.
+ * @param[in]     req Request.
+ * @param[out]    res Response of the last attempt. Release it with
+ *                    @ref http_response_fini() even on failure.
+ * @return 0 if the last attempt got a response, whatever its status,
+ *         otherwise its error code.
+ */
+extern int
+retry_request (struct retry              *r,
+               struct http_pool          *p,
+               struct http_request const *req,
+               struct http_response      *res) nonnull_in();
+
+/**
+ * @brief Get a snapshot of the statistics.
+ */
+extern struct retry_stats
+retry_stats (struct retry *r) nonnull_in();
+
+#endif /* LIBCANTH_SRC_RETRY_H_ */
@@ -0,0 +1,499 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file sflight.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mono.h"
+#include "sflight.h"
+
+/**
+ * @brief What a broadcast item holds.
+ */
+fixed_enum(sflight_kind, uint8_t) {
+	sflight_header, //!< Header line.
+	sflight_head,   //!< Response framing.
+	sflight_event,  //!< Event type, data and ID.
+	sflight_data,   //!< Body bytes.
+};
+
+/**
+ * @brief Broadcast item. Items never change once appended, so they can
+ *        be read without the lock for as long as the flight lives.
+ */
+struct sflight_item {
+	struct sflight_item *next;   //!< Next item, guarded by the lock.
+	struct http_frame    f;      //!< Framing of a head item.
+	int64_t              retry;  //!< Retry field of an event.
+	uint32_t             len[3]; //!< Lengths of the parts of the data.
+	enum sflight_kind    kind;   //!< What the item holds.
+	char                 data[]; //!< The parts, back to back.
+};
+
+/**
+ * @brief Response in flight or kept.
+ */
+struct sflight_flight {
+	struct sflight_flight  *next;  //!< Next in the same bucket.
+	struct sflight_flight  *older; //!< Previous in LRU order.
+	struct sflight_flight  *newer; //!< Next in LRU order.
+	struct rcache_key       key;   //!< Key of the request.
+	pthread_cond_t          cond;  //!< Signaled on each new item.
+	struct sflight_item    *head;  //!< First item.
+	struct sflight_item   **tail;  //!< Where the next item goes.
+	uint64_t                bytes; //!< Size of the items.
+	uint64_t                end;   //!< Time the stream ended, in us.
+	size_t                  refs;  //!< Calls, plus one while listed.
+	int                     e;     //!< Error code of the stream.
+	int                     status; //!< Status code of the stream.
+	bool                    done;  //!< Stream has ended.
+	bool                    kept;  //!< In the LRU.
+	bool                    listed; //!< In @ref sflight::tab.
+};
+
+nonnull_in()
+static struct sflight_flight **
+sflight_find (struct sflight          *s,
+              struct rcache_key const *k)
+{
+	struct sflight_flight **pp = &s->tab[k->h[0] & (s->cap - 1U)];
+	while (*pp && ((*pp)->key.h[0] != k->h[0] ||
+	               (*pp)->key.h[1] != k->h[1]))
+		pp = &(*pp)->next;
+	return pp;
+}
+
+/**
+ * @brief Drop a reference to a flight, freeing it with the last one.
+ */
+nonnull_in()
+static void
+sflight_unref (struct sflight_flight *f)
+{
+	if (--f->refs)
+		return;
+	for (struct sflight_item *i = f->head, *n; i; i = n) {
+		n = i->next;
+		free(i);
+	}
+	(void)pthread_cond_destroy(&f->cond);
+	free(f);
+}
+
+/**
+ * @brief Take a flight out of the table and the LRU.
+ */
+nonnull_in()
+static void
+sflight_unlist (struct sflight        *s,
+                struct sflight_flight *f)
+{
+	if (!f->listed)
+		return;
+
+	struct sflight_flight **pp = sflight_find(s, &f->key);
+	*pp = f->next;
+	f->listed = false;
+	s->count -= 1U;
+
+	if (f->kept) {
+		if (f->older)
+			f->older->newer = f->newer;
+		else
+			s->lru = f->newer;
+		if (f->newer)
+			f->newer->older = f->older;
+		else
+			s->mru = f->older;
+		f->older = f->newer = nullptr;
+		f->kept = false;
+		s->stats.entries -= 1U;
+		s->stats.bytes -= f->bytes;
+	}
+	sflight_unref(f);
+}
+
+/**
+ * @brief Make a kept flight the most recently used.
+ */
+nonnull_in()
+static void
+sflight_touch (struct sflight        *s,
+               struct sflight_flight *f)
+{
+	if (s->mru == f)
+		return;
+	if (f->older)
+		f->older->newer = f->newer;
+	else if (s->lru == f)
+		s->lru = f->newer;
+	if (f->newer)
+		f->newer->older = f->older;
+
+	f->newer = nullptr;
+	f->older = s->mru;
+	if (s->mru)
+		s->mru->newer = f;
+	else
+		s->lru = f;
+	s->mru = f;
+}
+
+nonnull_in()
+static int
+sflight_grow (struct sflight *s)
+{
+	size_t cap = s->cap * 2U;
+	struct sflight_flight **tab = calloc(cap, sizeof *tab);
+	if (!tab)
+		return errno;
+
+	for (size_t i = 0; i < s->cap; ++i) {
+		for (struct sflight_flight *f = s->tab[i], *n; f; f = n) {
+			n = f->next;
+			struct sflight_flight **pp = &tab[f->key.h[0] & (cap - 1U)];
+			f->next = *pp;
+			*pp = f;
+		}
+	}
+	free(s->tab);
+	s->tab = tab;
+	s->cap = cap;
+	return 0;
+}
+
+int
+sflight_init (struct sflight           *s,
+              struct sflight_cfg const *cfg)
+{
+	*s = (struct sflight){
+		.cfg = cfg ? *cfg : (struct sflight_cfg){0},
+		.cap = 64U,
+	};
+	if (!s->cfg.entries)
+		s->cfg.entries = SFLIGHT_ENTRIES;
+	if (!s->cfg.ttl_ms)
+		s->cfg.ttl_ms = SFLIGHT_TTL_MS;
+	if (!s->cfg.bytes)
+		s->cfg.bytes = SFLIGHT_BYTES;
+
+	s->tab = calloc(s->cap, sizeof *s->tab);
+	if (!s->tab)
+		return errno;
+
+	int e = pthread_mutex_init(&s->lock, nullptr);
+	if (e) {
+		free(s->tab);
+		s->tab = nullptr;
+	}
+	return e;
+}
+
+void
+sflight_fini (struct sflight *s)
+{
+	for (size_t i = 0; s->tab && i < s->cap; ++i) {
+		while (s->tab[i])
+			sflight_unlist(s, s->tab[i]);
+	}
+	free(s->tab);
+	s->tab = nullptr;
+	(void)pthread_mutex_destroy(&s->lock);
+}
+
+int
+sflight_join (struct sflight          *s,
+              struct rcache_key const *k,
+              struct hloop_ops const  *ops,
+              void                    *ctx,
+              struct sflight_call     *c)
+{
+	*c = (struct sflight_call){.s = s, .ops = ops, .ctx = ctx};
+	uint64_t now = mono_us();
+
+	(void)pthread_mutex_lock(&s->lock);
+	struct sflight_flight *f = *sflight_find(s, k);
+	if (f && f->kept && now - f->end > s->cfg.ttl_ms * UINT64_C(1000)) {
+		sflight_unlist(s, f);
+		s->stats.evicted += 1U;
+		f = nullptr;
+	}
+
+	if (f) {
+		f->refs += 1U;
+		if (f->kept) {
+			sflight_touch(s, f);
+			s->stats.hits += 1U;
+			c->role = sflight_cached;
+		} else {
+			s->stats.followers += 1U;
+			c->role = sflight_follow;
+		}
+		c->f = f;
+		(void)pthread_mutex_unlock(&s->lock);
+		return 0;
+	}
+
+	int e = s->count >= s->cap ? sflight_grow(s) : 0;
+	if (!e && !(f = calloc(1U, sizeof *f)))
+		e = errno;
+	if (!e) {
+		e = pthread_cond_init(&f->cond, nullptr);
+		if (e) {
+			free(f);
+			f = nullptr;
+		}
+	}
+	if (!e) {
+		struct sflight_flight **pp = sflight_find(s, k);
+		f->key = *k;
+		f->tail = &f->head;
+		f->refs = 2U;
+		f->listed = true;
+		f->next = *pp;
+		*pp = f;
+		s->count += 1U;
+		s->stats.leaders += 1U;
+		c->f = f;
+		c->role = sflight_lead;
+	}
+	(void)pthread_mutex_unlock(&s->lock);
+	return e;
+}
+
+/**
+ * @brief Hand an item to the callbacks of a call.
+ */
+nonnull_in()
+static void
+sflight_deliver (struct sflight_call const *c,
+                 struct sflight_item const *i)
+{
+	struct hloop_ops const *ops = c->ops;
+	switch (i->kind) {
+	case sflight_header:
+		if (ops->header)
+			ops->header(c->ctx, i->data, i->len[0]);
+		break;
+	case sflight_head:
+		if (ops->head)
+			ops->head(c->ctx, &i->f);
+		break;
+	case sflight_event:
+		if (ops->event) {
+			struct sse_event ev = {
+				.event = make_dstr_view_from_decay(
+				                 i->data, i->len[0]),
+				.data  = make_dstr_view_from_decay(
+				                 &i->data[i->len[0]], i->len[1]),
+				.id    = make_dstr_view_from_decay(
+				                 &i->data[i->len[0] + i->len[1]],
+				                 i->len[2]),
+				.retry = i->retry,
+			};
+			ops->event(c->ctx, &ev);
+		}
+		break;
+	case sflight_data:
+		if (ops->data)
+			ops->data(c->ctx, i->data, i->len[0]);
+		break;
+	}
+}
+
+void
+sflight_wait (struct sflight_call *c)
+{
+	struct sflight *s = c->s;
+	struct sflight_flight *f = c->f;
+	struct sflight_item *i = nullptr;
+	if (!f)
+		return;
+
+	for (;;) {
+		(void)pthread_mutex_lock(&s->lock);
+		struct sflight_item *n;
+		while (!(n = i ? i->next : f->head) && !f->done)
+			(void)pthread_cond_wait(&f->cond, &s->lock);
+		(void)pthread_mutex_unlock(&s->lock);
+		if (!n)
+			break;
+		sflight_deliver(c, n);
+		i = n;
+	}
+
+	/* Written before done was set, and never after. */
+	if (c->ops->done)
+		c->ops->done(c->ctx, f->e, f->status);
+
+	(void)pthread_mutex_lock(&s->lock);
+	sflight_unref(f);
+	c->f = nullptr;
+	(void)pthread_mutex_unlock(&s->lock);
+}
+
+/**
+ * @brief Append an item of up to three parts to the broadcast list.
+ */
+nonnull_in(1)
+static void
+sflight_add (struct sflight_call     *c,
+             enum sflight_kind        kind,
+             struct http_frame const *fr,
+             void const              *a,
+             size_t                   na,
+             void const              *b,
+             size_t                   nb,
+             void const              *d,
+             size_t                   nd,
+             int64_t                  retry)
+{
+	struct sflight *s = c->s;
+	struct sflight_flight *f = c->f;
+	if (!f || f->e)
+		return;
+
+	size_t len = na + nb + nd;
+	struct sflight_item *i = nullptr;
+	if (na <= UINT32_MAX && nb <= UINT32_MAX && nd <= UINT32_MAX)
+		i = malloc(sizeof *i + len);
+	if (i) {
+		*i = (struct sflight_item){
+			.f     = fr ? *fr : (struct http_frame){0},
+			.retry = retry,
+			.len   = {(uint32_t)na, (uint32_t)nb, (uint32_t)nd},
+			.kind  = kind,
+		};
+		if (na)
+			memcpy(i->data, a, na);
+		if (nb)
+			memcpy(&i->data[na], b, nb);
+		if (nd)
+			memcpy(&i->data[na + nb], d, nd);
+	}
+
+	(void)pthread_mutex_lock(&s->lock);
+	if (i) {
+		*f->tail = i;
+		f->tail = &i->next;
+		f->bytes += sizeof *i + len;
+	} else {
+		/* Followers can't get the whole stream any more. */
+		f->e = ENOMEM;
+	}
+	(void)pthread_cond_broadcast(&f->cond);
+	(void)pthread_mutex_unlock(&s->lock);
+}
+
+static void
+sflight_on_header (void       *ctx,
+                   char const *s,
+                   size_t      n)
+{
+	struct sflight_call *c = ctx;
+	sflight_add(c, sflight_header, nullptr, s, n, nullptr, 0, nullptr, 0,
+	            0);
+	if (c->ops->header)
+		c->ops->header(c->ctx, s, n);
+}
+
+static void
+sflight_on_head (void                    *ctx,
+                 struct http_frame const *f)
+{
+	struct sflight_call *c = ctx;
+	sflight_add(c, sflight_head, f, nullptr, 0, nullptr, 0, nullptr, 0,
+	            0);
+	if (c->ops->head)
+		c->ops->head(c->ctx, f);
+}
+
+static void
+sflight_on_event (void                   *ctx,
+                  struct sse_event const *ev)
+{
+	struct sflight_call *c = ctx;
+	sflight_add(c, sflight_event, nullptr,
+	            dstr_get(&ev->event), ev->event.len,
+	            dstr_get(&ev->data), ev->data.len,
+	            dstr_get(&ev->id), ev->id.len, ev->retry);
+	if (c->ops->event)
+		c->ops->event(c->ctx, ev);
+}
+
+static void
+sflight_on_data (void       *ctx,
+                 void const *s,
+                 size_t      n)
+{
+	struct sflight_call *c = ctx;
+	sflight_add(c, sflight_data, nullptr, s, n, nullptr, 0, nullptr, 0,
+	            0);
+	if (c->ops->data)
+		c->ops->data(c->ctx, s, n);
+}
+
+static void
+sflight_on_done (void *ctx,
+                 int   e,
+                 int   status)
+{
+	struct sflight_call *c = ctx;
+	struct sflight *s = c->s;
+	struct sflight_flight *f = c->f;
+
+	if (f) {
+		(void)pthread_mutex_lock(&s->lock);
+		if (!f->e)
+			f->e = e;
+		f->status = status;
+		f->end = mono_us();
+		f->done = true;
+		(void)pthread_cond_broadcast(&f->cond);
+
+		if (f->e || status < 200 || status >= 300) {
+			s->stats.failed += 1U;
+			sflight_unlist(s, f);
+		} else if (f->bytes > s->cfg.bytes) {
+			sflight_unlist(s, f);
+		} else {
+			f->kept = true;
+			s->stats.entries += 1U;
+			s->stats.bytes += f->bytes;
+			sflight_touch(s, f);
+			while (s->lru != f &&
+			       (s->stats.entries > s->cfg.entries ||
+			        s->stats.bytes > s->cfg.bytes)) {
+				sflight_unlist(s, s->lru);
+				s->stats.evicted += 1U;
+			}
+		}
+
+		sflight_unref(f);
+		c->f = nullptr;
+		(void)pthread_mutex_unlock(&s->lock);
+	}
+
+	if (c->ops->done)
+		c->ops->done(c->ctx, e, status);
+}
+
+struct hloop_ops const sflight_lead_ops = {
+	.header = sflight_on_header,
+	.head   = sflight_on_head,
+	.event  = sflight_on_event,
+	.data   = sflight_on_data,
+	.done   = sflight_on_done,
+};
+
+struct sflight_stats
+sflight_stats (struct sflight *s)
+{
+	(void)pthread_mutex_lock(&s->lock);
+	struct sflight_stats st = s->stats;
+	(void)pthread_mutex_unlock(&s->lock);
+	return st;
+}
@@ -0,0 +1,165 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file sflight.h
+ *
+ * @brief Coalescing of identical requests in flight.
+ *
+ * The first caller to ask for a key leads: it sends the request with
+ * @ref sflight_lead_ops in front of its own callbacks, and every
+ * callback the stream makes is appended to a broadcast list. Callers
+ * that ask for the same key while the stream is in flight follow:
+ * @ref sflight_wait() hands them the list from the start and then each
+ * new item as it arrives, so all of them see the whole stream from a
+ * single upstream request. Complete 2xx responses stay in a small LRU
+ * for a while, and callers that ask for them then get them at once.
+ *
+ * A failed stream isn't kept, but the callers already following it get
+ * the same failure.
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_SFLIGHT_H_
+#define LIBCANTH_SRC_SFLIGHT_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hloop.h"
+#include "rcache.h"
+#include "util.h"
+
+/**
+ * @brief Default number of complete responses kept.
+ */
+#define SFLIGHT_ENTRIES 256U
+
+/**
+ * @brief Default bytes of complete responses kept.
+ */
+#define SFLIGHT_BYTES (64U << 20U)
+
+/**
+ * @brief Default time a complete response is kept, in milliseconds.
+ */
+#define SFLIGHT_TTL_MS 60000U
+
+/**
+ * @brief How a caller gets its response.
+ */
+fixed_enum(sflight_role, uint8_t) {
+	sflight_lead,   //!< Send the request with @ref sflight_lead_ops.
+	sflight_follow, //!< Get the stream of a leader from @ref sflight_wait().
+	sflight_cached, //!< Get a kept response from @ref sflight_wait().
+};
+
+/**
+ * @brief Configuration. Zero fields take their defaults.
+ */
+struct sflight_cfg {
+	uint32_t entries; //!< Complete responses kept.
+	uint32_t ttl_ms;  //!< Time a complete response is kept.
+	uint64_t bytes;   //!< Bytes of complete responses kept.
+};
+
+/**
+ * @brief Statistics.
+ */
+struct sflight_stats {
+	size_t   leaders;   //!< Requests sent upstream.
+	size_t   followers; //!< Requests that joined one in flight.
+	size_t   hits;      //!< Requests answered by a kept response.
+	size_t   failed;    //!< Streams that failed or weren't 2xx.
+	size_t   evicted;   //!< Responses dropped to make room, or aged.
+	size_t   entries;   //!< Responses kept.
+	uint64_t bytes;     //!< Bytes of responses kept.
+};
+
+struct sflight_flight;
+
+/**
+ * @brief Coalescing layer, shared by any number of threads.
+ */
+struct sflight {
+	pthread_mutex_t         lock;  //!< Guards everything below.
+	struct sflight_cfg      cfg;   //!< Configuration.
+	struct sflight_flight **tab;   //!< Flights by key.
+	size_t                  cap;   //!< Size of @ref sflight::tab.
+	size_t                  count; //!< Flights in @ref sflight::tab.
+	struct sflight_flight  *lru;   //!< Least recently used response.
+	struct sflight_flight  *mru;   //!< Most recently used response.
+	struct sflight_stats    stats; //!< Statistics.
+};
+
+/**
+ * @brief One caller's part in a flight.
+ */
+struct sflight_call {
+	struct sflight         *s;    //!< Coalescing layer.
+	struct sflight_flight  *f;    //!< Flight, `NULL` once left.
+	struct hloop_ops const *ops;  //!< Callbacks of the caller.
+	void                   *ctx;  //!< Context of @ref sflight_call::ops.
+	enum sflight_role       role; //!< How to get the response.
+};
+
+/**
+ * @brief Stream callbacks of a leader, with its @ref sflight_call as
+ *        context. Everything is broadcast and passed on to the
+ *        leader's own callbacks.
+ *
+ * The stream must end in `done`. If the request can't even be sent,
+ * call `sflight_lead_ops.done()` directly so followers aren't left
+ * waiting.
+ */
+extern struct hloop_ops const sflight_lead_ops;
+
+/**
+ * @brief Initialize a coalescing layer.
+ *
+ * @param[out] s   Coalescing layer.
+ * @param[in]  cfg Configuration, or `NULL` for the defaults.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+sflight_init (struct sflight           *s,
+              struct sflight_cfg const *cfg) nonnull_in(1);
+
+/**
+ * @brief Release a coalescing layer. No calls may be left.
+ */
+extern void
+sflight_fini (struct sflight *s) nonnull_in();
+
+/**
+ * @brief Ask for a response.
+ *
+ * @param[in,out] s   Coalescing layer.
+ * @param[in]     k   Key of the request, from @ref rcache_key().
+ * @param[in]     ops Callbacks to get the response through.
+ * @param[in]     ctx Context of @p ops.
+ * @param[out]    c   Call. Its role says what to do next.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+sflight_join (struct sflight          *s,
+              struct rcache_key const *k,
+              struct hloop_ops const  *ops,
+              void                    *ctx,
+              struct sflight_call     *c) nonnull_in(1,2,3,5);
+
+/**
+ * @brief Get the response of a follower or cached call.
+ *
+ * Blocks until the stream has ended, handing each item to the callbacks
+ * of the call as soon as it's there, and `done` last. The call is then
+ * left.
+ */
+extern void
+sflight_wait (struct sflight_call *c) nonnull_in();
+
+/**
+ * @brief Get a snapshot of the statistics.
+ */
+extern struct sflight_stats
+sflight_stats (struct sflight *s) nonnull_in();
+
+#endif /* LIBCANTH_SRC_SFLIGHT_H_ */
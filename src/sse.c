@@ -0,0 +1,289 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file sse.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <stdlib.h>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif /* __SSE2__ */
+
+#include "num.h"
+#include "sse.h"
+
+/**
+ * @brief Find the next line feed.
+ *
+ * @return Index of the first `\n` at or after @p i, or @p len if there
+ *         is none.
+ */
+nonnull_in()
+static force_inline size_t
+sse_scan (uint8_t const *s,
+          size_t         i,
+          size_t         len)
+{
+#if defined(__SSE2__)
+	__m128i const lf = _mm_set1_epi8('\n');
+
+	for (; len - i >= 16U; i += 16U) {
+		__m128i v = _mm_loadu_si128((__m128i const *)&s[i]);
+		unsigned m = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, lf));
+		if (m)
+			return i + (size_t)__builtin_ctz(m);
+	}
+#else
+	constexpr uint64_t ones = UINT64_C(0x0101010101010101);
+	constexpr uint64_t high = UINT64_C(0x8080808080808080);
+
+	for (; len - i >= 8U; i += 8U) {
+		uint64_t v;
+		__builtin_memcpy(&v, &s[i], 8U);
+		v ^= ones * '\n';
+		uint64_t m = (v - ones) & ~v & high;
+		if (m) {
+			if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+				return i + (size_t)__builtin_ctzll(m) / 8U;
+			break;
+		}
+	}
+#endif /* __SSE2__ */
+
+	for (; i < len && s[i] != '\n'; ++i);
+	return i;
+}
+
+/**
+ * @brief Find the end of the first blank line.
+ *
+ * A blank line that starts in the previous chunk is found with the help
+ * of the bytes that ended it.
+ *
+ * @param s    Input.
+ * @param len  Length of @p s.
+ * @param prev The two bytes before @p s, the last one in the low byte.
+ * @return Index right after the blank line, or 0 if there is none.
+ */
+nonnull_in()
+static size_t
+sse_boundary (uint8_t const *s,
+              size_t         len,
+              unsigned       prev)
+{
+	if (!len)
+		return 0;
+
+	if ((prev & 0xffU) == '\n') {
+		if (s[0] == '\n')
+			return 1U;
+		if (s[0] == '\r' && len > 1U && s[1] == '\n')
+			return 2U;
+	} else if (prev == ('\n' << 8U | '\r') && s[0] == '\n') {
+		return 1U;
+	}
+
+	for (size_t i = sse_scan(s, 0, len); i < len;
+	     i = sse_scan(s, i + 1U, len)) {
+		if (len - i > 1U && s[i + 1U] == '\n')
+			return i + 2U;
+		if (len - i > 2U && s[i + 1U] == '\r' && s[i + 2U] == '\n')
+			return i + 3U;
+	}
+
+	return 0;
+}
+
+nonnull_in()
+static int
+sse_grow (uint8_t **buf,
+          size_t   *cap,
+          size_t    n)
+{
+	if (n <= *cap)
+		return 0;
+
+	size_t c = *cap ? *cap : 1024U;
+	while (c < n)
+		c *= 2U;
+
+	uint8_t *b = realloc(*buf, c);
+	if (!b)
+		return errno;
+
+	*buf = b;
+	*cap = c;
+	return 0;
+}
+
+/**
+ * @brief Split a complete event into its fields.
+ *
+ * @return 0 on success, `ENOMSG` if the event has no data, otherwise an
+ *         error code.
+ */
+nonnull_in()
+static int
+sse_event (struct sse       *p,
+           uint8_t const    *s,
+           size_t            n,
+           struct sse_event *ev)
+{
+	uint8_t const *data = nullptr;
+	size_t dlen = 0, jlen = 0;
+	bool joined = false;
+
+	*ev = (struct sse_event){.retry = -1};
+
+	for (size_t i = 0; i < n;) {
+		uint8_t const *nl = __builtin_memchr(&s[i], '\n', n - i);
+		size_t end = nl ? (size_t)(nl - s) : n;
+		uint8_t const *l = &s[i];
+		size_t m = end - i - (end > i && s[end - 1U] == '\r');
+		i = end + 1U;
+
+		if (!m || l[0] == ':')
+			continue;
+
+		uint8_t const *colon = __builtin_memchr(l, ':', m);
+		size_t k = colon ? (size_t)(colon - l) : m;
+		uint8_t const *v = colon ? colon + 1 : &l[m];
+		size_t vn = colon ? m - k - 1U : 0;
+		if (vn && *v == ' ') {
+			++v;
+			--vn;
+		}
+
+		if (k == 4U && !__builtin_memcmp(l, "data", 4U)) {
+			if (!data) {
+				data = v;
+				dlen = vn;
+				continue;
+			}
+			/* Only multi-line data needs a buffer of its own. */
+			int e = sse_grow(&p->join, &p->jcap,
+			                 (joined ? jlen : dlen) + vn + 1U);
+			if (e)
+				return e;
+			if (!joined) {
+				__builtin_memcpy(p->join, data, dlen);
+				jlen = dlen;
+				joined = true;
+			}
+			p->join[jlen++] = '\n';
+			__builtin_memcpy(&p->join[jlen], v, vn);
+			jlen += vn;
+		} else if (k == 5U && !__builtin_memcmp(l, "event", 5U)) {
+			ev->event = make_dstr_view_from_decay((char const *)v, vn);
+		} else if (k == 2U && !__builtin_memcmp(l, "id", 2U)) {
+			if (!__builtin_memchr(v, '\0', vn))
+				ev->id = make_dstr_view_from_decay((char const *)v,
+				                                   vn);
+		} else if (k == 5U && !__builtin_memcmp(l, "retry", 5U)) {
+			int64_t r;
+			if (vn && (unsigned)(v[0] - '0') < 10U &&
+			    !num_parse_i64((char const *)v, vn, &r))
+				ev->retry = r;
+		}
+	}
+
+	if (!data)
+		return ENOMSG;
+
+	ev->data = joined
+	         ? make_dstr_view_from_decay((char const *)p->join, jlen)
+	         : make_dstr_view_from_decay((char const *)data, dlen);
+	return 0;
+}
+
+/**
+ * @brief Append to the partial event.
+ */
+nonnull_in()
+static int
+sse_carry (struct sse    *p,
+           uint8_t const *s,
+           size_t         n)
+{
+	if (!n)
+		return 0;
+
+	if (n > SSE_EVENT_MAX - p->len) {
+		sse_reset(p);
+		return EMSGSIZE;
+	}
+
+	int e = sse_grow(&p->buf, &p->cap, p->len + n);
+	if (e)
+		return e;
+
+	__builtin_memcpy(&p->buf[p->len], s, n);
+	p->len += n;
+	return 0;
+}
+
+int
+sse_feed (struct sse       *p,
+          void const       *src,
+          size_t            len,
+          size_t           *off,
+          struct sse_event *ev)
+{
+	uint8_t const *s = src;
+	size_t i = *off;
+
+	if (p->done)
+		sse_reset(p);
+
+	for (;;) {
+		size_t end;
+		int e;
+
+		if (p->len) {
+			uint8_t const *t = &p->buf[p->len - 1U];
+			unsigned prev = (p->len > 1U ? t[-1] : '\n') << 8U | t[0];
+			end = sse_boundary(&s[i], len - i, prev);
+
+			e = sse_carry(p, &s[i], end ? end : len - i);
+			if (e)
+				return e;
+			if (!end) {
+				*off = len;
+				return EAGAIN;
+			}
+			*off = i += end;
+			p->done = true;
+			e = sse_event(p, p->buf, p->len, ev);
+			p->copied += !e;
+		} else {
+			end = sse_boundary(&s[i], len - i, '\n');
+			if (!end) {
+				e = sse_carry(p, &s[i], len - i);
+				if (!e) {
+					*off = len;
+					e = EAGAIN;
+				}
+				return e;
+			}
+			e = sse_event(p, &s[i], end, ev);
+			*off = i += end;
+		}
+
+		if (e != ENOMSG) {
+			p->events += !e;
+			return e;
+		}
+
+		if (p->done)
+			sse_reset(p);
+	}
+}
+
+void
+sse_fini (struct sse *p)
+{
+	free(p->buf);
+	free(p->join);
+	*p = sse();
+}
@@ -0,0 +1,111 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file sse.h
+ *
+ * @brief Resumable server-sent events parser.
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_SSE_H_
+#define LIBCANTH_SRC_SSE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dstr.h"
+#include "util.h"
+
+/**
+ * @brief Largest event the parser will carry across chunks.
+ */
+#define SSE_EVENT_MAX (16U << 20U)
+
+/**
+ * @brief Event handed out by @ref sse_feed().
+ *
+ * The fields are views, either of the chunk passed to @ref sse_feed()
+ * or of the parser's own buffer, and are valid until the next call.
+ */
+struct sse_event {
+	dstr    event; //!< Event type, empty if the stream didn't name one.
+	dstr    data;  //!< Data lines joined with `\n`.
+	dstr    id;    //!< Last event ID field, if any.
+	int64_t retry; //!< Reconnection time in milliseconds, or -1.
+};
+
+/**
+ * @brief Server-sent events parser state.
+ */
+struct sse {
+	uint8_t *buf;    //!< Event cut off by the end of a chunk.
+	size_t   len;    //!< Bytes in @ref sse::buf.
+	size_t   cap;    //!< Size of @ref sse::buf.
+	uint8_t *join;   //!< Data of events with several data lines.
+	size_t   jcap;   //!< Size of @ref sse::join.
+	size_t   events; //!< Events handed out.
+	size_t   copied; //!< Events that had to be copied.
+	bool     done;   //!< @ref sse::buf holds an event handed out.
+};
+
+/**
+ * @brief Server-sent events parser RAII initializer.
+ * @return A parser object by value.
+ */
+static const_inline
+struct sse sse (void)
+{
+	return (struct sse){0};
+}
+
+/**
+ * @brief Parse the next event from a chunk of the stream.
+ *
+ * Event boundaries are found by scanning for line feeds several bytes
+ * at a time. An event that lies within the chunk is handed out as
+ * views of it without copying. Only the part of an event that is cut
+ * off by the end of the chunk is copied, to be completed by the next
+ * chunk. Lines may end in LF or CRLF, comment lines are skipped, and
+ * events without data aren't handed out.
+ *
+ * Call repeatedly with the same chunk until it returns `EAGAIN`:
+ *
+ * @code
+ * size_t off = 0;
+ * struct sse_event ev;
+ * while (!(e = sse_feed(&p, buf, len, &off, &ev)))
+ *         consume(&ev);
+ * @endcode
+ *
+ * @param[in,out] p   Parser.
+ * @param[in]     src Chunk.
+ * @param[in]     len Length of @p src.
+ * @param[in,out] off Offset into @p src, advanced past what was parsed.
+ * @param[out]    ev  Event.
+ * @return 0 if an event was parsed, `EAGAIN` once the chunk has been
+ *         consumed, otherwise an error code. An event that grows past
+ *         @ref SSE_EVENT_MAX is `EMSGSIZE`.
+ */
+extern int
+sse_feed (struct sse       *p,
+          void const       *src,
+          size_t            len,
+          size_t           *off,
+          struct sse_event *ev) nonnull_in(1,4,5);
+
+/**
+ * @brief Drop any partial event, keeping the buffers.
+ */
+nonnull_in()
+static force_inline void
+sse_reset (struct sse *p)
+{
+	p->len = 0;
+	p->done = false;
+}
+
+/**
+ * @brief Release a parser.
+ */
+extern void
+sse_fini (struct sse *p) nonnull_in();
+
+#endif /* LIBCANTH_SRC_SSE_H_ */
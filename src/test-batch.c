@@ -0,0 +1,680 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file test-batch.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define PROGNAME "test-batch"
+#define SYNOPSIS "[OPTION]..."
+#define PURPOSE  "Run prompts through the Message Batches pipeline"
+
+#define OPTIONS(X)                                \
+	X(boolean, help, 'h', "help",             \
+	  "print this help text and exit")        \
+	                                          \
+	X(number, prompts, 'n', "prompts",        \
+	  "submit NUM prompts",                   \
+	  "NUM", 100000, 1, 10000000)             \
+	                                          \
+	X(number, requests, 'm', "max-requests",  \
+	  "put at most NUM requests in a batch",  \
+	  "NUM", 40000, 1, 100000)                \
+	                                          \
+	X(number, bytes, 's', "max-bytes",        \
+	  "make batches at most NUM bytes",       \
+	  "NUM", 8 << 20, 1024, 256 << 20)        \
+	                                          \
+	X(string, dir, 'd', "dir",                \
+	  "write files to DIR instead of a "      \
+	  "temporary directory",                  \
+	  "DIR")
+
+#define DETAILS \
+ "Prompts are written to batch files, which are submitted to\n" \
+ "a mock server in a child process. Each batch is polled until\n" \
+ "it ends, and its results, which the server returns in reverse\n" \
+ "order with every tenth request failed, are downloaded and\n" \
+ "matched back to the prompts."
+
+#include "letopt.h"
+
+#undef DETAILS
+#undef OPTIONS
+#undef PURPOSE
+#undef SYNOPSIS
+#undef PROGNAME
+
+#include "batch.h"
+#include "dbg.h"
+#include "message.h"
+#include "mono.h"
+#include "test-mock.h"
+
+/**
+ * @brief Polls of a mock batch until it ends. The first one is rate
+ *        limited.
+ */
+#define MOCK_POLLS 3U
+
+/**
+ * @brief Most batches the mock server keeps.
+ */
+#define MOCK_BATCHES 256U
+
+/**
+ * @brief Request of a submitted batch, as far as the mock reads it.
+ */
+#define MOCK_REQUEST_FIELDS(X)                                            \
+	X(string, custom_id, "custom_id")                                 \
+	X(value,  params,    "params")
+
+#define MOCK_PARAMS_FIELDS(X)                                             \
+	X(value, messages, "messages")
+
+#define MOCK_TURN_FIELDS(X)                                               \
+	X(string, content, "content")
+
+JDECODE_STRUCT(mock_request, MOCK_REQUEST_FIELDS);
+JDECODE_STRUCT(mock_params, MOCK_PARAMS_FIELDS);
+JDECODE_STRUCT(mock_turn, MOCK_TURN_FIELDS);
+
+JDECODE_PROTO(mock_request);
+JDECODE_PROTO(mock_params);
+JDECODE_PROTO(mock_turn);
+
+JDECODE_FUNC(mock_request, MOCK_REQUEST_FIELDS)
+JDECODE_FUNC(mock_params, MOCK_PARAMS_FIELDS)
+JDECODE_FUNC(mock_turn, MOCK_TURN_FIELDS)
+
+/**
+ * @brief Mock API state.
+ */
+struct mock_api {
+	pthread_mutex_t lock;                  //!< Guards everything below.
+	dstr            results[MOCK_BATCHES]; //!< Results of each batch.
+	uint32_t        polls[MOCK_BATCHES];   //!< Polls of each batch.
+	uint32_t        batches;               //!< Batches created.
+	char const     *port;                  //!< Listening port.
+};
+
+/**
+ * @brief Results seen by the client.
+ */
+struct tally {
+	uint8_t *seen;      //!< Results per prompt.
+	size_t   n;         //!< Prompts.
+	size_t   succeeded; //!< Results that succeeded.
+	size_t   errored;   //!< Results that errored.
+};
+
+static size_t
+prompt (char   *dst,
+        size_t  size,
+        size_t  i)
+{
+	int n = snprintf(dst, size, "Prompt %zu: summarize the plot of "
+	                 "\"Hamlet\" in one sentence, in the style of a "
+	                 "weather report.", i);
+	return n < 0 ? 0 : (size_t)n;
+}
+
+static bool
+mock_reply (int         fd,
+            int         status,
+            char const *body,
+            size_t      n)
+{
+	char head[128];
+	int k = snprintf(head, sizeof head, "HTTP/1.1 %d X\r\n"
+	                 "Content-Type: application/json\r\n"
+	                 "Content-Length: %zu\r\n\r\n", status, n);
+	return mock_send(fd, head, (size_t)k) && mock_send(fd, body, n);
+}
+
+/**
+ * @brief Write one result line.
+ */
+static void
+mock_result (struct jwriter *w,
+             dstr const     *id,
+             dstr const     *text,
+             bool            fail)
+{
+	static char const error[] = "{\"type\":\"error\",\"error\":"
+	                            "{\"type\":\"overloaded_error\"}}";
+
+	(void)jwriter_object_begin(w);
+	(void)jwriter_key(w, "custom_id", 9U);
+	(void)jwriter_string(w, dstr_get(id), id->len);
+	(void)jwriter_key(w, "result", 6U);
+	(void)jwriter_object_begin(w);
+	(void)jwriter_key(w, "type", 4U);
+	if (fail) {
+		(void)jwriter_string_clean(w, "errored", 7U);
+		(void)jwriter_key(w, "error", 5U);
+		(void)jwriter_raw(w, error, sizeof error - 1U);
+	} else {
+		(void)jwriter_string_clean(w, "succeeded", 9U);
+		(void)jwriter_key(w, "message", 7U);
+		(void)jwriter_object_begin(w);
+		(void)jwriter_key(w, "type", 4U);
+		(void)jwriter_string_clean(w, "message", 7U);
+		(void)jwriter_key(w, "role", 4U);
+		(void)jwriter_string_clean(w, "assistant", 9U);
+		(void)jwriter_key(w, "content", 7U);
+		(void)jwriter_array_begin(w);
+		(void)jwriter_object_begin(w);
+		(void)jwriter_key(w, "type", 4U);
+		(void)jwriter_string_clean(w, "text", 4U);
+		(void)jwriter_key(w, "text", 4U);
+		(void)jwriter_string(w, dstr_get(text), text->len);
+		(void)jwriter_object_end(w);
+		(void)jwriter_array_end(w);
+		(void)jwriter_key(w, "stop_reason", 11U);
+		(void)jwriter_string_clean(w, "end_turn", 8U);
+		(void)jwriter_object_end(w);
+	}
+	(void)jwriter_object_end(w);
+	(void)jwriter_object_end(w);
+}
+
+/**
+ * @brief Write the results of a submitted batch, last request first.
+ *        Every tenth prompt fails, and the rest get their text echoed.
+ */
+static int
+mock_results (struct jtape const *t,
+              dstr               *out)
+{
+	size_t req = 0;
+	if (jtape_type(t, 1U) != jtape_object)
+		return EPROTO;
+	for (size_t i = 2U, end = jtape_payload(t, 1U) - 1U; i < end;
+	     i = jtape_skip(t, i + 1U)) {
+		dstr k = jtape_str(t, i);
+		if (dstr_eq(&k, "requests", 8U)) {
+			req = i + 1U;
+			break;
+		}
+	}
+	if (!req || jtape_type(t, req) != jtape_array)
+		return EPROTO;
+
+	/* Collect the request indices to walk them backwards. */
+	size_t n = 0, cap = 0, *idx = nullptr;
+	for (size_t i = req + 1U, end = jtape_payload(t, req) - 1U; i < end;
+	     i = jtape_skip(t, i)) {
+		if (n == cap) {
+			cap = cap ? cap * 2U : 1024U;
+			size_t *p = realloc(idx, cap * sizeof *idx);
+			if (!p) {
+				free(idx);
+				return errno;
+			}
+			idx = p;
+		}
+		idx[n++] = i;
+	}
+
+	struct jwriter w;
+	jwriter_init(&w, out, n * 256U);
+	int e = 0;
+	while (n--) {
+		struct mock_request r;
+		struct mock_params p = {0};
+		struct mock_turn u = {0};
+		e = mock_request_decode(&r, t, idx[n]);
+		if (!e)
+			e = !r.has.custom_id || !r.has.params
+			    ? EPROTO : mock_params_decode(&p, t, r.m_params);
+		if (!e)
+			e = !p.has.messages ||
+			    jtape_type(t, p.m_messages) != jtape_array
+			    ? EPROTO : mock_turn_decode(&u, t, p.m_messages + 1U);
+		if (!e && !u.has.content)
+			e = EPROTO;
+		if (e)
+			break;
+
+		size_t k = 0;
+		char const *s = dstr_get(&r.m_custom_id);
+		for (size_t j = 2U; j < r.m_custom_id.len; ++j)
+			k = k * 10U + (size_t)(s[j] - '0');
+		mock_result(&w, &r.m_custom_id, &u.m_content, !(k % 10U));
+	}
+
+	free(idx);
+	int f = jwriter_end(&w);
+	return e ? e : f;
+}
+
+/**
+ * @brief Answer one request.
+ *
+ * @return Whether the connection can be kept.
+ */
+static bool
+mock_serve (void       *ctx,
+            int         fd,
+            char const *head,
+            char const *body,
+            size_t      blen)
+{
+	struct mock_api *m = ctx;
+	char b[256];
+	int n;
+	unsigned k;
+
+	if (!strstr(head, "\r\nx-api-key: test\r\n"))
+		return mock_reply(fd, 401, "{}", 2U);
+
+	if (!strncmp(head, "POST /v1/messages/batches ", 26U)) {
+		struct jtape t = {0};
+		dstr res;
+		dstr_init(&res);
+		int e = jtape_parse(&t, body, blen);
+		if (!e)
+			e = mock_results(&t, &res);
+		jtape_fini(&t);
+
+		(void)pthread_mutex_lock(&m->lock);
+		k = m->batches;
+		if (!e && k < MOCK_BATCHES) {
+			dstr_move(&m->results[k], &res);
+			++m->batches;
+		}
+		(void)pthread_mutex_unlock(&m->lock);
+		dstr_fini(&res);
+
+		if (e || k == MOCK_BATCHES)
+			return mock_reply(fd, 400, "{}", 2U);
+		n = snprintf(b, sizeof b, "{\"id\":\"msgbatch_%u\",\"type\":"
+		             "\"message_batch\",\"processing_status\":"
+		             "\"in_progress\",\"results_url\":null}", k);
+		return mock_reply(fd, 200, b, (size_t)n);
+	}
+
+	if (strncmp(head, "GET /v1/messages/batches/msgbatch_", 34U) ||
+	    sscanf(&head[34], "%u", &k) != 1)
+		return mock_reply(fd, 404, "{}", 2U);
+
+	char const *rest = strchr(&head[34], ' ');
+	bool results = rest && rest - head > 42 &&
+	               !strncmp(rest - 8, "/results", 8U);
+
+	(void)pthread_mutex_lock(&m->lock);
+	bool known = k < m->batches;
+	uint32_t p = known && !results ? m->polls[k]++ : 0;
+	dstr const *r = known ? &m->results[k] : nullptr;
+	(void)pthread_mutex_unlock(&m->lock);
+	if (!known)
+		return mock_reply(fd, 404, "{}", 2U);
+
+	if (results) {
+		/* Send the results in chunks, as a stored file would be. */
+		static char const hdr[] = "HTTP/1.1 200 OK\r\n"
+		                          "Content-Type: application/binary\r\n"
+		                          "Transfer-Encoding: chunked\r\n\r\n";
+		if (!mock_send(fd, hdr, sizeof hdr - 1U))
+			return false;
+		char const *s = dstr_get(r);
+		for (size_t i = 0, c; i < r->len; i += c) {
+			c = r->len - i < 65536U ? r->len - i : 65536U;
+			n = snprintf(b, sizeof b, "%zx\r\n", c);
+			if (!mock_send(fd, b, (size_t)n) ||
+			    !mock_send(fd, &s[i], c) ||
+			    !mock_send(fd, "\r\n", 2U))
+				return false;
+		}
+		return mock_send(fd, "0\r\n\r\n", 5U);
+	}
+
+	if (!p)
+		return mock_reply(fd, 429, "{}", 2U);
+
+	bool ended = p + 1U >= MOCK_POLLS;
+	n = snprintf(b, sizeof b, "{\"id\":\"msgbatch_%u\",\"type\":"
+	             "\"message_batch\",\"processing_status\":\"%s\","
+	             "\"results_url\":", k, ended ? "ended" : "in_progress");
+	n += ended
+	     ? snprintf(&b[n], sizeof b - (size_t)n, "\"http://127.0.0.1:%s"
+	                "/v1/messages/batches/msgbatch_%u/results\"}",
+	                m->port, k)
+	     : snprintf(&b[n], sizeof b - (size_t)n, "null}");
+	return mock_reply(fd, 200, b, (size_t)n);
+}
+
+/**
+ * @brief Fork a mock API server, which serves until the parent closes
+ *        its end of the control pipe.
+ *
+ * @param[out] port Where to store the port it listens on.
+ * @param[out] ctl  Where to store the control pipe.
+ * @return Process ID of the server, or -1 with `errno` set.
+ */
+static pid_t
+mock_fork (char *port,
+           int  *ctl)
+{
+	static struct mock_api api = {.lock = PTHREAD_MUTEX_INITIALIZER};
+	static struct mock m = {.serve = mock_serve, .ctx = &api};
+	int pfd[2];
+
+	int e = mock_listen(&m);
+	if (e) {
+		errno = e;
+		return -1;
+	}
+	if (pipe(pfd)) {
+		(void)close(m.fd);
+		return -1;
+	}
+	(void)snprintf(port, 8U, "%s", m.port);
+	api.port = m.port;
+
+	pid_t pid = fork();
+	if (!pid) {
+		char c;
+		(void)close(pfd[1]);
+		if (mock_run(&m))
+			_exit(EXIT_FAILURE);
+		while (read(pfd[0], &c, 1U) < 0 && errno == EINTR);
+		_exit(EXIT_SUCCESS);
+	}
+
+	(void)close(m.fd);
+	(void)close(pfd[0]);
+	if (pid < 0) {
+		(void)close(pfd[1]);
+		return -1;
+	}
+
+	*ctl = pfd[1];
+	return pid;
+}
+
+/**
+ * @brief Check a result against its prompt.
+ */
+static int
+on_result (void                      *ctx,
+           struct batch_result const *r,
+           struct jtape const        *t)
+{
+	struct tally *y = ctx;
+	char const *s = dstr_get(&r->m_custom_id);
+	size_t i = 0;
+
+	if (r->m_custom_id.len < 3U || strncmp(s, "p-", 2U))
+		return EPROTO;
+	for (size_t j = 2U; j < r->m_custom_id.len; ++j) {
+		if (s[j] < '0' || s[j] > '9')
+			return EPROTO;
+		i = i * 10U + (size_t)(s[j] - '0');
+	}
+	if (i >= y->n || y->seen[i]++) {
+		pr_err_("unexpected result %.*s", (int)r->m_custom_id.len, s);
+		return EPROTO;
+	}
+
+	struct batch_outcome const *o = &r->m_result;
+	if (dstr_eq(&o->m_type, "errored", 7U)) {
+		++y->errored;
+		return !(i % 10U) && o->has.error ? 0 : EPROTO;
+	}
+	if (!dstr_eq(&o->m_type, "succeeded", 9U) || !o->has.message ||
+	    !(i % 10U))
+		return EPROTO;
+	++y->succeeded;
+
+	struct message msg;
+	struct message_block blk;
+	int e = message_decode(&msg, t, o->m_message);
+	if (!e)
+		e = msg.has.content &&
+		    jtape_type(t, msg.m_content) == jtape_array
+		    ? message_block_decode(&blk, t, msg.m_content + 1U)
+		    : EPROTO;
+	if (e)
+		return e;
+
+	char want[256];
+	size_t n = prompt(want, sizeof want, i);
+	return blk.has.text && dstr_eq(&blk.m_text, want, n) ? 0 : EPROTO;
+}
+
+static int
+write_batches (char const                *prefix,
+               size_t                     n,
+               struct batch_limits const *lim,
+               uint32_t                  *files)
+{
+	struct batch_writer b;
+	int e = batch_writer_open(&b, prefix, lim);
+
+	for (size_t i = 0; !e && i < n; ++i) {
+		char id[32], text[256];
+		int k = snprintf(id, sizeof id, "p-%zu", i);
+		size_t t = prompt(text, sizeof text, i);
+		e = batch_writer_prompt(&b, id, (size_t)k, "claude-sonnet-4-5",
+		                        256, text, t);
+	}
+
+	if (!e)
+		e = batch_writer_close(&b);
+	*files = b.files;
+	batch_writer_fini(&b);
+	return e;
+}
+
+/**
+ * @brief Check that every batch file is within the size limit.
+ */
+static int
+check_batches (char const                *prefix,
+               uint32_t                   files,
+               struct batch_limits const *lim,
+               size_t                    *bytes)
+{
+	*bytes = 0;
+	for (uint32_t i = 0; i < files; ++i) {
+		char path[4096];
+		struct stat st;
+		int e = batch_path(path, sizeof path, prefix, i);
+		if (e)
+			return e;
+		if (stat(path, &st))
+			return errno;
+		if ((uintmax_t)st.st_size > lim->max_bytes) {
+			pr_err_("%s: %jd bytes", path, (intmax_t)st.st_size);
+			return EMSGSIZE;
+		}
+		*bytes += (size_t)st.st_size;
+	}
+	return 0;
+}
+
+static int
+results_path (char       *dst,
+              size_t      size,
+              char const *prefix,
+              uint32_t    i)
+{
+	int n = snprintf(dst, size, "%s.%" PRIu32 ".results.jsonl", prefix, i);
+	return n < 0 || (size_t)n >= size ? ENAMETOOLONG : 0;
+}
+
+static int
+run_batches (char const             *prefix,
+             uint32_t                files,
+             struct batch_api const *api,
+             struct tally           *y)
+{
+	struct http_pool p;
+	struct hloop l;
+	int e = http_pool_init(&p, nullptr);
+	if (e)
+		return e;
+	e = hloop_init(&l, nullptr);
+	if (e) {
+		http_pool_fini(&p);
+		return e;
+	}
+
+	struct batch_poll poll = {
+		.initial_ms = 5U,
+		.max_ms     = 20U,
+		.timeout_ms = 10000U,
+	};
+	for (uint32_t i = 0; !e && i < files; ++i) {
+		char path[4096], out[4096];
+		dstr id, res;
+		dstr_init(&id);
+		dstr_init(&res);
+
+		e = batch_path(path, sizeof path, prefix, i);
+		if (!e)
+			e = results_path(out, sizeof out, prefix, i);
+		if (!e)
+			e = batch_create(&p, api, path, &id);
+		if (!e)
+			e = batch_wait(&p, api, &id, &poll, &res);
+		if (!e)
+			e = batch_fetch(&l, api, &res, out);
+		if (!e)
+			e = batch_results(out, on_result, y);
+		if (e)
+			pr_errno_(e, "batch %" PRIu32, i);
+
+		dstr_fini(&res);
+		dstr_fini(&id);
+	}
+
+	hloop_fini(&l);
+	http_pool_fini(&p);
+	return e;
+}
+
+static void
+remove_files (char const *prefix,
+              uint32_t    files)
+{
+	for (uint32_t i = 0; i < files; ++i) {
+		char path[4096];
+		if (!batch_path(path, sizeof path, prefix, i))
+			(void)unlink(path);
+		if (!results_path(path, sizeof path, prefix, i))
+			(void)unlink(path);
+	}
+}
+
+int
+main (int    c,
+      char **v)
+{
+	struct letopt opt = letopt_init(c, v);
+
+	if (letopt_nargs(&opt) || opt.m_help)
+		letopt_helpful_exit(&opt);
+
+	size_t n = (size_t)opt.m_prompts;
+	struct batch_limits lim = {
+		.max_requests = (uint32_t)opt.m_requests,
+		.max_bytes    = (uint32_t)opt.m_bytes,
+	};
+
+	char tmp[] = "/tmp/test-batch.XXXXXX";
+	char const *dir = opt.m_dir;
+	if (!dir && !(dir = mkdtemp(tmp))) {
+		pr_errno_(errno, "mkdtemp");
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	char prefix[4096];
+	int k = snprintf(prefix, sizeof prefix, "%s/batch", dir);
+	struct tally y = {.seen = calloc(n, 1U), .n = n};
+	if (!y.seen || k < 0 || (size_t)k >= sizeof prefix) {
+		pr_errno_(y.seen ? ENAMETOOLONG : ENOMEM, "%s", dir);
+		free(y.seen);
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	/* Fork the server before this process starts any threads. */
+	char port[8];
+	int ctl = -1;
+	pid_t pid = mock_fork(port, &ctl);
+	if (pid < 0) {
+		pr_errno_(errno, "mock server");
+		free(y.seen);
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	uint32_t files = 0;
+	size_t bytes = 0;
+	uint64_t t0 = mono_us();
+	int e = write_batches(prefix, n, &lim, &files);
+	uint64_t t1 = mono_us();
+	if (!e)
+		e = check_batches(prefix, files, &lim, &bytes);
+	if (!e)
+		pr_out("%zu prompts in %" PRIu32 " batches, %zu bytes, "
+		       "written in %.1f ms", n, files, bytes,
+		       (double)(t1 - t0) / 1e3);
+
+	struct batch_api api = {
+		.host = "127.0.0.1",
+		.port = port,
+		.key  = "test",
+	};
+	if (!e)
+		e = run_batches(prefix, files, &api, &y);
+	uint64_t t2 = mono_us();
+
+	for (size_t i = 0; !e && i < n; ++i) {
+		if (!y.seen[i]) {
+			pr_err_("no result for p-%zu", i);
+			e = EPROTO;
+		}
+	}
+	if (!e && y.errored != (n + 9U) / 10U) {
+		pr_err_("%zu errored results, expected %zu", y.errored,
+		        (n + 9U) / 10U);
+		e = EPROTO;
+	}
+
+	struct rusage ru;
+	if (!e && !getrusage(RUSAGE_SELF, &ru))
+		pr_out("%zu succeeded, %zu errored, processed in %.1f ms, "
+		       "max RSS %ld KiB", y.succeeded, y.errored,
+		       (double)(t2 - t1) / 1e3, ru.ru_maxrss);
+
+	int status = 0;
+	(void)close(ctl);
+	if (waitpid(pid, &status, 0) != pid ||
+	    !WIFEXITED(status) || WEXITSTATUS(status)) {
+		pr_err_("mock server failed");
+		e = e ? e : EPROTO;
+	}
+
+	if (!opt.m_dir) {
+		remove_files(prefix, files);
+		(void)rmdir(dir);
+	}
+
+	free(y.seen);
+	(void)letopt_fini(&opt);
+	return e ? EXIT_FAILURE : EXIT_SUCCESS;
+}
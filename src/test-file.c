@@ -0,0 +1,184 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file test-file.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+
+#define PROGNAME "test-file"
+#define SYNOPSIS "[OPTION]... [--] FILE..."
+#define PURPOSE  "Concatenate files through the file layer"
+
+#define OPTIONS(X)                              \
+	X(boolean, help, 'h', "help",           \
+	  "print this help text and exit")      \
+	                                        \
+	X(string, output, 'o', "output",        \
+	  "write to FILE instead of stdout",    \
+	  "FILE")                               \
+	                                        \
+	X(boolean, atomic, 'a', "atomic",       \
+	  "replace output only on success")     \
+	                                        \
+	X(boolean, read, 'r', "read",           \
+	  "read input to memory, don't splice") \
+	                                        \
+	X(boolean, cached, 'c', "cached",       \
+	  "read input through the file cache")  \
+	                                        \
+	X(boolean, decompress, 'z', "decompress", \
+	  "decode gzip and zstd input")         \
+	                                        \
+	X(boolean, text, 't', "text",           \
+	  "read input as UTF-8 text, strip BOM" \
+	  " and convert CRLF to LF")            \
+	                                        \
+	X(number, repeat, 'n', "repeat",        \
+	  "output each FILE NUM times",         \
+	  "NUM", 1, 1, 1000000)                 \
+	                                        \
+	X(boolean, stats, 's', "stats",         \
+	  "print file cache statistics")
+
+#define DETAILS \
+ "Input files are copied in kernel space unless reading\n" \
+ "is requested, in which case they're loaded to memory\n"  \
+ "and queued for vectored output."
+
+#include "letopt.h"
+
+#undef DETAILS
+#undef OPTIONS
+#undef PURPOSE
+#undef SYNOPSIS
+#undef PROGNAME
+
+#include "dbg.h"
+#include "fcache.h"
+#include "fstream.h"
+
+static int
+arg_conflict (struct letopt *opt);
+
+int
+main (int    c,
+      char **v)
+{
+	struct letopt opt = letopt_init(c, v);
+
+	if (arg_conflict(&opt))
+		return letopt_fini(&opt);
+
+	if (letopt_nargs(&opt) < 1 || opt.m_help)
+		letopt_helpful_exit(&opt);
+
+	char const *path = opt.has.output ? opt.m_output : "/dev/stdout";
+	unsigned flags = opt.m_atomic ? file_out_atomic : 0U;
+	int ret = EXIT_SUCCESS;
+
+	struct file_out out;
+	int e = file_out_open(&out, path, flags);
+	if (e) {
+		pr_errno_(e, "%s", path);
+		file_out_fini(&out);
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	for (int i = 0; !e && i < letopt_nargs(&opt) * opt.m_repeat; ++i) {
+		char const *arg = letopt_arg(&opt, i % letopt_nargs(&opt));
+
+		if (opt.m_decompress) {
+			struct fstream z;
+			e = fstream_open(&z, arg);
+			for (size_t n = 1U; !e && n;) {
+				unsigned char const *p;
+				e = fstream_next(&z, &p, &n);
+				if (!e)
+					e = file_out_write(&out, p, n);
+			}
+			if (e)
+				pr_errno_(e, "%s", arg);
+			fstream_fini(&z);
+			continue;
+		}
+
+		if (!opt.m_read) {
+			e = file_out_splice(&out, arg);
+			if (e)
+				pr_errno_(e, "%s", arg);
+			continue;
+		}
+
+		struct file_in f = opt.m_cached ? file_read_cached(arg)
+		                 : opt.m_text   ? file_read_text(arg)
+		                                : file_read(arg);
+		e = file_error(&f);
+		if (e) {
+			pr_errno_(e, "%s", arg);
+		} else {
+			if (opt.m_text && !(f.text & file_text_valid))
+				pr_wrn_("%s: invalid UTF-8 at offset %zu",
+				        arg, f.bad);
+			if (opt.m_text && opt.m_stats)
+				pr_("%s: %zu bytes, %zu code points%s%s\n",
+				    arg, f.size, f.chars,
+				    f.text & file_text_bom ? ", BOM" : "",
+				    f.text & file_text_crlf ? ", CRLF" : "");
+
+			e = file_out_write(&out, f.data, f.size);
+			if (e)
+				pr_errno_(e, "%s", path);
+		}
+		file_in_fini(&f);
+	}
+
+	if (e) {
+		ret = EXIT_FAILURE;
+	} else {
+		e = file_out_commit(&out);
+		if (e) {
+			pr_errno_(e, "%s", path);
+			ret = EXIT_FAILURE;
+		}
+	}
+
+	file_out_fini(&out);
+
+	if (opt.m_stats) {
+		struct fcache_stats st = fcache_stats();
+		pr_("hits %zu, misses %zu, evicted %zu, entries %zu, bytes %zu\n",
+		    st.hits, st.misses, st.evicted, st.entries, st.bytes);
+	}
+
+	fcache_purge();
+	(void)letopt_fini(&opt);
+	return ret;
+}
+
+static int
+arg_conflict (struct letopt *opt)
+{
+	int e = 0;
+
+	if (opt->m_cached || opt->m_text)
+		opt->m_read = true;
+
+	if (opt->m_decompress && opt->m_cached) {
+		pr_err_("can't decompress cached input");
+		e = EINVAL;
+	}
+
+	if (opt->m_text && (opt->m_cached || opt->m_decompress)) {
+		pr_err_("can't combine text mode with -c or -z");
+		e = EINVAL;
+	}
+
+	if (opt->m_atomic && !opt->has.output) {
+		pr_err_("can't replace stdout atomically");
+		e = EINVAL;
+	}
+
+	opt->p.e = e;
+	return e;
+}
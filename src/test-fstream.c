@@ -0,0 +1,286 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file test-fstream.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef HAVE_ZLIB
+# include <zlib.h>
+#endif /* HAVE_ZLIB */
+#ifdef HAVE_ZSTD
+# include <zstd.h>
+#endif /* HAVE_ZSTD */
+
+#define PROGNAME "test-fstream"
+#define SYNOPSIS "[OPTION]..."
+#define PURPOSE  "Decode streams that end on chunk boundaries"
+
+#define OPTIONS(X)                                  \
+	X(boolean, help, 'h', "help",               \
+	  "print this help text and exit")          \
+	                                            \
+	X(number, chunks, 'n', "chunks",            \
+	  "check streams of up to NUM chunks",      \
+	  "NUM", 3, 1, 64)
+
+#define DETAILS \
+ "Streams one byte short of, exactly at, and one byte past each multiple\n" \
+ "of the decoded chunk size are written as single frames, and as two\n" \
+ "frames split at a chunk boundary, in every compressed format that was\n" \
+ "built in. Each is read back chunk by chunk and compared to what was\n" \
+ "written."
+
+#include "letopt.h"
+
+#undef DETAILS
+#undef OPTIONS
+#undef PURPOSE
+#undef SYNOPSIS
+#undef PROGNAME
+
+#include "dbg.h"
+#include "fstream.h"
+
+static char const *const codec_name[] = {
+	[fstream_plain] = "plain",
+	[fstream_gzip]  = "gzip",
+	[fstream_zstd]  = "zstd",
+};
+
+/**
+ * @brief Fill a buffer with compressible pseudorandom text.
+ */
+static void
+fill (unsigned char *p,
+      size_t         n,
+      uint64_t       seed)
+{
+	uint64_t x = seed * 0x9e3779b97f4a7c15U + 1U;
+	for (size_t i = 0; i < n; ++i) {
+		x ^= x << 13U;
+		x ^= x >> 7U;
+		x ^= x << 17U;
+		p[i] = (unsigned char)('a' + (x & 15U));
+	}
+}
+
+static int
+write_all (int         fd,
+           void const *s,
+           size_t      n)
+{
+	for (unsigned char const *p = s; n;) {
+		ssize_t r = write(fd, p, n);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		p += r;
+		n -= (size_t)r;
+	}
+	return 0;
+}
+
+/**
+ * @brief Compress @p n bytes into one frame and append it to @p fd.
+ */
+static int
+write_frame (int                 fd,
+             enum fstream_codec  codec,
+             unsigned char const *src,
+             size_t              n)
+{
+	if (codec == fstream_plain)
+		return write_all(fd, src, n);
+
+	int e = ENOTSUP;
+	void *dst = nullptr;
+	size_t len = 0;
+
+#ifdef HAVE_ZLIB
+	if (codec == fstream_gzip) {
+		z_stream z = {0};
+		if (deflateInit2(&z, 6, Z_DEFLATED, 31, 8,
+		                 Z_DEFAULT_STRATEGY) != Z_OK)
+			return ENOMEM;
+		len = deflateBound(&z, (uLong)n);
+		dst = malloc(len);
+		e = ENOMEM;
+		if (dst) {
+			z.next_in = (unsigned char *)src;
+			z.avail_in = (uInt)n;
+			z.next_out = dst;
+			z.avail_out = (uInt)len;
+			e = deflate(&z, Z_FINISH) == Z_STREAM_END ? 0 : EIO;
+			len -= z.avail_out;
+		}
+		(void)deflateEnd(&z);
+	}
+#endif /* HAVE_ZLIB */
+
+#ifdef HAVE_ZSTD
+	if (codec == fstream_zstd) {
+		ZSTD_CCtx *z = ZSTD_createCCtx();
+		len = ZSTD_compressBound(n);
+		dst = malloc(len);
+		e = ENOMEM;
+		if (z && dst) {
+			/* The checksum is read only after the last byte
+			 * of content has been flushed. */
+			(void)ZSTD_CCtx_setParameter(z, ZSTD_c_checksumFlag,
+			                             1);
+			len = ZSTD_compress2(z, dst, len, src, n);
+			e = ZSTD_isError(len) ? EIO : 0;
+		}
+		(void)ZSTD_freeCCtx(z);
+	}
+#endif /* HAVE_ZSTD */
+
+	if (!e)
+		e = write_all(fd, dst, len);
+	free(dst);
+	return e;
+}
+
+/**
+ * @brief Read a stream back chunk by chunk and compare it.
+ */
+static int
+read_back (char const          *path,
+           enum fstream_codec   codec,
+           unsigned char const *want,
+           size_t               len)
+{
+	struct fstream s;
+	int e = fstream_open(&s, path);
+	if (!e && s.codec != codec) {
+		pr_err_("%s stream detected as %s", codec_name[codec],
+		        codec_name[s.codec]);
+		e = EPROTO;
+	}
+
+	for (size_t pos = 0; !e;) {
+		unsigned char const *p;
+		size_t n;
+		e = fstream_next(&s, &p, &n);
+		if (e)
+			break;
+		if (!n) {
+			if (pos != len) {
+				pr_err_("ended after %zu of %zu bytes",
+				        pos, len);
+				e = EPROTO;
+			}
+			break;
+		}
+		if (n > len - pos || memcmp(p, &want[pos], n)) {
+			pr_err_("wrong chunk of %zu bytes at %zu", n, pos);
+			e = EPROTO;
+		}
+		pos += n;
+	}
+
+	fstream_fini(&s);
+	return e;
+}
+
+/**
+ * @brief Write a stream of one or two frames and read it back.
+ *
+ * @param path  Scratch file path.
+ * @param codec Encoding.
+ * @param a     Content size of the first frame.
+ * @param b     Content size of the second frame, or 0 for none.
+ */
+static int
+check (char const         *path,
+       enum fstream_codec  codec,
+       size_t              a,
+       size_t              b)
+{
+	unsigned char *want = malloc(a + b);
+	if (!want)
+		return ENOMEM;
+	fill(want, a, a);
+	fill(&want[a], b, b + 1U);
+
+	int e = 0;
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd < 0) {
+		e = errno;
+	} else {
+		e = write_frame(fd, codec, want, a);
+		if (!e && b)
+			e = write_frame(fd, codec, &want[a], b);
+		if (close(fd) && !e)
+			e = errno;
+	}
+
+	if (!e)
+		e = read_back(path, codec, want, a + b);
+	if (e)
+		pr_errno_(e, "%s stream of %zu + %zu bytes",
+		          codec_name[codec], a, b);
+
+	free(want);
+	return e;
+}
+
+int
+main (int    c,
+      char **v)
+{
+	struct letopt opt = letopt_init(c, v);
+
+	if (letopt_nargs(&opt) || opt.m_help)
+		letopt_helpful_exit(&opt);
+
+	char tmp[] = "/tmp/test-fstream.XXXXXX";
+	char const *dir = mkdtemp(tmp);
+	if (!dir) {
+		pr_errno_(errno, "mkdtemp");
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	char path[4096];
+	(void)snprintf(path, sizeof path, "%s/stream", dir);
+
+	static enum fstream_codec const codecs[] = {
+		fstream_plain,
+#ifdef HAVE_ZLIB
+		fstream_gzip,
+#endif /* HAVE_ZLIB */
+#ifdef HAVE_ZSTD
+		fstream_zstd,
+#endif /* HAVE_ZSTD */
+	};
+
+	int e = 0;
+	size_t chunks = (size_t)opt.m_chunks;
+	for (size_t i = 0; i < sizeof codecs / sizeof codecs[0]; ++i) {
+		size_t n = 0;
+		for (size_t k = 1; k <= chunks; ++k) {
+			size_t z = k * FSTREAM_OUT_SIZE;
+			for (size_t d = z - 1U; d <= z + 1U; ++d, ++n)
+				e = e ? e : check(path, codecs[i], d, 0);
+			e = e ? e : check(path, codecs[i], z, z);
+			++n;
+		}
+		if (e)
+			break;
+		printf("%s: %zu streams\n", codec_name[codecs[i]], n);
+	}
+
+	(void)unlink(path);
+	(void)rmdir(dir);
+	(void)letopt_fini(&opt);
+	return e ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,508 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file test-hedge.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PROGNAME "test-hedge"
+#define SYNOPSIS "[OPTION]..."
+#define PURPOSE  "Hedge slow requests to a second mock server"
+
+#define OPTIONS(X)                                \
+	X(boolean, help, 'h', "help",             \
+	  "print this help text and exit")        \
+	                                          \
+	X(number, requests, 'n', "requests",      \
+	  "send NUM requests per round",          \
+	  "NUM", 2000, 100, 1000000)              \
+	                                          \
+	X(number, jobs, 'j', "jobs",              \
+	  "keep NUM requests in flight",          \
+	  "NUM", 16, 1, 1024)                     \
+	                                          \
+	X(number, slow, 's', "slow",              \
+	  "make the first server wait NUM ms "    \
+	  "before one response in 32",            \
+	  "NUM", 200, 20, 10000)                  \
+	                                          \
+	X(number, budget, 'b', "budget",          \
+	  "allow NUM permille of requests to "    \
+	  "be hedged",                            \
+	  "NUM", 50, 1, 1000)
+
+#define DETAILS \
+ "Two mock servers on loopback ports send short event streams. The\n" \
+ "first one is fast, but holds back one response in 32 for a long\n" \
+ "time, and the second one is always a little slow. A round sent to\n" \
+ "the first server alone is compared with a round hedged to the\n" \
+ "second one: each request has to get one whole stream from one\n" \
+ "server, the 99th percentile time to first byte has to drop, and\n" \
+ "losing streams have to be cancelled. A last round with a tiny\n" \
+ "budget has to stay within it. Before that, a stream cancels another\n" \
+ "one on the same loop thread just before the other one's response\n" \
+ "arrives."
+
+#include "letopt.h"
+
+#undef DETAILS
+#undef OPTIONS
+#undef PURPOSE
+#undef SYNOPSIS
+#undef PROGNAME
+
+#include "dbg.h"
+#include "hedge.h"
+#include "mono.h"
+#include "test-mock.h"
+
+/**
+ * @brief Events in each response.
+ */
+#define MOCK_EVENTS 5U
+
+/**
+ * @brief Mock event stream server.
+ */
+struct backend {
+	struct mock m;       //!< Server.
+	char        name;    //!< Letter that marks its events.
+	uint32_t    slow_ms; //!< Wait before one response in 32.
+	uint32_t    wait_ms; //!< Wait before any other response.
+	uint32_t    aborted; //!< Responses cut off, atomically updated.
+};
+
+/**
+ * @brief One request and what came of it.
+ */
+struct req {
+	struct round *r;        //!< Round.
+	char          path[24]; //!< Request path.
+	size_t        n;        //!< Request number.
+	uint64_t      start;    //!< Time it was sent, in us.
+	uint64_t      first;    //!< Time of the response head, in us.
+	size_t        events;   //!< Events in order.
+	char          server;   //!< Server that sent the events.
+	int           status;   //!< Status code from done.
+	int           e;        //!< Error code from done.
+	bool          bad;      //!< Got an event out of place.
+};
+
+/**
+ * @brief Requests of a round.
+ */
+struct round {
+	struct req *q;        //!< Requests.
+	size_t      n;        //!< Number of requests.
+	uint32_t    inflight; //!< Requests not done, atomically updated.
+	uint32_t    done;     //!< Requests done, atomically updated.
+};
+
+static void
+sleep_us (uint64_t us)
+{
+	struct timespec t = {
+		.tv_sec  = (time_t)(us / 1000000U),
+		.tv_nsec = (long)(us % 1000000U) * 1000L,
+	};
+	(void)nanosleep(&t, nullptr);
+}
+
+/**
+ * @brief Send the event stream of request @p n.
+ */
+static bool
+mock_stream (struct backend *m,
+             int             fd,
+             size_t          n)
+{
+	sleep_us((n % 32U == 7U ? m->slow_ms : m->wait_ms) * UINT64_C(1000));
+
+	static char const head[] = "HTTP/1.1 200 OK\r\n"
+	                           "Content-Type: text/event-stream\r\n"
+	                           "Transfer-Encoding: chunked\r\n\r\n";
+	if (!mock_send(fd, head, sizeof head - 1U))
+		return false;
+
+	for (unsigned i = 0; i < MOCK_EVENTS; ++i) {
+		char ev[64], out[96];
+		int k = snprintf(ev, sizeof ev, "data: %c %zu %u\n\n",
+		                 m->name, n, i);
+		k = snprintf(out, sizeof out, "%x\r\n%s\r\n", (unsigned)k, ev);
+		sleep_us(1000U);
+		if (!mock_send(fd, out, (size_t)k))
+			return false;
+	}
+	return mock_send(fd, "0\r\n\r\n", 5U);
+}
+
+/**
+ * @brief Answer one request. The path is the request number.
+ */
+static bool
+serve (void       *ctx,
+       int         fd,
+       char const *head,
+       char const *body,
+       size_t      blen)
+{
+	struct backend *m = ctx;
+	(void)body;
+	(void)blen;
+
+	size_t n = 0;
+	char const *path = strchr(head, ' ');
+	if (!path || sscanf(path, " /%zu ", &n) != 1)
+		return false;
+	if (!mock_stream(m, fd, n)) {
+		(void)__atomic_add_fetch(&m->aborted, 1U, __ATOMIC_RELAXED);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Start a backend.
+ */
+static int
+backend_start (struct backend *b)
+{
+	b->m = (struct mock){.serve = serve, .ctx = b};
+	return mock_start(&b->m);
+}
+
+static void
+on_head (void                    *ctx,
+         struct http_frame const *f)
+{
+	struct req *q = ctx;
+	(void)f;
+	if (q->first)
+		q->bad = true;
+	q->first = mono_us();
+}
+
+static void
+on_event (void                   *ctx,
+          struct sse_event const *ev)
+{
+	struct req *q = ctx;
+	char data[64];
+	size_t len = ev->data.len < sizeof data - 1U ? ev->data.len
+	                                              : sizeof data - 1U;
+	memcpy(data, dstr_get(&ev->data), len);
+	data[len] = '\0';
+
+	char server = 0;
+	size_t n = SIZE_MAX, i = SIZE_MAX;
+	if (sscanf(data, "%c %zu %zu", &server, &n, &i) != 3 ||
+	    n != q->n || i != q->events || (q->server && server != q->server))
+		q->bad = true;
+	q->server = server;
+	q->events += 1U;
+}
+
+static void
+on_done (void *ctx,
+         int   e,
+         int   status)
+{
+	struct req *q = ctx;
+	q->e = e;
+	q->status = status;
+	struct round *r = q->r;
+	(void)__atomic_sub_fetch(&r->inflight, 1U, __ATOMIC_RELAXED);
+	(void)__atomic_add_fetch(&r->done, 1U, __ATOMIC_RELEASE);
+}
+
+static struct hloop_ops const ops = {
+	.head  = on_head,
+	.event = on_event,
+	.done  = on_done,
+};
+
+/**
+ * @brief A stream that cancels another from its first event.
+ */
+struct killer {
+	struct hloop *l;      //!< Loop group.
+	struct req   *victim; //!< Stream to cancel.
+	struct req    q;      //!< What this stream got.
+};
+
+static void
+kill_on_event (void                   *ctx,
+               struct sse_event const *ev)
+{
+	struct killer *k = ctx;
+	if (!k->q.events++) {
+		(void)hloop_cancel(k->l, k->victim);
+		/* Hold the loop thread until the victim's response has
+		 * arrived too, so the cancel and the victim's input are in
+		 * the same batch of readiness events. */
+		sleep_us(30000U);
+	}
+	(void)ev;
+}
+
+static void
+kill_on_done (void *ctx,
+              int   e,
+              int   status)
+{
+	on_done(&((struct killer *)ctx)->q, e, status);
+}
+
+static struct hloop_ops const kill_ops = {
+	.event = kill_on_event,
+	.done  = kill_on_done,
+};
+
+/**
+ * @brief Check that a stream cancelled by another one on the same loop
+ *        thread is finished without touching its input, as happens
+ *        when a hedge wins.
+ */
+static int
+check_cancel (char const *fast,
+              char const *slow)
+{
+	struct hloop l;
+	int e = hloop_init(&l, &(struct hloop_cfg){.threads = 1U});
+	if (e)
+		return e;
+
+	struct round r = {.n = 2U};
+	struct req victim = {.r = &r, .n = 1U};
+	struct killer k = {.l = &l, .victim = &victim, .q = {.r = &r}};
+	struct http_request req = {
+		.method = "GET",
+		.host   = "127.0.0.1",
+		.port   = fast,
+		.path   = "/0",
+	};
+	e = hloop_submit(&l, &req, &kill_ops, &k);
+	if (!e) {
+		req.port = slow;
+		req.path = "/1";
+		e = hloop_submit(&l, &req, &ops, &victim);
+		if (e)
+			(void)__atomic_add_fetch(&r.done, 1U, __ATOMIC_RELAXED);
+	}
+	while (!e && __atomic_load_n(&r.done, __ATOMIC_ACQUIRE) < 2U)
+		sleep_us(1000U);
+	hloop_fini(&l);
+
+	if (!e && (k.q.e || k.q.status != 200 || k.q.events != MOCK_EVENTS ||
+	           victim.e != ECANCELED || victim.first)) {
+		pr_err_("cancelled stream: error %d, %s", victim.e,
+		        victim.first ? "got its response" : "no response");
+		e = EPROTO;
+	}
+	if (!e)
+		pr_out("cancel: stream killed on the same loop thread");
+	return e;
+}
+
+static int
+cmp_u64 (void const *a,
+         void const *b)
+{
+	uint64_t x = *(uint64_t const *)a, y = *(uint64_t const *)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief Send a round of requests, directly or hedged, and check that
+ *        each got one whole stream.
+ *
+ * @param[in,out] l    Loop group.
+ * @param[in,out] h    Policy, or `NULL` to send directly.
+ * @param[in]     port Port of the first server.
+ * @param[in]     n    Number of requests.
+ * @param[in]     jobs Requests in flight.
+ * @param[out]    p99  99th percentile time to first byte, in us.
+ * @param[out]    alt  Requests served by the second server.
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+round_trip (struct hloop *l,
+            struct hedge *h,
+            char const   *port,
+            size_t        n,
+            uint32_t      jobs,
+            uint64_t     *p99,
+            size_t       *alt)
+{
+	struct round r = {.q = calloc(n, sizeof *r.q), .n = n};
+	uint64_t *ttfb = calloc(n, sizeof *ttfb);
+	if (!r.q || !ttfb) {
+		free(ttfb);
+		free(r.q);
+		return ENOMEM;
+	}
+
+	int e = 0;
+	size_t sent = 0;
+	for (; sent < n; ++sent) {
+		while (__atomic_load_n(&r.inflight, __ATOMIC_RELAXED) >= jobs)
+			sleep_us(100U);
+
+		struct req *q = &r.q[sent];
+		*q = (struct req){.r = &r, .n = sent};
+		(void)snprintf(q->path, sizeof q->path, "/%zu", sent);
+		struct http_request req = {
+			.method = "GET",
+			.host   = "127.0.0.1",
+			.port   = port,
+			.path   = q->path,
+		};
+
+		(void)__atomic_add_fetch(&r.inflight, 1U, __ATOMIC_RELAXED);
+		q->start = mono_us();
+		e = h ? hedge_submit(h, &req, &ops, q)
+		      : hloop_submit(l, &req, &ops, q);
+		if (e) {
+			pr_errno_(e, "request %zu", sent);
+			(void)__atomic_sub_fetch(&r.inflight, 1U,
+			                         __ATOMIC_RELAXED);
+			break;
+		}
+	}
+	while (__atomic_load_n(&r.done, __ATOMIC_ACQUIRE) < sent)
+		sleep_us(1000U);
+
+	*alt = 0;
+	for (size_t i = 0; !e && i < n; ++i) {
+		struct req const *q = &r.q[i];
+		if (q->e || q->status != 200 || q->bad ||
+		    q->events != MOCK_EVENTS) {
+			pr_err_("request %zu: error %d, status %d, %zu events%s",
+			        i, q->e, q->status, q->events,
+			        q->bad ? ", mixed up" : "");
+			e = EPROTO;
+		}
+		ttfb[i] = q->first - q->start;
+		*alt += q->server == 'b';
+	}
+	if (!e) {
+		qsort(ttfb, n, sizeof *ttfb, cmp_u64);
+		*p99 = ttfb[(n - 1U) * 99U / 100U];
+	}
+
+	free(ttfb);
+	free(r.q);
+	return e;
+}
+
+int
+main (int    c,
+      char **v)
+{
+	struct letopt opt = letopt_init(c, v);
+
+	if (letopt_nargs(&opt) || opt.m_help)
+		letopt_helpful_exit(&opt);
+
+	size_t n = (size_t)opt.m_requests;
+	uint32_t jobs = (uint32_t)opt.m_jobs;
+	struct backend a = {.name = 'a', .slow_ms = (uint32_t)opt.m_slow};
+	struct backend b = {.name = 'b', .slow_ms = 5U, .wait_ms = 5U};
+	struct hloop l;
+	int e = backend_start(&a);
+	if (!e)
+		e = backend_start(&b);
+	if (!e)
+		e = hloop_init(&l, &(struct hloop_cfg){.threads = 2U});
+	if (e) {
+		pr_errno_(e, "setup");
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	e = check_cancel(a.m.port, b.m.port);
+
+	/* Baseline without hedging. */
+	uint64_t base = 0, p99 = 0;
+	size_t alt = 0;
+	if (!e)
+		e = round_trip(&l, nullptr, a.m.port, n, jobs, &base, &alt);
+	if (!e)
+		pr_out("direct: p99 time to first byte %.1f ms",
+		       (double)base / 1e3);
+
+	struct hedge h;
+	if (!e)
+		e = hedge_init(&h, &l, &(struct hedge_cfg){
+			.budget   = (uint32_t)opt.m_budget,
+			.alt_host = "127.0.0.1",
+			.alt_port = b.m.port,
+		});
+	if (!e) {
+		e = round_trip(&l, &h, a.m.port, n, jobs, &p99, &alt);
+		struct hedge_stats st = hedge_stats(&h);
+		hedge_fini(&h);
+		size_t allow = HEDGE_BURST + st.requests *
+		               (size_t)opt.m_budget / 1000U;
+		if (!e)
+			pr_out("hedged: p99 time to first byte %.1f ms, "
+			       "delay %.1f ms, %zu hedged, %zu won, %zu lost, "
+			       "%zu denied, %zu cancelled, %zu from the second "
+			       "server", (double)p99 / 1e3,
+			       (double)st.delay_us / 1e3, st.hedged,
+			       st.hedge_won, st.first_won, st.denied,
+			       st.cancelled, alt);
+		if (!e && (p99 * 2U > base || st.hedged > allow ||
+		           !st.hedge_won || !st.cancelled ||
+		           alt != st.hedge_won)) {
+			pr_err_("hedging didn't pay off as it should");
+			e = EPROTO;
+		}
+	}
+
+	/* A budget of one hedge per thousand requests, and two at once. */
+	if (!e)
+		e = hedge_init(&h, &l, &(struct hedge_cfg){
+			.min_ms   = 1U,
+			.max_ms   = 1U,
+			.budget   = 1U,
+			.burst    = 2U,
+			.alt_host = "127.0.0.1",
+			.alt_port = b.m.port,
+		});
+	if (!e) {
+		e = round_trip(&l, &h, a.m.port, n, jobs, &p99, &alt);
+		struct hedge_stats st = hedge_stats(&h);
+		hedge_fini(&h);
+		size_t allow = 2U + st.requests / 1000U;
+		if (!e)
+			pr_out("budget: %zu hedged, %zu denied", st.hedged,
+			       st.denied);
+		if (!e && (st.hedged > allow || !st.denied)) {
+			pr_err_("%zu hedges, at most %zu allowed", st.hedged,
+			        allow);
+			e = EPROTO;
+		}
+	}
+
+	hloop_fini(&l);
+
+	/* Let the servers see the connections close. */
+	for (unsigned i = 0; i < 1000U &&
+	     (mock_live(&a.m) || mock_live(&b.m)); ++i)
+		sleep_us(1000U);
+	if (!e)
+		pr_out("servers cut off %u and %u responses",
+		       __atomic_load_n(&a.aborted, __ATOMIC_RELAXED),
+		       __atomic_load_n(&b.aborted, __ATOMIC_RELAXED));
+
+	(void)letopt_fini(&opt);
+	return e ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,599 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file test-hloop.c
+ *
+ * @author Juuso Alasuutari
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define PROGNAME "test-hloop"
+#define SYNOPSIS "[OPTION]..."
+#define PURPOSE  "Hold many concurrent event streams on the HTTP event loop"
+
+#define OPTIONS(X)                              \
+	X(boolean, help, 'h', "help",           \
+	  "print this help text and exit")      \
+	                                        \
+	X(number, streams, 'n', "streams",      \
+	  "hold NUM streams at once",           \
+	  "NUM", 10000, 1, 1000000)             \
+	                                        \
+	X(number, events, 'k', "events",        \
+	  "send NUM events on each stream",     \
+	  "NUM", 10, 1, 100000)                 \
+	                                        \
+	X(number, threads, 'j', "threads",      \
+	  "run NUM loop threads",               \
+	  "NUM", 2, 1, 256)                     \
+	                                        \
+	X(number, interval, 'i', "interval",    \
+	  "wait NUM ms between event rounds",   \
+	  "NUM", 20, 0, 10000)
+
+#define DETAILS \
+ "A mock server in a child process opens an event stream\n" \
+ "for every request and, once all of them are open, sends\n" \
+ "timestamped events in rounds. Memory per stream and the\n" \
+ "latency from send to event callback are reported, first\n" \
+ "on new connections and then on reused ones."
+
+#include "letopt.h"
+
+#undef DETAILS
+#undef OPTIONS
+#undef PURPOSE
+#undef SYNOPSIS
+#undef PROGNAME
+
+#include "dbg.h"
+#include "hloop.h"
+#include "mono.h"
+#include "num.h"
+
+/**
+ * @brief Mock server connection.
+ */
+struct peer {
+	uint32_t len;      //!< Bytes of request in buf.
+	bool     stream;   //!< An event stream is open.
+	char     buf[252]; //!< Request head.
+};
+
+/**
+ * @brief Client side of one stream.
+ */
+struct stream {
+	struct bench *b;      //!< Shared state.
+	size_t        events; //!< Events received.
+	size_t        bytes;  //!< Body bytes received.
+	int           e;      //!< Completion error.
+	int           status; //!< Response status.
+};
+
+/**
+ * @brief Shared client state. Counters are atomically updated.
+ */
+struct bench {
+	uint32_t *lat;   //!< Callback latencies in microseconds.
+	size_t    cap;   //!< Size of lat.
+	size_t    nlat;  //!< Latencies recorded.
+	size_t    heads; //!< Response heads received.
+	size_t    done;  //!< Streams finished.
+};
+
+static size_t
+rss (void)
+{
+	unsigned long size = 0, res = 0;
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (f) {
+		if (fscanf(f, "%lu %lu", &size, &res) != 2)
+			res = 0;
+		(void)fclose(f);
+	}
+	return (size_t)res * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * @brief Send a whole message with one call.
+ *
+ * The epoll server never waits for a socket to drain, so a short send
+ * counts as a failure.
+ */
+static bool
+ep_send (int         fd,
+         char const *s,
+         size_t      n)
+{
+	ssize_t w;
+	do w = send(fd, s, n, MSG_NOSIGNAL);
+	while (w < 0 && errno == EINTR);
+	return w == (ssize_t)n;
+}
+
+/**
+ * @brief Send a timestamped event on every open stream.
+ *
+ * The stream is ended after the last round.
+ */
+static bool
+ep_round (struct peer *p,
+          int          nfd,
+          bool         last)
+{
+	for (int fd = 0; fd < nfd; ++fd) {
+		if (!p[fd].stream)
+			continue;
+
+		char ev[48], chunk[72];
+		int n = snprintf(ev, sizeof ev, "data: %" PRIu64 "\n\n",
+		                 mono_us());
+		n = snprintf(chunk, sizeof chunk, "%x\r\n%s\r\n%s", n, ev,
+		             last ? "0\r\n\r\n" : "");
+		if (!ep_send(fd, chunk, (size_t)n))
+			return false;
+		p[fd].stream = !last;
+	}
+	return true;
+}
+
+/**
+ * @brief Answer a complete request head.
+ *
+ * | path      | response                                       |
+ * |-----------|------------------------------------------------|
+ * | `/events` | chunked event stream, sent in rounds on demand |
+ * | `/plain`  | `hello` with a Content-Length                  |
+ * | `/hang`   | nothing                                        |
+ */
+static bool
+ep_request (struct peer *p,
+            int          fd)
+{
+	char const *path = strchr(p->buf, ' ');
+	p->len = 0;
+	if (!path)
+		return false;
+
+	if (!strncmp(path, " /events ", 9U)) {
+		static char const head[] =
+			"HTTP/1.1 200 OK\r\n"
+			"Content-Type: text/event-stream\r\n"
+			"Transfer-Encoding: chunked\r\n\r\n";
+		p->stream = true;
+		return ep_send(fd, head, sizeof head - 1U);
+	}
+
+	if (!strncmp(path, " /plain ", 8U)) {
+		static char const res[] =
+			"HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+		return ep_send(fd, res, sizeof res - 1U);
+	}
+
+	return true;
+}
+
+/**
+ * @brief Run the mock server until the control pipe closes.
+ *
+ * It runs in a process of its own so that its memory and CPU time stay
+ * out of the client's numbers, and it serves every connection from one
+ * epoll loop.
+ */
+static int
+ep_main (int     lfd,
+         int     ctl,
+         int     nfd,
+         int64_t events,
+         int64_t interval)
+{
+	struct peer *p = calloc((size_t)nfd, sizeof *p);
+	int ep = epoll_create1(EPOLL_CLOEXEC);
+	struct epoll_event ev[64] = {
+		{.events = EPOLLIN, .data = {.fd = lfd}},
+		{.events = EPOLLIN, .data = {.fd = ctl}},
+	};
+	if (!p || ep < 0 || epoll_ctl(ep, EPOLL_CTL_ADD, lfd, &ev[0]) ||
+	    epoll_ctl(ep, EPOLL_CTL_ADD, ctl, &ev[1]))
+		return EXIT_FAILURE;
+
+	for (;;) {
+		int n = epoll_wait(ep, ev, 64, -1);
+		if (n < 0 && errno != EINTR)
+			return EXIT_FAILURE;
+
+		for (int i = 0; i < n; ++i) {
+			int fd = ev[i].data.fd;
+
+			if (fd == lfd) {
+				int c;
+				while ((c = accept4(lfd, nullptr, nullptr,
+				                    SOCK_NONBLOCK)) >= 0) {
+					struct epoll_event a = {
+						.events = EPOLLIN,
+						.data   = {.fd = c},
+					};
+					if (c >= nfd ||
+					    epoll_ctl(ep, EPOLL_CTL_ADD, c, &a))
+						return EXIT_FAILURE;
+					p[c] = (struct peer){0};
+				}
+				continue;
+			}
+
+			if (fd == ctl) {
+				char b;
+				if (read(ctl, &b, 1U) < 1)
+					return EXIT_SUCCESS;
+				for (int64_t r = 0; r < events; ++r) {
+					if (r && interval)
+						(void)usleep((useconds_t)interval * 1000U);
+					if (!ep_round(p, nfd, r + 1 == events))
+						return EXIT_FAILURE;
+				}
+				continue;
+			}
+
+			struct peer *q = &p[fd];
+			ssize_t r = recv(fd, &q->buf[q->len],
+			                 sizeof q->buf - 1U - q->len, 0);
+			if (r < 1) {
+				if (r < 0 && errno == EAGAIN)
+					continue;
+				q->stream = false;
+				(void)close(fd);
+				continue;
+			}
+			q->len += (uint32_t)r;
+			q->buf[q->len] = '\0';
+			if (strstr(q->buf, "\r\n\r\n")) {
+				if (!ep_request(q, fd))
+					return EXIT_FAILURE;
+			} else if (q->len == sizeof q->buf - 1U) {
+				return EXIT_FAILURE;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Start the mock server process.
+ *
+ * @return Process ID, or -1 on failure.
+ */
+static pid_t
+ep_start (char    port[static 8],
+          int    *ctl,
+          int     nfd,
+          int64_t events,
+          int64_t interval)
+{
+	struct sockaddr_in a = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t n = sizeof a;
+	int pfd[2];
+
+	int lfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (lfd < 0)
+		return -1;
+	if (bind(lfd, (struct sockaddr *)&a, sizeof a) ||
+	    listen(lfd, SOMAXCONN) ||
+	    getsockname(lfd, (struct sockaddr *)&a, &n) ||
+	    pipe2(pfd, O_CLOEXEC)) {
+		(void)close(lfd);
+		return -1;
+	}
+
+	pid_t pid = fork();
+	if (!pid) {
+		(void)close(pfd[1]);
+		_exit(ep_main(lfd, pfd[0], nfd, events, interval));
+	}
+
+	(void)close(lfd);
+	(void)close(pfd[0]);
+	if (pid < 0) {
+		(void)close(pfd[1]);
+		return -1;
+	}
+
+	*ctl = pfd[1];
+	(void)snprintf(port, 8U, "%u", ntohs(a.sin_port));
+	return pid;
+}
+
+static void
+on_head (void                    *ctx,
+         struct http_frame const *f)
+{
+	struct stream *s = ctx;
+	(void)f;
+	(void)__atomic_add_fetch(&s->b->heads, 1U, __ATOMIC_RELAXED);
+}
+
+static void
+on_event (void                   *ctx,
+          struct sse_event const *ev)
+{
+	uint64_t t = mono_us();
+	struct stream *s = ctx;
+	struct bench *b = s->b;
+	int64_t sent;
+
+	++s->events;
+	if (num_parse_i64(dstr_get(&ev->data), ev->data.len, &sent))
+		return;
+
+	size_t i = __atomic_fetch_add(&b->nlat, 1U, __ATOMIC_RELAXED);
+	if (i < b->cap)
+		b->lat[i] = (uint32_t)(t - (uint64_t)sent);
+}
+
+static void
+on_data (void       *ctx,
+         void const *p,
+         size_t      n)
+{
+	struct stream *s = ctx;
+	s->bytes += n;
+	if (n != 5U || memcmp(p, "hello", 5U))
+		s->e = EPROTO;
+}
+
+static void
+on_done (void *ctx,
+         int   e,
+         int   status)
+{
+	struct stream *s = ctx;
+	if (!s->e)
+		s->e = e;
+	s->status = status;
+	(void)__atomic_add_fetch(&s->b->done, 1U, __ATOMIC_RELEASE);
+}
+
+static struct hloop_ops const ops = {
+	.head  = on_head,
+	.event = on_event,
+	.data  = on_data,
+	.done  = on_done,
+};
+
+/**
+ * @brief Wait for a counter to reach a value.
+ */
+static int
+wait_for (size_t *n,
+          size_t  want)
+{
+	for (uint64_t end = mono_us() + 120000000U; mono_us() < end;) {
+		if (__atomic_load_n(n, __ATOMIC_ACQUIRE) >= want)
+			return 0;
+		(void)usleep(1000);
+	}
+	pr_err_("timed out at %zu of %zu", __atomic_load_n(n, __ATOMIC_ACQUIRE),
+	        want);
+	return ETIMEDOUT;
+}
+
+static int
+submit (struct hloop  *l,
+        char const    *port,
+        char const    *path,
+        struct stream *s,
+        size_t         n,
+        struct bench  *b)
+{
+	struct http_request req = {
+		.method = "GET",
+		.host   = "127.0.0.1",
+		.port   = port,
+		.path   = path,
+	};
+
+	for (size_t i = 0; i < n; ++i) {
+		s[i] = (struct stream){.b = b};
+		int e = hloop_submit(l, &req, &ops, &s[i]);
+		if (e) {
+			pr_errno_(e, "hloop_submit");
+			return e;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Check the outcome of finished streams.
+ */
+static int
+verify (struct stream const *s,
+        size_t               n,
+        int                  e,
+        size_t               events,
+        size_t               bytes)
+{
+	for (size_t i = 0; i < n; ++i) {
+		if (s[i].e != e || (!e && s[i].status != 200) ||
+		    s[i].events != events || s[i].bytes != bytes) {
+			pr_err_("stream %zu: error %d, status %d, %zu events, "
+			        "%zu bytes", i, s[i].e, s[i].status,
+			        s[i].events, s[i].bytes);
+			return EPROTO;
+		}
+	}
+	return 0;
+}
+
+static int
+cmp_u32 (void const *a,
+         void const *b)
+{
+	uint32_t x = *(uint32_t const *)a, y = *(uint32_t const *)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief Open every stream, then have the server send its events.
+ */
+static int
+round_trip (struct hloop  *l,
+            char const    *port,
+            int            ctl,
+            struct stream *s,
+            size_t         n,
+            size_t         events,
+            struct bench  *b,
+            char const    *what)
+{
+	*b = (struct bench){.lat = b->lat, .cap = b->cap};
+	struct hloop_stats st = hloop_stats(l);
+	size_t mem = rss();
+	uint64_t t = mono_us();
+
+	int e = submit(l, port, "/events", s, n, b);
+	if (!e)
+		e = wait_for(&b->heads, n);
+	if (e)
+		return e;
+
+	t = mono_us() - t;
+	mem = rss() - mem;
+	if (write(ctl, "g", 1U) != 1)
+		return errno;
+
+	e = wait_for(&b->done, n);
+	if (!e)
+		e = verify(s, n, 0, events, 0);
+	if (e)
+		return e;
+
+	size_t k = b->nlat < b->cap ? b->nlat : b->cap;
+	if (k != n * events) {
+		pr_err_("%zu latencies for %zu events", k, n * events);
+		return EPROTO;
+	}
+	qsort(b->lat, k, sizeof *b->lat, cmp_u32);
+
+	struct hloop_stats now = hloop_stats(l);
+	pr_out("%s: %zu streams open in %.1f ms, %zu connects, %zu reuses, "
+	       "%.0f bytes per stream", what, n, (double)t / 1e3,
+	       now.connects - st.connects, now.reuses - st.reuses,
+	       (double)mem / (double)n);
+	pr_out("%s: %zu events, callback latency p50 %" PRIu32 " us, "
+	       "p99 %" PRIu32 " us, max %" PRIu32 " us", what, k,
+	       b->lat[k / 2U], b->lat[k - 1U - k / 100U], b->lat[k - 1U]);
+	return 0;
+}
+
+int
+main (int    c,
+      char **v)
+{
+	struct letopt opt = letopt_init(c, v);
+
+	if (letopt_nargs(&opt) || opt.m_help)
+		letopt_helpful_exit(&opt);
+
+	size_t n = (size_t)opt.m_streams;
+	size_t k = (size_t)opt.m_events;
+
+	/* Both ends of every stream live in this process tree. */
+	struct rlimit rl;
+	if (!getrlimit(RLIMIT_NOFILE, &rl)) {
+		rl.rlim_cur = rl.rlim_max;
+		(void)setrlimit(RLIMIT_NOFILE, &rl);
+	}
+	if (rl.rlim_cur < n + 64U) {
+		pr_err_("%zu streams need %zu file descriptors, the limit is %ju",
+		        n, n + 64U, (uintmax_t)rl.rlim_cur);
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	struct stream *s = calloc(n, sizeof *s);
+	struct bench b = {.lat = calloc(n * k, sizeof *b.lat), .cap = n * k};
+	if (!s || !b.lat) {
+		pr_errno_(errno, "calloc");
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+	/* Fault the result arrays in before any memory is measured. */
+	memset(s, 0, n * sizeof *s);
+	memset(b.lat, 0, n * k * sizeof *b.lat);
+
+	char port[8];
+	int ctl;
+	pid_t pid = ep_start(port, &ctl, (int)rl.rlim_cur, opt.m_events,
+	                       opt.m_interval);
+	if (pid < 0) {
+		pr_errno_(errno, "mock server");
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	struct hloop l;
+	int e = hloop_init(&l, &(struct hloop_cfg){
+		.threads    = (uint32_t)opt.m_threads,
+		.timeout_ms = 60000U,
+	});
+	if (e) {
+		pr_errno_(e, "hloop_init");
+		(void)close(ctl);
+		(void)waitpid(pid, nullptr, 0);
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	size_t m = n < 100U ? n : 100U;
+	e = submit(&l, port, "/plain", s, m, &b);
+	if (!e)
+		e = wait_for(&b.done, m);
+	if (!e)
+		e = verify(s, m, 0, 0, 5U);
+
+	if (!e)
+		e = round_trip(&l, port, ctl, s, n, k, &b, "cold");
+	if (!e)
+		e = round_trip(&l, port, ctl, s, n, k, &b, "warm");
+
+	/* Streams still in progress are cancelled by hloop_fini(). */
+	b.done = 0;
+	if (!e)
+		e = submit(&l, port, "/hang", s, m, &b);
+
+	struct hloop_stats st = hloop_stats(&l);
+	hloop_fini(&l);
+	if (!e)
+		e = verify(s, m, ECANCELED, 0, 0);
+
+	pr_out("requests %zu, connects %zu, reuses %zu, retries %zu, "
+	       "events %zu", st.requests, st.connects, st.reuses,
+	       st.retries, st.events);
+
+	int status = 0;
+	(void)close(ctl);
+	if (waitpid(pid, &status, 0) != pid ||
+	    !WIFEXITED(status) || WEXITSTATUS(status)) {
+		pr_err_("mock server failed");
+		e = e ? e : EPROTO;
+	}
+
+	free(b.lat);
+	free(s);
+	(void)letopt_fini(&opt);
+	return e ? EXIT_FAILURE : EXIT_SUCCESS;
+}
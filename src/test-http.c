@@ -0,0 +1,409 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file test-http.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PROGNAME "test-http"
+#define SYNOPSIS "[OPTION]..."
+#define PURPOSE  "Exercise the HTTP client against a loopback server"
+
+#define OPTIONS(X)                              \
+	X(boolean, help, 'h', "help",           \
+	  "print this help text and exit")      \
+	                                        \
+	X(number, requests, 'n', "requests",    \
+	  "send NUM requests per round",        \
+	  "NUM", 1000, 1, 10000000)             \
+	                                        \
+	X(number, threads, 'j', "threads",      \
+	  "send from NUM threads at once",      \
+	  "NUM", 4, 1, 256)                     \
+	                                        \
+	X(number, conns, 'm', "max-conns",      \
+	  "open at most NUM connections",       \
+	  "NUM", 2, 1, 1024)
+
+#define DETAILS \
+ "A mock server is started on a loopback port. Framing,\n" \
+ "connection reuse, and idle reaping are checked, and the\n" \
+ "latency of warm connections is compared to reconnecting."
+
+#include "letopt.h"
+
+#undef DETAILS
+#undef OPTIONS
+#undef PURPOSE
+#undef SYNOPSIS
+#undef PROGNAME
+
+#include "dbg.h"
+#include "http.h"
+#include "mono.h"
+#include "test-mock.h"
+
+/**
+ * @brief Client thread state.
+ */
+struct client {
+	pthread_t         tid;
+	struct http_pool *pool;
+	struct mock      *srv;
+	int64_t           n;
+	int               e;
+};
+
+/**
+ * @brief Answer one request.
+ *
+ * The path selects the response framing:
+ *
+ * | path        | response                                      |
+ * |-------------|-----------------------------------------------|
+ * | `/echo`     | the request body with a Content-Length        |
+ * | `/chunked`  | the request body in three chunks and trailer  |
+ * | `/close`    | `ok`, then the connection is closed           |
+ * | `/eof`      | HTTP/1.0, the request body until close        |
+ * | `/bye`      | like `/echo`, then the connection is closed   |
+ * | `/continue` | 100 Continue followed by 204 No Content       |
+ */
+static bool
+serve (void       *ctx,
+       int         fd,
+       char const *head,
+       char const *body,
+       size_t      blen)
+{
+	(void)ctx;
+
+	char *out = malloc(blen * 2U + 256U);
+	if (!out)
+		return false;
+
+	bool open = true;
+	char const *path = strchr(head, ' ') + 1;
+	char *p = out;
+
+	if (!strncmp(path, "/chunked ", 9U)) {
+		size_t a = blen / 3U, b = blen - a - a;
+		p += sprintf(p, "HTTP/1.1 200 OK\r\nX-Mock: yes\r\n"
+		                "Transfer-Encoding: gzip, chunked\r\n\r\n");
+		size_t part[3] = {a, a, b};
+		for (int i = 0; i < 3; ++i) {
+			if (!part[i])
+				continue;
+			p += sprintf(p, i ? "%zx\r\n" : "%zX;x=y\r\n",
+			             part[i]);
+			memcpy(p, body, part[i]);
+			p += part[i];
+			body += part[i];
+			p += sprintf(p, "\r\n");
+		}
+		p += sprintf(p, "0\r\nX-Trailer: t\r\n\r\n");
+	} else if (!strncmp(path, "/close ", 7U)) {
+		p += sprintf(p, "HTTP/1.1 200 OK\r\nConnection: close\r\n"
+		                "Content-Length: 2\r\n\r\nok");
+		open = false;
+	} else if (!strncmp(path, "/eof ", 5U)) {
+		p += sprintf(p, "HTTP/1.0 200 OK\r\n\r\n");
+		memcpy(p, body, blen);
+		p += blen;
+		open = false;
+	} else if (!strncmp(path, "/continue ", 10U)) {
+		p += sprintf(p, "HTTP/1.1 100 Continue\r\n\r\n"
+		                "HTTP/1.1 204 No Content\r\n\r\n");
+	} else {
+		open = strncmp(path, "/bye ", 5U) &&
+		       !strstr(head, "\r\nConnection: close\r\n");
+		p += sprintf(p, "HTTP/1.1 200 OK\r\nX-Mock:  yes \r\n"
+		                "Content-Length: %zu\r\n\r\n", blen);
+		memcpy(p, body, blen);
+		p += blen;
+	}
+
+	open = mock_send(fd, out, (size_t)(p - out)) && open;
+	free(out);
+	return open;
+}
+
+/**
+ * @brief Send a request and check the response.
+ *
+ * @param p      Pool.
+ * @param m      Mock server.
+ * @param path   Request path.
+ * @param body   Body pieces.
+ * @param n      Number of @p body pieces.
+ * @param status Expected status.
+ * @param want   Expected response body.
+ * @param wlen   Length of @p want.
+ * @param close  Ask the server to close the connection.
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+check (struct http_pool   *p,
+       struct mock        *m,
+       char const         *path,
+       struct iovec const *body,
+       size_t              n,
+       int                 status,
+       void const         *want,
+       size_t              wlen,
+       bool                close)
+{
+	dstr hdr[] = {
+		make_dstr_view("Accept: */*"),
+		make_dstr_view("Connection: close"),
+	};
+	struct http_request req = {
+		.method   = n ? "POST" : "GET",
+		.host     = "127.0.0.1",
+		.port     = m->port,
+		.path     = path,
+		.headers  = hdr,
+		.nheaders = close ? 2U : 1U,
+		.body     = body,
+		.nbody    = n,
+	};
+	struct http_response res;
+
+	int e = http_request(p, &req, &res);
+	if (e) {
+		pr_errno_(e, "%s", path);
+	} else if (res.status != status) {
+		pr_err_("%s: status %d, expected %d", path, res.status, status);
+		e = EPROTO;
+	} else if (res.body.len != wlen ||
+	           memcmp(dstr_get(&res.body), want, wlen)) {
+		pr_err_("%s: body of %u bytes, expected %zu", path,
+		        res.body.len, wlen);
+		e = EPROTO;
+	}
+
+	dstr v;
+	if (!e && !strcmp(path, "/echo") &&
+	    (!http_response_header(&res, "x-mock", &v) ||
+	     !dstr_eq(&v, "yes", 3U))) {
+		pr_err_("%s: X-Mock header missing", path);
+		e = EPROTO;
+	}
+
+	http_response_fini(&res);
+	return e;
+}
+
+static int
+echo (struct http_pool *p,
+      struct mock      *m,
+      int64_t           i,
+      bool              close)
+{
+	char b[32];
+	int n = snprintf(b, sizeof b, "request %" PRId64, i);
+	struct iovec v[] = {{b, 8U}, {&b[8], (size_t)n - 8U}};
+	return check(p, m, "/echo", v, 2U, 200, b, (size_t)n, close);
+}
+
+static void *
+client_main (void *arg)
+{
+	struct client *c = arg;
+	for (int64_t i = 0; !c->e && i < c->n; ++i)
+		c->e = echo(c->pool, c->srv, i, false);
+	return nullptr;
+}
+
+/**
+ * @brief Check framing and reuse on a single thread.
+ */
+static int
+framing (struct http_pool *p,
+         struct mock      *m,
+         int64_t           n)
+{
+	size_t a = mock_accepts(m);
+	int e = 0;
+
+	for (int64_t i = 0; !e && i < n; ++i)
+		e = echo(p, m, i, false);
+	if (!e && mock_accepts(m) - a != 1U) {
+		pr_err_("%zu connections for %" PRId64 " requests",
+		        mock_accepts(m) - a, n);
+		e = EPROTO;
+	}
+
+	size_t big = 1U << 20U;
+	char *s = malloc(big);
+	if (!s)
+		return e ? e : errno;
+	for (size_t i = 0; i < big; ++i)
+		s[i] = (char)('a' + i % 26U);
+
+	struct iovec v[100];
+	for (size_t i = 0; i < 100U; ++i)
+		v[i] = (struct iovec){&s[i * (big / 100U)],
+		                      i < 99U ? big / 100U
+		                              : big - 99U * (big / 100U)};
+
+	if (!e)
+		e = check(p, m, "/echo", v, 100U, 200, s, big, false);
+	if (!e)
+		e = check(p, m, "/chunked", v, 100U, 200, s, big, false);
+	if (!e)
+		e = check(p, m, "/chunked", v, 1U, 200, s, v[0].iov_len, false);
+	if (!e)
+		e = check(p, m, "/eof", v, 3U, 200, s, 3U * v[0].iov_len, false);
+	if (!e)
+		e = check(p, m, "/close", nullptr, 0, 200, "ok", 2U, false);
+	if (!e)
+		e = check(p, m, "/continue", nullptr, 0, 204, "", 0, false);
+	if (!e)
+		e = check(p, m, "/bye", v, 1U, 200, s, v[0].iov_len, false);
+	if (!e) {
+		/* Let the FIN of the server arrive. */
+		(void)usleep(10000);
+		e = echo(p, m, 0, false);
+	}
+
+	free(s);
+	return e;
+}
+
+/**
+ * @brief Check that concurrent requests stay within the limit.
+ */
+static int
+concurrent (struct http_pool *p,
+            struct mock      *m,
+            int64_t           n,
+            int64_t           threads,
+            int64_t           conns)
+{
+	struct client *c = calloc((size_t)threads, sizeof *c);
+	if (!c)
+		return errno;
+
+	size_t a = mock_accepts(m);
+	int e = 0;
+	int64_t k = 0;
+
+	for (; k < threads; ++k) {
+		c[k] = (struct client){.pool = p, .srv = m,
+		                       .n = n / threads + (k < n % threads)};
+		e = pthread_create(&c[k].tid, nullptr, client_main, &c[k]);
+		if (e)
+			break;
+	}
+
+	for (int64_t i = 0; i < k; ++i) {
+		(void)pthread_join(c[i].tid, nullptr);
+		if (!e)
+			e = c[i].e;
+	}
+
+	if (!e && mock_accepts(m) - a > (size_t)conns) {
+		pr_err_("%zu connections with a limit of %" PRId64,
+		        mock_accepts(m) - a, conns);
+		e = EPROTO;
+	}
+
+	free(c);
+	return e;
+}
+
+/**
+ * @brief Check that idle connections expire.
+ */
+static int
+reaping (struct http_pool *p)
+{
+	size_t idle = http_pool_stats(p).idle;
+	(void)usleep(150000);
+	size_t n = http_pool_reap(p);
+	if (idle && n == idle)
+		return 0;
+	pr_err_("reaped %zu of %zu idle connections", n, idle);
+	return EPROTO;
+}
+
+/**
+ * @brief Compare warm connections to reconnecting for each request.
+ */
+static int
+latency (struct http_pool *p,
+         struct mock      *m,
+         int64_t           n)
+{
+	int e = 0;
+	uint64_t t[3] = {mono_us()};
+
+	for (int64_t i = 0; !e && i < n; ++i)
+		e = echo(p, m, i, false);
+	t[1] = mono_us();
+
+	for (int64_t i = 0; !e && i < n; ++i)
+		e = echo(p, m, i, true);
+	t[2] = mono_us();
+
+	if (!e)
+		pr_out("warm %.1f us, reconnect %.1f us per request",
+		       (double)(t[1] - t[0]) / (double)n,
+		       (double)(t[2] - t[1]) / (double)n);
+	return e;
+}
+
+int
+main (int    c,
+      char **v)
+{
+	struct letopt opt = letopt_init(c, v);
+
+	if (letopt_nargs(&opt) || opt.m_help)
+		letopt_helpful_exit(&opt);
+
+	struct mock m = {.serve = serve};
+	int e = mock_start(&m);
+	if (e) {
+		pr_errno_(e, "mock server");
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	struct http_pool p;
+	e = http_pool_init(&p, &(struct http_pool_cfg){
+		.max_conns = (uint32_t)opt.m_conns,
+		.idle_ms   = 100U,
+		.timeout_ms = 5000U,
+	});
+	if (e) {
+		pr_errno_(e, "http_pool_init");
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	e = framing(&p, &m, opt.m_requests);
+	if (!e)
+		e = concurrent(&p, &m, opt.m_requests, opt.m_threads,
+		               opt.m_conns);
+	if (!e)
+		e = reaping(&p);
+	if (!e)
+		e = latency(&p, &m, opt.m_requests);
+
+	struct http_stats st = http_pool_stats(&p);
+	pr_out("requests %zu, connects %zu, reuses %zu, retries %zu, "
+	       "reaped %zu", st.requests, st.connects, st.reuses,
+	       st.retries, st.reaped);
+
+	http_pool_fini(&p);
+	(void)close(m.fd);
+	(void)letopt_fini(&opt);
+	return e ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,500 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file test-json.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <inttypes.h>
+
+#define PROGNAME "test-json"
+#define SYNOPSIS "[OPTION]... [--] FILE..."
+#define PURPOSE  "Parse JSON files with the push parser"
+
+#define OPTIONS(X)                              \
+	X(boolean, help, 'h', "help",           \
+	  "print this help text and exit")      \
+	                                        \
+	X(number, chunk, 'b', "chunk",          \
+	  "feed input NUM bytes at a time",     \
+	  "NUM", 65536, 1, 1048576)             \
+	                                        \
+	X(boolean, print, 'p', "print",         \
+	  "print tokens as they're parsed")     \
+	                                        \
+	X(boolean, tape, 't', "tape",           \
+	  "parse whole files into a tape")      \
+	                                        \
+	X(string, output, 'o', "output",        \
+	  "write tapes back out to FILE",       \
+	  "FILE")                               \
+	                                        \
+	X(string, get, 'g', "get",              \
+	  "look up the value at PATH",          \
+	  "PATH")                               \
+	                                        \
+	X(boolean, message, 'm', "message",     \
+	  "decode tapes as API responses")      \
+	                                        \
+	X(boolean, delta, 'd', "delta",         \
+	  "decode lines as stream deltas")      \
+	                                        \
+	X(boolean, fields, 'f', "fields",       \
+	  "print object members as they end")   \
+	                                        \
+	X(boolean, events, 'e', "events",       \
+	  "parse files as server-sent events")  \
+	                                        \
+	X(boolean, quiet, 'q', "quiet",         \
+	  "report errors via exit code only")
+
+#define DETAILS \
+ "Compressed input is decoded on the fly. Each file may\n" \
+ "contain any number of whitespace-separated values,\n"   \
+ "except in tape mode, which expects one document."
+
+#include "letopt.h"
+
+#undef DETAILS
+#undef OPTIONS
+#undef PURPOSE
+#undef SYNOPSIS
+#undef PROGNAME
+
+#include "dbg.h"
+#include "fstream.h"
+#include "json.h"
+#include "jpartial.h"
+#include "jpath.h"
+#include "jtape.h"
+#include "jwriter.h"
+#include "message.h"
+#include "sse.h"
+
+struct sink {
+	struct json     *p;
+	struct file_out *out;
+	size_t           tokens;
+	bool             message;
+	bool             print;
+	bool             quiet;
+};
+
+constexpr static char const tok_name[][8] = {
+	[json_null]         = "null",
+	[json_false]        = "false",
+	[json_true]         = "true",
+	[json_number]       = "number",
+	[json_string]       = "string",
+	[json_key]          = "key",
+	[json_object_begin] = "{",
+	[json_object_end]   = "}",
+	[json_array_begin]  = "[",
+	[json_array_end]    = "]",
+};
+
+static int
+sink_token (void          *ctx,
+            enum json_tok  tok,
+            dstr const    *val)
+{
+	struct sink *k = ctx;
+	++k->tokens;
+
+	if (k->print) {
+		unsigned d = k->p->depth;
+		if (tok == json_object_begin || tok == json_array_begin)
+			--d;
+		pr_out_("%*s%s", (int)d * 2, "", tok_name[tok]);
+		if (tok == json_number || tok == json_string || tok == json_key)
+			pr_out_(" %.*s", (int)val->len, dstr_get(val));
+		pr_out_("\n");
+	}
+
+	return 0;
+}
+
+static int
+parse (char const *path,
+       size_t      chunk,
+       struct sink *k)
+{
+	struct fstream z;
+	struct json p;
+
+	json_init(&p, sink_token, k);
+	k->p = &p;
+	k->tokens = 0;
+
+	int e = fstream_open(&z, path);
+	for (size_t n = 1U; !e && n;) {
+		unsigned char const *c;
+		e = fstream_next(&z, &c, &n);
+		for (size_t i = 0; !e && i < n; i += chunk)
+			e = json_feed(&p, &c[i], n - i < chunk ? n - i : chunk);
+	}
+
+	if (!e)
+		e = json_end(&p);
+
+	if (k->quiet)
+		;
+	else if (e && p.ec)
+		pr_errno_(e, "%s: offset %zu", path, p.offset);
+	else if (e)
+		pr_errno_(e, "%s", path);
+	else if (!k->print)
+		pr_out("%s: %zu values, %zu tokens", path, p.values, k->tokens);
+
+	json_fini(&p);
+	fstream_fini(&z);
+	return e;
+}
+
+static size_t
+print_value (struct jtape const *t,
+             size_t              i,
+             int                 d)
+{
+	enum jtape_type y = jtape_type(t, i);
+	dstr s;
+
+	switch (y) {
+	case jtape_object:
+	case jtape_array:
+		pr_out("%*s%c", d * 2, "", y);
+		for (size_t j = i + 1U; j < jtape_payload(t, i) - 1U;) {
+			if (y == jtape_object) {
+				s = jtape_str(t, j++);
+				pr_out("%*skey %.*s", d * 2 + 2, "",
+				       (int)s.len, dstr_get(&s));
+			}
+			j = print_value(t, j, d + 1);
+		}
+		pr_out("%*s%c", d * 2, "", y + 2);
+		break;
+	case jtape_string:
+		s = jtape_str(t, i);
+		pr_out("%*sstring %.*s", d * 2, "", (int)s.len, dstr_get(&s));
+		break;
+	case jtape_int:
+		pr_out("%*snumber %" PRId64, d * 2, "", jtape_i64(t, i));
+		break;
+	case jtape_double:
+		pr_out("%*snumber %.17g", d * 2, "", jtape_f64(t, i));
+		break;
+	case jtape_null:
+		pr_out("%*snull", d * 2, "");
+		break;
+	case jtape_true:
+		pr_out("%*strue", d * 2, "");
+		break;
+	case jtape_false:
+		pr_out("%*sfalse", d * 2, "");
+		break;
+	default:
+		break;
+	}
+
+	return jtape_skip(t, i);
+}
+
+/**
+ * @brief Serialize a tape into a file, sizing it first so that the
+ *        file can be preallocated.
+ */
+static int
+write_tape (struct jtape const *t,
+            struct file_out    *out)
+{
+	struct jwriter w;
+	jwriter_size(&w);
+	(void)jwriter_tape(&w, t, 1U);
+	int e = jwriter_end(&w);
+	if (e)
+		return e;
+
+	size_t n = jwriter_length(&w) + 1U;
+	jwriter_init_file(&w, out, n);
+	(void)jwriter_tape(&w, t, 1U);
+	e = jwriter_end(&w);
+	if (!e && jwriter_length(&w) + 1U != n)
+		e = EPROTO;
+	return e ? e : file_out_write(out, "\n", 1U);
+}
+
+static int
+print_message (struct jtape const *t)
+{
+	struct message m;
+	int e = message_decode(&m, t, 1U);
+	if (e)
+		return e;
+
+	pr_out("%.*s %.*s %.*s in=%" PRId64 " out=%" PRId64,
+	       (int)m.m_id.len, dstr_get(&m.m_id),
+	       (int)m.m_model.len, dstr_get(&m.m_model),
+	       (int)m.m_stop_reason.len, dstr_get(&m.m_stop_reason),
+	       m.m_usage.m_input_tokens, m.m_usage.m_output_tokens);
+
+	if (!m.has.content || jtape_type(t, m.m_content) != jtape_array)
+		return 0;
+
+	size_t end = jtape_payload(t, m.m_content) - 1U;
+	for (size_t i = m.m_content + 1U; i < end; i = jtape_skip(t, i)) {
+		struct message_block b;
+		e = message_block_decode(&b, t, i);
+		if (e)
+			return e;
+		dstr const *s = b.has.text ? &b.m_text : &b.m_name;
+		pr_out("%.*s: %.*s", (int)b.m_type.len, dstr_get(&b.m_type),
+		       (int)s->len, dstr_get(s));
+	}
+
+	return 0;
+}
+
+static int
+fields (char const  *path,
+        size_t       chunk,
+        struct sink *k)
+{
+	struct jpartial j;
+	struct file_in f = fstream_read(path);
+
+	jpartial_init(&j);
+
+	int e = file_error(&f);
+	for (size_t i = 0, n = e ? 0 : f.size, m = 0; !e && i < n; i += chunk) {
+		e = jpartial_feed(&j, &f.data[i], n - i < chunk ? n - i : chunk);
+		for (; m < j.len && !k->quiet; ++m) {
+			struct jpartial_field const *v = &j.field[m];
+			pr_out("%zu: %.*s %s %.*s", i, (int)v->key.len,
+			       dstr_get(&v->key), tok_name[v->type],
+			       (int)v->value.len, dstr_get(&v->value));
+		}
+	}
+
+	if (!e)
+		e = jpartial_end(&j);
+
+	if (k->quiet)
+		;
+	else if (e && j.p.ec)
+		pr_errno_(e, "%s: offset %zu", path, j.p.offset);
+	else if (e)
+		pr_errno_(e, "%s", path);
+
+	jpartial_fini(&j);
+	file_in_fini(&f);
+	return e;
+}
+
+static int
+events (char const  *path,
+        size_t       chunk,
+        struct sink *k)
+{
+	struct sse p = sse();
+	struct file_in f = fstream_read(path);
+
+	int e = file_error(&f);
+	for (size_t i = 0, n = e ? 0 : f.size; !e && i < n; i += chunk) {
+		size_t m = n - i < chunk ? n - i : chunk, off = 0;
+		struct sse_event ev;
+		while (!(e = sse_feed(&p, &f.data[i], m, &off, &ev))) {
+			if (k->print)
+				pr_out("%zu: %.*s %.*s", i + off,
+				       (int)ev.event.len, dstr_get(&ev.event),
+				       (int)ev.data.len, dstr_get(&ev.data));
+		}
+		if (e == EAGAIN)
+			e = 0;
+	}
+
+	if (k->quiet)
+		;
+	else if (e)
+		pr_errno_(e, "%s", path);
+	else
+		pr_out("%s: %zu events, %zu copied", path, p.events, p.copied);
+
+	sse_fini(&p);
+	file_in_fini(&f);
+	return e;
+}
+
+static int
+deltas (char const  *path,
+        struct sink *k)
+{
+	struct message_text_parser p = {0};
+	struct file_in f = fstream_read(path);
+
+	int e = file_error(&f);
+	char const *s = (char const *)f.data;
+	for (size_t i = 0, n = e ? 0 : f.size; i < n; ++i) {
+		char const *nl = __builtin_memchr(&s[i], '\n', n - i);
+		size_t end = nl ? (size_t)(nl - s) : n;
+		struct message_text d;
+
+		int r = message_text_parse(&p, &s[i], end - i, &d);
+		if (r == ENOMSG) {
+			r = 0;
+		} else if (!r && k->print) {
+			pr_out("%" PRId64 " %.*s: %.*s", d.index,
+			       (int)d.type.len, dstr_get(&d.type),
+			       (int)d.text.len, dstr_get(&d.text));
+		} else if (r && !k->quiet) {
+			pr_errno_(r, "%s: line at offset %zu", path, i);
+		}
+
+		if (!e)
+			e = r;
+		i = end;
+	}
+
+	if (k->quiet)
+		;
+	else if (file_error(&f))
+		pr_errno_(e, "%s", path);
+	else
+		pr_out("%s: %" PRIu64 " fast, %" PRIu64 " fallback", path,
+		       p.hits, p.misses);
+
+	message_text_parser_fini(&p);
+	file_in_fini(&f);
+	return e;
+}
+
+static int
+parse_tape (char const  *path,
+            struct sink *k)
+{
+	struct jtape t = {0};
+	struct file_in f = fstream_read(path);
+
+	int e = file_error(&f);
+	if (!e)
+		e = jtape_parse(&t, f.data, f.size);
+
+	if (!e && k->out) {
+		e = write_tape(&t, k->out);
+		if (e && !k->quiet)
+			pr_errno_(e, "%s: write", path);
+		jtape_fini(&t);
+		file_in_fini(&f);
+		return e;
+	}
+
+	if (k->quiet)
+		;
+	else if (e && !file_error(&f))
+		pr_errno_(e, "%s: offset %zu", path, t.error);
+	else if (e)
+		pr_errno_(e, "%s", path);
+	else if (k->message && (e = print_message(&t)))
+		pr_errno_(e, "%s: decode", path);
+	else if (k->message)
+		;
+	else if (k->print)
+		(void)print_value(&t, 1U, 0);
+	else
+		pr_out("%s: %zu tape entries", path, t.len);
+
+	jtape_fini(&t);
+	file_in_fini(&f);
+	return e;
+}
+
+static int
+lookup (char const         *path,
+        char const         *expr,
+        struct jpath const *jp,
+        struct sink        *k)
+{
+	struct jpath_value v;
+	struct file_in f = fstream_read(path);
+
+	int e = file_error(&f);
+	bool missing = false;
+	if (!e) {
+		e = jpath_get(jp, f.data, f.size, &v);
+		missing = e == ENOENT;
+	}
+
+	if (k->quiet)
+		;
+	else if (missing)
+		pr_err_("%s: path not found: %s", path, expr);
+	else if (e)
+		pr_errno_(e, "%s", path);
+	else
+		pr_out("%s%s %.*s", tok_name[v.type], v.escaped ? " (escaped)" : "",
+		       (int)v.text.len, dstr_get(&v.text));
+
+	file_in_fini(&f);
+	return e;
+}
+
+int
+main (int    c,
+      char **v)
+{
+	struct letopt opt = letopt_init(c, v);
+
+	if (letopt_nargs(&opt) < 1 || opt.m_help)
+		letopt_helpful_exit(&opt);
+
+	int ret = EXIT_SUCCESS;
+	struct sink k = {.message = opt.m_message, .print = opt.m_print,
+	                 .quiet = opt.m_quiet};
+
+	struct jpath jp;
+	if (opt.has.get) {
+		int e = jpath_compile(&jp, opt.m_get);
+		if (e) {
+			pr_errno_(e, "%s", opt.m_get);
+			(void)letopt_fini(&opt);
+			return EXIT_FAILURE;
+		}
+	}
+
+	struct file_out out;
+	if (opt.has.output) {
+		int e = file_out_open(&out, opt.m_output, 0);
+		if (e) {
+			pr_errno_(e, "%s", opt.m_output);
+			file_out_fini(&out);
+			(void)letopt_fini(&opt);
+			return EXIT_FAILURE;
+		}
+		k.out = &out;
+		opt.m_tape = true;
+	}
+
+	if (opt.m_message)
+		opt.m_tape = true;
+
+	for (int i = 0; i < letopt_nargs(&opt); ++i) {
+		char const *arg = letopt_arg(&opt, i);
+		if (opt.m_fields ? fields(arg, (size_t)opt.m_chunk, &k)
+		  : opt.m_events ? events(arg, (size_t)opt.m_chunk, &k)
+		  : opt.m_delta  ? deltas(arg, &k)
+		  : opt.has.get  ? lookup(arg, opt.m_get, &jp, &k)
+		  : opt.m_tape   ? parse_tape(arg, &k)
+		                 : parse(arg, (size_t)opt.m_chunk, &k))
+			ret = EXIT_FAILURE;
+	}
+
+	if (k.out) {
+		int e = file_out_commit(&out);
+		if (e) {
+			pr_errno_(e, "%s", opt.m_output);
+			ret = EXIT_FAILURE;
+		}
+		file_out_fini(&out);
+	}
+
+	(void)letopt_fini(&opt);
+	return ret;
+}
@@ -0,0 +1,231 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file test-mock.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "test-mock.h"
+
+struct mock_conn {
+	struct mock *m;
+	int          fd;
+};
+
+bool
+mock_send (int         fd,
+           void const *s,
+           size_t      n)
+{
+	for (char const *p = s; n;) {
+		ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+		if (w < 1) {
+			if (w && errno == EINTR)
+				continue;
+			return false;
+		}
+		p += w;
+		n -= (size_t)w;
+	}
+	return true;
+}
+
+/**
+ * @brief Receive until @p buf holds at least @p want bytes.
+ */
+static bool
+mock_recv (int     fd,
+           char   *buf,
+           size_t *len,
+           size_t  want)
+{
+	while (*len < want) {
+		ssize_t r = recv(fd, &buf[*len], want - *len, 0);
+		if (r < 1) {
+			if (r && errno == EINTR)
+				continue;
+			return false;
+		}
+		*len += (size_t)r;
+	}
+	return true;
+}
+
+/**
+ * @brief Read the next request head into @p buf, growing it as needed.
+ *
+ * @return Length of the head including the empty line, or 0 if the
+ *         connection ended.
+ */
+static size_t
+mock_head (int     fd,
+           char  **buf,
+           size_t *cap,
+           size_t *len)
+{
+	for (;;) {
+		(*buf)[*len] = '\0';
+		char *end = strstr(*buf, "\r\n\r\n");
+		if (end)
+			return (size_t)(end - *buf) + 4U;
+
+		if (*len + 1U == *cap) {
+			char *p = realloc(*buf, *cap * 2U);
+			if (!p)
+				return 0;
+			*buf = p;
+			*cap *= 2U;
+		}
+
+		ssize_t r = recv(fd, &(*buf)[*len], *cap - *len - 1U, 0);
+		if (r < 1) {
+			if (r && errno == EINTR)
+				continue;
+			return 0;
+		}
+		*len += (size_t)r;
+	}
+}
+
+/**
+ * @brief Serve requests on one connection until either end leaves.
+ */
+static void *
+mock_conn (void *arg)
+{
+	struct mock_conn c = *(struct mock_conn *)arg;
+	free(arg);
+
+	size_t cap = 4096U, len = 0;
+	char *buf = malloc(cap);
+
+	while (buf) {
+		size_t hlen = mock_head(c.fd, &buf, &cap, &len), blen = 0;
+		if (!hlen)
+			break;
+
+		char const *cl = strstr(buf, "\r\nContent-Length: ");
+		if (cl && cl < &buf[hlen])
+			blen = (size_t)strtoul(cl + 18, nullptr, 10);
+
+		if (hlen + blen + 1U > cap) {
+			char *p = realloc(buf, hlen + blen + 1U);
+			if (!p)
+				break;
+			buf = p;
+			cap = hlen + blen + 1U;
+		}
+		if (!mock_recv(c.fd, buf, &len, hlen + blen))
+			break;
+
+		/* End the head after the CRLF of its last line. */
+		buf[hlen - 2U] = '\0';
+		if (!c.m->serve(c.m->ctx, c.fd, buf, &buf[hlen], blen))
+			break;
+
+		len -= hlen + blen;
+		memmove(buf, &buf[hlen + blen], len);
+	}
+
+	free(buf);
+	(void)close(c.fd);
+	(void)__atomic_sub_fetch(&c.m->live, 1U, __ATOMIC_RELEASE);
+	return nullptr;
+}
+
+static void *
+mock_main (void *arg)
+{
+	struct mock *m = arg;
+
+	for (;;) {
+		int fd = accept(m->fd, nullptr, nullptr);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			break;
+		}
+
+		/* Streamed responses mustn't wait for ACKs. */
+		int one = 1;
+		(void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one,
+		                 sizeof one);
+
+		(void)__atomic_add_fetch(&m->accepts, 1U, __ATOMIC_RELAXED);
+
+		struct mock_conn *c = malloc(sizeof *c);
+		pthread_t t;
+		if (!c) {
+			(void)close(fd);
+			continue;
+		}
+		*c = (struct mock_conn){.m = m, .fd = fd};
+		(void)__atomic_add_fetch(&m->live, 1U, __ATOMIC_RELAXED);
+		if (pthread_create(&t, nullptr, mock_conn, c)) {
+			(void)__atomic_sub_fetch(&m->live, 1U, __ATOMIC_RELAXED);
+			(void)close(fd);
+			free(c);
+			continue;
+		}
+		(void)pthread_detach(t);
+	}
+
+	return nullptr;
+}
+
+int
+mock_listen (struct mock *m)
+{
+	struct sockaddr_in a = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t n = sizeof a;
+
+	m->accepts = 0;
+	m->live = 0;
+	m->fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (m->fd < 0)
+		return errno;
+
+	if (bind(m->fd, (struct sockaddr *)&a, sizeof a) ||
+	    listen(m->fd, 1024) ||
+	    getsockname(m->fd, (struct sockaddr *)&a, &n)) {
+		int e = errno;
+		(void)close(m->fd);
+		return e;
+	}
+
+	(void)snprintf(m->port, sizeof m->port, "%u", ntohs(a.sin_port));
+	return 0;
+}
+
+int
+mock_run (struct mock *m)
+{
+	pthread_t t;
+	int e = pthread_create(&t, nullptr, mock_main, m);
+	if (!e)
+		(void)pthread_detach(t);
+	return e;
+}
+
+int
+mock_start (struct mock *m)
+{
+	int e = mock_listen(m);
+	if (!e) {
+		e = mock_run(m);
+		if (e)
+			(void)close(m->fd);
+	}
+	return e;
+}
@@ -0,0 +1,110 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file test-mock.h
+ *
+ * @brief Mock HTTP/1.1 server for the test programs.
+ *
+ * The server listens on an ephemeral loopback port and serves each
+ * connection on a thread of its own. Requests are read one at a time,
+ * along with a body of `Content-Length` bytes, and handed to a callback
+ * that writes the response.
+ *
+ * @author Juuso Alasuutari
+ */
+#ifndef LIBCANTH_SRC_TEST_MOCK_H_
+#define LIBCANTH_SRC_TEST_MOCK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util.h"
+
+/**
+ * @brief Request handler.
+ *
+ * Called on the thread of the connection, so calls for different
+ * connections may run concurrently.
+ *
+ * @param ctx  @ref mock::ctx.
+ * @param fd   Connection socket to write the response to.
+ * @param head Request line and header fields, each ending in CRLF,
+ *             without the empty line after them.
+ * @param body Request body.
+ * @param blen Length of @p body.
+ * @return Whether or not to keep serving the connection.
+ */
+typedef bool (mock_fn)(void       *ctx,
+                       int         fd,
+                       char const *head,
+                       char const *body,
+                       size_t      blen);
+
+/**
+ * @brief Mock server state.
+ */
+struct mock {
+	mock_fn  *serve;   //!< Request handler.
+	void     *ctx;     //!< Passed to @ref mock::serve.
+	int       fd;      //!< Listening socket.
+	char      port[8]; //!< Port it listens on.
+	uint32_t  accepts; //!< Connections accepted, atomically updated.
+	uint32_t  live;    //!< Connections open, atomically updated.
+};
+
+/**
+ * @brief Open the listening socket.
+ *
+ * @param[in,out] m Server with @ref mock::serve and @ref mock::ctx set.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+mock_listen (struct mock *m) nonnull_in();
+
+/**
+ * @brief Start accepting connections on a thread, which runs until the
+ *        process exits.
+ *
+ * @param[in,out] m Server returned by @ref mock_listen(). Must stay
+ *                  valid until the process exits.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+mock_run (struct mock *m) nonnull_in();
+
+/**
+ * @brief Open the listening socket and start accepting connections.
+ *
+ * @param[in,out] m Server with @ref mock::serve and @ref mock::ctx set.
+ * @return 0 on success, otherwise an error code.
+ */
+extern int
+mock_start (struct mock *m) nonnull_in();
+
+/**
+ * @brief Send all of a buffer.
+ *
+ * @return true on success, false if the connection failed.
+ */
+extern bool
+mock_send (int         fd,
+           void const *s,
+           size_t      n) nonnull_in();
+
+/**
+ * @brief Get the number of connections accepted.
+ */
+static force_inline size_t
+mock_accepts (struct mock *m)
+{
+	return __atomic_load_n(&m->accepts, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Get the number of connections still open.
+ */
+static force_inline size_t
+mock_live (struct mock *m)
+{
+	return __atomic_load_n(&m->live, __ATOMIC_ACQUIRE);
+}
+
+#endif /* LIBCANTH_SRC_TEST_MOCK_H_ */
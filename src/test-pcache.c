@@ -0,0 +1,484 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file test-pcache.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROGNAME "test-pcache"
+#define SYNOPSIS "[OPTION]..."
+#define PURPOSE  "Place prompt cache breakpoints in simulated conversations"
+
+#define OPTIONS(X)                                  \
+	X(boolean, help, 'h', "help",               \
+	  "print this help text and exit")          \
+	                                            \
+	X(number, conversations, 'c', "convs",      \
+	  "run NUM conversations side by side",     \
+	  "NUM", 64, 1, 100000)                     \
+	                                            \
+	X(number, turns, 't', "turns",              \
+	  "run NUM turns per conversation",         \
+	  "NUM", 24, 1, 10000)                      \
+	                                            \
+	X(number, edit, 'e', "edit",                \
+	  "rewrite the last message every NUM "     \
+	  "turns, 0 for never",                     \
+	  "NUM", 6, 0, 10000)                       \
+	                                            \
+	X(number, system, 's', "system",            \
+	  "use a system prompt of NUM bytes",       \
+	  "NUM", 8192, 1, 100000000)
+
+#define DETAILS \
+ "Conversations share tool definitions and a system prompt, and grow\n" \
+ "by a user and an assistant message per turn. Now and then the last\n" \
+ "user message is rewritten instead. Each request is sent to a\n" \
+ "simulated server which caches prefixes at breakpoints and reads\n" \
+ "them back the way the API does, once with the planned breakpoints\n" \
+ "and once with only the system prompt marked. The shares of input\n" \
+ "read from cache are reported."
+
+#include "letopt.h"
+
+#undef DETAILS
+#undef OPTIONS
+#undef PURPOSE
+#undef SYNOPSIS
+#undef PROGNAME
+
+#include "dbg.h"
+#include "mono.h"
+#include "pcache.h"
+
+/**
+ * @brief Number of tool definitions.
+ */
+#define TOOLS 4U
+
+/**
+ * @brief Blocks the server looks back from a breakpoint for a hit.
+ */
+#define LOOKBACK 20U
+
+/**
+ * @brief Simulated server cache.
+ */
+struct server {
+	uint64_t *set;   //!< Cached prefix hashes, 0 for a free slot.
+	size_t    cap;   //!< Size of @ref server::set, a power of two.
+	size_t    n;     //!< Prefixes cached.
+	uint64_t  read;  //!< Bytes read from cache.
+	uint64_t  write; //!< Bytes written to cache.
+	uint64_t  input; //!< Bytes not cached.
+};
+
+/**
+ * @brief Conversation state.
+ */
+struct conv {
+	struct pcache_block *b;   //!< Blocks of the next request.
+	size_t               n;   //!< Number of blocks.
+	size_t               cap; //!< Allocated size of @ref conv::b.
+};
+
+static uint32_t
+rnd (uint64_t *s,
+     uint32_t  n)
+{
+	*s ^= *s >> 12U;
+	*s ^= *s << 25U;
+	*s ^= *s >> 27U;
+	return (uint32_t)((*s * UINT64_C(0x2545f4914f6cdd1d)) >> 32U) % n;
+}
+
+/**
+ * @brief Make a text block of about @p len bytes of random words.
+ */
+static int
+make_block (struct pcache_block *b,
+            uint64_t            *rng,
+            size_t               len)
+{
+	static char const *const words[] = {
+		"the", "cache", "prefix", "request", "of", "token",
+		"model", "a", "stable", "block", "and", "message",
+	};
+	static char const head[] = "{\"type\":\"text\",\"text\":\"";
+
+	char *s = malloc(sizeof head + len + 16U);
+	if (!s)
+		return errno;
+	memcpy(s, head, sizeof head - 1U);
+	size_t n = sizeof head - 1U;
+	while (n < len) {
+		char const *w = words[rnd(rng, sizeof words / sizeof *words)];
+		size_t k = strlen(w);
+		memcpy(&s[n], w, k);
+		n += k;
+		s[n++] = ' ';
+	}
+	memcpy(&s[n - 1U], "\"}", 2U);
+	*b = (struct pcache_block){.data = s, .len = n + 1U};
+	return 0;
+}
+
+static uint64_t
+server_hash (uint64_t             h,
+             struct pcache_block const *b)
+{
+	unsigned char const *s = b->data;
+	for (size_t i = 0; i < b->len; ++i)
+		h = (h ^ s[i]) * 0x100000001b3U;
+	return h ? h : 1U;
+}
+
+static bool
+server_has (struct server const *s,
+            uint64_t             h)
+{
+	size_t mask = s->cap - 1U;
+	for (size_t i = h & mask; s->cap && s->set[i]; i = (i + 1U) & mask) {
+		if (s->set[i] == h)
+			return true;
+	}
+	return false;
+}
+
+static int
+server_add (struct server *s,
+            uint64_t       h)
+{
+	if (server_has(s, h))
+		return 0;
+
+	if ((s->n + 1U) * 2U > s->cap) {
+		size_t cap = s->cap ? s->cap * 2U : 1024U;
+		uint64_t *set = calloc(cap, sizeof *set);
+		if (!set)
+			return errno;
+		for (size_t i = 0; i < s->cap; ++i) {
+			uint64_t v = s->set[i];
+			size_t j = v & (cap - 1U);
+			for (; v && set[j]; j = (j + 1U) & (cap - 1U));
+			if (v)
+				set[j] = v;
+		}
+		free(s->set);
+		s->set = set;
+		s->cap = cap;
+	}
+
+	size_t i = h & (s->cap - 1U);
+	while (s->set[i])
+		i = (i + 1U) & (s->cap - 1U);
+	s->set[i] = h;
+	s->n += 1U;
+	return 0;
+}
+
+/**
+ * @brief Serve a request. The longest cached prefix ending at most
+ *        @ref LOOKBACK blocks before a breakpoint is read, and the
+ *        prefix at each breakpoint is written.
+ *
+ * @param[in,out] s    Server.
+ * @param[in]     b    Blocks.
+ * @param[in]     n    Number of blocks.
+ * @param[in]     at   Breakpoints, ascending.
+ * @param[in]     nat  Number of breakpoints.
+ * @param[out]    u    Bytes read, written, and not cached.
+ */
+static int
+server_serve (struct server             *s,
+              struct pcache_block const *b,
+              size_t                     n,
+              uint32_t const            *at,
+              uint32_t                   nat,
+              uint64_t                   u[3])
+{
+	uint64_t *pre = malloc(n * 2U * sizeof *pre);
+	if (!pre)
+		return errno;
+	uint64_t *off = &pre[n];
+	for (size_t i = 0; i < n; ++i) {
+		pre[i] = server_hash(i ? pre[i - 1U] : 0xcbf29ce484222325U,
+		                     &b[i]);
+		off[i] = (i ? off[i - 1U] : 0) + b[i].len;
+	}
+
+	size_t hit = 0;
+	for (uint32_t i = 0; i < nat; ++i) {
+		size_t lo = at[i] >= LOOKBACK ? at[i] - LOOKBACK + 1U : 0;
+		for (size_t j = at[i] + 1U; j > lo && j > hit; --j) {
+			if (server_has(s, pre[j - 1U])) {
+				hit = j;
+				break;
+			}
+		}
+	}
+
+	int e = 0;
+	for (uint32_t i = 0; !e && i < nat; ++i)
+		e = server_add(s, pre[at[i]]);
+
+	uint64_t total = off[n - 1U];
+	uint64_t read = hit ? off[hit - 1U] : 0;
+	uint64_t write = nat && at[nat - 1U] + 1U > hit
+	                 ? off[at[nat - 1U]] - read : 0;
+	u[0] = read;
+	u[1] = write;
+	u[2] = total - read - write;
+	s->read += u[0];
+	s->write += u[1];
+	s->input += u[2];
+	free(pre);
+	return e;
+}
+
+static int
+conv_push (struct conv         *c,
+           struct pcache_block  b)
+{
+	if (c->n == c->cap) {
+		size_t cap = c->cap ? c->cap * 2U : 64U;
+		struct pcache_block *p = realloc(c->b, cap * sizeof *p);
+		if (!p)
+			return errno;
+		c->b = p;
+		c->cap = cap;
+	}
+	c->b[c->n++] = b;
+	return 0;
+}
+
+/**
+ * @brief Check marking and planning on small fixed input.
+ */
+static int
+check_basics (void)
+{
+	static struct {
+		char const *in;
+		char const *out;
+	} const marks[] = {
+		{"{\"a\":1}",
+		 "{\"a\":1,\"cache_control\":{\"type\":\"ephemeral\"}}"},
+		{" { }\n",
+		 " { \"cache_control\":{\"type\":\"ephemeral\"}}"},
+	};
+
+	int e = 0;
+	dstr s = {0};
+	for (size_t i = 0; !e && i < sizeof marks / sizeof *marks; ++i) {
+		struct pcache_block b = {marks[i].in, strlen(marks[i].in)};
+		struct jwriter w;
+		jwriter_init(&w, &s, 0);
+		(void)pcache_write(&w, &b, true);
+		e = jwriter_end(&w);
+		if (!e && !dstr_eq(&s, marks[i].out, strlen(marks[i].out))) {
+			pr_err_("marked %s as %.*s", marks[i].in, (int)s.len,
+			        dstr_get(&s));
+			e = EPROTO;
+		}
+	}
+	if (!e) {
+		struct pcache_block b = {"[1]", 3U};
+		struct jwriter w;
+		jwriter_init(&w, &s, 0);
+		if (pcache_write(&w, &b, true) != EINVAL) {
+			pr_err_("marked an array");
+			e = EPROTO;
+		}
+		(void)jwriter_end(&w);
+	}
+	dstr_fini(&s);
+	if (e)
+		return e;
+
+	struct pcache p;
+	e = pcache_init(&p, &(struct pcache_cfg){
+		.min_bytes     = 16U,
+		.conversations = 2U,
+	});
+	if (e)
+		return e;
+
+	struct pcache_block const b[] = {
+		{"0123456789", 10U}, {"abcdefghij", 10U},
+		{"ABCDEFGHIJ", 10U}, {"klmnopqrst", 10U},
+		{"0123456789", 10U},
+	};
+	static struct {
+		uint64_t conv;
+		uint8_t  blocks[4];
+		uint8_t  n;
+		uint8_t  stable;
+		uint8_t  nat;
+		uint8_t  at[3];
+	} const cases[] = {
+		{1, {0, 1, 2},    3, 0, 1, {2}},
+		{1, {0, 1, 2, 3}, 4, 3, 2, {2, 3}},
+		{1, {0, 4, 2},    3, 1, 1, {2}},
+		{1, {0, 1},       2, 2, 1, {1}},
+		{1, {0},          1, 1, 0, {0}},
+		{2, {0, 1, 2},    3, 0, 1, {2}},
+		{3, {0, 1, 2},    3, 0, 1, {2}},
+		{1, {0, 1, 2},    3, 0, 1, {2}},
+	};
+	for (size_t i = 0; !e && i < sizeof cases / sizeof *cases; ++i) {
+		struct pcache_block req[4];
+		for (uint8_t j = 0; j < cases[i].n; ++j)
+			req[j] = b[cases[i].blocks[j]];
+
+		struct pcache_plan plan;
+		e = pcache_plan(&p, cases[i].conv, req, cases[i].n, &plan);
+		if (e)
+			break;
+		if (plan.stable != cases[i].stable ||
+		    plan.n != cases[i].nat ||
+		    memcmp(plan.at, (uint32_t[3]){cases[i].at[0],
+		                                  cases[i].at[1],
+		                                  cases[i].at[2]},
+		           plan.n * sizeof *plan.at)) {
+			pr_err_("case %zu: %zu stable, %" PRIu32 " breakpoints",
+			        i, plan.stable, plan.n);
+			e = EPROTO;
+		}
+	}
+
+	/* Conversation 1 was forgotten to make room for 3. */
+	struct pcache_stats st = pcache_stats(&p);
+	if (!e && (st.evicted != 2U || st.requests != 8U || st.hits != 2U)) {
+		pr_err_("%zu evicted, %zu requests, %zu hits", st.evicted,
+		        st.requests, st.hits);
+		e = EPROTO;
+	}
+	pcache_fini(&p);
+	return e;
+}
+
+int
+main (int    c,
+      char **v)
+{
+	struct letopt opt = letopt_init(c, v);
+
+	if (letopt_nargs(&opt) || opt.m_help)
+		letopt_helpful_exit(&opt);
+
+	int e = check_basics();
+	if (e) {
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	size_t nconv = (size_t)opt.m_conversations;
+	struct conv *cv = calloc(nconv, sizeof *cv);
+	struct pcache_block fixed[TOOLS + 1U] = {0};
+	struct server srv[2] = {0};
+	struct pcache p;
+	uint64_t rng = 0x9e3779b97f4a7c15U;
+	e = cv ? pcache_init(&p, nullptr) : errno;
+	if (e) {
+		pr_errno_(e, "init");
+		free(cv);
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	/* Tools and the system prompt, shared by every conversation. */
+	for (unsigned i = 0; !e && i <= TOOLS; ++i)
+		e = make_block(&fixed[i], &rng,
+		               i < TOOLS ? 1024U : (size_t)opt.m_system);
+	for (size_t i = 0; !e && i < nconv; ++i) {
+		for (unsigned j = 0; !e && j <= TOOLS; ++j)
+			e = conv_push(&cv[i], fixed[j]);
+	}
+
+	uint64_t t0 = mono_us(), planned = 0;
+	size_t edits = 0;
+	for (unsigned t = 0; !e && t < opt.m_turns; ++t) {
+		for (size_t i = 0; !e && i < nconv; ++i) {
+			struct conv *k = &cv[i];
+			struct pcache_block m;
+
+			if (opt.m_edit && t % opt.m_edit == opt.m_edit - 1U &&
+			    k->n > TOOLS + 2U) {
+				free((void *)k->b[--k->n].data);
+				free((void *)k->b[--k->n].data);
+				++edits;
+			}
+			e = make_block(&m, &rng, 200U + rnd(&rng, 1800U));
+			if (!e)
+				e = conv_push(k, m);
+			if (e)
+				break;
+
+			struct pcache_plan plan;
+			uint64_t t1 = mono_us();
+			e = pcache_plan(&p, i, k->b, k->n, &plan);
+			planned += mono_us() - t1;
+
+			uint64_t u[3];
+			uint32_t sys = TOOLS;
+			if (!e)
+				e = server_serve(&srv[0], k->b, k->n, plan.at,
+				                 plan.n, u);
+			if (!e)
+				pcache_usage(&p, (int64_t)u[2] / 4,
+				             (int64_t)u[0] / 4, (int64_t)u[1] / 4);
+			if (!e)
+				e = server_serve(&srv[1], k->b, k->n, &sys, 1U, u);
+			if (!e)
+				e = make_block(&m, &rng, 400U + rnd(&rng, 3600U));
+			if (!e)
+				e = conv_push(k, m);
+		}
+	}
+	uint64_t t1 = mono_us();
+
+	struct pcache_stats st = pcache_stats(&p);
+	if (e) {
+		pr_errno_(e, "simulation");
+	} else {
+		double r[2];
+		for (unsigned i = 0; i < 2U; ++i) {
+			struct server const *s = &srv[i];
+			uint64_t all = s->read + s->write + s->input;
+			r[i] = all ? (double)s->read / (double)all : 0.0;
+		}
+
+		pr_out("%zu requests, %zu edits, %zu with a stable prefix, "
+		       "%.1f us per plan in %.1f ms", st.requests, edits,
+		       st.hits, (double)planned / (double)st.requests,
+		       (double)(t1 - t0) / 1e3);
+		pr_out("planned: %5.1f%% read from cache (%.1f%% counted)",
+		       r[0] * 100.0, pcache_hit_rate(&st) / 10.0);
+		pr_out("by hand: %5.1f%% read from cache", r[1] * 100.0);
+
+		if (opt.m_turns >= 8U && (r[0] < 0.8 || r[0] < r[1])) {
+			pr_err_("planned breakpoints read %.1f%% from cache",
+			        r[0] * 100.0);
+			e = EPROTO;
+		}
+	}
+
+	for (size_t i = 0; i < nconv; ++i) {
+		for (size_t j = TOOLS + 1U; j < cv[i].n; ++j)
+			free((void *)cv[i].b[j].data);
+		free(cv[i].b);
+	}
+	for (unsigned i = 0; i <= TOOLS; ++i)
+		free((void *)fixed[i].data);
+	free(srv[0].set);
+	free(srv[1].set);
+	free(cv);
+	pcache_fini(&p);
+	(void)letopt_fini(&opt);
+	return e ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,473 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file test-ratelimit.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PROGNAME "test-ratelimit"
+#define SYNOPSIS "[OPTION]..."
+#define PURPOSE  "Pace simulated requests against rate limits"
+
+#define OPTIONS(X)                                  \
+	X(boolean, help, 'h', "help",               \
+	  "print this help text and exit")          \
+	                                            \
+	X(number, seconds, 't', "time",             \
+	  "run for NUM seconds",                    \
+	  "NUM", 5, 1, 3600)                        \
+	                                            \
+	X(number, threads, 'j', "threads",          \
+	  "send from NUM threads at once",          \
+	  "NUM", 64, 1, 1024)                       \
+	                                            \
+	X(number, latency, 'l', "latency",          \
+	  "take NUM ms to answer a request",        \
+	  "NUM", 50, 0, 60000)                      \
+	                                            \
+	X(number, rpm, 'r', "rpm",                  \
+	  "allow NUM requests per minute",          \
+	  "NUM", 12000, 1, 100000000)               \
+	                                            \
+	X(number, itpm, 'i', "itpm",                \
+	  "allow NUM input tokens per minute",      \
+	  "NUM", 2000000, 1, 2000000000)            \
+	                                            \
+	X(number, otpm, 'o', "otpm",                \
+	  "allow NUM output tokens per minute",     \
+	  "NUM", 400000, 1, 2000000000)             \
+	                                            \
+	X(number, max_tokens, 'm', "max-tokens",    \
+	  "ask for up to NUM output tokens",        \
+	  "NUM", 256, 1, 1000000)                   \
+	                                            \
+	X(number, other, 'x', "other",              \
+	  "let another client use NUM permille "    \
+	  "of the limits",                          \
+	  "NUM", 0, 0, 1000)                        \
+	                                            \
+	X(number, fill, 'f', "fill",                \
+	  "start with NUM permille of the limits "  \
+	  "available on the server",                \
+	  "NUM", 1000, 0, 1000)
+
+#define DETAILS \
+ "Client threads send requests to a simulated server that enforces\n" \
+ "token buckets the way the API does, charging the output token\n" \
+ "limit up front and refunding the unused part. The client learns\n" \
+ "the limits from response headers and paces itself; the share of\n" \
+ "each limit used and the number of 429 responses are reported."
+
+#include "letopt.h"
+
+#undef DETAILS
+#undef OPTIONS
+#undef PURPOSE
+#undef SYNOPSIS
+#undef PROGNAME
+
+#include "dbg.h"
+#include "mono.h"
+#include "ratelimit.h"
+
+/**
+ * @brief Size of the prompt text requests take slices of.
+ */
+#define TEXT_SIZE 4096U
+
+/**
+ * @brief Simulated server.
+ */
+struct server {
+	pthread_mutex_t lock;                      //!< Guards the rest.
+	double          avail[ratelimit_kinds];    //!< Bucket levels.
+	double          rate[ratelimit_kinds];     //!< Refill per us.
+	double          other[ratelimit_kinds];    //!< Use by others per us.
+	uint32_t        limit[ratelimit_kinds];    //!< Per-minute limits.
+	uint64_t        used[ratelimit_kinds];     //!< Used by the client.
+	uint64_t        last;                      //!< Time of last refill.
+	size_t          accepted;                  //!< Requests accepted.
+	size_t          rejected;                  //!< Requests rejected.
+};
+
+/**
+ * @brief Client thread state.
+ */
+struct client {
+	pthread_t         tid;
+	struct ratelimit *r;
+	struct server    *srv;
+	char const       *text;
+	uint64_t          rng;
+	uint32_t          latency;
+	uint32_t          max_tokens;
+	bool const       *stop;
+	int               e;
+};
+
+static uint32_t
+next (uint64_t *s)
+{
+	*s ^= *s << 13U;
+	*s ^= *s >> 7U;
+	*s ^= *s << 17U;
+	return (uint32_t)(*s >> 32U);
+}
+
+static void
+server_refill (struct server *s,
+               uint64_t       now)
+{
+	double dt = (double)(now - s->last);
+	s->last = now;
+	for (unsigned i = 0; i < ratelimit_kinds; ++i) {
+		s->avail[i] += (s->rate[i] - s->other[i]) * dt;
+		if (s->avail[i] > s->limit[i])
+			s->avail[i] = s->limit[i];
+	}
+}
+
+/**
+ * @brief Format the rate-limit headers of a response.
+ */
+static size_t
+server_headers (struct server const *s,
+                char                 h[][64],
+                bool                 retry)
+{
+	static char const *const names[ratelimit_kinds] = {
+		"requests", "input-tokens", "output-tokens",
+	};
+	size_t n = 0;
+	for (unsigned i = 0; i < ratelimit_kinds; ++i) {
+		double a = s->avail[i] > 0.0 ? s->avail[i] : 0.0;
+		(void)snprintf(h[n++], 64U, "anthropic-ratelimit-%s-limit: %"
+		               PRIu32, names[i], s->limit[i]);
+		(void)snprintf(h[n++], 64U, "Anthropic-RateLimit-%s-Remaining:"
+		               " %.0f", names[i], a);
+	}
+	if (retry)
+		(void)snprintf(h[n++], 64U, "retry-after: 1");
+	return n;
+}
+
+/**
+ * @brief Admit a request the way the API does.
+ *
+ * @return Whether the request was accepted.
+ */
+static bool
+server_admit (struct server *s,
+              uint32_t       input,
+              uint32_t       output,
+              char           h[][64],
+              size_t        *n)
+{
+	(void)pthread_mutex_lock(&s->lock);
+	server_refill(s, mono_us());
+	bool ok = s->avail[ratelimit_requests] >= 1.0 &&
+	          s->avail[ratelimit_input] >= input &&
+	          s->avail[ratelimit_output] >= output;
+	if (ok) {
+		s->avail[ratelimit_requests] -= 1.0;
+		s->avail[ratelimit_input] -= input;
+		s->avail[ratelimit_output] -= output;
+		s->used[ratelimit_requests] += 1U;
+		s->used[ratelimit_input] += input;
+		s->accepted += 1U;
+	} else {
+		s->rejected += 1U;
+	}
+	*n = server_headers(s, h, !ok);
+	(void)pthread_mutex_unlock(&s->lock);
+	return ok;
+}
+
+/**
+ * @brief Finish a request, refunding unused output tokens.
+ */
+static void
+server_finish (struct server *s,
+               uint32_t       output,
+               uint32_t       used,
+               char           h[][64],
+               size_t        *n)
+{
+	(void)pthread_mutex_lock(&s->lock);
+	server_refill(s, mono_us());
+	s->avail[ratelimit_output] += output - used;
+	s->used[ratelimit_output] += used;
+	*n = server_headers(s, h, false);
+	(void)pthread_mutex_unlock(&s->lock);
+}
+
+static int
+feed (struct ratelimit *r,
+      char              h[][64],
+      size_t            n)
+{
+	for (size_t i = 0; i < n; ++i) {
+		int e = ratelimit_header(r, h[i], strlen(h[i]));
+		if (e)
+			return e;
+	}
+	return 0;
+}
+
+static void *
+client_main (void *arg)
+{
+	struct client *c = arg;
+	char h[8][64];
+	size_t n;
+
+	while (!__atomic_load_n(c->stop, __ATOMIC_RELAXED)) {
+		/* A prompt of 100 to 1000 bytes, which the server bills
+		 * at about four fifths of the estimate. */
+		size_t len = 100U + next(&c->rng) % 900U;
+		char const *text = &c->text[next(&c->rng) % (TEXT_SIZE - len)];
+		uint32_t est = ratelimit_estimate(text, len);
+		uint32_t input = est * 4U / 5U;
+		uint32_t output = c->max_tokens;
+
+		c->e = ratelimit_acquire(c->r, est, output, 10000U);
+		if (c->e) {
+			pr_errno_(c->e, "ratelimit_acquire");
+			break;
+		}
+
+		if (!server_admit(c->srv, input, output, h, &n)) {
+			c->e = feed(c->r, h, n);
+			ratelimit_settle(c->r, est, output, 0, 0);
+			if (c->e)
+				break;
+			continue;
+		}
+
+		if (c->latency)
+			(void)usleep(c->latency * 1000U);
+
+		uint32_t used = next(&c->rng) % (output + 1U);
+		server_finish(c->srv, output, used, h, &n);
+		c->e = feed(c->r, h, n);
+		ratelimit_settle(c->r, est, output, input, used);
+		if (c->e)
+			break;
+	}
+
+	return nullptr;
+}
+
+/**
+ * @brief Check the estimator and header parser on fixed input.
+ */
+static int
+check_basics (void)
+{
+	static char const ja[] = "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e";
+	if (ratelimit_estimate("hello world", 11U) != 3U ||
+	    ratelimit_estimate(ja, sizeof ja - 1U) != 3U ||
+	    ratelimit_estimate("", 0) != 0) {
+		pr_err_("ratelimit_estimate");
+		return EPROTO;
+	}
+
+	struct ratelimit r;
+	int e = ratelimit_init(&r, nullptr);
+	if (e)
+		return e;
+
+	static char const *const good[] = {
+		"anthropic-ratelimit-requests-limit: 60",
+		"anthropic-ratelimit-requests-reset: 2025-01-01T00:00:00Z",
+		"anthropic-ratelimit-tokens-limit: x",
+		"content-type: application/json",
+		"ANTHROPIC-RATELIMIT-OUTPUT-TOKENS-LIMIT:\t8000 ",
+	};
+	static char const *const bad[] = {
+		"anthropic-ratelimit-input-tokens-remaining: -1",
+		"anthropic-ratelimit-requests-limit: ",
+		"retry-after: Wed, 21 Oct 2015 07:28:00 GMT",
+	};
+	for (size_t i = 0; !e && i < sizeof good / sizeof *good; ++i) {
+		if (ratelimit_header(&r, good[i], strlen(good[i]))) {
+			pr_err_("rejected %s", good[i]);
+			e = EPROTO;
+		}
+	}
+	for (size_t i = 0; !e && i < sizeof bad / sizeof *bad; ++i) {
+		if (ratelimit_header(&r, bad[i], strlen(bad[i])) != EPROTO) {
+			pr_err_("accepted %s", bad[i]);
+			e = EPROTO;
+		}
+	}
+
+	struct ratelimit_stats st = ratelimit_stats(&r);
+	if (!e && (st.limit[ratelimit_requests] != 60U ||
+	           st.limit[ratelimit_input] ||
+	           st.limit[ratelimit_output] != 8000U)) {
+		pr_err_("limits %" PRIu32 ", %" PRIu32 ", %" PRIu32,
+		        st.limit[0], st.limit[1], st.limit[2]);
+		e = EPROTO;
+	}
+
+	/* One request per second, so the next one has to wait. */
+	uint32_t ms = 0;
+	if (!e && (ratelimit_try(&r, 10U, 10U, &ms) != EAGAIN || !ms ||
+	           ms > 1100U)) {
+		pr_err_("ratelimit_try: %" PRIu32 " ms", ms);
+		e = EPROTO;
+	}
+	if (!e && ratelimit_acquire(&r, 10U, 10U, 1U) != ETIMEDOUT) {
+		pr_err_("ratelimit_acquire didn't time out");
+		e = EPROTO;
+	}
+	if (!e && ratelimit_stats(&r).timeouts != 1U) {
+		pr_err_("timeout not counted");
+		e = EPROTO;
+	}
+
+	ratelimit_fini(&r);
+	return e;
+}
+
+int
+main (int    c,
+      char **v)
+{
+	struct letopt opt = letopt_init(c, v);
+
+	if (letopt_nargs(&opt) || opt.m_help)
+		letopt_helpful_exit(&opt);
+
+	int e = check_basics();
+	if (e) {
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	size_t n = (size_t)opt.m_threads;
+	struct client *cl = calloc(n, sizeof *cl);
+	char *text = malloc(TEXT_SIZE);
+	if (!cl || !text) {
+		pr_errno_(errno, "malloc");
+		free(text);
+		free(cl);
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+	static char const words[] = "the quick brown fox jumps over a lazy dog ";
+	for (size_t i = 0; i < TEXT_SIZE; ++i)
+		text[i] = words[i % (sizeof words - 1U)];
+
+	struct server srv = {
+		.lock  = PTHREAD_MUTEX_INITIALIZER,
+		.limit = {
+			(uint32_t)opt.m_rpm,
+			(uint32_t)opt.m_itpm,
+			(uint32_t)opt.m_otpm,
+		},
+	};
+	for (unsigned i = 0; i < ratelimit_kinds; ++i) {
+		srv.rate[i] = srv.limit[i] / 60e6;
+		srv.other[i] = srv.rate[i] * (double)opt.m_other / 1000.0;
+		srv.avail[i] = srv.limit[i] * (double)opt.m_fill / 1000.0;
+	}
+
+	/* The limits are learned from the first response. */
+	struct ratelimit r;
+	e = ratelimit_init(&r, nullptr);
+	if (e) {
+		pr_errno_(e, "ratelimit_init");
+		free(text);
+		free(cl);
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	bool stop = false;
+	size_t started = 0;
+	uint64_t t0 = mono_us();
+	srv.last = t0;
+	for (; started < n; ++started) {
+		cl[started] = (struct client){
+			.r          = &r,
+			.srv        = &srv,
+			.text       = text,
+			.rng        = 0x9e3779b97f4a7c15U * (started + 1U),
+			.latency    = (uint32_t)opt.m_latency,
+			.max_tokens = (uint32_t)opt.m_max_tokens,
+			.stop       = &stop,
+		};
+		e = pthread_create(&cl[started].tid, nullptr, client_main,
+		                   &cl[started]);
+		if (e) {
+			pr_errno_(e, "pthread_create");
+			break;
+		}
+	}
+
+	if (!e)
+		(void)sleep((unsigned)opt.m_seconds);
+	__atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+
+	(void)pthread_mutex_lock(&srv.lock);
+	uint64_t t1 = mono_us();
+	uint64_t used[ratelimit_kinds];
+	memcpy(used, srv.used, sizeof used);
+	size_t accepted = srv.accepted, rejected = srv.rejected;
+	(void)pthread_mutex_unlock(&srv.lock);
+
+	for (size_t i = 0; i < started; ++i) {
+		(void)pthread_join(cl[i].tid, nullptr);
+		if (!e)
+			e = cl[i].e;
+	}
+
+	struct ratelimit_stats st = ratelimit_stats(&r);
+	ratelimit_fini(&r);
+
+	/* Share of what the other client leaves over. */
+	static char const *const names[ratelimit_kinds] = {
+		"requests", "input tokens", "output tokens",
+	};
+	double top = 0.0, mins = (double)(t1 - t0) / 60e6;
+	double left = 1.0 - (double)opt.m_other / 1000.0;
+	for (unsigned i = 0; !e && i < ratelimit_kinds; ++i) {
+		double u = left > 0.0
+		           ? (double)used[i] / (srv.limit[i] * mins * left)
+		           : 0.0;
+		if (u > top)
+			top = u;
+		pr_out("%-13s %10" PRIu64 " used, %5.1f%% of the limit",
+		       names[i], used[i], u * 100.0);
+	}
+
+	if (!e)
+		pr_out("%zu accepted, %zu rejected, %zu waited, %zu throttled "
+		       "in %.1f s", accepted, rejected, st.waited,
+		       st.throttled, (double)(t1 - t0) / 1e6);
+
+	/* Without competition the client should neither get throttled
+	 * nor leave much of its target share unused. */
+	if (!e && !opt.m_other && opt.m_fill == 1000) {
+		if (rejected) {
+			pr_err_("%zu requests rejected", rejected);
+			e = EPROTO;
+		} else if (top < 0.85 || top > 1.0) {
+			pr_err_("%.1f%% of the limit used", top * 100.0);
+			e = EPROTO;
+		}
+	}
+
+	free(text);
+	free(cl);
+	(void)letopt_fini(&opt);
+	return e ? EXIT_FAILURE : EXIT_SUCCESS;
+}
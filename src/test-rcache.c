@@ -0,0 +1,551 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file test-rcache.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PROGNAME "test-rcache"
+#define SYNOPSIS "[OPTION]..."
+#define PURPOSE  "Record and replay responses through the response cache"
+
+#define OPTIONS(X)                                  \
+	X(boolean, help, 'h', "help",               \
+	  "print this help text and exit")          \
+	                                            \
+	X(number, streams, 'n', "streams",          \
+	  "record NUM event streams",               \
+	  "NUM", 2000, 1, 10000000)                 \
+	                                            \
+	X(number, events, 'e', "events",            \
+	  "send NUM events per stream",             \
+	  "NUM", 50, 1, 100000)                     \
+	                                            \
+	X(number, gap, 'g', "gap",                  \
+	  "wait NUM us between the events of the "  \
+	  "timed stream",                           \
+	  "NUM", 2000, 100, 1000000)                \
+	                                            \
+	X(string, dir, 'd', "dir",                  \
+	  "keep the cache in DIR instead of a "     \
+	  "temporary directory",                    \
+	  "DIR")
+
+#define DETAILS \
+ "Event streams are recorded into a new cache the way a stream of the\n" \
+ "event loop would be, looked up by request, and replayed without\n" \
+ "delays. One stream is recorded with real gaps between events and\n" \
+ "replayed at full and quarter timing. The cache is then reopened,\n" \
+ "and reopened again after cutting the index short and leaving a\n" \
+ "torn record at the end of the segment, and every stream is checked\n" \
+ "to replay as recorded each time. An open cache is checked to refuse\n" \
+ "to be opened a second time."
+
+#include "letopt.h"
+
+#undef DETAILS
+#undef OPTIONS
+#undef PURPOSE
+#undef SYNOPSIS
+#undef PROGNAME
+
+#include "dbg.h"
+#include "mono.h"
+#include "rcache.h"
+
+/**
+ * @brief What a consumer saw of a stream.
+ */
+struct sink {
+	uint64_t hash;   //!< Hash of everything seen.
+	size_t   events; //!< Events seen.
+	size_t   bytes;  //!< Body bytes seen.
+	int      status; //!< Status code from the head.
+	int      e;      //!< Error code from done.
+	bool     done;   //!< Whether done was called.
+};
+
+static void
+sink_hash (struct sink *k,
+           void const  *s,
+           size_t       n)
+{
+	unsigned char const *p = s;
+	uint64_t h = k->hash ^ n;
+	for (size_t i = 0; i < n; ++i)
+		h = (h ^ p[i]) * 0x100000001b3U;
+	k->hash = h;
+}
+
+static void
+on_header (void       *ctx,
+           char const *s,
+           size_t      n)
+{
+	sink_hash(ctx, s, n);
+}
+
+static void
+on_head (void                    *ctx,
+         struct http_frame const *f)
+{
+	struct sink *k = ctx;
+	k->status = f->status;
+	sink_hash(k, &f->status, sizeof f->status);
+	sink_hash(k, &f->events, sizeof f->events);
+}
+
+static void
+on_event (void                   *ctx,
+          struct sse_event const *ev)
+{
+	struct sink *k = ctx;
+	k->events += 1U;
+	sink_hash(k, dstr_get(&ev->event), ev->event.len);
+	sink_hash(k, dstr_get(&ev->data), ev->data.len);
+	sink_hash(k, dstr_get(&ev->id), ev->id.len);
+	sink_hash(k, &ev->retry, sizeof ev->retry);
+}
+
+static void
+on_data (void       *ctx,
+         void const *s,
+         size_t      n)
+{
+	struct sink *k = ctx;
+	k->bytes += n;
+	sink_hash(k, s, n);
+}
+
+static void
+on_done (void *ctx,
+         int   e,
+         int   status)
+{
+	struct sink *k = ctx;
+	k->e = e;
+	k->done = true;
+	sink_hash(k, &status, sizeof status);
+}
+
+static struct hloop_ops const sink_ops = {
+	.header = on_header,
+	.head   = on_head,
+	.event  = on_event,
+	.data   = on_data,
+	.done   = on_done,
+};
+
+static int
+body_key (struct rcache_key *k,
+          size_t             i)
+{
+	char buf[256];
+	int n = snprintf(buf, sizeof buf, "{\"model\":\"test\","
+	                 "\"max_tokens\":64,\"stream\":true,\"messages\":"
+	                 "[{\"role\":\"user\",\"content\":\"prompt %zu\"}]}",
+	                 i);
+	return rcache_key(k, "/v1/messages", buf, (size_t)n);
+}
+
+/**
+ * @brief Play the server side of a stream into a recorder.
+ *
+ * @param[in,out] r      Recorder.
+ * @param[in]     i      Stream number, which picks the text.
+ * @param[in]     events Number of events.
+ * @param[in]     gap    Time between events, in us.
+ * @param[in]     status Status code to send.
+ * @param[in]     e      Error code to finish with.
+ */
+static void
+play (struct rcache_rec *r,
+      size_t             i,
+      size_t             events,
+      uint32_t           gap,
+      int                status,
+      int                e)
+{
+	static char const ct[] = "content-type: text/event-stream";
+	struct http_frame f = {
+		.status  = status,
+		.chunked = true,
+		.keep    = true,
+		.events  = true,
+	};
+	rcache_rec_ops.header(r, ct, sizeof ct - 1U);
+	rcache_rec_ops.head(r, &f);
+
+	for (size_t j = 0; j < events; ++j) {
+		char buf[256];
+		int n = snprintf(buf, sizeof buf, "{\"type\":"
+		                 "\"content_block_delta\",\"index\":0,"
+		                 "\"delta\":{\"type\":\"text_delta\","
+		                 "\"text\":\"word %zu of stream %zu\"}}", j, i);
+		struct sse_event ev = {
+			.event = make_dstr_view("content_block_delta"),
+			.data  = make_dstr_view_from_decay(buf, (size_t)n),
+			.retry = -1,
+		};
+		if (gap) {
+			struct timespec t = {.tv_nsec = (long)gap * 1000L};
+			(void)nanosleep(&t, nullptr);
+		}
+		rcache_rec_ops.event(r, &ev);
+	}
+
+	rcache_rec_ops.done(r, e, status);
+}
+
+/**
+ * @brief Check that equal requests get equal keys and others don't.
+ */
+static int
+check_keys (void)
+{
+	static char const *const same[] = {
+		"{\"b\":1,\"a\":[1,2.5,{\"y\":\"x\",\"x\":null}]}",
+		" { \"a\" : [ 1 , 2.50 , {\"x\":null,\"y\":\"\\u0078\"} ] ,"
+		"\n\"b\" : 1e0 } ",
+	};
+	static char const *const other[] = {
+		"{\"b\":1,\"a\":[2,1,{\"y\":\"x\",\"x\":null}]}",
+		"{\"b\":2,\"a\":[1,2.5,{\"y\":\"x\",\"x\":null}]}",
+		"{\"b\":1,\"a\":[1,2.5,{\"y\":\"x\",\"x\":false}]}",
+	};
+
+	struct rcache_key a, b;
+	int e = rcache_key(&a, "/v1/messages", same[0], strlen(same[0]));
+	if (!e)
+		e = rcache_key(&b, "/v1/messages", same[1], strlen(same[1]));
+	if (e) {
+		pr_errno_(e, "rcache_key");
+		return e;
+	}
+	if (memcmp(&a, &b, sizeof a)) {
+		pr_err_("equal requests got different keys");
+		return EPROTO;
+	}
+
+	for (size_t i = 0; i < sizeof other / sizeof *other; ++i) {
+		e = rcache_key(&b, "/v1/messages", other[i], strlen(other[i]));
+		if (e || !memcmp(&a, &b, sizeof a)) {
+			pr_err_("%s got the key of %s", other[i], same[0]);
+			return EPROTO;
+		}
+	}
+
+	e = rcache_key(&b, "/v1/messages/count_tokens", same[0],
+	               strlen(same[0]));
+	if (e || !memcmp(&a, &b, sizeof a)) {
+		pr_err_("path doesn't change the key");
+		return EPROTO;
+	}
+	if (!rcache_key(&b, nullptr, "{\"a\":", 5U)) {
+		pr_err_("invalid JSON got a key");
+		return EPROTO;
+	}
+	return 0;
+}
+
+/**
+ * @brief Replay every stream and compare it with the recording.
+ */
+static int
+check_all (struct rcache  *c,
+           uint64_t const *want,
+           size_t          n,
+           char const     *what)
+{
+	uint64_t t0 = mono_us();
+	size_t events = 0;
+	for (size_t i = 0; i < n; ++i) {
+		struct rcache_key k;
+		struct rcache_hit h;
+		struct sink s = {0};
+		int e = body_key(&k, i);
+		if (!e)
+			e = rcache_get(c, &k, &h);
+		if (!e)
+			e = rcache_replay(&h, 0, &sink_ops, &s);
+		if (e || !s.done || s.e || s.hash != want[i]) {
+			pr_err_("%s: stream %zu: %s", what, i,
+			        e ? strerror(e) : "replayed differently");
+			return e ? e : EPROTO;
+		}
+		events += s.events;
+	}
+	uint64_t t1 = mono_us();
+
+	struct rcache_stats st = rcache_stats(c);
+	pr_out("%s: %zu streams replayed, %.0f events/s, %zu records, "
+	       "%zu recovered, %zu damaged, %" PRIu64 " bytes", what, n,
+	       (double)events * 1e6 / (double)(t1 - t0 + 1U), st.records,
+	       st.recovered, st.corrupt, st.bytes);
+	return 0;
+}
+
+/**
+ * @brief Record and replay one stream with real gaps between events.
+ */
+static int
+check_timing (struct rcache *c,
+              size_t         n,
+              uint32_t       gap)
+{
+	struct rcache_key k;
+	int e = rcache_key(&k, "/v1/messages", "{\"timed\":true}", 14U);
+	if (e)
+		return e;
+
+	struct sink s = {0};
+	struct rcache_rec r;
+	rcache_rec_init(&r, c, &k, &sink_ops, &s);
+	uint64_t t0 = mono_us();
+	play(&r, n, 20U, gap, 200, 0);
+	uint64_t rec = mono_us() - t0;
+	rcache_rec_fini(&r);
+
+	static uint32_t const pace[] = {1000U, 250U, 0};
+	for (size_t i = 0; i < sizeof pace / sizeof *pace; ++i) {
+		struct rcache_hit h;
+		struct sink p = {0};
+		e = rcache_get(c, &k, &h);
+		if (e)
+			return e;
+		t0 = mono_us();
+		e = rcache_replay(&h, pace[i], &sink_ops, &p);
+		uint64_t dt = mono_us() - t0;
+		if (e)
+			return e;
+
+		uint64_t lo = 20U * gap * pace[i] / 1000U;
+		pr_out("pace %4" PRIu32 ": %7.1f ms, recorded in %.1f ms",
+		       pace[i], (double)dt / 1e3, (double)rec / 1e3);
+		if (p.hash != s.hash || dt < lo ||
+		    (pace[i] < 1000U && dt > rec)) {
+			pr_err_("replay at pace %" PRIu32 " took %.1f ms",
+			        pace[i], (double)dt / 1e3);
+			return EPROTO;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Check that failed and non-2xx responses aren't stored, and
+ *        that a complete response is.
+ */
+static int
+check_other (struct rcache *c)
+{
+	static int const err[][2] = {{500, 0}, {200, ECONNRESET}};
+	for (size_t i = 0; i < sizeof err / sizeof *err; ++i) {
+		struct rcache_key k;
+		struct rcache_hit h;
+		struct sink s = {0};
+		struct rcache_rec r;
+		int e = rcache_key(&k, "/failed", "[]", 2U);
+		if (e)
+			return e;
+		k.h[1] += i;
+		rcache_rec_init(&r, c, &k, &sink_ops, &s);
+		play(&r, 0, 3U, 0, err[i][0], err[i][1]);
+		rcache_rec_fini(&r);
+		if (!s.done || rcache_get(c, &k, &h) != ENOENT) {
+			pr_err_("stored a response with status %d, error %d",
+			        err[i][0], err[i][1]);
+			return EPROTO;
+		}
+	}
+
+	static char const head[] = "content-type: application/json\r\n"
+	                           "request-id: req_1\r\n";
+	static char const body[] = "{\"id\":\"msg_1\",\"type\":\"message\"}";
+	struct http_response res = {
+		.head   = make_dstr_view(head),
+		.body   = make_dstr_view(body),
+		.status = 200,
+	};
+	struct rcache_key k;
+	struct rcache_hit h;
+	struct sink s = {0};
+	int e = rcache_key(&k, "/v1/messages", "{\"stream\":false}", 16U);
+	if (!e)
+		e = rcache_put_response(c, &k, &res);
+	if (!e && rcache_put_response(c, &k, &res) != EEXIST)
+		e = EPROTO;
+	if (!e)
+		e = rcache_get(c, &k, &h);
+	if (!e)
+		e = rcache_replay(&h, 0, &sink_ops, &s);
+	if (!e && (s.status != 200 || s.bytes != sizeof body - 1U))
+		e = EPROTO;
+	if (e)
+		pr_errno_(e, "rcache_put_response");
+	return e;
+}
+
+int
+main (int    c,
+      char **v)
+{
+	struct letopt opt = letopt_init(c, v);
+
+	if (letopt_nargs(&opt) || opt.m_help)
+		letopt_helpful_exit(&opt);
+
+	char tmp[] = "/tmp/test-rcache.XXXXXX";
+	char const *dir = opt.m_dir;
+	if (!dir && !(dir = mkdtemp(tmp))) {
+		pr_errno_(errno, "mkdtemp");
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	char path[4096], ipath[4096];
+	(void)snprintf(path, sizeof path, "%s/responses", dir);
+	(void)snprintf(ipath, sizeof ipath, "%s/responses.idx", dir);
+	(void)unlink(path);
+	(void)unlink(ipath);
+
+	size_t n = (size_t)opt.m_streams;
+	uint64_t *want = calloc(n, sizeof *want);
+	struct rcache rc;
+	int e = want ? check_keys() : ENOMEM;
+	if (!e)
+		e = rcache_open(&rc, path, 0);
+	if (e) {
+		pr_errno_(e, "%s", path);
+		free(want);
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	/* The segment stays locked for as long as the cache is open. */
+	struct rcache again;
+	e = rcache_open(&again, path, 0);
+	if (e != EBUSY) {
+		if (!e)
+			rcache_close(&again);
+		pr_err_("cache opened twice");
+		e = EPROTO;
+	} else {
+		e = 0;
+	}
+
+	uint64_t t0 = mono_us();
+	for (size_t i = 0; !e && i < n; ++i) {
+		struct rcache_key k;
+		struct rcache_hit h;
+		struct sink s = {0};
+		struct rcache_rec r;
+		e = body_key(&k, i);
+		if (!e && rcache_get(&rc, &k, &h) != ENOENT) {
+			pr_err_("stream %zu cached before it was sent", i);
+			e = EPROTO;
+		}
+		if (e)
+			break;
+		rcache_rec_init(&r, &rc, &k, &sink_ops, &s);
+		play(&r, i, (size_t)opt.m_events, 0, 200, 0);
+		rcache_rec_fini(&r);
+		want[i] = s.hash;
+	}
+	uint64_t t1 = mono_us();
+	if (!e)
+		pr_out("%zu streams recorded in %.1f ms", n,
+		       (double)(t1 - t0) / 1e3);
+
+	if (!e)
+		e = check_all(&rc, want, n, "recorded");
+	if (!e)
+		e = check_timing(&rc, n, (uint32_t)opt.m_gap);
+	if (!e)
+		e = check_other(&rc);
+	struct rcache_stats st = rcache_stats(&rc);
+	rcache_close(&rc);
+
+	size_t records = st.records;
+	if (!e && (records != n + 2U || st.skipped != 3U)) {
+		pr_err_("%zu records, %zu skipped", records, st.skipped);
+		e = EPROTO;
+	}
+
+	if (!e)
+		e = rcache_open(&rc, path, 0);
+	if (!e) {
+		e = check_all(&rc, want, n, "reopened");
+		rcache_close(&rc);
+	}
+
+	/* Lose the last four index entries, one of them in part, and
+	 * tear a record at the end. */
+	if (!e) {
+		struct stat sb;
+		int fd = open(ipath, O_WRONLY | O_CLOEXEC);
+		if (fd < 0 || fstat(fd, &sb) ||
+		    ftruncate(fd, sb.st_size - 3 * 24 - 5))
+			e = errno;
+		if (fd >= 0)
+			(void)close(fd);
+		fd = open(path, O_WRONLY | O_APPEND | O_CLOEXEC);
+		if (!e && (fd < 0 || write(fd, "\x31\x52\x43\x52torn", 8) != 8))
+			e = errno ? errno : EIO;
+		if (fd >= 0)
+			(void)close(fd);
+	}
+	if (!e)
+		e = rcache_open(&rc, path, 0);
+	if (!e) {
+		e = check_all(&rc, want, n, "repaired");
+		st = rcache_stats(&rc);
+		if (!e && (st.records != records || st.recovered != 4U ||
+		           st.corrupt != 1U)) {
+			pr_err_("%zu records, %zu recovered, %zu damaged",
+			        st.records, st.recovered, st.corrupt);
+			e = EPROTO;
+		}
+		rcache_close(&rc);
+	}
+
+	/* Damage the items of the first record. */
+	if (!e) {
+		int fd = open(path, O_WRONLY | O_CLOEXEC);
+		if (fd < 0 || pwrite(fd, "X", 1U, 8 + 40 + 40) != 1)
+			e = errno ? errno : EIO;
+		if (fd >= 0)
+			(void)close(fd);
+	}
+	if (!e)
+		e = rcache_open(&rc, path, 0);
+	if (!e) {
+		struct rcache_key k;
+		struct rcache_hit h;
+		e = body_key(&k, 0);
+		if (!e && rcache_get(&rc, &k, &h) != EBADMSG) {
+			pr_err_("damaged record not detected");
+			e = EPROTO;
+		}
+		rcache_close(&rc);
+	}
+
+	if (e)
+		pr_errno_(e, "%s", path);
+	if (!opt.m_dir) {
+		(void)unlink(path);
+		(void)unlink(ipath);
+		(void)rmdir(dir);
+	}
+	free(want);
+	(void)letopt_fini(&opt);
+	return e ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,450 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file test-retry.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PROGNAME "test-retry"
+#define SYNOPSIS "[OPTION]..."
+#define PURPOSE  "Exercise the retry policy against a faulty server"
+
+#define OPTIONS(X)                                \
+	X(boolean, help, 'h', "help",             \
+	  "print this help text and exit")        \
+	                                          \
+	X(number, requests, 'n', "requests",      \
+	  "send NUM requests per round",          \
+	  "NUM", 2000, 20, 1000000)               \
+	                                          \
+	X(number, threads, 'j', "threads",        \
+	  "send from NUM threads at once",        \
+	  "NUM", 8, 1, 256)                       \
+	                                          \
+	X(number, budget, 'b', "budget",          \
+	  "allow NUM permille of requests to "    \
+	  "be retried",                           \
+	  "NUM", 100, 1, 10000)
+
+#define DETAILS \
+ "A mock server on a loopback port fails chosen requests with\n" \
+ "5xx, 429 with retry-after-ms, or a dropped connection. The\n" \
+ "retry decisions are checked one by one, then a round where\n" \
+ "one request in twenty fails at first has to succeed in full,\n" \
+ "and a round where every request fails must stay within the\n" \
+ "retry budget."
+
+#include "letopt.h"
+
+#undef DETAILS
+#undef OPTIONS
+#undef PURPOSE
+#undef SYNOPSIS
+#undef PROGNAME
+
+#include "dbg.h"
+#include "mono.h"
+#include "retry.h"
+#include "test-mock.h"
+
+/**
+ * @brief Delay the mock server asks for with `429`.
+ */
+#define MOCK_AFTER_MS 20U
+
+/**
+ * @brief Faults the mock server has served.
+ */
+struct faults {
+	uint32_t *hits; //!< Requests seen per ID, atomically updated.
+	size_t    n;    //!< Number of IDs.
+};
+
+/**
+ * @brief Attempt counts by verdict, atomically updated by the trace
+ *        callback.
+ */
+struct trace {
+	size_t verdicts[retry_deadline + 1];
+	size_t short_delays; //!< Retries sooner than the server asked.
+};
+
+/**
+ * @brief Client thread state.
+ */
+struct client {
+	pthread_t         tid;
+	struct retry     *r;
+	struct http_pool *pool;
+	struct mock      *m;
+	size_t            first;   //!< First request ID.
+	size_t            count;   //!< Requests to send.
+	size_t            step;    //!< ID stride.
+	bool              outage;  //!< Fail every request.
+	uint32_t         *lat;     //!< Latency per request, in us.
+	size_t            ok;      //!< Requests that succeeded.
+	int               e;
+};
+
+/**
+ * @brief Answer one request.
+ *
+ * The path is `/ID/FAILS/CODE`: the first FAILS requests for ID get
+ * status CODE, or the connection is dropped if CODE is 0, and the rest
+ * get `200`. A `429` comes with `retry-after-ms`.
+ */
+static bool
+serve (void       *ctx,
+       int         fd,
+       char const *head,
+       char const *body,
+       size_t      blen)
+{
+	struct faults *f = ctx;
+	(void)body;
+	(void)blen;
+
+	size_t id = SIZE_MAX;
+	unsigned fails = 0, code = 0;
+	char const *path = strchr(head, ' ');
+	if (path && sscanf(path, " /%zu/%u/%u ", &id, &fails,
+	                   &code) == 3 && id < f->n) {
+		uint32_t k = __atomic_fetch_add(&f->hits[id], 1U,
+		                                __ATOMIC_RELAXED);
+		if (k >= fails)
+			code = 200U;
+	} else {
+		code = 404U;
+	}
+	if (!code)
+		return false;
+
+	char out[256];
+	int n = snprintf(out, sizeof out, "HTTP/1.1 %u X\r\n%s"
+	                 "Content-Length: 2\r\n\r\nok", code,
+	                 code == 429U ? "Retry-After-Ms: 20\r\n" : "");
+	return mock_send(fd, out, (size_t)n);
+}
+
+static void
+on_attempt (void                       *ctx,
+            struct retry_attempt const *a)
+{
+	struct trace *t = ctx;
+	(void)__atomic_add_fetch(&t->verdicts[a->verdict], 1U,
+	                         __ATOMIC_RELAXED);
+	if (a->verdict == retry_again && a->delay_ms < a->after_ms)
+		(void)__atomic_add_fetch(&t->short_delays, 1U,
+		                         __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Check single decisions of a fresh policy.
+ */
+static int
+decisions (void)
+{
+	static struct {
+		int                e;
+		int                status;
+		bool               idempotent;
+		enum retry_verdict want;
+	} const cases[] = {
+		{0,            200, false, retry_done},
+		{0,            404, true,  retry_done},
+		{0,            429, false, retry_again},
+		{0,            529, false, retry_again},
+		{0,            503, false, retry_again},
+		{0,            500, false, retry_unsafe},
+		{0,            500, true,  retry_again},
+		{0,            502, true,  retry_again},
+		{ECONNREFUSED, 0,   false, retry_again},
+		{ECONNRESET,   0,   false, retry_unsafe},
+		{ETIMEDOUT,    0,   true,  retry_again},
+		{ENOMEM,       0,   true,  retry_done},
+	};
+
+	struct retry r;
+	int e = retry_init(&r, &(struct retry_cfg){
+		.base_ms    = 10U,
+		.cap_ms     = 1000U,
+		.budget_min = 1000U,
+	});
+	if (e)
+		return e;
+	usleep(20000);
+
+	for (size_t i = 0; !e && i < sizeof cases / sizeof *cases; ++i) {
+		struct retry_state s;
+		uint32_t d = UINT32_MAX;
+		retry_begin(&r, &s, cases[i].idempotent);
+		enum retry_verdict v = retry_next(&r, &s, cases[i].e,
+		                                  cases[i].status, 0, &d);
+		if (v != cases[i].want ||
+		    (v == retry_again ? d < 10U || d > 30U : d)) {
+			pr_err_("case %zu: verdict %d, delay %" PRIu32, i,
+			        (int)v, d);
+			e = EPROTO;
+		}
+	}
+
+	/* The delay never drops below retry-after, and a longer one than
+	 * the cap is given up on. Attempts run out after the fourth. */
+	struct retry_state s;
+	uint32_t d = 0;
+	retry_begin(&r, &s, false);
+	if (!e && (retry_next(&r, &s, 0, 429, 500U, &d) != retry_again ||
+	           d != 500U)) {
+		pr_err_("retry-after: delay %" PRIu32, d);
+		e = EPROTO;
+	}
+	if (!e && retry_next(&r, &s, 0, 429, 5000U, &d) != retry_deadline) {
+		pr_err_("retry-after beyond the cap");
+		e = EPROTO;
+	}
+	retry_begin(&r, &s, true);
+	for (uint32_t i = 1U, prev = 10U; !e && i <= RETRY_ATTEMPTS; ++i) {
+		enum retry_verdict v = retry_next(&r, &s, 0, 503, 0, &d);
+		if (v != (i < RETRY_ATTEMPTS ? retry_again : retry_attempts)) {
+			pr_err_("attempt %" PRIu32 ": verdict %d", i, (int)v);
+			e = EPROTO;
+		} else if (v == retry_again && (d < 10U || d > prev * 3U)) {
+			pr_err_("attempt %" PRIu32 ": delay %" PRIu32, i, d);
+			e = EPROTO;
+		}
+		prev = d;
+	}
+
+	dstr hdr[] = {make_dstr_view("Idempotency-Key: abc")};
+	struct http_request req = {.method = "POST"};
+	if (!e && retry_idempotent(&req)) {
+		pr_err_("POST taken as idempotent");
+		e = EPROTO;
+	}
+	req.headers = hdr;
+	req.nheaders = 1U;
+	if (!e && !retry_idempotent(&req)) {
+		pr_err_("Idempotency-Key ignored");
+		e = EPROTO;
+	}
+
+	retry_fini(&r);
+	return e;
+}
+
+static void *
+client_main (void *arg)
+{
+	struct client *c = arg;
+	static unsigned const codes[] = {503, 529, 429, 0, 500, 502};
+	dstr hdr[] = {make_dstr_view("Idempotency-Key: x")};
+
+	for (size_t k = 0; k < c->count; ++k) {
+		size_t id = c->first + k * c->step;
+		char path[64];
+		unsigned fails = 0, code = 200;
+		if (c->outage) {
+			fails = UINT32_MAX;
+			code = 503;
+		} else if (!(id % 20U)) {
+			fails = 1U + !(id % 100U);
+			code = codes[id / 20U % (sizeof codes / sizeof *codes)];
+		}
+		(void)snprintf(path, sizeof path, "/%zu/%u/%u", id, fails, code);
+
+		struct http_request req = {
+			.method   = "POST",
+			.host     = "127.0.0.1",
+			.port     = c->m->port,
+			.path     = path,
+			.headers  = hdr,
+			.nheaders = 1U,
+		};
+		struct http_response res;
+		uint64_t t0 = mono_us();
+		int e = retry_request(c->r, c->pool, &req, &res);
+		c->lat[k] = (uint32_t)(mono_us() - t0);
+		if (!e && res.status == 200)
+			++c->ok;
+		http_response_fini(&res);
+	}
+
+	return nullptr;
+}
+
+static int
+cmp_u32 (void const *a,
+         void const *b)
+{
+	uint32_t x = *(uint32_t const *)a, y = *(uint32_t const *)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief Run a round of requests from several threads.
+ */
+static int
+round_trip (struct retry     *r,
+            struct http_pool *p,
+            struct mock      *m,
+            size_t            first,
+            size_t            n,
+            size_t            threads,
+            bool              outage,
+            size_t           *ok,
+            uint32_t         *lat)
+{
+	struct client *cl = calloc(threads, sizeof *cl);
+	if (!cl)
+		return errno;
+
+	size_t started = 0;
+	int e = 0;
+	for (; started < threads; ++started) {
+		cl[started] = (struct client){
+			.r      = r,
+			.pool   = p,
+			.m      = m,
+			.first  = first + started,
+			.count  = (n - started + threads - 1U) / threads,
+			.step   = threads,
+			.outage = outage,
+			.lat    = &lat[started * ((n + threads - 1U) / threads)],
+		};
+		e = pthread_create(&cl[started].tid, nullptr, client_main,
+		                   &cl[started]);
+		if (e)
+			break;
+	}
+
+	*ok = 0;
+	for (size_t i = 0; i < started; ++i) {
+		(void)pthread_join(cl[i].tid, nullptr);
+		*ok += cl[i].ok;
+	}
+
+	free(cl);
+	return e;
+}
+
+int
+main (int    c,
+      char **v)
+{
+	struct letopt opt = letopt_init(c, v);
+
+	if (letopt_nargs(&opt) || opt.m_help)
+		letopt_helpful_exit(&opt);
+
+	size_t n = (size_t)opt.m_requests;
+	size_t j = (size_t)opt.m_threads;
+	size_t slots = (n + j - 1U) / j * j;
+	struct faults f = {
+		.hits = calloc(n * 2U, sizeof *f.hits),
+		.n    = n * 2U,
+	};
+	struct mock m = {.serve = serve, .ctx = &f};
+	uint32_t *lat = calloc(slots, sizeof *lat);
+	if (!f.hits || !lat) {
+		pr_errno_(errno, "calloc");
+		free(lat);
+		free(f.hits);
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	int e = decisions();
+	if (!e)
+		e = mock_start(&m);
+
+	struct trace t = {0};
+	struct retry r;
+	struct http_pool p;
+	if (!e)
+		e = retry_init(&r, &(struct retry_cfg){
+			.base_ms    = 5U,
+			.cap_ms     = 200U,
+			.budget     = (uint32_t)opt.m_budget,
+			.budget_min = 1U,
+			.trace      = on_attempt,
+			.ctx        = &t,
+		});
+	if (e) {
+		pr_errno_(e, "setup");
+		free(lat);
+		free(f.hits);
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+	e = http_pool_init(&p, &(struct http_pool_cfg){
+		.max_conns  = (uint32_t)j,
+		.timeout_ms = 5000U,
+	});
+
+	/* Transient faults: every one of them is retried and succeeds. */
+	size_t ok = 0;
+	uint64_t t0 = mono_us();
+	if (!e)
+		e = round_trip(&r, &p, &m, 0, n, j, false, &ok, lat);
+	uint64_t t1 = mono_us();
+	struct retry_stats st = retry_stats(&r);
+	if (!e) {
+		qsort(lat, slots, sizeof *lat, cmp_u32);
+		uint32_t const *l = &lat[slots - n];
+		pr_out("transient: %zu of %zu ok, %zu attempts, %zu retries "
+		       "in %.1f ms, latency p50 %" PRIu32 " us, p99 %" PRIu32
+		       " us, max %" PRIu32 " us", ok, n, st.attempts,
+		       st.retries, (double)(t1 - t0) / 1e3, l[n / 2U],
+		       l[n * 99U / 100U], l[n - 1U]);
+		if (ok != n || t.short_delays || st.denied) {
+			pr_err_("%zu failed, %zu retried early, %zu denied",
+			        n - ok, t.short_delays, st.denied);
+			e = EPROTO;
+		}
+	}
+
+	/* Outage: retries stay within the budget. */
+	if (!e)
+		e = round_trip(&r, &p, &m, n, n, j, true, &ok, lat);
+	uint64_t t2 = mono_us();
+	struct retry_stats st2 = retry_stats(&r);
+	if (!e) {
+		size_t retries = st2.retries - st.retries;
+		/* Everything paid in, the floor, and the initial balance. */
+		size_t allow = st2.requests * (size_t)opt.m_budget / 1000U +
+		               (size_t)((t2 - t0) / 1000000U) + 11U -
+		               st.retries;
+		pr_out("outage: %zu of %zu ok, %zu retries, %zu denied, "
+		       "%.2f attempts per request in %.1f ms", ok, n, retries,
+		       st2.denied - st.denied,
+		       (double)(st2.attempts - st.attempts) / (double)n,
+		       (double)(t2 - t1) / 1e3);
+		if (ok || retries > allow) {
+			pr_err_("%zu retries, at most %zu allowed", retries,
+			        allow);
+			e = EPROTO;
+		}
+	}
+
+	http_pool_fini(&p);
+
+	/* Let the server see the connections close before its counters go. */
+	for (unsigned i = 0; i < 1000U && mock_live(&m); ++i) {
+		struct timespec t = {.tv_nsec = 1000000L};
+		(void)nanosleep(&t, nullptr);
+	}
+
+	retry_fini(&r);
+	free(lat);
+	if (!mock_live(&m))
+		free(f.hits);
+	(void)letopt_fini(&opt);
+	return e ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,564 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/** @file test-sflight.c
+ *
+ * @author Juuso Alasuutari
+ */
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PROGNAME "test-sflight"
+#define SYNOPSIS "[OPTION]..."
+#define PURPOSE  "Coalesce identical requests from many threads"
+
+#define OPTIONS(X)                                  \
+	X(boolean, help, 'h', "help",               \
+	  "print this help text and exit")          \
+	                                            \
+	X(number, jobs, 'j', "jobs",                \
+	  "ask from NUM threads at once",           \
+	  "NUM", 32, 1, 1024)                       \
+	                                            \
+	X(number, requests, 'n', "requests",        \
+	  "send NUM requests per thread",           \
+	  "NUM", 200, 1, 1000000)                   \
+	                                            \
+	X(number, keys, 'k', "keys",                \
+	  "pick each request from NUM distinct "    \
+	  "ones",                                   \
+	  "NUM", 8, 1, 100000)                      \
+	                                            \
+	X(number, events, 'e', "events",            \
+	  "send NUM events per stream",             \
+	  "NUM", 20, 1, 100000)                     \
+	                                            \
+	X(number, gap, 'g', "gap",                  \
+	  "wait NUM us between events upstream",    \
+	  "NUM", 200, 0, 1000000)                   \
+	                                            \
+	X(number, ttl, 't', "ttl",                  \
+	  "keep complete responses for NUM ms",     \
+	  "NUM", 5, 1, 3600000)
+
+#define DETAILS \
+ "Each thread sends requests picked at random from a small set, and a\n" \
+ "request that leads plays a slow event stream upstream. Every caller\n" \
+ "is checked to get the same stream the upstream played, and the\n" \
+ "number of upstream calls is compared to the number of requests.\n" \
+ "Failed streams are checked to reach every follower and to not be\n" \
+ "kept, and the LRU to evict by count, size and age."
+
+#include "letopt.h"
+
+#undef DETAILS
+#undef OPTIONS
+#undef PURPOSE
+#undef SYNOPSIS
+#undef PROGNAME
+
+#include "dbg.h"
+#include "mono.h"
+#include "sflight.h"
+
+/**
+ * @brief What a consumer saw of a stream.
+ */
+struct sink {
+	uint64_t hash;   //!< Hash of everything seen.
+	size_t   events; //!< Events seen.
+	int      status; //!< Status code from done.
+	int      e;      //!< Error code from done.
+	bool     done;   //!< Whether done was called.
+};
+
+/**
+ * @brief State shared by the threads.
+ */
+struct shared {
+	struct sflight  *s;        //!< Coalescing layer.
+	uint64_t const  *want;     //!< Hash of the stream of each key.
+	uint32_t        *upstream; //!< Upstream calls per key, atomically
+	                           //!< updated.
+	size_t           keys;     //!< Distinct requests.
+	size_t           requests; //!< Requests per thread.
+	size_t           events;   //!< Events per stream.
+	uint32_t         gap;      //!< Time between events, in us.
+	uint32_t         go;       //!< Set to start, atomically updated.
+	uint32_t         bad;      //!< Wrong streams, atomically updated.
+};
+
+/**
+ * @brief A client thread.
+ */
+struct client {
+	struct shared *sh;   //!< Shared state.
+	pthread_t      tid;  //!< Thread ID.
+	uint64_t       seed; //!< Random state.
+};
+
+static void
+sleep_us (uint32_t us)
+{
+	struct timespec t = {
+		.tv_sec  = (time_t)(us / 1000000U),
+		.tv_nsec = (long)(us % 1000000U) * 1000L,
+	};
+	(void)nanosleep(&t, nullptr);
+}
+
+static void
+sink_hash (struct sink *k,
+           void const  *s,
+           size_t       n)
+{
+	unsigned char const *p = s;
+	uint64_t h = k->hash ^ n;
+	for (size_t i = 0; i < n; ++i)
+		h = (h ^ p[i]) * 0x100000001b3U;
+	k->hash = h;
+}
+
+static void
+on_header (void       *ctx,
+           char const *s,
+           size_t      n)
+{
+	sink_hash(ctx, s, n);
+}
+
+static void
+on_head (void                    *ctx,
+         struct http_frame const *f)
+{
+	struct sink *k = ctx;
+	sink_hash(k, &f->status, sizeof f->status);
+	sink_hash(k, &f->events, sizeof f->events);
+}
+
+static void
+on_event (void                   *ctx,
+          struct sse_event const *ev)
+{
+	struct sink *k = ctx;
+	k->events += 1U;
+	sink_hash(k, dstr_get(&ev->event), ev->event.len);
+	sink_hash(k, dstr_get(&ev->data), ev->data.len);
+	sink_hash(k, dstr_get(&ev->id), ev->id.len);
+	sink_hash(k, &ev->retry, sizeof ev->retry);
+}
+
+static void
+on_data (void       *ctx,
+         void const *s,
+         size_t      n)
+{
+	sink_hash(ctx, s, n);
+}
+
+static void
+on_done (void *ctx,
+         int   e,
+         int   status)
+{
+	struct sink *k = ctx;
+	k->e = e;
+	k->status = status;
+	k->done = true;
+	sink_hash(k, &status, sizeof status);
+}
+
+static struct hloop_ops const sink_ops = {
+	.header = on_header,
+	.head   = on_head,
+	.event  = on_event,
+	.data   = on_data,
+	.done   = on_done,
+};
+
+static int
+body_key (struct rcache_key *k,
+          size_t             i)
+{
+	char buf[256];
+	int n = snprintf(buf, sizeof buf, "{\"model\":\"test\","
+	                 "\"max_tokens\":64,\"stream\":true,\"messages\":"
+	                 "[{\"role\":\"user\",\"content\":\"classify %zu\"}]}",
+	                 i);
+	return rcache_key(k, "/v1/messages", buf, (size_t)n);
+}
+
+/**
+ * @brief Play the server side of a stream.
+ *
+ * @param[in] ops    Callbacks.
+ * @param[in] ctx    Context of @p ops.
+ * @param[in] i      Request number, which picks the text.
+ * @param[in] events Number of events.
+ * @param[in] gap    Time before each event, in us.
+ * @param[in] status Status code to send.
+ */
+static void
+play (struct hloop_ops const *ops,
+      void                   *ctx,
+      size_t                  i,
+      size_t                  events,
+      uint32_t                gap,
+      int                     status)
+{
+	static char const ct[] = "content-type: text/event-stream";
+	struct http_frame f = {
+		.status  = status,
+		.chunked = true,
+		.keep    = true,
+		.events  = true,
+	};
+	ops->header(ctx, ct, sizeof ct - 1U);
+	ops->head(ctx, &f);
+
+	for (size_t j = 0; j < events; ++j) {
+		char buf[256];
+		int n = snprintf(buf, sizeof buf, "{\"type\":"
+		                 "\"content_block_delta\",\"index\":0,"
+		                 "\"delta\":{\"type\":\"text_delta\","
+		                 "\"text\":\"word %zu of answer %zu\"}}", j, i);
+		struct sse_event ev = {
+			.event = make_dstr_view("content_block_delta"),
+			.data  = make_dstr_view_from_decay(buf, (size_t)n),
+			.retry = -1,
+		};
+		if (gap)
+			sleep_us(gap);
+		ops->event(ctx, &ev);
+	}
+
+	ops->done(ctx, 0, status);
+}
+
+/**
+ * @brief Send one request through the coalescing layer.
+ *
+ * @param[in,out] s      Coalescing layer.
+ * @param[in]     i      Request number.
+ * @param[in]     events Number of events upstream.
+ * @param[in]     gap    Time between events upstream, in us.
+ * @param[in]     status Status code upstream.
+ * @param[out]    k      What the caller saw.
+ * @param[out]    role   How the caller got it.
+ * @return 0 on success, otherwise an error code.
+ */
+static int
+ask (struct sflight    *s,
+     size_t             i,
+     size_t             events,
+     uint32_t           gap,
+     int                status,
+     struct sink       *k,
+     enum sflight_role *role)
+{
+	struct rcache_key key;
+	struct sflight_call c;
+	*k = (struct sink){0};
+	int e = body_key(&key, i);
+	if (!e)
+		e = sflight_join(s, &key, &sink_ops, k, &c);
+	if (e)
+		return e;
+
+	*role = c.role;
+	if (c.role == sflight_lead)
+		play(&sflight_lead_ops, &c, i, events, gap, status);
+	else
+		sflight_wait(&c);
+	return 0;
+}
+
+static void *
+client_main (void *arg)
+{
+	struct client *cl = arg;
+	struct shared *sh = cl->sh;
+	while (!__atomic_load_n(&sh->go, __ATOMIC_ACQUIRE))
+		sleep_us(50U);
+
+	for (size_t n = 0; n < sh->requests; ++n) {
+		cl->seed ^= cl->seed << 13U;
+		cl->seed ^= cl->seed >> 7U;
+		cl->seed ^= cl->seed << 17U;
+		size_t i = (size_t)(cl->seed % sh->keys);
+
+		struct sink k;
+		enum sflight_role role = sflight_lead;
+		int e = ask(sh->s, i, sh->events, sh->gap, 200, &k, &role);
+		if (!e && role == sflight_lead)
+			(void)__atomic_add_fetch(&sh->upstream[i], 1U,
+			                         __ATOMIC_RELAXED);
+		if (e || !k.done || k.e || k.status != 200 ||
+		    k.hash != sh->want[i]) {
+			if (!__atomic_fetch_add(&sh->bad, 1U, __ATOMIC_RELAXED))
+				pr_err_("request %zu: %s", i, e ? strerror(e)
+				        : "got a different stream");
+		}
+	}
+	return nullptr;
+}
+
+/**
+ * @brief Hash of the stream a request gets when sent directly.
+ */
+static uint64_t
+direct (size_t i,
+        size_t events,
+        int    status)
+{
+	struct sink k = {0};
+	play(&sink_ops, &k, i, events, 0, status);
+	return k.hash;
+}
+
+/**
+ * @brief A follower thread of @ref check_failed().
+ */
+struct follower {
+	struct sflight *s;   //!< Coalescing layer.
+	pthread_t       tid; //!< Thread ID.
+	struct sink     k;   //!< What it saw.
+	int             e;   //!< Error code of @ref ask().
+};
+
+static void *
+follower_main (void *arg)
+{
+	struct follower *f = arg;
+	enum sflight_role role = sflight_lead;
+	f->e = ask(f->s, 0, 3U, 0, 500, &f->k, &role);
+	if (!f->e && role != sflight_follow)
+		f->e = EPROTO;
+	return nullptr;
+}
+
+/**
+ * @brief Check that a failed stream reaches every follower and isn't
+ *        kept, and that a leader that can't send releases them.
+ */
+static int
+check_failed (void)
+{
+	struct sflight s;
+	int e = sflight_init(&s, nullptr);
+	if (e)
+		return e;
+
+	struct rcache_key key;
+	struct sflight_call c;
+	struct sink lead = {0};
+	e = body_key(&key, 0);
+	if (!e)
+		e = sflight_join(&s, &key, &sink_ops, &lead, &c);
+	if (!e && c.role != sflight_lead)
+		e = EPROTO;
+	if (e) {
+		sflight_fini(&s);
+		return e;
+	}
+
+	struct follower fl[8];
+	size_t started = 0;
+	for (; started < sizeof fl / sizeof *fl; ++started) {
+		fl[started] = (struct follower){.s = &s};
+		if (pthread_create(&fl[started].tid, nullptr, follower_main,
+		                   &fl[started]))
+			break;
+	}
+	while (sflight_stats(&s).followers < started)
+		sleep_us(100U);
+	play(&sflight_lead_ops, &c, 0, 3U, 0, 500);
+
+	uint64_t want = direct(0, 3U, 500);
+	for (size_t i = 0; i < started; ++i) {
+		(void)pthread_join(fl[i].tid, nullptr);
+		if (!e && (fl[i].e || fl[i].k.status != 500 ||
+		           fl[i].k.hash != want)) {
+			pr_err_("follower %zu: %s", i, fl[i].e
+			        ? strerror(fl[i].e) : "got a different stream");
+			e = EPROTO;
+		}
+	}
+
+	/* Not kept, so the next caller leads, and gives up. */
+	struct sink k = {0};
+	if (!e)
+		e = sflight_join(&s, &key, &sink_ops, &k, &c);
+	if (!e && c.role != sflight_lead) {
+		pr_err_("a failed stream was kept");
+		e = EPROTO;
+	}
+	if (!e) {
+		struct sflight_call f;
+		struct sink fk = {0};
+		e = sflight_join(&s, &key, &sink_ops, &fk, &f);
+		if (!e) {
+			sflight_lead_ops.done(&c, ECANCELED, 0);
+			sflight_wait(&f);
+			if (fk.e != ECANCELED)
+				e = EPROTO;
+		}
+	}
+
+	struct sflight_stats st = sflight_stats(&s);
+	sflight_fini(&s);
+	if (!e && (st.failed != 2U || st.entries)) {
+		pr_err_("%zu failed, %zu kept", st.failed, st.entries);
+		e = EPROTO;
+	}
+	if (!e)
+		pr_out("failed streams: %zu followers released", started + 1U);
+	return e;
+}
+
+/**
+ * @brief Check eviction by count, size and age.
+ */
+static int
+check_lru (size_t events)
+{
+	static struct {
+		struct sflight_cfg cfg;
+		size_t             keys;  //!< Keys to send in order.
+		size_t             again; //!< Key to send again.
+		uint32_t           sleep; //!< Time to wait before that.
+		enum sflight_role  role;  //!< How it must get it.
+	} const t[] = {
+		{{.entries = 2U}, 3U, 2U, 0, sflight_cached},
+		{{.entries = 2U}, 3U, 0, 0, sflight_lead},
+		{{.bytes = 64U}, 1U, 0, 0, sflight_lead},
+		{{.ttl_ms = 1U}, 1U, 0, 3000U, sflight_lead},
+		{{.ttl_ms = 1000U}, 1U, 0, 3000U, sflight_cached},
+	};
+
+	for (size_t i = 0; i < sizeof t / sizeof *t; ++i) {
+		struct sflight s;
+		int e = sflight_init(&s, &t[i].cfg);
+		if (e)
+			return e;
+
+		struct sink k;
+		enum sflight_role role = sflight_lead;
+		for (size_t j = 0; !e && j < t[i].keys; ++j)
+			e = ask(&s, j, events, 0, 200, &k, &role);
+		if (!e) {
+			sleep_us(t[i].sleep);
+			e = ask(&s, t[i].again, events, 0, 200, &k, &role);
+		}
+		struct sflight_stats st = sflight_stats(&s);
+		sflight_fini(&s);
+		if (!e && (role != t[i].role ||
+		           k.hash != direct(t[i].again, events, 200))) {
+			pr_err_("LRU case %zu: role %d, %zu kept, %zu evicted",
+			        i, (int)role, st.entries, st.evicted);
+			e = EPROTO;
+		}
+		if (e)
+			return e;
+	}
+	pr_out("LRU: eviction by count, size and age");
+	return 0;
+}
+
+int
+main (int    c,
+      char **v)
+{
+	struct letopt opt = letopt_init(c, v);
+
+	if (letopt_nargs(&opt) || opt.m_help)
+		letopt_helpful_exit(&opt);
+
+	struct shared sh = {
+		.keys     = (size_t)opt.m_keys,
+		.requests = (size_t)opt.m_requests,
+		.events   = (size_t)opt.m_events,
+		.gap      = (uint32_t)opt.m_gap,
+	};
+	size_t jobs = (size_t)opt.m_jobs;
+	uint64_t *want = calloc(sh.keys, sizeof *want);
+	sh.upstream = calloc(sh.keys, sizeof *sh.upstream);
+	struct client *cl = calloc(jobs, sizeof *cl);
+	struct sflight s;
+	int e = want && sh.upstream && cl ? 0 : ENOMEM;
+	if (!e)
+		e = sflight_init(&s, &(struct sflight_cfg){
+			.ttl_ms = (uint32_t)opt.m_ttl,
+		});
+	if (e) {
+		pr_errno_(e, "sflight_init");
+		free(cl);
+		free(sh.upstream);
+		free(want);
+		(void)letopt_fini(&opt);
+		return EXIT_FAILURE;
+	}
+
+	for (size_t i = 0; i < sh.keys; ++i)
+		want[i] = direct(i, sh.events, 200);
+	sh.s = &s;
+	sh.want = want;
+
+	size_t started = 0;
+	for (; started < jobs; ++started) {
+		cl[started] = (struct client){
+			.sh   = &sh,
+			.seed = 0x9e3779b97f4a7c15U * (started + 1U),
+		};
+		e = pthread_create(&cl[started].tid, nullptr, client_main,
+		                   &cl[started]);
+		if (e) {
+			pr_errno_(e, "pthread_create");
+			break;
+		}
+	}
+	uint64_t t0 = mono_us();
+	__atomic_store_n(&sh.go, 1U, __ATOMIC_RELEASE);
+	for (size_t i = 0; i < started; ++i)
+		(void)pthread_join(cl[i].tid, nullptr);
+	uint64_t t1 = mono_us();
+
+	struct sflight_stats st = sflight_stats(&s);
+	sflight_fini(&s);
+
+	size_t total = started * sh.requests, upstream = 0;
+	for (size_t i = 0; i < sh.keys; ++i)
+		upstream += sh.upstream[i];
+	pr_out("%zu requests in %.1f ms: %zu upstream, %zu followed, "
+	       "%zu kept, %zu evicted", total, (double)(t1 - t0) / 1e3,
+	       upstream, st.followers, st.hits, st.evicted);
+
+	if (!e && sh.bad)
+		e = EPROTO;
+	if (!e && (upstream != st.leaders ||
+	           st.leaders + st.followers + st.hits != total ||
+	           st.entries > sh.keys)) {
+		pr_err_("%zu leaders, %zu upstream, %zu kept",
+		        st.leaders, upstream, st.entries);
+		e = EPROTO;
+	}
+	if (!e && started > 1U && total >= 2U * sh.keys &&
+	    (!st.followers || upstream * 2U > total)) {
+		pr_err_("%zu of %zu requests went upstream", upstream, total);
+		e = EPROTO;
+	}
+
+	if (!e)
+		e = check_failed();
+	if (!e)
+		e = check_lru(sh.events);
+
+	free(cl);
+	free(sh.upstream);
+	free(want);
+	(void)letopt_fini(&opt);
+	return e ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -12,23 +12,105 @@ diag_apple_clang(ignored "-Wpadded")
 
 diag_apple_clang(pop)
 
+#include <time.h>
+
+#include "arena.h"
 #include "dbg.h"
 #include "dstr.h"
-#include "file.h"
+#include "fstream.h"
+#include "jtape.h"
+#include "jwriter.h"
 #include "version.h"
 
+/**
+ * @brief Minimum time spent benchmarking each parser on each file.
+ */
+#define BENCH_NSEC 20000000U
+
+static uint64_t
+now_ns (void)
+{
+	struct timespec ts = {0};
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Compare the throughput of cJSON, with and without an arena,
+ *        and the tape parser. Also measure how fast the tape can be
+ *        serialized back into a reused string.
+ */
+static void
+bench (char const     *path,
+       struct file_in *f,
+       struct arena   *m,
+       struct jtape   *t)
+{
+	struct jwriter w;
+	dstr s = {0};
+	double mb = (double)f->size / 1e6;
+	char const *txt = file_text(f);
+	struct arena *prev = arena_use(nullptr);
+	uint64_t n = 0, dt, t0 = now_ns();
+	do {
+		cJSON_Delete(cJSON_Parse(txt));
+		++n;
+	} while ((dt = now_ns() - t0) < BENCH_NSEC);
+	double a = mb * (double)n * 1e9 / (double)dt;
+
+	(void)arena_use(m);
+	n = 0;
+	t0 = now_ns();
+	do {
+		(void)cJSON_Parse(txt);
+		arena_reset(m);
+		++n;
+	} while ((dt = now_ns() - t0) < BENCH_NSEC);
+	double b = mb * (double)n * 1e9 / (double)dt;
+	(void)arena_use(prev);
+
+	n = 0;
+	t0 = now_ns();
+	do {
+		(void)jtape_parse(t, f->data, f->size);
+		++n;
+	} while ((dt = now_ns() - t0) < BENCH_NSEC);
+	double c = mb * (double)n * 1e9 / (double)dt;
+
+	n = 0;
+	t0 = now_ns();
+	do {
+		jwriter_init(&w, &s, 0);
+		(void)jwriter_tape(&w, t, 1U);
+		if (jwriter_end(&w))
+			break;
+		++n;
+	} while ((dt = now_ns() - t0) < BENCH_NSEC);
+	double d = (double)s.len / 1e6 * (double)n * 1e9 / (double)dt;
+	dstr_fini(&s);
+
+	pr_out("%s: cJSON %.1f MB/s, cJSON+arena %.1f MB/s, jtape %.1f MB/s, "
+	       "jwriter %.1f MB/s", path, a, b, c, d);
+}
+
 int
 main (int    argc,
       char **argv)
 {
 	int ret = EXIT_SUCCESS;
+	struct arena m = {0};
+	struct jtape t = {0};
 	pr_out("%s / %s", canth_c_version(), canth_cxx_version());
 
+	cJSON_InitHooks(&(cJSON_Hooks){.malloc_fn = arena_hook_malloc,
+	                               .free_fn   = arena_hook_free});
+	(void)arena_use(&m);
+
 	for (int i = 0; ++i < argc;) {
-		struct file_in f = file_read(argv[i]);
+		struct file_in f = fstream_read(argv[i]);
 		int e = file_error(&f);
 		if (e) {
-			pr_errno(e, "file_read");
+			pr_errno(e, "fstream_read");
 			ret = EXIT_FAILURE;
 			continue;
 		}
@@ -58,11 +140,21 @@ main (int    argc,
 				}
 			}
 		} else {
-			cJSON_Delete(json);
+			e = jtape_parse(&t, f.data, f.size);
+			if (e)
+				pr_wrrno_(e, "%s: jtape_parse: offset %zu",
+				          argv[i], t.error);
+			else
+				bench(argv[i], &f, &m, &t);
 		}
 
+		arena_reset(&m);
 		file_in_fini(&f);
 	}
 
+	(void)arena_use(nullptr);
+	cJSON_InitHooks(nullptr);
+	arena_fini(&m);
+	jtape_fini(&t);
 	return ret;
 }
@@ -433,3 +433,170 @@ utf8_parse_next_code_point (struct utf8 *const  u8p,
 
 	return ptr;
 }
+
+/**
+ * @brief Check if a parser state allows an ASCII byte to follow.
+ */
+static const_inline bool
+utf8_st8_at_boundary (enum utf8_st8 st8)
+{
+	return st8 == utf8_asc || st8 == utf8_cb1 || st8 == utf8_ini;
+}
+
+/**
+ * @brief Check eight bytes at once for non-ASCII and carriage returns.
+ *
+ * @param v    Eight input bytes.
+ * @param crlf Whether carriage returns need special handling.
+ * @return `true` if all bytes can be copied as they are.
+ */
+static const_inline bool
+utf8_swar_plain (uint64_t v,
+                 bool     crlf)
+{
+	constexpr uint64_t ones = UINT64_C(0x0101010101010101);
+	constexpr uint64_t high = UINT64_C(0x8080808080808080);
+
+	if (v & high)
+		return false;
+
+	/* With every high bit clear, this is nonzero
+	 * only if some byte of `v ^ '\r'` is zero.
+	 */
+	v ^= ones * '\r';
+	return !crlf || !((v - ones) & ~v & high);
+}
+
+size_t
+utf8_text_scan (struct utf8_text *const t,
+                uint8_t                *dst,
+                uint8_t const          *src,
+                size_t                  len)
+{
+	uint8_t *const start = dst;
+	enum utf8_st8 st8 = (enum utf8_st8)t->st8;
+	size_t chars = t->chars;
+	size_t i = 0;
+
+	while (i < len) {
+		bool valid = t->error == SIZE_MAX;
+
+		if (!t->cr && (!valid || utf8_st8_at_boundary(st8))) {
+			size_t k = i;
+			for (; len - k >= 8U; k += 8U) {
+				uint64_t v;
+				__builtin_memcpy(&v, &src[k], 8U);
+				if (!utf8_swar_plain(v, t->crlf))
+					break;
+				__builtin_memcpy(dst, &v, 8U);
+				dst += 8U;
+			}
+
+			if (k != i) {
+				if (valid) {
+					chars += k - i;
+					st8 = utf8_asc;
+				}
+				i = k;
+				if (i == len)
+					break;
+			}
+		}
+
+		uint8_t b = src[i++];
+
+		if (valid) {
+			uint16_t next = utf8_lut[b] & utf8_dst[st8];
+			if (next) {
+				st8 = (enum utf8_st8)__builtin_ctz(next);
+				chars += st8 == utf8_asc || st8 == utf8_cb1;
+			} else {
+				t->error = t->offset + i - 1U;
+			}
+		}
+
+		if (t->cr) {
+			t->cr = false;
+			if (b == '\n')
+				chars -= valid; /* CR was counted */
+			else
+				*dst++ = '\r';
+		}
+
+		if (b == '\r' && t->crlf) {
+			t->cr = true;
+			continue;
+		}
+
+		*dst++ = b;
+	}
+
+	t->chars = chars;
+	t->st8 = st8;
+	t->offset += len;
+	return (size_t)(dst - start);
+}
+
+bool
+utf8_text_check (struct utf8_text *const t,
+                 uint8_t const          *src,
+                 size_t                  len)
+{
+	enum utf8_st8 st8 = (enum utf8_st8)t->st8;
+	size_t chars = t->chars;
+	size_t i = 0;
+
+	while (t->error == SIZE_MAX && i < len) {
+		if (utf8_st8_at_boundary(st8)) {
+			size_t k = i;
+			for (; len - k >= 8U; k += 8U) {
+				uint64_t v;
+				__builtin_memcpy(&v, &src[k], 8U);
+				if (!utf8_swar_plain(v, false))
+					break;
+			}
+
+			if (k != i) {
+				chars += k - i;
+				st8 = utf8_asc;
+				i = k;
+				if (i == len)
+					break;
+			}
+		}
+
+		uint16_t next = utf8_lut[src[i]] & utf8_dst[st8];
+		if (!next) {
+			t->error = t->offset + i;
+			break;
+		}
+
+		st8 = (enum utf8_st8)__builtin_ctz(next);
+		chars += st8 == utf8_asc || st8 == utf8_cb1;
+		++i;
+	}
+
+	t->chars = chars;
+	t->st8 = st8;
+	t->offset += len;
+	return t->error == SIZE_MAX;
+}
+
+size_t
+utf8_text_end (struct utf8_text *const t,
+               uint8_t                *dst)
+{
+	size_t n = 0;
+
+	if (t->cr) {
+		t->cr = false;
+		dst[n++] = '\r';
+	}
+
+	if (t->error == SIZE_MAX &&
+	    !utf8_st8_at_boundary((enum utf8_st8)t->st8))
+		t->error = t->offset;
+
+	t->st8 = utf8_ini;
+	return n;
+}
@@ -227,4 +227,141 @@ utf8_expects_leading_byte (struct utf8 const *const u8p)
 	return u8p->state & (utf8_bit(asc) | utf8_bit(cb1) | utf8_bit(ini));
 }
 
+/**
+ * @brief Bulk UTF-8 text scanner state.
+ *
+ * Keeps what @ref utf8_text_scan() needs to resume in the middle of a
+ * multi-byte sequence or a CRLF pair, so input can be fed in arbitrary
+ * chunks as it arrives.
+ */
+struct utf8_text {
+	size_t  chars;  //!< Code points written, up to the first error.
+	size_t  offset; //!< Input offset of the next byte.
+	size_t  error;  //!< Input offset of the first invalid byte,
+	                //!< or `SIZE_MAX` if none was found.
+	uint8_t st8;    //!< Parser state as a @ref utf8_st8 value.
+	bool    crlf;   //!< Convert CRLF line endings to LF.
+	bool    cr;     //!< A carriage return is being held back.
+};
+
+/**
+ * @brief UTF-8 text scanner RAII initializer.
+ * @param crlf Whether to convert CRLF line endings to LF.
+ * @return A UTF-8 text scanner object by value.
+ */
+static const_inline
+struct utf8_text utf8_text (bool crlf)
+{
+	return (struct utf8_text) {
+		.chars  = 0,
+		.offset = 0,
+		.error  = SIZE_MAX,
+		.st8    = utf8_ini,
+		.crlf   = crlf,
+		.cr     = false,
+	};
+}
+
+/**
+ * @brief Validate, count, and copy a chunk of UTF-8 text in one pass.
+ *
+ * ASCII runs are handled eight bytes at a time; everything else goes
+ * through the same state machine as @ref utf8_parse_next_code_point().
+ * Validation stops at the first invalid byte, whose input offset is
+ * stored in @ref utf8_text::error, but copying and line ending
+ * conversion continue to the end of the input.
+ *
+ * @p dst may be equal to @p src or point anywhere before it in the
+ * same buffer, which makes in-place normalization possible.
+ *
+ * @param t   Scanner state.
+ * @param dst Output buffer with room for at least `len + 1` bytes.
+ * @param src Input buffer.
+ * @param len Length of @p src.
+ * @return Number of bytes written to @p dst.
+ */
+extern size_t
+utf8_text_scan (struct utf8_text *t,
+                uint8_t          *dst,
+                uint8_t const    *src,
+                size_t            len) nonnull_in();
+
+/**
+ * @brief Validate a chunk of UTF-8 without copying it.
+ *
+ * Works like @ref utf8_text_scan() with line ending conversion off,
+ * except that nothing is written anywhere.
+ *
+ * @param t   Scanner state.
+ * @param src Input buffer.
+ * @param len Length of @p src.
+ * @return `true` if no invalid byte has been found so far.
+ */
+extern bool
+utf8_text_check (struct utf8_text *t,
+                 uint8_t const    *src,
+                 size_t            len) nonnull_in();
+
+/**
+ * @brief Check if a text scan is between code points.
+ */
+nonnull_in()
+static force_inline bool
+utf8_text_at_boundary (struct utf8_text const *t)
+{
+	return t->st8 == utf8_asc || t->st8 == utf8_cb1 || t->st8 == utf8_ini;
+}
+
+/**
+ * @brief Finish a text scan.
+ *
+ * Flushes a held-back carriage return and flags a truncated trailing
+ * multi-byte sequence as invalid at the end of the input.
+ *
+ * @param t   Scanner state.
+ * @param dst Output buffer with room for at least one byte.
+ * @return Number of bytes written to @p dst.
+ */
+extern size_t
+utf8_text_end (struct utf8_text *t,
+               uint8_t          *dst) nonnull_in();
+
+/**
+ * @brief Encode a code point as UTF-8.
+ *
+ * @param cp  Unicode scalar value, i.e. at most 0x10ffff and not a
+ *            surrogate. Not checked.
+ * @param dst Output buffer with room for at least 4 bytes.
+ * @return Number of bytes written to @p dst.
+ */
+nonnull_in()
+static force_inline size_t
+utf8_encode (uint32_t  cp,
+             uint8_t  *dst)
+{
+	if (cp < 0x80U) {
+		dst[0] = (uint8_t)cp;
+		return 1U;
+	}
+
+	if (cp < 0x800U) {
+		dst[0] = (uint8_t)(0xc0U | (cp >> 6U));
+		dst[1] = (uint8_t)(0x80U | (cp & 0x3fU));
+		return 2U;
+	}
+
+	if (cp < 0x10000U) {
+		dst[0] = (uint8_t)(0xe0U | (cp >> 12U));
+		dst[1] = (uint8_t)(0x80U | ((cp >> 6U) & 0x3fU));
+		dst[2] = (uint8_t)(0x80U | (cp & 0x3fU));
+		return 3U;
+	}
+
+	dst[0] = (uint8_t)(0xf0U | (cp >> 18U));
+	dst[1] = (uint8_t)(0x80U | ((cp >> 12U) & 0x3fU));
+	dst[2] = (uint8_t)(0x80U | ((cp >> 6U) & 0x3fU));
+	dst[3] = (uint8_t)(0x80U | (cp & 0x3fU));
+	return 4U;
+}
+
 #endif /* LIBCANTH_SRC_UTF8_H_ */